@@ -489,6 +489,35 @@ xytoij_tree_t *grid_xytoij_init(double **gx, double **gy, int nce1,
 }
 
 
+/** Creates a copy of a xytoij_tree_t for use by another thread. The
+  * copy shares the partition and grid coordinates, but has no hash
+  * table, which is the only state grid_xytoij() modifies.
+  *
+  * @param partition a xytoij_tree_t structure returned from xytoij_init.
+  * @return copy to be destroyed with grid_xytoij_clone_destroy().
+  */
+xytoij_tree_t *grid_xytoij_clone(xytoij_tree_t *partition)
+{
+  xytoij_tree_t *tree = (xytoij_tree_t *)malloc(sizeof(xytoij_tree_t));
+
+  memcpy(tree, partition, sizeof(xytoij_tree_t));
+  tree->ht = NULL;
+
+  return tree;
+}
+
+
+/** Destroys a copy made by grid_xytoij_clone(). The shared partition
+  * is left untouched.
+  *
+  * @param tree copy to be destroyed.
+  */
+void grid_xytoij_clone_destroy(xytoij_tree_t *tree)
+{
+  free(tree);
+}
+
+
 /** calculates the indices (i,j) of a topologically rectangular
   * grid cell containing the point (x,y).
   *
@@ -41,6 +41,15 @@ bal* bal_build(delaunay* d);
  */
 void bal_destroy(bal* l);
 
+/* Copies an interpolator for use by another thread. The copy shares
+ * the weights of `l' and locates points in `d'.
+ *
+ * @param l Interpolator to copy
+ * @param d Triangulation for the copy (see delaunay_clone())
+ * @return Copy to be released with free()
+ */
+bal* bal_clone(bal* l, delaunay* d);
+
 /* Finds baycentric interpolated value in a point.
  *
  * @param l Linear interpolation
@@ -41,6 +41,15 @@ bl* bl_build(delaunay* d);
  */
 void bl_destroy(bl* l);
 
+/* Copies an interpolator for use by another thread. The copy shares
+ * the weights of `l' and locates points in `d'.
+ *
+ * @param l Interpolator to copy
+ * @param d Triangulation for the copy (see delaunay_clone())
+ * @return Copy to be released with free()
+ */
+bl* bl_clone(bl* l, delaunay* d);
+
 /* Finds linearly interpolated value in a point.
  *
  * @param l Linear interpolation
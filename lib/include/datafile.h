@@ -24,7 +24,7 @@
 typedef enum { DFT_ASCII, DFT_NETCDF, DFT_MULTI_NETCDF } DataFileType;
 */
 /* MH mempack */
-typedef enum { DFT_ASCII, DFT_NETCDF, DFT_MULTI_NETCDF, DFT_MEMPACK} DataFileType;
+typedef enum { DFT_ASCII, DFT_NETCDF, DFT_MULTI_NETCDF, DFT_MEMPACK, DFT_SHMPACK} DataFileType;
 typedef enum { AT_TEXT, AT_BYTE, AT_FLOAT, AT_DOUBLE, AT_SHORT, AT_INT }
   AttributeType;
 
@@ -163,8 +163,16 @@ typedef struct {
   char xyzunits[MAXSTRLEN];     /* Position units */
   double *v2d;                  /* 2d variables */
   double *v3d;                  /* 3d variables */
+  void *shm;                    /* Shared memory segment (shmpack only) */
+  size_t shmsize;               /* Size of the shared memory segment */
+  long seq;                     /* Last shared memory record used */
+  int shmrd;                    /* Reader entry in the segment */
+  long shmino;                  /* Inode of the mapped segment */
 } df_mempack_t;
 
+/* Memory packets of either transport */
+#define DF_IS_MEMPACK(df) ((df)->type == DFT_MEMPACK || (df)->type == DFT_SHMPACK)
+
 typedef struct {
   int nz;
   int *kn, **kmap;
@@ -282,6 +290,7 @@ struct df_variable {
   GRID_SPECS *gs1_master_2d;
   GRID_SPECS **gs0_master_3d;
   GRID_SPECS **gs1_master_3d;
+  void *us_wts;                 /* Geometric weights for interp_us_2d/3d */
   int nz;
   int *kn, **kmap, **kflag;
   int **kmapi, **kmapj;
@@ -428,6 +437,7 @@ struct datafile {
   char i_rule[MAXSTRLEN];       /* Interpolation rule */
   void *private_data;           /* Private data for the reader */
   void *vtrans;                 /* Vertical coordinate transform */
+  void *prefetch;               /* Read-ahead state (dfprefetch.c) */
   /*
    *  These hashtables facilitate the inverse weighting interpolation
    *  routines for performance
@@ -471,6 +481,14 @@ void df_fixup_variable_sign(datafile_t *df, int vid);
 int df_eval_period(datafile_t *df, int vid, double r, double dr, double **ptr);
 double df_get_data_value(datafile_t *df, df_variable_t *v, int record,
                          int *is);
+double *df_get_record_data(datafile_t *df, df_variable_t *v, int record);
+void df_free_us_weights(df_variable_t *v);
+int df_linear_weights(datafile_t *df, df_variable_t *v, double coords[],
+		      int *offsets, double *weights);
+
+/* Shared memory memory packets */
+void shmpack_write(df_mempack_t *mp, char *name);
+void shmpack_close(df_mempack_t *mp);
 
 int df_set_coord_system(datafile_t *df, df_variable_t *v,
                         int ncr, df_coord_mapping_t *requests);
@@ -529,6 +547,16 @@ extern "C" {
 void nc_buffered_get_vara_double(int ncid, df_variable_t *v, int varid, 
 				 size_t start[], size_t count[], double *var);
 void nc_buffered_clean_up_all_vars(datafile_t *df);
+void df_nc_lock(void);
+void df_nc_unlock(void);
+int df_nc_release(void);
+void df_nc_restore(int depth);
+void df_nc_yield(void);
+void df_prefetch_set_threads(int n);
+void df_prefetch_init(datafile_t *df, double dt, size_t budget);
+int df_prefetch_get(datafile_t *df, df_variable_t *v, int r);
+void df_prefetch_schedule(datafile_t *df, df_variable_t *v, int r);
+void df_prefetch_free(datafile_t *df);
 #ifdef __cplusplus
 }
 #endif
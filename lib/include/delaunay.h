@@ -108,6 +108,18 @@ delaunay* delaunay_create();
  */
 void delaunay_destroy(delaunay* d);
 
+/* Creates a shallow copy of a Delaunay triangulation for point
+ * location. The copy shares the points, triangles and neighbours of
+ * `d' but has its own search seed (first_id) and vid, so that several
+ * threads can locate points in the same triangulation concurrently.
+ * The circle search work data is not usable through the copy.
+ *
+ * @param d Delaunay triangulation
+ * @return Copy to be destroyed with delaunay_clone_destroy()
+ */
+delaunay* delaunay_clone(delaunay* d);
+void delaunay_clone_destroy(delaunay* d);
+
 
 /* Finds triangle specified point belongs to (if any).
  *
@@ -99,6 +99,7 @@ double wgt_gaussian(double x, double scale);
 double wgt_gaussian_2d(double x, double y, double scale);
 double drandom(double min, double max);
 float ran3(int *init);
+double ran_ctr(unsigned long seed, unsigned long id, unsigned long ctr);
 
 
 
@@ -149,6 +149,8 @@ int grid_interp(GRID_SPECS *gs);
 GRID_SPECS *grid_spec_create(void);
 void grid_specs_destroy(GRID_SPECS *gs);
 void grid_spec_init(GRID_SPECS *gs);
+GRID_SPECS *grid_spec_clone(GRID_SPECS *gs);
+void grid_spec_clone_destroy(GRID_SPECS *gs);
 
 /* Convenient wrapper functions */
 GRID_SPECS *grid_interp_init(double *x, double *y, double *z, int npoints,
@@ -26,6 +26,13 @@ typedef void (*intout) (int nstep, int n, double x, double *y, void *p);
 typedef void (*intfinal) (int n, double x, double *y, double *y1,
                           int naccpt, int nrejct, int nfcn, void *p);
 
+typedef void (*derivfn_batch) (int nl, int *active, double *t, double *y,
+                               double *y1, void *p);
+
+typedef void (*intfinal_batch) (int l, int n, double x, double *y,
+                                double *y1, int naccpt, int nrejct,
+                                int nfcn, void *p);
+
 typedef int (*integrator) (derivfn calc, int n, double x, double *y0,
                            double xend, double eps, double hmax, double *h,
                            intout out, intfinal final, void *p);
@@ -38,6 +45,10 @@ int dopri5(derivfn calc, int n, double x, double *y, double xend,
            double eps, double hmax, double *h0, intout out, intfinal final,
            void *custom_data);
 
+int dopri5_batch(derivfn_batch calc, int n, int nl, double x, double **y,
+                 double xend, double eps, double hmax, double **h0,
+                 intfinal_batch final, void *custom_data, int *status);
+
 int adapt1(derivfn calc, int n, double x, double *y, double xend,
            double eps, double hmax, double *h0, intout out, intfinal final,
            void *custom_data);
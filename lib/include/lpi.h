@@ -41,6 +41,15 @@ lpi* lpi_build(delaunay* d);
  */
 void lpi_destroy(lpi* l);
 
+/* Copies an interpolator for use by another thread. The copy shares
+ * the weights of `l' and locates points in `d'.
+ *
+ * @param l Interpolator to copy
+ * @param d Triangulation for the copy (see delaunay_clone())
+ * @return Copy to be released with free()
+ */
+lpi* lpi_clone(lpi* l, delaunay* d);
+
 /* Finds linearly interpolated value in a point.
  *
  * @param l Linear interpolation
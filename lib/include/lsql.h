@@ -56,6 +56,15 @@ lsql* lsql_build(delaunay* d);
  */
 void lsql_destroy(lsql* l);
 
+/* Copies an interpolator for use by another thread. The copy shares
+ * the weights of `l' and locates points in `d'.
+ *
+ * @param l Interpolator to copy
+ * @param d Triangulation for the copy (see delaunay_clone())
+ * @return Copy to be released with free()
+ */
+lsql* lsql_clone(lsql* l, delaunay* d);
+
 /* Finds linearly interpolated value in a point.
  *
  * @param l Linear interpolation
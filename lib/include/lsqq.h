@@ -57,6 +57,15 @@ lsqq* lsqq_build(delaunay* d);
  */
 void lsqq_destroy(lsqq* l);
 
+/* Copies an interpolator for use by another thread. The copy shares
+ * the weights of `l' and locates points in `d'.
+ *
+ * @param l Interpolator to copy
+ * @param d Triangulation for the copy (see delaunay_clone())
+ * @return Copy to be released with free()
+ */
+lsqq* lsqq_clone(lsqq* l, delaunay* d);
+
 /* Finds linearly interpolated value in a point.
  *
  * @param l Linear interpolation
@@ -98,4 +98,5 @@ int ncw_var_size(int fid, int vid);
 void ncw_var_read(int fid, char *name, int size, long *start, long *count,
                   void *buf);
 void ncw_def_var_chunking(const char fname[], int ncid, int varid, size_t *chunksize);
+void ncw_def_var_deflate(const char fname[], int ncid, int varid, int shuffle, int level);
 #endif
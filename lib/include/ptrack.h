@@ -33,6 +33,23 @@ typedef struct {
   double svel;
 } particle_t;
 
+/* Structure of arrays particle store: one contiguous array per
+   particle attribute, indexed by particle number. */
+typedef struct {
+  long np;                      /* Number of particles */
+  double *e1;                   /* x location */
+  double *e2;                   /* y location */
+  double *e3;                   /* z location */
+  int *c;                       /* Mesh index */
+  short *flag;                  /* Status flags */
+  int *dumpf;                   /* Output flags */
+  double *age;                  /* Age (s) */
+  unsigned char *out_age;       /* Scaled age for output */
+  double *size;                 /* Size */
+  unsigned char *out_size;      /* Scaled size for output */
+  double *svel;                 /* Settling velocity */
+} pt_store_t;
+
 #define PT_ACTIVE 0x001
 #define PT_LOST   0x002
 #define PT_AGE    0x004
@@ -47,5 +64,10 @@ void pt_read(char *name, int rec, long *np, particle_t **p, double *t,
              char *t_units, int *ndump);
 void pt_write(int fid, int rec, double t, long np, particle_t *p);
 void pt_write_a(int fid, int rec, double t, long np, particle_t *p);
+pt_store_t *pt_store_alloc(long np);
+void pt_store_free(pt_store_t *ps);
+void pt_read_s(char *name, int rec, pt_store_t **ps, double *t,
+               char *t_units, int *ndump);
+void pt_write_s(int fid, int rec, double t, pt_store_t *ps);
 
 #endif                          /* _PTRACK_H */
@@ -54,6 +54,8 @@ xytoij_tree_t *grid_xytoij_init(double **gx, double **gy, int nce1,
                                 int nce2);
 xytoij_tree_t *grid_xytoij_init_hash(double **gx, double **gy, int nce1,
                                      int nce2, int hsize);
+xytoij_tree_t *grid_xytoij_clone(xytoij_tree_t *partition);
+void grid_xytoij_clone_destroy(xytoij_tree_t *tree);
 int grid_xytoij(xytoij_tree_t *partition, double x, double y, int *ival,
                 int *jval);
 int grid_ijtoxy(xytoij_tree_t *partition, int ival, int jval, double *x,
@@ -480,6 +480,38 @@ void delaunay_destroy(delaunay* d)
     free(d);
 }
 
+/* Creates a shallow copy of a Delaunay triangulation for point
+ * location by another thread.
+ *
+ * @param d Delaunay triangulation
+ * @return Copy sharing the triangulation of `d'
+ */
+delaunay* delaunay_clone(delaunay* d)
+{
+    delaunay* dc = malloc(sizeof(delaunay));
+
+    memcpy(dc, d, sizeof(delaunay));
+    dc->flags = NULL;
+    dc->t_in = NULL;
+    dc->t_out = NULL;
+    dc->flagids = NULL;
+    dc->nflags = 0;
+    dc->nflagsallocated = 0;
+
+    return dc;
+}
+
+/* Destroys a copy made by delaunay_clone(). The shared triangulation
+ * is left untouched.
+ *
+ * @param d Copy to be destroyed
+ */
+void delaunay_clone_destroy(delaunay* d)
+{
+    if (d != NULL)
+        free(d);
+}
+
 /* Returns whether the point p is on the right side of the vector (p0, p1).
  */
 static int onrightside(point* p, point* p0, point* p1)
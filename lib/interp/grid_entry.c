@@ -301,6 +301,56 @@ void grid_specs_destroy(GRID_SPECS *gs)
   free_1d(gs);
 }
 
+/*
+ * Copies a grid spec for use by another thread. The copy shares the
+ * interpolation weights and data of gs, so a rebuild of gs is seen
+ * by the copy, but has its own triangle search seed, Delaunay id and
+ * variable id. Only rules whose point interpolation has no other
+ * shared state can be copied; NULL is returned for the rest.
+ */
+GRID_SPECS *grid_spec_clone(GRID_SPECS *gs)
+{
+  INTERP_RULE rule = gs->type;
+  GRID_SPECS *gc;
+  delaunay *d;
+  void *interpolator;
+
+  if (rule != GRID_LINEAR && rule != GRID_BL && rule != GRID_BAL &&
+      rule != GRID_LSQQ && rule != GRID_LSQL)
+    return(NULL);
+
+  d = delaunay_clone(gs->d);
+  if (rule == GRID_LINEAR)
+    interpolator = lpi_clone(gs->interpolator, d);
+  else if (rule == GRID_BL)
+    interpolator = bl_clone(gs->interpolator, d);
+  else if (rule == GRID_BAL)
+    interpolator = bal_clone(gs->interpolator, d);
+  else if (rule == GRID_LSQQ)
+    interpolator = lsqq_clone(gs->interpolator, d);
+  else
+    interpolator = lsql_clone(gs->interpolator, d);
+
+  gc = (GRID_SPECS *)alloc_1d(1, sizeof(GRID_SPECS));
+  memcpy(gc, gs, sizeof(GRID_SPECS));
+  gc->interpolator = interpolator;
+  gc->d = d;
+  gc->destroy_pbathy = 0;
+  gc->destroy_delaunay = 0;
+
+  return gc;
+}
+
+/*
+ * Destroys a copy made by grid_spec_clone()
+ */
+void grid_spec_clone_destroy(GRID_SPECS *gs)
+{
+  free(gs->interpolator);
+  delaunay_clone_destroy(gs->d);
+  free_1d(gs);
+}
+
 /*
  * Main entry function for standalone executable, the library should
  * call the _interp_on_point routine
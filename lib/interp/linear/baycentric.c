@@ -298,6 +298,24 @@ void bal_destroy(bal* l)
     free(l);
 }
 
+/* Copies an interpolator for use by another thread. The copy shares
+ * the weights of `l', but locates points in `d', normally a copy of
+ * the triangulation made with delaunay_clone().
+ *
+ * @param l Interpolator to copy
+ * @param d Triangulation for the copy
+ * @return Copy to be released with free()
+ */
+bal* bal_clone(bal* l, delaunay* d)
+{
+    bal* lc = malloc(sizeof(bal));
+
+    memcpy(lc, l, sizeof(bal));
+    lc->d = d;
+
+    return lc;
+}
+
 /* Finds linear baycentric interpolated value in a point.
  *
  * @param l Baycentric interpolation
@@ -308,7 +326,7 @@ void bal_interpolate_point(bal* l, point* p)
   int i, j;
   delaunay* d = l->d;
   lweights *lw, *lws;
-  double v, z0;
+  double v, z0, tmx, tmn;
   int id = (int)p->x;
   int ids = (int)p->y;
   int vid = d->vid;
@@ -318,18 +336,18 @@ void bal_interpolate_point(bal* l, point* p)
   lws = &l->weights[ids];
 
   v = 0.0;
-  lw->tmx = -1e10;
-  lw->tmn = 1e10;
+  tmx = -1e10;
+  tmn = 1e10;
   for (i = 0; i < 3; i++) {
     idt = lw->idt;
     j = lws->cells[lws->tri[idt][i]];
     z0 = (j == -1) ?  d->points[ids].v[vid] : d->points[j].v[vid];
     v += lw->w[i] * z0;
     /*if(id==623&&vid==3)printf("interp %d %d i=%d j=%d w=%f z0=%f %f\n",ids,idt,i,j,lw->w[i],z0,v);*/
-    lw->tmx = max(lw->tmx, z0);
-    lw->tmn = min(lw->tmn, z0);
+    tmx = max(tmx, z0);
+    tmn = min(tmn, z0);
   }
-  v = min(lw->tmx, max(lw->tmn, v));
+  v = min(tmx, max(tmn, v));
   p->z = v;
 }
 
@@ -339,7 +357,7 @@ void bal_interpolate_point2(bal* l1, bal* l2, point* p)
   int i, j;
   delaunay* d = l2->d;
   lweights *lw, *lws;
-  double v, z0;
+  double v, z0, tmx, tmn;
   int id = (int)p->x;
   int ids = (int)p->y;
   int vid = d->vid;
@@ -349,18 +367,18 @@ void bal_interpolate_point2(bal* l1, bal* l2, point* p)
   lws = &l2->weights[ids];
 
   v = 0.0;
-  lw->tmx = -1e10;
-  lw->tmn = 1e10;
+  tmx = -1e10;
+  tmn = 1e10;
   for (i = 0; i < 3; i++) {
     idt = lw->idt;
     j = lws->cells[lws->tri[idt][i]];
     z0 = (j == -1) ?  d->points[ids].v[vid] : d->points[j].v[vid];
     v += lw->w[i] * z0;
     /*if(id==623&&vid==3)printf("interp %d %d i=%d j=%d w=%f z0=%f %f\n",ids,idt,i,j,lw->w[i],z0,v);*/
-    lw->tmx = max(lw->tmx, z0);
-    lw->tmn = min(lw->tmn, z0);
+    tmx = max(tmx, z0);
+    tmn = min(tmn, z0);
   }
-  v = min(lw->tmx, max(lw->tmn, v));
+  v = min(tmx, max(tmn, v));
   p->z = v;
 }
 
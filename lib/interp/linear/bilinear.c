@@ -277,6 +277,24 @@ void bl_destroy(bl* l)
     free(l);
 }
 
+/* Copies an interpolator for use by another thread. The copy shares
+ * the weights of `l', but locates points in `d', normally a copy of
+ * the triangulation made with delaunay_clone().
+ *
+ * @param l Interpolator to copy
+ * @param d Triangulation for the copy
+ * @return Copy to be released with free()
+ */
+bl* bl_clone(bl* l, delaunay* d)
+{
+    bl* lc = malloc(sizeof(bl));
+
+    memcpy(lc, l, sizeof(bl));
+    lc->d = d;
+
+    return lc;
+}
+
 /* Finds lsq quadratic interpolated value in a point.
  *
  * @param l Quadratic interpolation
@@ -287,7 +305,7 @@ void bl_interpolate_point(bl* l, point* p)
   int i, j;
   delaunay* d = l->d;
   lweights *lw, *lws;
-  double v, z0;
+  double v, z0, tmx, tmn;
   int id = (int)p->x;
   int ids = (int)p->y;
   int vid = d->vid;
@@ -296,17 +314,17 @@ void bl_interpolate_point(bl* l, point* p)
   lws = &l->weights[ids];
   /*  if (id==643)printf("lin3 %x %x\n",lw->cells,lws->cells);*/
   v = 0.0;
-  lw->tmx = -1e10;
-  lw->tmn = 1e10;
+  tmx = -1e10;
+  tmn = 1e10;
   for (i = 0; i < 4; i++) {
     j = lws->cells[lw->qa[i]];
     z0 = (j == -1) ?  d->points[ids].v[vid] : d->points[j].v[vid];
     v += lw->w[i] * z0;
     /*if(vid==3&&id==623)printf("interp i=%d qf=%d qa=%d cells=%d z0=%f w=%e v=%f\n",i,lw->qf,lw->qa[i],j,z0,lw->w[i],v);*/
-    lw->tmx = max(lw->tmx, z0);
-    lw->tmn = min(lw->tmn, z0);
+    tmx = max(tmx, z0);
+    tmn = min(tmn, z0);
   }
-  v = min(lw->tmx, max(lw->tmn, v));
+  v = min(tmx, max(tmn, v));
   p->z = v;
 }
 
@@ -315,7 +333,7 @@ void bl_interpolate_point2(bl* l1, bl* l2, point* p)
   int i, j;
   delaunay* d = l2->d;
   lweights *lw, *lws;
-  double v, z0;
+  double v, z0, tmx, tmn;
   int id = (int)p->x;
   int ids = (int)p->y;
   int vid = d->vid;
@@ -325,8 +343,8 @@ void bl_interpolate_point2(bl* l1, bl* l2, point* p)
   /*printf("a %x\n",lw->qa);*/
   /*if (lw->qa==NULL)return(d->points[ids].v[vid]);*/
   v = 0.0;
-  lw->tmx = -1e10;
-  lw->tmn = 1e10;
+  tmx = -1e10;
+  tmn = 1e10;
   for (i = 0; i < 4; i++) {
     /*printf(" a %d %d\n",i,lw->qa[i]);*/
     j = lws->cells[lw->qa[i]];
@@ -334,10 +352,10 @@ void bl_interpolate_point2(bl* l1, bl* l2, point* p)
     z0 = (j == -1) ?  d->points[ids].v[vid] : d->points[j].v[vid];
     v += lw->w[i] * z0;
     /*if(vid==3&&id==623)printf("interp i=%d qf=%d qa=%d cells=%d z0=%f w=%e v=%f\n",i,lw->qf,lw->qa[i],j,z0,lw->w[i],v);*/
-    lw->tmx = max(lw->tmx, z0);
-    lw->tmn = min(lw->tmn, z0);
+    tmx = max(tmx, z0);
+    tmn = min(tmn, z0);
   }
-  v = min(lw->tmx, max(lw->tmn, v));
+  v = min(tmx, max(tmn, v));
   p->z = v;
   /*printf("ok\n");*/
 }
@@ -25,6 +25,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "lpi.h"
 
 typedef struct {
@@ -177,6 +178,24 @@ void lpi_destroy(lpi* l)
     free(l);
 }
 
+/* Copies an interpolator for use by another thread. The copy shares
+ * the weights of `l', but locates points in `d', normally a copy of
+ * the triangulation made with delaunay_clone().
+ *
+ * @param l Interpolator to copy
+ * @param d Triangulation for the copy
+ * @return Copy to be released with free()
+ */
+lpi* lpi_clone(lpi* l, delaunay* d)
+{
+    lpi* lc = malloc(sizeof(lpi));
+
+    memcpy(lc, l, sizeof(lpi));
+    lc->d = d;
+
+    return lc;
+}
+
 /* Finds linearly interpolated value in a point.
  *
  * @param l Linear interpolation
@@ -298,6 +298,24 @@ void lsql_destroy(lsql* l)
     free(l);
 }
 
+/* Copies an interpolator for use by another thread. The copy shares
+ * the weights of `l', but locates points in `d', normally a copy of
+ * the triangulation made with delaunay_clone().
+ *
+ * @param l Interpolator to copy
+ * @param d Triangulation for the copy
+ * @return Copy to be released with free()
+ */
+lsql* lsql_clone(lsql* l, delaunay* d)
+{
+    lsql* lc = malloc(sizeof(lsql));
+
+    memcpy(lc, l, sizeof(lsql));
+    lc->d = d;
+
+    return lc;
+}
+
 /* Finds lsq quadratic interpolated value in a point.
  *
  * @param l Quadratic interpolation
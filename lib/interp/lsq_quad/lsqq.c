@@ -301,6 +301,24 @@ void lsqq_destroy(lsqq* l)
     free(l);
 }
 
+/* Copies an interpolator for use by another thread. The copy shares
+ * the weights of `l', but locates points in `d', normally a copy of
+ * the triangulation made with delaunay_clone().
+ *
+ * @param l Interpolator to copy
+ * @param d Triangulation for the copy
+ * @return Copy to be released with free()
+ */
+lsqq* lsqq_clone(lsqq* l, delaunay* d)
+{
+    lsqq* lc = malloc(sizeof(lsqq));
+
+    memcpy(lc, l, sizeof(lsqq));
+    lc->d = d;
+
+    return lc;
+}
+
 /* Finds lsq quadratic interpolated value in a point.
  *
  * @param l Quadratic interpolation
@@ -25,6 +25,15 @@
 #include <time.h>
 #include "netcdf.h"
 #include "ems.h"
+#ifdef HAVE_PTHREADS
+#include <fcntl.h>
+#include <unistd.h>
+#include <semaphore.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 static char *lon_names[7] = {
   "degrees_east",
@@ -84,6 +93,8 @@ static char *cs_names[2] = {
 void netcdf_read(int fid, datafile_t *df, int type);
 void netcdf_read_records(datafile_t *df, int varid);
 void netcdf_read_data(datafile_t *df, df_variable_t *v, int rec, int roffset);
+void netcdf_get_record(datafile_t *df, df_variable_t *v, int r,
+                       int roffset, double *data);
 void netcdf_free(datafile_t *df);
 void netcdf_read_attrib(datafile_t *df, int varid, int attnum,
                         df_attribute_t *a);
@@ -128,6 +139,9 @@ void mempack_read_records(datafile_t *df, int varid);
 void mempack_read_data(datafile_t *df, df_variable_t *v, int r, int roffset);
 int mempack_read_file(char *mpname, datafile_t *df);
 void mempack_free(datafile_t *df);
+int shmpack_read_file(char *mpname, datafile_t *df);
+void shmpack_wait(datafile_t *df);
+void shmpack_release(df_mempack_t *mp);
 int MPK_SVARS = 4;
 
 /** Read and set up a datafile.
@@ -181,7 +195,7 @@ v   v   v   v   ...
   */
 void df_read(char *name, datafile_t *df)
 {
-  int fid;
+  int fid, ncerr;
   FILE *fp;
 
   /* Clear the structure */
@@ -193,9 +207,20 @@ void df_read(char *name, datafile_t *df)
   strcpy(df->name, name);
 
   /* Try to open the file */
-  if (nc_open(name, NC_NOWRITE, &fid) == NC_NOERR) {
+  df_nc_lock();
+  ncerr = nc_open(name, NC_NOWRITE, &fid);
+  df_nc_unlock();
+  if (ncerr == NC_NOERR) {
     /* It is a netCDF file! */
+    df_nc_lock();
     netcdf_read(fid, df, DFT_NETCDF);
+    df_nc_unlock();
+  }
+
+  else if (endswith(name, ".shm")) {
+    /* Memory packet in a shared memory segment */
+    mempack_read(name, df, DFT_SHMPACK);
+    return;
   }
 
   else if ((fp = fopen(name, "r")) != NULL) {
@@ -205,7 +230,9 @@ void df_read(char *name, datafile_t *df)
     prm_set_errfn(quiet);
     if (prm_skip_to_end_of_key(fp, "multi-netcdf-version")) {
        prm_flush_line(fp);
+       df_nc_lock();
        multi_netcdf_read(fp, df);       
+       df_nc_unlock();
     } else if (prm_skip_to_end_of_key(fp, "mempack-version")) { /* MH mempack */
        prm_flush_line(fp);
        mempack_read(name, df, DFT_MEMPACK);
@@ -273,10 +300,14 @@ void df_set_record(datafile_t *df, int varid)
   /* Read in the record data and populate the record info. and record
      variable in the datafile_t structure. */
   if (df->type == DFT_NETCDF) {
+    df_nc_lock();
     netcdf_read_records(df, varid);
+    df_nc_unlock();
   } else if (df->type == DFT_MULTI_NETCDF) {
+    df_nc_lock();
     multi_netcdf_read_records(df, varid);
-  } else if (df->type == DFT_MEMPACK) {
+    df_nc_unlock();
+  } else if (DF_IS_MEMPACK(df)) {
     mempack_read_records(df, varid);
   }
 
@@ -356,6 +387,7 @@ int df_reset_record(datafile_t *df)
   /* Read in the record data and populate the record info. and record
      variable in the datafile_t structure. */
   if (df->type == DFT_NETCDF) {
+    df_nc_lock();
     if (nc_open(df->name, NC_NOWRITE, &fid) == NC_NOERR) {
       nc_close(df->ncid);
       df->ncid = fid;
@@ -366,6 +398,7 @@ int df_reset_record(datafile_t *df)
 	doread = 1;
       }
     }
+    df_nc_unlock();
   } else if (df->type == DFT_MULTI_NETCDF) {
     /*
      * Not implemented yet. Need to:
@@ -435,7 +468,7 @@ int df_find_record(datafile_t *df, double r, int *before, int *after,
     r = fmod(r, df->rec_mod_scale);
   }
 
-  if (df->type == DFT_MEMPACK) {
+  if (DF_IS_MEMPACK(df)) {
     df_mempack_t *mp = (df_mempack_t *)df->private_data;
     if (mp->runcode == DF_FAIL) {
       *before = df->r0;
@@ -459,6 +492,9 @@ int df_find_record(datafile_t *df, double r, int *before, int *after,
       f1 = f2 = 1;
       time(&iclk);
       while (r >= mp->next) {
+	/* Block until the writer posts a record rather than spin */
+	if (df->type == DFT_SHMPACK)
+	  shmpack_wait(df);
 	mempack_read_records(df, df->ri);
 	mp->next = df->records[ihigh] + mp->dt;
 	clock = time(&clk) - iclk;
@@ -587,7 +623,7 @@ void df_read_records(datafile_t *df, df_variable_t *v, int start_rec,
     }
   }
 
-  if (df->type == DFT_MEMPACK) {
+  if (DF_IS_MEMPACK(df)) {
     df_mempack_t *mp = (df_mempack_t *)df->private_data;
     if (v->data == NULL) {
       alloc_data_records(df, v, df->dimensions[df->ri].size);
@@ -677,12 +713,23 @@ void df_read_records(datafile_t *df, df_variable_t *v, int start_rec,
     v->nrecords = nrecs;
     for (i = sr; i <= er; ++i) {
 
+      /* Records already read ahead are copied from the buffer      */
+      if (df->prefetch != NULL && v->dim_as_record &&
+          df_prefetch_get(df, v, i))
+        continue;
+
+      df_nc_lock();
       if (df->type == DFT_NETCDF) 
          netcdf_read_data(df, v, i, 0);
 
       else if (df->type == DFT_MULTI_NETCDF)
          multi_netcdf_read_data(df, v, i);
+      df_nc_unlock();
     }
+
+    /* Queue the records expected next                              */
+    if (df->prefetch != NULL && v->dim_as_record)
+      df_prefetch_schedule(df, v, start_rec + nrecs - 1);
   }
 }
 
@@ -717,9 +764,15 @@ void df_free(datafile_t *df)
   if (df != NULL) {
     int i, j;
 
+    /* Stop any reads ahead before the file is closed */
+    if (df->prefetch != NULL)
+      df_prefetch_free(df);
+
     /* Free any memory specifically associated with the file type */
     if (df->type == DFT_ASCII)
       ascii_free(df);
+    else if (df->type == DFT_SHMPACK)
+      mempack_free(df);
     else
       netcdf_free(df);
 
@@ -761,6 +814,8 @@ void df_free(datafile_t *df)
         if (v->dimids != NULL)
           free(v->dimids);
 
+	if (v->us_wts != NULL)
+	  df_free_us_weights(v);
 	if (v->gs0_master_2d != NULL) {
 	  GRID_SPECS *gs = v->gs0_master_2d;
 	  grid_specs_destroy(gs);
@@ -1423,6 +1478,56 @@ double df_get_data_value(datafile_t *df, df_variable_t *v, int record,
 }
 
 
+/** Get the data for the specified record as a flat array. The
+  * values are stored with the last dimension varying fastest, so
+  * for a 2D variable value [i][j] is at offset i * nj + j.
+  *
+  * @param df pointer to datafile structure.
+  * @param v pointer to variable structure.
+  * @param record record index (not relative record index).
+  * @return Pointer to the start of the record data.
+  *
+  * @see df_get_data_value
+  */
+double *df_get_record_data(datafile_t *df, df_variable_t *v, int record)
+{
+  int ri = record - v->start_record;
+  double *data = NULL;
+
+  if (ri < 0)
+    ri = 0;
+  if (ri >= v->nrecords)
+    ri = v->nrecords - 1;
+
+  switch (v->nd) {
+  case 0:
+    data = &VAR_0D(v)[ri];
+    break;
+
+  case 1:
+    data = VAR_1D(v)[ri];
+    break;
+
+  case 2:
+    data = VAR_2D(v)[ri][0];
+    break;
+
+  case 3:
+    data = VAR_3D(v)[ri][0][0];
+    break;
+
+  case 4:
+    data = VAR_4D(v)[ri][0][0][0];
+    break;
+
+  default:
+    quit("df_get_record_data: Bad number of dimensions\n");
+  }
+
+  return data;
+}
+
+
 /* PRIVATE or PROTECTED functions */
 
 
@@ -1828,17 +1933,31 @@ void netcdf_read_records(datafile_t *df, int varid) {
  */
 void netcdf_read_data(datafile_t *df, df_variable_t *v, int r, int roffset)
 {
-  size_t start[5];
-  size_t count[5];
-  int i = 0, j, k, l;
-  int index = r - v->start_record;
-  int fid = df->ncid;
-
   if (!(df->rec_modulus) && ((r < 0) || (r >= df->nrecords)))
     quit
       ("netcdf_read_data: Attempt to read an invalid record for variable '%s'.\n",
        v->name);
 
+  netcdf_get_record(df, v, r, roffset, df_get_record_data(df, v, r));
+}
+
+
+/* Read a data record of a variable from a netCDF file into the
+ * contiguous buffer data, applying the scale factor and offset.
+ * The record need not be one held by the variable; this is also
+ * used by the read-ahead threads (dfprefetch.c).
+ */
+void netcdf_get_record(datafile_t *df, df_variable_t *v, int r,
+                       int roffset, double *data)
+{
+  size_t start[5];
+  size_t count[5];
+  size_t n = 1, j;
+  int i = 0, d;
+
+  if (v->nd > 4)
+    quit("read_data: Bad number of dimensions\n");
+
   if (v->dim_as_record) {
     if (df->rec_modulus)
       start[i] = (r % df->nrecords) - roffset;
@@ -1847,72 +1966,15 @@ void netcdf_read_data(datafile_t *df, df_variable_t *v, int r, int roffset)
     count[i++] = 1;
   }
 
-  switch (v->nd) {
-  case 0:
-    nc_get_vara_double(fid, v->varid, start, count, &v->data[index]);
-    v->data[index] = v->data[index] * v->scale_factor + v->add_offset;
-    break;
-
-  case 1:
-    start[i] = 0;
-    count[i++] = df->dimensions[v->dimids[0]].size;
-    nc_get_vara_double(fid, v->varid, start, count, VAR_1D(v)[index]);
-    for (i = 0; i < (int)df->dimensions[v->dimids[0]].size; ++i)
-      VAR_1D(v)[index][i]
-        = VAR_1D(v)[index][i] * v->scale_factor + v->add_offset;
-    break;
-
-  case 2:
-    start[i] = 0;
-    count[i++] = df->dimensions[v->dimids[0]].size;
-    start[i] = 0;
-    count[i++] = df->dimensions[v->dimids[1]].size;
-    nc_get_vara_double(fid, v->varid, start, count, VAR_2D(v)[index][0]);
-    for (i = 0; i < (int)df->dimensions[v->dimids[0]].size; ++i)
-      for (j = 0; j < (int)df->dimensions[v->dimids[1]].size; ++j)
-        VAR_2D(v)[index][i][j]
-          = VAR_2D(v)[index][i][j] * v->scale_factor + v->add_offset;
-    break;
-
-  case 3:
-    start[i] = 0;
-    count[i++] = df->dimensions[v->dimids[0]].size;
-    start[i] = 0;
-    count[i++] = df->dimensions[v->dimids[1]].size;
-    start[i] = 0;
-    count[i++] = df->dimensions[v->dimids[2]].size;
-    nc_get_vara_double(fid, v->varid, start, count,
-                       VAR_3D(v)[index][0][0]);
-    for (i = 0; i < (int)df->dimensions[v->dimids[0]].size; ++i)
-      for (j = 0; j < (int)df->dimensions[v->dimids[1]].size; ++j)
-        for (k = 0; k < (int)df->dimensions[v->dimids[2]].size; ++k)
-          VAR_3D(v)[index][i][j][k]
-            = VAR_3D(v)[index][i][j][k] * v->scale_factor + v->add_offset;
-    break;
-
-  case 4:
-    start[i] = 0;
-    count[i++] = df->dimensions[v->dimids[0]].size;
-    start[i] = 0;
-    count[i++] = df->dimensions[v->dimids[1]].size;
+  for (d = 0; d < v->nd; ++d) {
     start[i] = 0;
-    count[i++] = df->dimensions[v->dimids[2]].size;
-    start[i] = 0;
-    count[i++] = df->dimensions[v->dimids[3]].size;
-    nc_get_vara_double(fid, v->varid, start, count,
-                       VAR_4D(v)[index][0][0][0]);
-    for (i = 0; i < (int)df->dimensions[v->dimids[0]].size; ++i)
-      for (j = 0; j < (int)df->dimensions[v->dimids[1]].size; ++j)
-        for (k = 0; k < (int)df->dimensions[v->dimids[2]].size; ++k)
-          for (l = 0; l < (int)df->dimensions[v->dimids[3]].size; ++l)
-            VAR_4D(v)[index][i][j][k][l]
-              = VAR_4D(v)[index][i][j][k][l] * v->scale_factor +
-              v->add_offset;
-    break;
-
-  default:
-    quit("read_data: Bad number of dimensions\n");
+    count[i++] = df->dimensions[v->dimids[d]].size;
+    n *= df->dimensions[v->dimids[d]].size;
   }
+
+  nc_get_vara_double(df->ncid, v->varid, start, count, data);
+  for (j = 0; j < n; ++j)
+    data[j] = data[j] * v->scale_factor + v->add_offset;
 }
 
 
@@ -1922,7 +1984,9 @@ void netcdf_read_data(datafile_t *df, df_variable_t *v, int r, int roffset)
  */
 void netcdf_free(datafile_t *df)
 {
+  df_nc_lock();
   nc_close(df->ncid);
+  df_nc_unlock();
 
 }
 
@@ -2226,7 +2290,10 @@ void mempack_read(char *name, datafile_t *df, int type)
   /* Use the name to get the memory address */
   /* Farhan to do */
   strcpy(mp->id, name);
-  mempack_read_file(name, df);
+  if (type == DFT_SHMPACK)
+    shmpack_read_file(name, df);
+  else
+    mempack_read_file(name, df);
   mp->next = mp->time + mp->dt;
   /*memcpy(mp, id, sizeof(df_mempack_t));*/
 
@@ -2447,10 +2514,14 @@ void mempack_read_records(datafile_t *df, int varid) {
   df_mempack_t *mp = (df_mempack_t *)df->private_data;
   int i, recdimid = rv->dimids[0];
 
-  FILE *fp;
-  while ((fp = fopen(mp->id, "r")) == NULL);
-  prm_read_double(fp, "time", &mp->time);
-  fclose(fp);
+  if (df->type == DFT_SHMPACK)
+    shmpack_read_file(mp->id, df);
+  else {
+    FILE *fp;
+    while ((fp = fopen(mp->id, "r")) == NULL);
+    prm_read_double(fp, "time", &mp->time);
+    fclose(fp);
+  }
 
   if (rv->data == NULL)
     rv->data = (double *)malloc(sizeof(double) * 
@@ -2476,7 +2547,10 @@ void mempack_read_data(datafile_t *df, df_variable_t *v, int r, int roffset)
   int index = r - v->start_record;
   df_mempack_t *mp = (df_mempack_t *)df->private_data;
 
-  mempack_read_file(mp->id, df);
+  /* A shared memory packet uses the record claimed when the record  */
+  /* times were last read, so that all variables come from it.       */
+  if (df->type != DFT_SHMPACK)
+    mempack_read_file(mp->id, df);
 
   if (!(df->rec_modulus) && ((r < 0) || (r >= df->nrecords)))
     quit
@@ -2535,11 +2609,18 @@ void mempack_read_data(datafile_t *df, df_variable_t *v, int r, int roffset)
 void mempack_free(datafile_t *df)
 {
   df_mempack_t *mp = (df_mempack_t *)df->private_data;
-  d_free_1d(mp->xyz);
   if (mp->status) i_free_1d(mp->status);
-  if (mp->n2d) d_free_1d(mp->v2d);
-  if (mp->n3d) d_free_1d(mp->v3d);
+  if (mp->shm != NULL) {
+    /* Data points into the shared memory segment */
+    shmpack_release(mp);
+    shmpack_close(mp);
+  } else {
+    d_free_1d(mp->xyz);
+    if (mp->n2d) d_free_1d(mp->v2d);
+    if (mp->n3d) d_free_1d(mp->v3d);
+  }
   free(mp);
+  df->private_data = NULL;
 }
 
 int mempack_read_file(char *mpname, datafile_t *df)
@@ -2574,6 +2655,353 @@ int mempack_read_file(char *mpname, datafile_t *df)
 }
 
 
+/*
+Shared memory memory packets (shmpack).
+
+A memory packet written to a file ending in ".shm" is published to a
+POSIX shared memory segment rather than as an ascii file. The segment
+holds a header with the packet description followed by a ring of
+SHMPACK_NSLOT records of binary data (time, position data, 2d and 3d
+variables laid out as for df_mempack_t). The writer fills the next slot
+in the ring, marks it with its record number and posts a process shared
+semaphore; the reader points the packet data straight at the latest
+slot, so no text conversion or copy through a file takes place.
+
+Each reader takes one of SHMPACK_NREADER reader entries in the header
+when it attaches, recording its process id there, and a reader beyond
+these is rejected. A reader records the number of the record it holds
+in its entry (rseq) and posts a second semaphore as it moves on. The
+writer never runs more than SHMPACK_NSLOT - 1 records ahead of the
+slowest attached reader; it waits on that semaphore for the reader to
+release the slot rather than overwrite a record still in use. Entries
+of readers that have exited are freed by the writer. Records are
+numbered in their slots as well, and a slot that does not hold the
+record the reader asked for is not used. Records are claimed once per
+time step (mempack_read_records()), so that all the variables of a
+step come from the same record.
+
+A writer that restarts creates a new segment under the same name. A
+reader that waits for a record checks that the name still refers to
+the segment it mapped, and stops with an error if not.
+
+The segment name is the basename of the file, eg. "out/bdry.shm" is
+mapped as "/bdry.shm".
+*/
+#define SHMPACK_NSLOT 4
+#define SHMPACK_NREADER 8
+#define SHMPACK_MAGIC "shmpack3"
+
+typedef struct {
+  char magic[16];               /* Set once the header is complete */
+  int nslot;                    /* Number of records in the ring */
+  int npoints;                  /* Number of points */
+  int nz;                       /* Number of layers */
+  int n2d;                      /* Number of 2d variables */
+  int n3d;                      /* Number of 3d variables */
+  double dt;                    /* Time step of dump */
+  char tunits[MAXSTRLEN];       /* Time units */
+  char xyzunits[MAXSTRLEN];     /* Position units */
+  char vars[MAXSTRLEN];         /* Variable list */
+  char units[MAXSTRLEN];        /* Variable units */
+  size_t nval;                  /* Number of values in each record */
+  size_t offset;                /* Offset of the first record */
+  size_t slotsize;              /* Size of a record including header */
+  volatile long seq;            /* Number of records published */
+  volatile long rseq[SHMPACK_NREADER];  /* Record held by each reader */
+  volatile int rpid[SHMPACK_NREADER];   /* Reader process, 0 if free */
+#ifdef HAVE_PTHREADS
+  sem_t sm_new;                 /* Posted when a record is published */
+  sem_t sm_free;                /* Posted when a reader moves on */
+#endif
+} shmpack_header_t;
+
+typedef struct {
+  volatile long seq;            /* Record number held in this slot */
+  double time;                  /* Time stamp */
+  int runcode;                  /* Runcode */
+} shmpack_slot_t;
+
+#define SHMPACK_ALIGN(n) (((n) + 63) & ~((size_t)63))
+#define SHMPACK_SLOT(h, i) ((shmpack_slot_t *)((char *)(h) + (h)->offset + (i) * (h)->slotsize))
+#define SHMPACK_DATA(s) ((double *)((char *)(s) + SHMPACK_ALIGN(sizeof(shmpack_slot_t))))
+
+/* Converts a file name into a shared memory segment name */
+static void shmpack_name(char *name, char *shmname)
+{
+  char *p = strrchr(name, '/');
+  sprintf(shmname, "/%s", (p == NULL) ? name : p + 1);
+}
+
+#ifdef HAVE_PTHREADS
+/*
+ * Returns the oldest record held by an attached reader, or -1 if no
+ * reader is attached. Entries of readers that have exited are freed.
+ */
+static long shmpack_oldest(shmpack_header_t *h)
+{
+  long rseq = -1;
+  int i, pid;
+
+  for (i = 0; i < SHMPACK_NREADER; i++) {
+    if ((pid = h->rpid[i]) == 0) continue;
+    if (kill(pid, 0) != 0 && errno == ESRCH) {
+      __sync_bool_compare_and_swap(&h->rpid[i], pid, 0);
+      continue;
+    }
+    if (rseq < 0 || h->rseq[i] < rseq)
+      rseq = h->rseq[i];
+  }
+  return(rseq);
+}
+#endif
+
+/*
+ * Publish a memory packet to its shared memory segment. The segment is
+ * created on the first call.
+ */
+void shmpack_write(df_mempack_t *mp, char *name)
+{
+#ifdef HAVE_PTHREADS
+  shmpack_header_t *h;
+  shmpack_slot_t *sl;
+  double *d;
+  size_t nxyz = 2 * mp->npoints + mp->nz;
+  size_t n2d = mp->n2d * mp->npoints;
+  size_t n3d = mp->n3d * mp->npoints * mp->nz;
+  long seq, rseq;
+  int warned = 0;
+
+  if (mp->shm == NULL) {
+    char shmname[MAXSTRLEN];
+    size_t nval = nxyz + n2d + n3d;
+    size_t slotsize = SHMPACK_ALIGN(sizeof(shmpack_slot_t)) +
+      SHMPACK_ALIGN(nval * sizeof(double));
+    size_t offset = SHMPACK_ALIGN(sizeof(shmpack_header_t));
+    int fd;
+
+    /* Start from a new segment so a reader never sees a stale one */
+    shmpack_name(name, shmname);
+    shm_unlink(shmname);
+    if ((fd = shm_open(shmname, O_CREAT | O_RDWR, 0666)) < 0)
+      quit("shmpack_write: Can't create shared memory '%s'\n", shmname);
+    mp->shmsize = offset + SHMPACK_NSLOT * slotsize;
+    if (ftruncate(fd, mp->shmsize) != 0)
+      quit("shmpack_write: Can't size shared memory '%s'\n", shmname);
+    mp->shm = mmap(NULL, mp->shmsize, PROT_READ | PROT_WRITE, MAP_SHARED,
+		   fd, 0);
+    close(fd);
+    if (mp->shm == MAP_FAILED)
+      quit("shmpack_write: Can't map shared memory '%s'\n", shmname);
+
+    h = (shmpack_header_t *)mp->shm;
+    memset(h, 0, sizeof(shmpack_header_t));
+    h->nslot = SHMPACK_NSLOT;
+    h->npoints = mp->npoints;
+    h->nz = mp->nz;
+    h->n2d = mp->n2d;
+    h->n3d = mp->n3d;
+    h->dt = mp->dt;
+    strcpy(h->tunits, mp->tunits);
+    strcpy(h->xyzunits, mp->xyzunits);
+    strcpy(h->vars, mp->vars);
+    strcpy(h->units, mp->units);
+    h->nval = nval;
+    h->offset = offset;
+    h->slotsize = slotsize;
+    h->seq = 0;
+    if (sem_init(&h->sm_new, 1, 0) || sem_init(&h->sm_free, 1, 0))
+      quit("shmpack_write: Can't initialise semaphore for '%s'\n", shmname);
+    __sync_synchronize();
+    strcpy(h->magic, SHMPACK_MAGIC);
+  }
+  h = (shmpack_header_t *)mp->shm;
+
+  /* Wait for the readers to release the slot to be filled */
+  seq = h->seq + 1;
+  while ((rseq = shmpack_oldest(h)) >= 0 && seq - rseq >= h->nslot) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += 1;
+    if (sem_timedwait(&h->sm_free, &ts) != 0 && !warned) {
+      warn("shmpack_write: waiting for the reader of %s\n", name);
+      warned = 1;
+    }
+  }
+
+  /* Fill the next slot in the ring */
+  sl = SHMPACK_SLOT(h, seq % h->nslot);
+  sl->seq = 0;
+  __sync_synchronize();
+  sl->time = mp->time;
+  sl->runcode = mp->runcode;
+  d = SHMPACK_DATA(sl);
+  memcpy(d, mp->xyz, nxyz * sizeof(double));
+  if (n2d) memcpy(&d[nxyz], mp->v2d, n2d * sizeof(double));
+  if (n3d) memcpy(&d[nxyz + n2d], mp->v3d, n3d * sizeof(double));
+  __sync_synchronize();
+  sl->seq = seq;
+
+  /* Publish */
+  h->seq = seq;
+  __sync_synchronize();
+  sem_post(&h->sm_new);
+#else
+  quit("shmpack_write: Shared memory packets require pthreads\n");
+#endif
+}
+
+/*
+ * Unmap the shared memory segment of a memory packet. The segment is
+ * left in place for any reader and removed by the next writer.
+ */
+void shmpack_close(df_mempack_t *mp)
+{
+#ifdef HAVE_PTHREADS
+  if (mp->shm != NULL) {
+    munmap(mp->shm, mp->shmsize);
+    mp->shm = NULL;
+  }
+#endif
+}
+
+/*
+ * Detach a reader from a shared memory packet, so the writer no longer
+ * waits for it. Only the reader's own entry is freed.
+ */
+void shmpack_release(df_mempack_t *mp)
+{
+#ifdef HAVE_PTHREADS
+  shmpack_header_t *h = (shmpack_header_t *)mp->shm;
+
+  if (h == NULL || mp->shmrd < 0) return;
+  h->rpid[mp->shmrd] = 0;
+  mp->shmrd = -1;
+  __sync_synchronize();
+  sem_post(&h->sm_free);
+#endif
+}
+
+/*
+ * Wait (for up to a second) for the writer to publish a new record.
+ * If none arrives, check that the writer has not restarted with a new
+ * segment.
+ */
+void shmpack_wait(datafile_t *df)
+{
+#ifdef HAVE_PTHREADS
+  df_mempack_t *mp = (df_mempack_t *)df->private_data;
+  shmpack_header_t *h = (shmpack_header_t *)mp->shm;
+  struct timespec ts;
+  char shmname[MAXSTRLEN];
+  struct stat st;
+  int fd, restart;
+
+  if (h == NULL || h->seq != mp->seq) return;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_sec += 1;
+  if (sem_timedwait(&h->sm_new, &ts) == 0) return;
+
+  shmpack_name(mp->id, shmname);
+  if ((fd = shm_open(shmname, O_RDONLY, 0)) < 0) return;
+  restart = (fstat(fd, &st) == 0 && (long)st.st_ino != mp->shmino);
+  close(fd);
+  if (restart)
+    quit("shmpack_wait: The writer of %s has restarted\n", mp->id);
+#endif
+}
+
+/*
+ * Attach to a shared memory packet and point the packet data at the
+ * latest record.
+ */
+int shmpack_read_file(char *mpname, datafile_t *df)
+{
+#ifdef HAVE_PTHREADS
+  df_mempack_t *data = (df_mempack_t *)df->private_data;
+  shmpack_header_t *h;
+  shmpack_slot_t *sl;
+  struct timespec ts = {0, 10000000};
+  double *d;
+  long seq;
+  int i;
+
+  if (data->shm == NULL) {
+    char shmname[MAXSTRLEN];
+    struct stat st;
+    int fd;
+
+    /* Wait for the writer to create the segment and publish its    */
+    /* first record.                                                */
+    shmpack_name(mpname, shmname);
+    while ((fd = shm_open(shmname, O_RDWR, 0)) < 0)
+      nanosleep(&ts, NULL);
+    do {
+      if (fstat(fd, &st) != 0)
+	quit("shmpack_read_file: Can't stat shared memory '%s'\n", shmname);
+      if (st.st_size < (off_t)sizeof(shmpack_header_t))
+	nanosleep(&ts, NULL);
+    } while (st.st_size < (off_t)sizeof(shmpack_header_t));
+    data->shmsize = st.st_size;
+    data->shmino = (long)st.st_ino;
+    data->shm = mmap(NULL, data->shmsize, PROT_READ | PROT_WRITE,
+		     MAP_SHARED, fd, 0);
+    close(fd);
+    if (data->shm == MAP_FAILED)
+      quit("shmpack_read_file: Can't map shared memory '%s'\n", shmname);
+    h = (shmpack_header_t *)data->shm;
+    while (strcmp(h->magic, SHMPACK_MAGIC) != 0 || h->seq == 0)
+      nanosleep(&ts, NULL);
+    __sync_synchronize();
+
+    data->version = 1.0;
+    data->npoints = h->npoints;
+    data->nz = h->nz;
+    data->n2d = h->n2d;
+    data->n3d = h->n3d;
+    data->dt = h->dt;
+    strcpy(data->tunits, h->tunits);
+    strcpy(data->xyzunits, h->xyzunits);
+    strcpy(data->vars, h->vars);
+    strcpy(data->units, h->units);
+
+    /* Take a reader entry. Until the first claim below the writer  */
+    /* sees the entry's old record, which is no later than any it   */
+    /* may overwrite.                                               */
+    for (i = 0; i < SHMPACK_NREADER; i++)
+      if (__sync_bool_compare_and_swap(&h->rpid[i], 0, (int)getpid()))
+	break;
+    if (i == SHMPACK_NREADER)
+      quit("shmpack_read_file: %s already has %d readers\n", mpname,
+	   SHMPACK_NREADER);
+    data->shmrd = i;
+  }
+  h = (shmpack_header_t *)data->shm;
+
+  /* Claim the latest complete record and release the previous one. */
+  /* The slot must still hold the record once claimed.               */
+  do {
+    seq = h->seq;
+    __sync_synchronize();
+    sl = SHMPACK_SLOT(h, seq % h->nslot);
+    h->rseq[data->shmrd] = seq;
+    __sync_synchronize();
+  } while (sl->seq != seq);
+  sem_post(&h->sm_free);
+  data->seq = seq;
+  data->time = sl->time;
+  data->runcode = sl->runcode;
+  d = SHMPACK_DATA(sl);
+  data->xyz = d;
+  data->v2d = (data->n2d) ? &d[2 * data->npoints + data->nz] : NULL;
+  data->v3d = (data->n3d) ? &d[2 * data->npoints + data->nz +
+			      data->n2d * data->npoints] : NULL;
+#else
+  quit("shmpack_read_file: Shared memory packets require pthreads\n");
+#endif
+  return(0);
+}
+
+
 /*
 Routine to read column data from an ascii file
 
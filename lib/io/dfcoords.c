@@ -660,7 +660,7 @@ int df_infer_coord_system(datafile_t *df, df_variable_t *v)
    *                   versions are still left in the code for comparision
    */
   else if (nc > nd) {
-    if (df->type == DFT_MEMPACK) {
+    if (DF_IS_MEMPACK(df)) {
       v->interp = interp_linear;
     }
     else if (df_is_ugrid(df)) {
@@ -674,9 +674,11 @@ int df_infer_coord_system(datafile_t *df, df_variable_t *v)
 
       if (df_get_num_coords(df, v) == 2 ) {
 	    v->gs0_master_2d = v->gs1_master_2d = NULL;
+	    v->us_wts = NULL;
 	    v->interp = interp_us_2d;
       } else if (df_get_num_coords(df, v) == 3 ) {
 	    v->gs0_master_3d = v->gs1_master_3d = NULL;
+	    v->us_wts = NULL;
 	    v->interp = interp_us_3d;
       } else
 	quit("df_infer_coord_system: Can't infer coordinates for %s in UGRID file %s\n", v->name, df->name);
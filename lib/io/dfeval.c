@@ -763,6 +763,183 @@ double interp_2d_inv_weight_hashed(datafile_t *df, df_variable_t *v, int record,
 
 
 
+/*
+Weights for unstructured interpolation. For the linear and natural
+neighbour rules the interpolated value is a weighted sum of the
+source values, with weights that depend only on the triangulation
+and the target point. These are computed once for each target point
+and layer, hashed on (x,y), and applied directly to each new record,
+so the interpolators need not be rebuilt when the record changes.
+Other rules rebuild the Grid Spec interpolators as before.
+*/
+typedef enum {US_NONE, US_LINEAR, US_NN, US_NNA} us_rule_t;
+
+typedef struct {
+  int n;                        /* Number of source points */
+  int *id;                      /* Delaunay vertices */
+  double *w;                    /* Weights */
+} us_weights_t;
+
+typedef struct {
+  us_rule_t rule;               /* Interpolation rule */
+  int nz;                       /* Number of layers */
+  hash_table_t **ht;            /* Weights for (x,y) in each layer */
+  nnpi **nn;                    /* Natural neighbour interpolators */
+} us_wts_t;
+
+static us_rule_t us_weight_rule(char *i_rule)
+{
+  if (strcasecmp(i_rule, "linear") == 0)
+    return(US_LINEAR);
+  if (strcasecmp(i_rule, "nn_sibson") == 0 ||
+      strcasecmp(i_rule, "nn_non_sibson") == 0)
+    return(US_NN);
+  if (strcasecmp(i_rule, "nna_sibson") == 0 ||
+      strcasecmp(i_rule, "nna_non_sibson") == 0)
+    return(US_NNA);
+  return(US_NONE);
+}
+
+static us_wts_t *us_wts_create(char *i_rule, int nz)
+{
+  us_wts_t *uw = (us_wts_t *)malloc(sizeof(us_wts_t));
+
+  uw->rule = us_weight_rule(i_rule);
+  uw->nz = nz;
+  uw->ht = (hash_table_t **)calloc(nz, sizeof(hash_table_t *));
+  uw->nn = (nnpi **)calloc(nz, sizeof(nnpi *));
+  return(uw);
+}
+
+static void us_weights_free(void *p)
+{
+  us_weights_t *wt = (us_weights_t *)p;
+
+  if (wt->n > 0) {
+    i_free_1d(wt->id);
+    d_free_1d(wt->w);
+  }
+  free(wt);
+}
+
+/*
+Frees the unstructured interpolation weights of a variable.
+*/
+void df_free_us_weights(df_variable_t *v)
+{
+  us_wts_t *uw = (us_wts_t *)v->us_wts;
+  int k;
+
+  if (uw == NULL)
+    return;
+  for (k = 0; k < uw->nz; k++) {
+    if (uw->ht[k] != NULL) {
+      ht_process(uw->ht[k], us_weights_free);
+      ht_destroy(uw->ht[k]);
+    }
+    if (uw->nn[k] != NULL)
+      nnpi_destroy(uw->nn[k]);
+  }
+  free(uw->ht);
+  free(uw->nn);
+  free(uw);
+  v->us_wts = NULL;
+}
+
+/*
+ * Returns the weights of layer k (triangulation d) at (x,y),
+ * computing them on first use.
+ */
+static us_weights_t *us_get_weights(us_wts_t *uw, int k, delaunay *d,
+				    char *i_rule, double x, double y)
+{
+  double key[2];
+  us_weights_t *wt;
+  point p;
+  int i;
+
+  key[0] = x;
+  key[1] = y;
+  if (uw->ht[k] == NULL)
+    uw->ht[k] = ht_create_d2(d->npoints);
+  else if ((wt = (us_weights_t *)ht_find(uw->ht[k], key)) != NULL)
+    return(wt);
+
+  wt = (us_weights_t *)malloc(sizeof(us_weights_t));
+  wt->n = 0;
+  wt->id = NULL;
+  wt->w = NULL;
+  p.x = x;
+  p.y = y;
+  p.z = 0.0;
+
+  if (uw->rule == US_LINEAR) {
+    /* Barycentric weights in the triangle located as for lpi       */
+    int tid = delaunay_xytoi_ng(d, &p, d->first_id);
+    if (tid >= 0) {
+      triangle *t = &d->triangles[tid];
+      point *p0 = &d->points[t->vids[0]];
+      point *p1 = &d->points[t->vids[1]];
+      point *p2 = &d->points[t->vids[2]];
+      double det = (p1->y - p2->y) * (p0->x - p2->x) +
+	(p2->x - p1->x) * (p0->y - p2->y);
+      d->first_id = tid;
+      wt->n = 3;
+      wt->id = i_alloc_1d(3);
+      wt->w = d_alloc_1d(3);
+      for (i = 0; i < 3; i++)
+	wt->id[i] = t->vids[i];
+      wt->w[0] = ((p1->y - p2->y) * (x - p2->x) +
+		  (p2->x - p1->x) * (y - p2->y)) / det;
+      wt->w[1] = ((p2->y - p0->y) * (x - p2->x) +
+		  (p0->x - p2->x) * (y - p2->y)) / det;
+      wt->w[2] = 1.0 - wt->w[0] - wt->w[1];
+    }
+  } else {
+    /* Natural neighbour weights                                    */
+    if (uw->nn[k] == NULL) {
+      uw->nn[k] = nnpi_create(d);
+      nnpi_set_rule(uw->nn[k], (strstr(i_rule, "non_sibson")) ?
+		    NON_SIBSONIAN : SIBSON);
+    }
+    nnpi_calculate_weights(uw->nn[k], &p);
+    wt->n = nnpi_get_nvertices(uw->nn[k]);
+    if (wt->n > 0) {
+      wt->id = i_alloc_1d(wt->n);
+      wt->w = d_alloc_1d(wt->n);
+      memcpy(wt->id, nnpi_get_vertices(uw->nn[k]), wt->n * sizeof(int));
+      memcpy(wt->w, nnpi_get_weights(uw->nn[k]), wt->n * sizeof(double));
+    }
+  }
+  ht_add(uw->ht[k], key, wt);
+  return(wt);
+}
+
+/*
+ * Applies weights to the source values vd. Delaunay vertex i holds
+ * source value vd[map[i]] (map = NULL for the identity).
+ */
+static double us_apply_weights(us_wts_t *uw, us_weights_t *wt, double *vd,
+			       int *map)
+{
+  double val = 0.0, vmin = HUGE, vmax = -HUGE;
+  int i;
+
+  if (wt->n == 0)
+    return(NaN);
+  for (i = 0; i < wt->n; i++) {
+    double z = vd[(map) ? map[wt->id[i]] : wt->id[i]];
+    val += z * wt->w[i];
+    if (z < vmin) vmin = z;
+    if (z > vmax) vmax = z;
+  }
+  /* The hashing natural neighbour interpolator bounds the result   */
+  if (uw->rule == US_NNA)
+    val = (val < vmin) ? vmin : ((val > vmax) ? vmax : val);
+  return(val);
+}
+
+
 /* Unstructured interpolation using Grid Spec libraries
 
  */
@@ -828,6 +1005,16 @@ double interp_us_2d(datafile_t *df, df_variable_t *v, int record,
     gs1->d = d;
     v->gs1_master_2d = gs1;
     v->rv[0] = v->rv[1] = -9999;
+    if (us_weight_rule(i_rule) != US_NONE)
+      v->us_wts = us_wts_create(i_rule, 1);
+  }
+
+  /* Apply the geometric weights directly to the record */
+  if (v->us_wts != NULL) {
+    us_wts_t *uw = (us_wts_t *)v->us_wts;
+    us_weights_t *wt = us_get_weights(uw, 0, v->gs0_master_2d->d, i_rule,
+				      coords[0], coords[1]);
+    return(us_apply_weights(uw, wt, vd, NULL));
   }
 
  /* Reinitialize the weights if the data has changed */
@@ -1210,6 +1397,8 @@ double interp_us_3d(datafile_t *df, df_variable_t *v, int record,
       v->gs1_master_3d[k] = gs1[k];
     }
     v->rv[0] = v->rv[1] = -9999;
+    if (us_weight_rule(i_rule) != US_NONE)
+      v->us_wts = us_wts_create(i_rule, nz);
   }
 
   /* Find the k layer */      
@@ -1231,34 +1420,48 @@ double interp_us_3d(datafile_t *df, df_variable_t *v, int record,
   if (!v->kn[ks]) ks = kt;
   kindex = kindex - ks;
 
-  /* Reinitialize the weights if the data has changed */
-  if (record != v->rv[rid]) {
-    for (k = 0; k < nz; k++) v->kflag[rid][k] = 0;
-    v->rv[rid] = record;
-  }
+  /* Apply the geometric weights directly to the record */
+  if (v->us_wts != NULL) {
+    us_wts_t *uw = (us_wts_t *)v->us_wts;
+    for (k = ks; k <= kt; ++k) {
+      if (v->gs0_master_3d[k] != NULL) {
+	us_weights_t *wt = us_get_weights(uw, k, v->gs0_master_3d[k]->d,
+					  i_rule, coords[0], coords[1]);
+	tdata[k - ks] = us_apply_weights(uw, wt, vd[k], v->kmap[k]);
+      } else
+	tdata[k - ks] = NaN;
+    }
+  } else {
 
-  /* Rebuild the weights for the required layers */
-  gs = (rid == 0) ? v->gs0_master_3d : v->gs1_master_3d;
-  for (k = ks; k <= kt; ++k) {
-    if (!v->kflag[rid][k]) {
-      delaunay *d = gs[k]->d;
-      for (i = 0; i < v->kn[k]; ++i) {
-	j = v->kmap[k][i];
-	d->points[i].z = vd[k][j];
-      }
-      v->kflag[rid][k] = 1;
+    /* Reinitialize the weights if the data has changed */
+    if (record != v->rv[rid]) {
+      for (k = 0; k < nz; k++) v->kflag[rid][k] = 0;
+      v->rv[rid] = record;
+    }
 
-      if (strcmp(i_rule, "nn_sibson") == 0)
-	for (i = 0; i < ni; i++)
-	  gs[k]->rebuild(gs[k]->interpolator, &d->points[i]);
-      else
-	gs[k]->rebuild(gs[k]->interpolator, d->points);
+    /* Rebuild the weights for the required layers */
+    gs = (rid == 0) ? v->gs0_master_3d : v->gs1_master_3d;
+    for (k = ks; k <= kt; ++k) {
+      if (!v->kflag[rid][k]) {
+	delaunay *d = gs[k]->d;
+	for (i = 0; i < v->kn[k]; ++i) {
+	  j = v->kmap[k][i];
+	  d->points[i].z = vd[k][j];
+	}
+	v->kflag[rid][k] = 1;
+
+	if (strcmp(i_rule, "nn_sibson") == 0)
+	  for (i = 0; i < v->kn[k]; i++)
+	    gs[k]->rebuild(gs[k]->interpolator, &d->points[i]);
+	else
+	  gs[k]->rebuild(gs[k]->interpolator, d->points);
+      }
     }
-  }
 
-  /* Do the horizontal interpolation on layers bracketing the depth */
-  for (k = ks; k <= kt; ++k) {
-    tdata[k - ks] = grid_interp_on_point(gs[k], coords[0], coords[1]);
+    /* Do the horizontal interpolation on layers bracketing the depth */
+    for (k = ks; k <= kt; ++k) {
+      tdata[k - ks] = grid_interp_on_point(gs[k], coords[0], coords[1]);
+    }
   }
 
   /* Do the vertical interpolation */
@@ -2077,6 +2280,74 @@ double interp_linear(datafile_t *df, df_variable_t *v, int record,
 }
 
 
+/*
+Routine to return the corner weights used by interp_linear() at a
+point, so that the interpolation can be applied to whole records at
+once. Offsets index the flattened record (see df_get_record_data())
+and both arrays must hold 1 << nd entries. Weights are in the same
+order as interp_linear() sums them. Returns the number of weights
+(0 if the point is not located), or -1 if the variable is not
+interpolated with interp_linear().
+*/
+int df_linear_weights(datafile_t *df, df_variable_t *v, double coords[],
+		      int *offsets, double *weights)
+{
+  int i, j, n = 0;
+  double indices[MAXNUMDIMS];
+  int nd = df_get_num_dims(df, v);
+  int *dimids = df_get_dim_ids(df, v);
+
+  if (v->interp != interp_linear || nd != df_get_num_coords(df, v) ||
+      nd < 1 || nd > 4)
+    return(-1);
+
+  if (df_ctoi(df, v, coords, indices) == nd) {
+    double findices[MAXNUMDIMS];
+    int iindices[MAXNUMDIMS];
+    int dsize[MAXNUMDIMS];
+    int stride[MAXNUMDIMS];
+    int ncorners = 1 << nd;
+
+    /* As for interp_linear(), trimming at boundaries               */
+    for (i = nd - 1; i >= 0; --i) {
+      dsize[i] = df->dimensions[dimids[i]].size - 1;
+      stride[i] = (i == nd - 1) ? 1 : stride[i + 1] * (dsize[i + 1] + 1);
+      findices[i] = indices[i];
+      if (findices[i] < 0)
+        findices[i] = 0.0;
+      if (findices[i] > dsize[i])
+        findices[i] = (double)dsize[i];
+      iindices[i] = (int)floor(findices[i]);
+      findices[i] -= iindices[i];
+    }
+
+    for (j = 0; j < ncorners; ++j) {
+      double term = 1.0;
+      int offset = 0;
+      for (i = 0; i < nd; ++i) {
+        int corner = iindices[i] + ((j >> i) & 0x01);
+        if (corner > dsize[i])
+          corner = dsize[i];
+        if ((j >> i) & 0x01)
+          term *= findices[i];
+        else
+          term *= (1 - findices[i]);
+        offset += corner * stride[i];
+      }
+      if (fabs(term) < 1e-5)
+        term = 0.0;
+      else if (fabs(1.0 - term) < 1e-5)
+        term = 1.0;
+      if (term > 0.0) {
+        offsets[n] = offset;
+        weights[n++] = term;
+      }
+    }
+  }
+  return(n);
+}
+
+
 /*
 MH: Routine to interpolate grid spatial data using a simple bilinear-like
 interpolation scheme for variables with a range 0-360.
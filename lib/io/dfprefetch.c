@@ -0,0 +1,519 @@
+/**
+ *
+ *  #### ENVIRONMENTAL MODELLING SUITE (EMS)
+ *
+ *  \file lib/io/dfprefetch.c
+ *
+ *  \brief Read-ahead of datafile records
+ *
+ *  Records of time varying netCDF datafiles are read ahead of the
+ *  model on a small pool of I/O threads. After each new record range
+ *  is read by df_read_records, the records expected next are queued,
+ *  the number ahead being set from the model time step and the record
+ *  spacing, and limited by a memory budget for each file. When the
+ *  model then asks for such a record it is copied from the buffer
+ *  rather than read from the file.
+ *
+ *  The netCDF library is not thread safe, so all netCDF access is
+ *  serialised with df_nc_lock(), taken around the netCDF calls of
+ *  the datafile reads, the I/O threads, the buffered transport reads
+ *  (nc_buffered.cpp), the dump, particle and restart writes, and the
+ *  model set-up. The lock is recursive and its depth is kept for
+ *  each thread, so a thread that must wait for another that may need
+ *  the lock drops its own hold with df_nc_release(). Long holders,
+ *  e.g. the dump writer, give the lock to any waiting thread between
+ *  variables with df_nc_yield().
+ *
+ *  \copyright
+ *  Copyright (c) 2018. Commonwealth Scientific and Industrial
+ *  Research Organisation (CSIRO). ABN 41 687 119 230. All rights
+ *  reserved. See the license file for disclaimer and full
+ *  use/redistribution conditions.
+ *
+ *  $Id:$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ems.h"
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+/* Located in datafile.c */
+extern void netcdf_get_record(datafile_t *df, df_variable_t *v, int r,
+			      int roffset, double *data);
+
+#ifdef HAVE_PTHREADS
+
+#define PF_QUEUED  0
+#define PF_READING 1
+#define PF_READY   2
+
+typedef struct pf_rec pf_rec_t;
+struct pf_rec {
+  datafile_t *df;               /* Datafile */
+  df_variable_t *v;             /* Variable */
+  int rec;                      /* Record number */
+  int status;                   /* PF_QUEUED, PF_READING or PF_READY */
+  int drop;                     /* Discard once read */
+  int pin;                      /* Waiters using the record */
+  size_t len;                   /* Number of values in the record */
+  double *data;                 /* Record data */
+  pf_rec_t *next;               /* Next record of this file */
+  pf_rec_t *qnext;              /* Next record in the read queue */
+};
+
+typedef struct {
+  double dt;                    /* Model time step in record units */
+  size_t budget;                /* Buffer budget (bytes) */
+  size_t used;                  /* Buffer memory in use (bytes) */
+  pf_rec_t *recs;               /* Records read or being read ahead */
+  int nhit;                     /* Records taken from the buffer */
+  int nwait;                    /* Records waited for */
+  int nmiss;                    /* Records read by the model thread */
+  int nbusy;                    /* Records being read */
+} df_prefetch_t;
+
+/* I/O thread pool, shared by all files */
+static pthread_mutex_t pf_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pf_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pf_done = PTHREAD_COND_INITIALIZER;
+static pf_rec_t *pf_head = NULL;
+static pf_rec_t *pf_tail = NULL;
+static pthread_t *pf_thd = NULL;
+static int pf_nthreads = 1;
+static int pf_nthd = 0;
+static int pf_nfiles = 0;
+static int pf_quit = 0;
+
+/* Lock for netCDF access */
+static pthread_mutex_t nc_lock;
+static pthread_once_t nc_lock_once = PTHREAD_ONCE_INIT;
+static __thread int nc_depth = 0;       /* Lock depth of this thread */
+static pthread_mutex_t nc_wait_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t nc_granted = PTHREAD_COND_INITIALIZER;
+static int nc_nwait = 0;                /* Threads waiting for nc_lock */
+static unsigned long nc_ngrant = 0;     /* Lock grants to waiters */
+
+
+/*
+ * The netCDF lock is recursive so that a reader holding it may call
+ * other datafile routines.
+ */
+static void nc_lock_init(void)
+{
+  pthread_mutexattr_t attr;
+
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&nc_lock, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+void df_nc_lock(void)
+{
+  pthread_once(&nc_lock_once, nc_lock_init);
+  if (pthread_mutex_trylock(&nc_lock) != 0) {
+    pthread_mutex_lock(&nc_wait_lock);
+    nc_nwait++;
+    pthread_mutex_unlock(&nc_wait_lock);
+
+    pthread_mutex_lock(&nc_lock);
+
+    pthread_mutex_lock(&nc_wait_lock);
+    nc_nwait--;
+    nc_ngrant++;
+    pthread_cond_broadcast(&nc_granted);
+    pthread_mutex_unlock(&nc_wait_lock);
+  }
+  nc_depth++;
+}
+
+void df_nc_unlock(void)
+{
+  nc_depth--;
+  pthread_mutex_unlock(&nc_lock);
+}
+
+
+/*
+ * Releases the netCDF lock if held by the calling thread, whatever
+ * its depth, so that a thread it waits for may take it. Returns the
+ * depth to pass to df_nc_restore().
+ */
+int df_nc_release(void)
+{
+  int depth;
+
+  depth = nc_depth;
+  while (nc_depth)
+    df_nc_unlock();
+  return depth;
+}
+
+void df_nc_restore(int depth)
+{
+  while (depth--)
+    df_nc_lock();
+}
+
+
+/*
+ * Hands the netCDF lock to a waiting thread, if any, and takes it
+ * back once that thread has had it. Only called by a thread holding
+ * the lock once.
+ */
+void df_nc_yield(void)
+{
+  unsigned long grant;
+
+  if (nc_depth != 1)
+    return;
+  pthread_mutex_lock(&nc_wait_lock);
+  if (nc_nwait == 0) {
+    pthread_mutex_unlock(&nc_wait_lock);
+    return;
+  }
+  grant = nc_ngrant;
+  pthread_mutex_unlock(&nc_wait_lock);
+
+  df_nc_unlock();
+  pthread_mutex_lock(&nc_wait_lock);
+  while (nc_ngrant == grant && nc_nwait > 0)
+    pthread_cond_wait(&nc_granted, &nc_wait_lock);
+  pthread_mutex_unlock(&nc_wait_lock);
+  df_nc_lock();
+}
+
+
+/*
+ * I/O thread. Reads queued records until the pool is shut down.
+ */
+static void *pf_worker(void *arg)
+{
+  pf_rec_t *p;
+
+  pthread_mutex_lock(&pf_lock);
+  while (1) {
+    while (pf_head == NULL && !pf_quit)
+      pthread_cond_wait(&pf_work, &pf_lock);
+    if (pf_head == NULL)
+      break;
+    p = pf_head;
+    pf_head = p->qnext;
+    if (pf_head == NULL)
+      pf_tail = NULL;
+    p->status = PF_READING;
+    ((df_prefetch_t *)p->df->prefetch)->nbusy++;
+    pthread_mutex_unlock(&pf_lock);
+
+    df_nc_lock();
+    netcdf_get_record(p->df, p->v, p->rec, 0, p->data);
+    df_nc_unlock();
+
+    pthread_mutex_lock(&pf_lock);
+    p->status = PF_READY;
+    ((df_prefetch_t *)p->df->prefetch)->nbusy--;
+    if (p->drop && !p->pin) {
+      free(p->data);
+      free(p);
+    }
+    pthread_cond_broadcast(&pf_done);
+  }
+  pthread_mutex_unlock(&pf_lock);
+  return NULL;
+}
+
+
+/*
+ * Removes a record from its file's list and the read queue, and
+ * frees it. A record being read is freed by the I/O thread, and one
+ * pinned by a waiter in df_prefetch_get() by the last waiter.
+ * Called with pf_lock held.
+ */
+static void pf_discard(df_prefetch_t *pf, pf_rec_t *p)
+{
+  pf_rec_t **pp;
+
+  for (pp = &pf->recs; *pp != NULL; pp = &(*pp)->next)
+    if (*pp == p) {
+      *pp = p->next;
+      break;
+    }
+  pf->used -= p->len * sizeof(double);
+
+  if (p->status == PF_READING || p->pin) {
+    p->drop = 1;
+    return;
+  }
+  if (p->status == PF_QUEUED) {
+    pf_rec_t *prev = NULL, *q;
+    for (q = pf_head; q != NULL; prev = q, q = q->qnext)
+      if (q == p) {
+	if (prev == NULL)
+	  pf_head = q->qnext;
+	else
+	  prev->qnext = q->qnext;
+	if (pf_tail == q)
+	  pf_tail = prev;
+	break;
+      }
+  }
+  free(p->data);
+  free(p);
+}
+
+
+/*
+ * Sets the number of I/O threads. Takes effect when the pool is
+ * next started.
+ */
+void df_prefetch_set_threads(int n)
+{
+  pf_nthreads = (n < 1) ? 1 : n;
+}
+
+
+/*
+ * Enables read-ahead for a datafile. dt is the model time step in
+ * seconds (0 reads one record ahead) and budget the buffer memory
+ * for the file in bytes. Only single netCDF files with a record
+ * variable are read ahead.
+ */
+void df_prefetch_init(datafile_t *df, double dt, size_t budget)
+{
+  df_prefetch_t *pf = (df_prefetch_t *)df->prefetch;
+
+  if (df->type != DFT_NETCDF || df->records == NULL || budget == 0)
+    return;
+
+  pthread_mutex_lock(&pf_lock);
+  if (pf == NULL) {
+    pf = (df_prefetch_t *)calloc(1, sizeof(df_prefetch_t));
+    df->prefetch = pf;
+    pf_nfiles++;
+    if (pf_nthd == 0) {
+      int n;
+      pf_quit = 0;
+      pf_thd = (pthread_t *)malloc(pf_nthreads * sizeof(pthread_t));
+      for (n = 0; n < pf_nthreads; n++) {
+	if (pthread_create(&pf_thd[n], NULL, pf_worker, NULL))
+	  quit("df_prefetch_init: Unable to create I/O thread\n");
+	pf_nthd++;
+      }
+    }
+  }
+  /* Record spacing is in the units of the record variable         */
+  pf->dt = dt / tm_unit_to_sec(df->rec_units);
+  pf->budget = budget;
+  pthread_mutex_unlock(&pf_lock);
+}
+
+
+/*
+ * Copies record r of variable v from the read-ahead buffer into the
+ * variable data, waiting if the read is in progress. Returns 0 if
+ * the record was not read ahead; a record still queued is dropped
+ * and left to the caller to read.
+ */
+int df_prefetch_get(datafile_t *df, df_variable_t *v, int r)
+{
+  df_prefetch_t *pf = (df_prefetch_t *)df->prefetch;
+  pf_rec_t *p;
+  int found = 0;
+
+  pthread_mutex_lock(&pf_lock);
+  for (p = pf->recs; p != NULL; p = p->next)
+    if (p->v == v && p->rec == r)
+      break;
+
+  if (p != NULL && p->status != PF_QUEUED) {
+    if (p->status == PF_READING) {
+      /* The I/O thread needs the netCDF lock to finish the read.    */
+      /* Another thread may discard the record while pf_lock is      */
+      /* dropped, so it is pinned until copied.                      */
+      int depth = df_nc_release();
+      pf->nwait++;
+      p->pin++;
+      while (p->status != PF_READY)
+	pthread_cond_wait(&pf_done, &pf_lock);
+      pthread_mutex_unlock(&pf_lock);
+      df_nc_restore(depth);
+      pthread_mutex_lock(&pf_lock);
+      p->pin--;
+    }
+    memcpy(df_get_record_data(df, v, r), p->data, p->len * sizeof(double));
+    found = 1;
+  }
+  if (p != NULL) {
+    if (!p->drop)
+      pf_discard(pf, p);
+    else if (!p->pin && p->status == PF_READY) {
+      free(p->data);
+      free(p);
+    }
+  }
+  if (found)
+    pf->nhit++;
+  else
+    pf->nmiss++;
+  pthread_mutex_unlock(&pf_lock);
+
+  return found;
+}
+
+
+/*
+ * Queues the records of variable v expected after record r. The
+ * model may pass dt / (record spacing) records in one step, so that
+ * many are read ahead, plus one for the next interpolation bracket.
+ * Records of v outside this window are discarded.
+ */
+void df_prefetch_schedule(datafile_t *df, df_variable_t *v, int r)
+{
+  df_prefetch_t *pf = (df_prefetch_t *)df->prefetch;
+  pf_rec_t *p, *next;
+  size_t len = 1;
+  int n = 1, i, rec;
+
+  if (df->rec_modulus == 0 && r + 1 >= df->nrecords)
+    n = 0;
+  else if (pf->dt > 0.0 && df->rec_modulus == 0) {
+    double drec = df->records[r + 1] - df->records[r];
+    if (drec > 0.0)
+      n = (int)ceil(pf->dt / drec) + 1;
+  }
+  if (n > df->nrecords)
+    n = df->nrecords;
+  for (i = 0; i < v->nd; i++)
+    len *= df->dimensions[v->dimids[i]].size;
+
+  pthread_mutex_lock(&pf_lock);
+  for (p = pf->recs; p != NULL; p = next) {
+    next = p->next;
+    if (p->v == v && (p->rec <= r || p->rec > r + n))
+      pf_discard(pf, p);
+  }
+
+  for (rec = r + 1; rec <= r + n; rec++) {
+    if (df->rec_modulus == 0 && rec >= df->nrecords)
+      break;
+    for (p = pf->recs; p != NULL; p = p->next)
+      if (p->v == v && p->rec == rec)
+	break;
+    if (p != NULL)
+      continue;
+    if (pf->used + len * sizeof(double) > pf->budget)
+      break;
+
+    p = (pf_rec_t *)calloc(1, sizeof(pf_rec_t));
+    p->df = df;
+    p->v = v;
+    p->rec = rec;
+    p->status = PF_QUEUED;
+    p->len = len;
+    p->data = (double *)malloc(len * sizeof(double));
+    p->next = pf->recs;
+    pf->recs = p;
+    pf->used += len * sizeof(double);
+    if (pf_tail == NULL)
+      pf_head = p;
+    else
+      pf_tail->qnext = p;
+    pf_tail = p;
+  }
+  pthread_cond_broadcast(&pf_work);
+  pthread_mutex_unlock(&pf_lock);
+}
+
+
+/*
+ * Discards the read-ahead records of a datafile, waiting for any
+ * being read. The I/O threads are stopped with the last file.
+ */
+void df_prefetch_free(datafile_t *df)
+{
+  df_prefetch_t *pf = (df_prefetch_t *)df->prefetch;
+  int depth;
+
+  if (pf == NULL)
+    return;
+
+  depth = df_nc_release();
+  pthread_mutex_lock(&pf_lock);
+  while (pf->recs != NULL)
+    pf_discard(pf, pf->recs);
+  /* Dropped records still refer to df until their read completes */
+  while (pf->nbusy)
+    pthread_cond_wait(&pf_done, &pf_lock);
+  emstag(LMETRIC,"lib:dfprefetch:df_prefetch_free",
+	 "%s: %d records read ahead (%d waited for), %d read directly",
+	 df->name, pf->nhit, pf->nwait, pf->nmiss);
+  free(pf);
+  df->prefetch = NULL;
+
+  if (--pf_nfiles == 0 && pf_nthd > 0) {
+    int n;
+    pf_quit = 1;
+    pthread_cond_broadcast(&pf_work);
+    pthread_mutex_unlock(&pf_lock);
+    for (n = 0; n < pf_nthd; n++)
+      pthread_join(pf_thd[n], NULL);
+    pthread_mutex_lock(&pf_lock);
+    free(pf_thd);
+    pf_thd = NULL;
+    pf_nthd = 0;
+  }
+  pthread_mutex_unlock(&pf_lock);
+  df_nc_restore(depth);
+}
+
+#else
+
+void df_nc_lock(void)
+{
+}
+
+void df_nc_unlock(void)
+{
+}
+
+int df_nc_release(void)
+{
+  return 0;
+}
+
+void df_nc_restore(int depth)
+{
+}
+
+void df_nc_yield(void)
+{
+}
+
+void df_prefetch_set_threads(int n)
+{
+}
+
+void df_prefetch_init(datafile_t *df, double dt, size_t budget)
+{
+  warn("df_prefetch_init: Read-ahead of %s requires pthreads\n", df->name);
+}
+
+int df_prefetch_get(datafile_t *df, df_variable_t *v, int r)
+{
+  return 0;
+}
+
+void df_prefetch_schedule(datafile_t *df, df_variable_t *v, int r)
+{
+}
+
+void df_prefetch_free(datafile_t *df)
+{
+}
+
+#endif
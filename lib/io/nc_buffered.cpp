@@ -23,6 +23,9 @@
  *  for when reading from file. ncid seems to be a static within the
  *  nc_ routines
  *
+ *  3. Other time varying datafiles are read ahead by dfprefetch.c,
+ *  which keeps its buffers in the datafile.
+ *
  *  TODO:
  *   * Move data structure into df rather than v. Not an issue at the
  *   moment but will be if we are concurrently trying to read from
@@ -77,8 +80,7 @@ public:
   }
 
   /* Read data from file */
-  void read_data(int ncid, int varid, size_t start[], size_t count[],
-		 pthread_mutex_t *imtx) {
+  void read_data(int ncid, int varid, size_t start[], size_t count[]) {
     int ret;
 
     /* Wait for copy to be done */
@@ -86,11 +88,11 @@ public:
 
     /* 
      * Call netcdf rotuine to get data, need protection for
-     * simultaneous variable reads
+     * simultaneous reads and writes (see df_nc_lock)
      */
-    pthread_mutex_lock(imtx);
+    df_nc_lock();
     ret = nc_get_vara_double(ncid, varid, start, count, data);
-    pthread_mutex_unlock(imtx);
+    df_nc_unlock();
     if (ret != NC_NOERR)
       quit("nc_buffered netcdf error %s\n", nc_strerror(ret));
 
@@ -111,7 +113,10 @@ public:
 	warn("(lib:io:nc_buffered) Waiting for buffered read, timeIdx = %d\n", 
 	     tindex);
     }
+    /* The reading thread may need the netCDF lock held by the caller */
+    int depth = df_nc_release();
     sem_wait(&done_read);
+    df_nc_restore(depth);
     if (time != tindex)
       quit((char*)"(lib:io:nc_buffered) Incorrect data (%d,%d)\n", 
 	   time, tindex);
@@ -139,8 +144,7 @@ class ncBuffers
 {
 public:
   /* Nominal constructor */
-  ncBuffers(int num, int nid, int vid, size_t time, size_t len, 
-	    pthread_mutex_t *imtx)
+  ncBuffers(int num, int nid, int vid, size_t time, size_t len)
     : tStartIdx(time)
   {
     size_t start[2];
@@ -167,9 +171,6 @@ public:
     /* Initialise counters */
     curr_pos = next_pos = 0;
 
-    /* Cache mutex */
-    mtx = imtx;
-
     /* Create this thread */
     if (pthread_create(&thd, NULL, pth_loop, this))
       quit((char*)"(lib:io:nc_buffered) Unable to create thread\n");
@@ -218,8 +219,6 @@ private:
 
   /* Thread */
   pthread_t thd;
-  /* Cache mutex */
-  pthread_mutex_t *mtx;
 };
 
 /*
@@ -237,7 +236,7 @@ void ncBuffers<T>::doNcRead(void)
     for (int i=0; i<num_bufs && !done; i++) {
       start[iTIME] = tIdx++;
       if (start[iTIME] < nrecords)
-	bufs[i].read_data(ncid, varid, start, count, mtx);
+	bufs[i].read_data(ncid, varid, start, count);
       else
 	done = true;
     }
@@ -277,13 +276,8 @@ void nc_buffered_get_vara_double(int ncid, df_variable_t *v, int varid,
   ncBuffers<double> *bufs = NULL;
 
   /*
-   * xxx Need to fix this
-   * At the moment this is global so *any* read will be locked for all
-   * threads. This is not the most optimum behaviour, need only lock
-   * one per ncid.
-   * Fix: Rework ncBuffers to hang off df and use a map to get at the
-   *     variable buffers underneath.
-   *     Also makes for destroy easier
+   * Reads are serialised with all other netCDF access, including
+   * the datafile read-ahead, through df_nc_lock (dfprefetch.c).
    * Timing is a problem ... we may not want consecutive time either
    * due to SP_INTERP type issues (in which case we'll need to keep
    * nieghbouring times hanging around) or overlap in mutli files.
@@ -294,7 +288,6 @@ void nc_buffered_get_vara_double(int ncid, df_variable_t *v, int varid,
    *      out as a new file will have a new object!!! TRANS_VARS was
    *      the problem!!
    */
-  static pthread_mutex_t *nc_mtx = NULL;
 
   /* Get time index and length of data array */
   size_t time = start[iTIME];
@@ -304,13 +297,8 @@ void nc_buffered_get_vara_double(int ncid, df_variable_t *v, int varid,
     /* Yes */
     bufs = static_cast< ncBuffers<double> *>(vbuf);
   } else {
-    /* Initialise mutex - one per ncid */
-    if (nc_mtx == NULL) {
-      nc_mtx = new pthread_mutex_t;
-      pthread_mutex_init(nc_mtx, NULL);
-    }
     /* First time, need to create it */
-    bufs = new ncBuffers<double>(NUM_NC_BUFFERS, ncid, varid, time, len, nc_mtx);
+    bufs = new ncBuffers<double>(NUM_NC_BUFFERS, ncid, varid, time, len);
 
     /* Set pointer on variable */
     v->nc_bufs = static_cast <void *>(bufs);
@@ -759,8 +759,6 @@ void ncw_def_var(const char fname[], int ncid, const char varname[], nc_type xty
 /* Same as above except with an extra option */
 void ncw_def_var2(const char fname[], int ncid, const char varname[], nc_type xtype, int ndims, const int dimids[], int* varid, int compress)
 {
-  int status;
-  
   /* Call above function first */
   ncw_def_var(fname, ncid, varname, xtype, ndims, dimids, varid);
   
@@ -772,9 +770,7 @@ void ncw_def_var2(const char fname[], int ncid, const char varname[], nc_type xt
 #ifdef NC_NETCDF4 /* The ifdef is just for compilation purposes */
   if (compress) {
     /* I got a deflate value of 2 from some research on the net (FR) */
-    status = nc_def_var_deflate(ncid, varid[0], NC_SHUFFLE, 1, 2);
-    if (status != NC_NOERR)
-      quit("nc_def_var_deflate error : %s\n", nc_strerror(status));
+    ncw_def_var_deflate(fname, ncid, varid[0], NC_SHUFFLE, 2);
   }
 #endif
 }
@@ -1418,4 +1414,24 @@ void ncw_def_var_chunking(const char fname[], int ncid, int varid, size_t *chunk
     quit("\"%s\": setting chunk sizes failed: %s\n", (fname != NULL?fname:EMPTY), nc_strerror(status));
   
 }
+
+/** Designate deflate compression
+ *
+ * @param fname NetCDF file name
+ * @param ncid NetCDF file id
+ * @param varid NetCDF variable id
+ * @param shuffle non-zero to apply the byte shuffle filter
+ * @param level deflate level, 1 (fastest) to 9 (smallest)
+ */
+void ncw_def_var_deflate(const char fname[], int ncid, int varid, int shuffle, int level)
+{
+#ifdef NC_NETCDF4
+  int status = nc_def_var_deflate(ncid, varid, shuffle, 1, level);
+
+  if (status != NC_NOERR)
+    quit("\"%s\": setting deflate level %d failed: %s\n", (fname != NULL?fname:EMPTY), level, nc_strerror(status));
+#else
+  quit("\"%s\": deflate compression requires netCDF-4\n", (fname != NULL?fname:EMPTY));
+#endif
+}
 // EOF
@@ -24,9 +24,13 @@
 #include <stdio.h>
 #include <math.h>
 #include <stdarg.h>
+#include <sys/stat.h>
 #include "ems.h"
 #include "errno.h"
 #include "ems.h"
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 
 errfn keyprm_errfn = errfn_quit_default;
@@ -60,59 +64,359 @@ void prm_set_case(int c)
 }
 
 
-/** Skip forward from the current file position to
-  * the start of the next line beginning with key.
-  *
-  * @param fp pointer to stdio FILE structure.
-  * @param key keyname to locate in file.
-  * @return non-zero if successful.
-  */
-int prm_skip_to_start_of_key(FILE * fp, char *key)
+/*
+ * Key index of a parameter file. Lookups used to read the file
+ * line by line from the current position until the key was found,
+ * so reading a large parameter file cost O(keys x lines). The file
+ * is now read once into an index of lines, hashed on the first word
+ * of each line, and a lookup visits only the lines starting with the
+ * key's first word. The search order (forward from the current
+ * position, then once from the start) and the matching rule are as
+ * before. The index is rebuilt if the file behind the stream
+ * changes; streams which are not regular files, or files larger
+ * than PRM_INDEX_MAX, are still searched line by line.
+ */
+#define PRM_INDEX_MAX (64*1024*1024)
+#define PRM_INDEX_NUM 64
+
+typedef struct {
+  char *word;                   /* First word in lower case */
+  int first;                    /* First line starting with word */
+  int last;                     /* Last line starting with word */
+} prm_word_t;
+
+typedef struct prm_index prm_index_t;
+struct prm_index {
+  FILE *fp;                     /* Indexed stream */
+  dev_t dev;                    /* File identity */
+  ino_t ino;
+  off_t size;
+  time_t mtime;
+  int nlines;                   /* Number of lines */
+  long *start;                  /* Offset of each line */
+  int *lead;                    /* Leading blanks of each line */
+  char **word;                  /* First word of each line */
+  int *next;                    /* Next line with the same word */
+  hash_table_t *ht;             /* prm_word_t for each word */
+  prm_index_t *nxt;             /* Next index */
+};
+
+static prm_index_t *prm_indices = NULL;
+#ifdef HAVE_PTHREADS
+static pthread_mutex_t prm_index_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* FNV-1a hash; ht_string_hash reads past the end of the string */
+static size_t prm_word_hash(void *key)
+{
+  unsigned char *c = (unsigned char *)key;
+  size_t h = 2166136261u;
+
+  while (*c)
+    h = (h ^ *c++) * 16777619u;
+  return h;
+}
+
+static void prm_word_free(void *p)
+{
+  prm_word_t *w = (prm_word_t *)p;
+  free(w->word);
+  free(w);
+}
+
+static void prm_index_clear(prm_index_t *ix)
+{
+  int i;
+
+  if (ix->ht != NULL) {
+    ht_process(ix->ht, prm_word_free);
+    ht_destroy(ix->ht);
+  }
+  for (i = 0; i < ix->nlines; i++)
+    if (ix->word[i] != NULL)
+      free(ix->word[i]);
+  free(ix->start);
+  free(ix->lead);
+  free(ix->word);
+  free(ix->next);
+  ix->ht = NULL;
+  ix->nlines = 0;
+  ix->start = NULL;
+  ix->lead = NULL;
+  ix->word = NULL;
+  ix->next = NULL;
+}
+
+/*
+ * Reads the stream into the index. Lines are split as fgets splits
+ * them, so that the line starts are those the search would see.
+ */
+static void prm_index_build(prm_index_t *ix)
+{
+  char buf[MAXLINELEN];
+  long fpos = ftell(ix->fp);
+  int n = 0, size = 1024;
+
+  ix->start = (long *)malloc(size * sizeof(long));
+  ix->lead = (int *)malloc(size * sizeof(int));
+  ix->word = (char **)malloc(size * sizeof(char *));
+  ix->next = (int *)malloc(size * sizeof(int));
+  ix->ht = ht_create(ix->size / 32 + 1024, prm_word_hash, ht_string_compare);
+
+  if (fseek(ix->fp, 0L, 0))
+    quit("prm_index_build: %s\n", strerror(errno));
+  while (1) {
+    long lpos = ftell(ix->fp);
+    char *s = fgets(buf, MAXLINELEN, ix->fp);
+    char *e;
+    if (s == NULL)
+      break;
+    if (n == size) {
+      size *= 2;
+      ix->start = (long *)realloc(ix->start, size * sizeof(long));
+      ix->lead = (int *)realloc(ix->lead, size * sizeof(int));
+      ix->word = (char **)realloc(ix->word, size * sizeof(char *));
+      ix->next = (int *)realloc(ix->next, size * sizeof(int));
+    }
+    while (is_blank(*s))
+      s++;
+    for (e = s; *e && !is_blank(*e); e++)
+      ;
+    ix->start[n] = lpos;
+    ix->lead[n] = s - buf;
+    ix->word[n] = NULL;
+    ix->next[n] = -1;
+    if (e > s) {
+      prm_word_t *w;
+      char *c;
+      *e = '\000';
+      ix->word[n] = strdup(s);
+      for (c = s; *c; c++)
+        *c = tolower((int)*c);
+      if ((w = (prm_word_t *)ht_find(ix->ht, s)) == NULL) {
+        w = (prm_word_t *)malloc(sizeof(prm_word_t));
+        w->word = strdup(s);
+        w->first = n;
+        ht_add(ix->ht, w->word, w);
+      } else
+        ix->next[w->last] = n;
+      w->last = n;
+    }
+    n++;
+  }
+  ix->nlines = n;
+  if (fseek(ix->fp, fpos, 0))
+    quit("prm_index_build: %s\n", strerror(errno));
+}
+
+/*
+ * Returns the index of a stream, building it on first use or when
+ * the file has changed, or NULL if the stream is not indexed.
+ */
+static prm_index_t *prm_index_get(FILE *fp)
+{
+  struct stat st;
+  prm_index_t *ix, *prev = NULL;
+  int n = 0;
+
+  if (fstat(fileno(fp), &st) || !S_ISREG(st.st_mode) ||
+      st.st_size > PRM_INDEX_MAX)
+    return NULL;
+
+  for (ix = prm_indices; ix != NULL; prev = ix, ix = ix->nxt, n++)
+    if (ix->fp == fp)
+      break;
+
+  if (ix == NULL) {
+    /* Reuse the oldest index if there are too many */
+    if (n >= PRM_INDEX_NUM) {
+      for (ix = prm_indices; ix->nxt != NULL; prev = ix, ix = ix->nxt)
+        ;
+      prev->nxt = NULL;
+      prm_index_clear(ix);
+    } else
+      ix = (prm_index_t *)calloc(1, sizeof(prm_index_t));
+    ix->fp = NULL;
+    ix->nxt = prm_indices;
+    prm_indices = ix;
+  }
+
+  if (ix->fp != fp || ix->dev != st.st_dev || ix->ino != st.st_ino ||
+      ix->size != st.st_size || ix->mtime != st.st_mtime) {
+    prm_index_clear(ix);
+    ix->fp = fp;
+    ix->dev = st.st_dev;
+    ix->ino = st.st_ino;
+    ix->size = st.st_size;
+    ix->mtime = st.st_mtime;
+    prm_index_build(ix);
+  }
+  return ix;
+}
+
+/*
+ * Returns non-zero if the line s, less leading blanks, starts with
+ * key followed by a blank.
+ */
+static int prm_key_match(char *s, char *key, int len)
+{
+  while (is_blank(s[0]))
+    s++;
+
+  /* Truncate the string at the first space after the key length. */
+  if (strlen(s) > len && is_blank(s[len]))
+    s[len] = '\000';
+  return (STRCMP(key, s) == 0);
+}
+
+/*
+ * Searches for the line starting with key, forward from the line at
+ * the current position and then once from the start of the file, by
+ * reading each line.
+ */
+static int prm_scan_key(FILE *fp, char *key, long *kpos)
 {
   char buf[MAXLINELEN];
   int len = strlen(key);
   long fpos;
   char *s;
   int rewound = 0;
-  /*UR 22/05/2008
-   * reduced failure of finding a key to
-   * 'TRACE'
-   * since it is not vital and allowed.
-   */
+
   do {
     fpos = ftell(fp);
     s = fgets(buf, MAXLINELEN, fp);
     if (s == NULL) {
-      if (!rewound) {
-        fpos = 0L;
-        if (fseek(fp, fpos, 0))
-          quit("prm_skip_to_start_of_key: %s\n", strerror(errno));
-        s = fgets(buf, MAXLINELEN, fp);
-        rewound = 1;
-      } else {
-        emstag(LTRACE,"lib:prmfile:prm_skip_to_start_of_key","key %s not found",key);
-       /* (*keyprm_errfn) ("prm_skip_to_start_of_key: key %s not found\n",
-                         key);*/
+      if (rewound)
+        return (0);
+      fpos = 0L;
+      if (fseek(fp, fpos, 0))
+        quit("prm_scan_key: %s\n", strerror(errno));
+      if ((s = fgets(buf, MAXLINELEN, fp)) == NULL)
         return (0);
+      rewound = 1;
+    }
+  } while (!prm_key_match(s, key, len));
+
+  for (s = buf; is_blank(*s); s++)
+    ;
+  *kpos = fpos + (s - buf);
+  return (1);
+}
+
+/*
+ * As prm_scan_key(), using the key index of the stream. The line
+ * found is checked against the file, and if the file has changed
+ * under the index the search falls back to prm_scan_key().
+ */
+static int prm_find_key(FILE *fp, char *key, long *kpos)
+{
+  char buf[MAXLINELEN];
+  char word[MAXLINELEN];
+  int len = strlen(key);
+  long fpos = ftell(fp);
+  prm_index_t *ix;
+  prm_word_t *w;
+  int i, lo, hi, pass, nw, found = 0, stale = 0;
+  char *c;
+
+#ifdef HAVE_PTHREADS
+  pthread_mutex_lock(&prm_index_lock);
+#endif
+  if (fpos < 0 || (ix = prm_index_get(fp)) == NULL) {
+#ifdef HAVE_PTHREADS
+    pthread_mutex_unlock(&prm_index_lock);
+#endif
+    return (prm_scan_key(fp, key, kpos));
+  }
+
+  /* Line containing the current position */
+  lo = 0;
+  hi = ix->nlines;
+  while (hi - lo > 1) {
+    int m = (lo + hi) / 2;
+    if (ix->start[m] <= fpos)
+      lo = m;
+    else
+      hi = m;
+  }
+
+  /* Part of a line left after the position, as fgets would read it */
+  if (lo < ix->nlines && ix->start[lo] < fpos) {
+    if (fgets(buf, MAXLINELEN, fp) != NULL && prm_key_match(buf, key, len)) {
+      for (c = buf; is_blank(*c); c++)
+        ;
+      *kpos = fpos + (c - buf);
+      found = 1;
+    }
+    lo++;
+  }
+
+  /* Lines starting with the first word of the key, from the current */
+  /* line to the end and then from the start.                         */
+  for (nw = 0; key[nw] && !is_blank(key[nw]); nw++)
+    word[nw] = tolower((int)key[nw]);
+  word[nw] = '\000';
+  if (!found && nw > 0 && (w = (prm_word_t *)ht_find(ix->ht, word)) != NULL) {
+    for (pass = 0; pass < 2 && !found && !stale; pass++) {
+      for (i = w->first; i >= 0 && !found && !stale; i = ix->next[i]) {
+        if (pass == 0 && i < lo)
+          continue;
+        if (key[nw] == '\000' && STRCMP(key, ix->word[i]) != 0)
+          continue;
+        if (fseek(fp, ix->start[i], 0))
+          quit("prm_find_key: %s\n", strerror(errno));
+        if (fgets(buf, MAXLINELEN, fp) != NULL &&
+            prm_key_match(buf, key, len)) {
+          *kpos = ix->start[i] + ix->lead[i];
+          found = 1;
+        } else if (key[nw] == '\000')
+          stale = 1;
       }
     }
+  }
 
-    while (is_blank(s[0]))
-      s++;
+  if (stale) {
+    /* Rebuild on the next lookup */
+    ix->size = -1;
+    if (fseek(fp, fpos, 0))
+      quit("prm_find_key: %s\n", strerror(errno));
+  } else if (!found && fseek(fp, 0L, 2))
+    /* A failed search reads to the end of the file */
+    quit("prm_find_key: %s\n", strerror(errno));
+#ifdef HAVE_PTHREADS
+  pthread_mutex_unlock(&prm_index_lock);
+#endif
+  if (stale)
+    return (prm_scan_key(fp, key, kpos));
+  return (found);
+}
 
-    /* Truncate the string at the first space after the key length. */
-    if (is_blank(s[len]))
-      s[len] = '\000';
-  } while (STRCMP(key, s) != 0);
 
-  if (s == NULL) {
-    emstag(LTRACE,"lib:prmfile:prm_skip_to_start_of_key","key %s not found", key);
-    /*(*keyprm_errfn) ("prm_skip_to_start_of_key: key %s not found\n", key);*/
+/** Skip forward from the current file position to
+  * the start of the next line beginning with key.
+  *
+  * @param fp pointer to stdio FILE structure.
+  * @param key keyname to locate in file.
+  * @return non-zero if successful.
+  */
+int prm_skip_to_start_of_key(FILE * fp, char *key)
+{
+  long kpos;
+
+  /*UR 22/05/2008
+   * reduced failure of finding a key to
+   * 'TRACE'
+   * since it is not vital and allowed.
+   */
+  if (!prm_find_key(fp, key, &kpos)) {
+    emstag(LTRACE,"lib:prmfile:prm_skip_to_start_of_key","key %s not found",key);
+    /* (*keyprm_errfn) ("prm_skip_to_start_of_key: key %s not found\n",
+                       key);*/
     return (0);
   }
 
   /* seek to start of line */
-  if (fseek(fp, fpos + (s - buf), 0))
+  if (fseek(fp, kpos, 0))
     quit("prm_skip_to_start_of_key: %s\n", strerror(errno));
 
   return (1);
@@ -130,55 +434,24 @@ int prm_skip_to_start_of_key(FILE * fp, char *key)
   */
 int prm_skip_to_end_of_key(FILE * fp, char *key)
 {
-  char buf[MAXLINELEN];
-  int len = strlen(key);
-  long fpos;
-  char *s;
-  int rewound = 0;
+  long kpos;
+
   /*UR 10/06/2005
    * reduced failure of finding a key to 
    * 'TRACE'
    * since it is not vital and allowed. 
    */
-  do {
-    fpos = ftell(fp);
-    s = fgets(buf, MAXLINELEN, fp);
-    if (s == NULL) {
-      if (!rewound) {
-        fpos = 0L;
-        if (fseek(fp, fpos, 0))
-          quit("prm_skip_to_end_of_key: %s\n", strerror(errno));
-        s = fgets(buf, MAXLINELEN, fp);
-        rewound = 1;
-      } else {
-        emstag(LTRACE,"lib:prmfile:prm_skip_to_end_of_key"," key %s not found\n",
-                         key);
-        /*
-        (*keyprm_errfn) ("prm_skip_to_end_of_key: key %s not found\n",
-                         key);*/
-        return (0);
-      }
-    }
-
-    if (s == NULL)
-      break;
-
-    while (is_blank(s[0]))
-      s++;
-
-    /* Truncate the string at the first space after the key length. */
-    if (strlen(s) > len && is_blank(s[len]))/*UR added length check to prevent invalid write*/
-      s[len] = '\000';
-  } while (STRCMP(key, s) != 0);
-
-  if (s == NULL) {
-    emstag(LTRACE,"lib:prmfile:prm_skip_to_end_of_key","key %s not found\n", key);
-    /*(*keyprm_errfn) ("prm_skip_to_end_of_key: key %s not found\n", key);*/
+  if (!prm_find_key(fp, key, &kpos)) {
+    emstag(LTRACE,"lib:prmfile:prm_skip_to_end_of_key"," key %s not found\n",
+           key);
+    /*
+    (*keyprm_errfn) ("prm_skip_to_end_of_key: key %s not found\n",
+                     key);*/
     return (0);
   }
 
   /* seek to character after key */
-  if (fseek(fp, fpos + (s - buf) + len, 0))
+  if (fseek(fp, kpos + strlen(key), 0))
     quit("prm_skip_to_end_of_key: %s\n", strerror(errno));
 
   return (1);
@@ -24,20 +24,75 @@
 #include "ems.h"
 
 
-/** Read an array of particles from a netCDF particle file
-  * at a specified record.
+/** Allocate a structure of arrays particle store.
+  *
+  * @param np number of particles.
+  * @return pointer to the new store.
+  */
+pt_store_t *pt_store_alloc(long np)
+{
+  pt_store_t *ps = (pt_store_t *)calloc(1, sizeof(pt_store_t));
+
+  if (ps == NULL)
+    quit("pt_store_alloc: not enough memory for particles\n");
+  ps->np = np;
+  ps->e1 = d_alloc_1d(np);
+  ps->e2 = d_alloc_1d(np);
+  ps->e3 = d_alloc_1d(np);
+  ps->c = i_alloc_1d(np);
+  ps->flag = s_alloc_1d(np);
+  ps->dumpf = i_alloc_1d(np);
+  ps->age = d_alloc_1d(np);
+  ps->out_age = uc_alloc_1d(np);
+  ps->size = d_alloc_1d(np);
+  ps->out_size = uc_alloc_1d(np);
+  ps->svel = d_alloc_1d(np);
+  memset(ps->c, 0, np * sizeof(int));
+  memset(ps->flag, 0, np * sizeof(short));
+  memset(ps->dumpf, 0, np * sizeof(int));
+  memset(ps->age, 0, np * sizeof(double));
+  memset(ps->out_age, 0, np);
+  memset(ps->size, 0, np * sizeof(double));
+  memset(ps->out_size, 0, np);
+  memset(ps->svel, 0, np * sizeof(double));
+  return (ps);
+}
+
+/** Free a particle store.
+  *
+  * @param ps particle store.
+  */
+void pt_store_free(pt_store_t *ps)
+{
+  if (ps == NULL)
+    return;
+  d_free_1d(ps->e1);
+  d_free_1d(ps->e2);
+  d_free_1d(ps->e3);
+  i_free_1d(ps->c);
+  s_free_1d(ps->flag);
+  i_free_1d(ps->dumpf);
+  d_free_1d(ps->age);
+  free_1d(ps->out_age);
+  d_free_1d(ps->size);
+  free_1d(ps->out_size);
+  d_free_1d(ps->svel);
+  free(ps);
+}
+
+/** Read particles from a netCDF particle file at a specified
+  * record into a particle store.
   *
   * @param name netCDF particle filename.
   * @param rec record number.
-  * @param np returned number of particles.
-  * @param p returned pointer to a particle structure.
+  * @param ps returned particle store; allocated if NULL.
   * @param t returned time for specified record (NULL if not required).
   * @param t_units returned time units (NULL if not required).
   * @param ndump returned number of dumps in particle file (NULL if not required).
   */
 void
-pt_read(char *name, int rec, long int *np, particle_t **p,
-        double *t, char *t_units, int *ndump)
+pt_read_s(char *name, int rec, pt_store_t **ps,
+          double *t, char *t_units, int *ndump)
 {
   int fid;
   int ndims;                    /* Number of dimensions */
@@ -56,8 +111,6 @@ pt_read(char *name, int rec, long int *np, particle_t **p,
   int y_vid;
   int z_vid;
   int f_vid;
-  double *b;
-  short *f;
   size_t nrec;
 
   /* Open the netCDF file */
@@ -135,11 +188,9 @@ pt_read(char *name, int rec, long int *np, particle_t **p,
     quit("pt_read: flag variable must have type NC_SHORT\n");
 
   /* Allocate space, if not already done */
-  if (*p == NULL) {
-    *np = (long)n;
-    if ((*p = (particle_t *)malloc((*np) * sizeof(particle_t))) == NULL)
-      quit("pt_read: not enough memory for particles\n");
-  } else if (*np != (int)n)
+  if (*ps == NULL)
+    *ps = pt_store_alloc((long)n);
+  else if ((*ps)->np != (long)n)
     quit
       ("pt_read: Number of particles doesn't match space already allocated\n");
 
@@ -152,31 +203,57 @@ pt_read(char *name, int rec, long int *np, particle_t **p,
     nc_get_att_text(fid, t_vid, "units", t_units);
 
   /* Read the particle data */
-  b = d_alloc_1d(*np);
-  f = s_alloc_1d(*np);
   start[0] = rec;
   start[1] = 0;
   count[0] = 1;
-  count[1] = *np;
-  nc_get_vara_double(fid, x_vid, start, count, b);
-  for (n = 0; n < (size_t) * np; n++)
-    (*p)[n].e1 = b[n];
-  nc_get_vara_double(fid, y_vid, start, count, b);
-  for (n = 0; n < (size_t) * np; n++)
-    (*p)[n].e2 = b[n];
-  nc_get_vara_double(fid, z_vid, start, count, b);
-  for (n = 0; n < (size_t) * np; n++)
-    (*p)[n].e3 = b[n];
-  nc_get_vara_short(fid, f_vid, start, count, f);
-  for (n = 0; n < (size_t) * np; n++)
-    (*p)[n].flag = f[n];
-  d_free_1d(b);
-  s_free_1d(f);
+  count[1] = (*ps)->np;
+  nc_get_vara_double(fid, x_vid, start, count, (*ps)->e1);
+  nc_get_vara_double(fid, y_vid, start, count, (*ps)->e2);
+  nc_get_vara_double(fid, z_vid, start, count, (*ps)->e3);
+  nc_get_vara_short(fid, f_vid, start, count, (*ps)->flag);
 
   /* Close the file */
   nc_close(fid);
 }
 
+/** Read an array of particles from a netCDF particle file
+  * at a specified record.
+  *
+  * @param name netCDF particle filename.
+  * @param rec record number.
+  * @param np returned number of particles.
+  * @param p returned pointer to a particle structure.
+  * @param t returned time for specified record (NULL if not required).
+  * @param t_units returned time units (NULL if not required).
+  * @param ndump returned number of dumps in particle file (NULL if not required).
+  */
+void
+pt_read(char *name, int rec, long int *np, particle_t **p,
+        double *t, char *t_units, int *ndump)
+{
+  pt_store_t *ps = NULL;
+  long n;
+
+  pt_read_s(name, rec, &ps, t, t_units, ndump);
+
+  /* Allocate space, if not already done */
+  if (*p == NULL) {
+    *np = ps->np;
+    if ((*p = (particle_t *)malloc((*np) * sizeof(particle_t))) == NULL)
+      quit("pt_read: not enough memory for particles\n");
+  } else if (*np != ps->np)
+    quit
+      ("pt_read: Number of particles doesn't match space already allocated\n");
+
+  for (n = 0; n < *np; n++) {
+    (*p)[n].e1 = ps->e1[n];
+    (*p)[n].e2 = ps->e2[n];
+    (*p)[n].e3 = ps->e3[n];
+    (*p)[n].flag = ps->flag[n];
+  }
+  pt_store_free(ps);
+}
+
 /** Create particle tracking output file.
   *
   * @param name particle filename.
@@ -234,19 +311,17 @@ int pt_create(char *name, long int np, char *t_units, int dumpf)
 }
 
 
-/** Write particles at a known record into the particle file.
+/** Write a particle store at a known record into the particle file.
   *
   * @param fid file descriptor to open and writable netCDF
   *            particle file.
   * @param rec record number to write.
   * @param t time at specified record.
-  * @param np number of particles to write.
-  * @param p array of particles to write.
+  * @param ps particle store to write.
   */
-void pt_write(int fid, int rec, double t, long int np, particle_t *p)
+void pt_write_s(int fid, int rec, double t, pt_store_t *ps)
 {
-  double *b;
-  short *f;
+  long np = ps->np;
   float *d;
   double s2d = 1.0 / 86400.0;
   unsigned char *c;
@@ -263,36 +338,23 @@ void pt_write(int fid, int rec, double t, long int np, particle_t *p)
   start[1] = 0;
   count[1] = np;
 
+  /* Positions and flags are written straight from the store */
+  nc_put_vara_double(fid, ncw_var_id(fid, "x"), start, count, ps->e1);
+  nc_put_vara_double(fid, ncw_var_id(fid, "y"), start, count, ps->e2);
+  nc_put_vara_double(fid, ncw_var_id(fid, "z"), start, count, ps->e3);
+  nc_put_vara_short(fid, ncw_var_id(fid, "flag"), start, count, ps->flag);
+
   /* Allocate buffers */
-  b = d_alloc_1d(np);
   d = f_alloc_1d(np);
-  f = s_alloc_1d(np);
   c = uc_alloc_1d(np);
 
-  /* Transfer and write data */
-  for (n = 0; n < np; n++)
-    b[n] = p[n].e1;
-  nc_put_vara_double(fid, ncw_var_id(fid, "x"), start, count, b);
-
-  for (n = 0; n < np; n++)
-    b[n] = p[n].e2;
-  nc_put_vara_double(fid, ncw_var_id(fid, "y"), start, count, b);
-
-  for (n = 0; n < np; n++)
-    b[n] = p[n].e3;
-  nc_put_vara_double(fid, ncw_var_id(fid, "z"), start, count, b);
-
-  for (n = 0; n < np; n++)
-    f[n] = p[n].flag;
-  nc_put_vara_short(fid, ncw_var_id(fid, "flag"), start, count, f);
-
   for (n = 0; n < np; n++) {
-    if (p[n].dumpf & PT_AGE) {
-      if (p[n].dumpf & PT_FATT) {
-	d[n] = (float)p[n].age * s2d;
+    if (ps->dumpf[n] & PT_AGE) {
+      if (ps->dumpf[n] & PT_FATT) {
+	d[n] = (float)ps->age[n] * s2d;
 	pf = 1;
       } else
-	c[n] = p[n].out_age;
+	c[n] = ps->out_age[n];
     }
   }
   if (pf)
@@ -302,12 +364,12 @@ void pt_write(int fid, int rec, double t, long int np, particle_t *p)
 
   pf = 0;
   for (n = 0; n < np; n++) {
-    if (p[n].dumpf & PT_SIZE) {
-      if (p[n].dumpf & PT_FATT) {
-	d[n] = (float)p[n].size;
+    if (ps->dumpf[n] & PT_SIZE) {
+      if (ps->dumpf[n] & PT_FATT) {
+	d[n] = (float)ps->size[n];
 	pf = 1;
       } else
-	c[n] = p[n].out_size;
+	c[n] = ps->out_size[n];
     }
   }
   if (pf)
@@ -315,10 +377,37 @@ void pt_write(int fid, int rec, double t, long int np, particle_t *p)
   else
     nc_put_vara_uchar(fid, ncw_var_id(fid, "size"), start, count, c);
 
-  d_free_1d(b);
   f_free_1d(d);
-  s_free_1d(f);
   free_1d(c);
 
   nc_sync(fid);
 }
+
+/** Write particles at a known record into the particle file.
+  *
+  * @param fid file descriptor to open and writable netCDF
+  *            particle file.
+  * @param rec record number to write.
+  * @param t time at specified record.
+  * @param np number of particles to write.
+  * @param p array of particles to write.
+  */
+void pt_write(int fid, int rec, double t, long int np, particle_t *p)
+{
+  pt_store_t *ps = pt_store_alloc(np);
+  long n;
+
+  for (n = 0; n < np; n++) {
+    ps->e1[n] = p[n].e1;
+    ps->e2[n] = p[n].e2;
+    ps->e3[n] = p[n].e3;
+    ps->flag[n] = p[n].flag;
+    ps->dumpf[n] = p[n].dumpf;
+    ps->age[n] = p[n].age;
+    ps->out_age[n] = p[n].out_age;
+    ps->size[n] = p[n].size;
+    ps->out_size[n] = p[n].out_size;
+  }
+  pt_write_s(fid, rec, t, ps);
+  pt_store_free(ps);
+}
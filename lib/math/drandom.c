@@ -16,6 +16,7 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
 #include <math.h>
 #include "ems.h"
 
@@ -204,3 +205,51 @@ float ran3(int *idum)
 #undef MSEED
 #undef MZ
 #undef FAC
+
+
+/* Philox4x32-10 constants (Salmon et al. 2011) */
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+/** Counter based random number generator. Returns a uniform deviate
+  * that is a pure function of (seed, id, ctr): the Philox4x32-10
+  * bijection of Salmon et al., "Parallel random numbers: as easy as
+  * 1, 2, 3", SC'11. There is no hidden state, so streams keyed on,
+  * e.g., a particle number and a time step index give the same draws
+  * regardless of the order (or the thread) in which they are made.
+  *
+  * @param seed user seed (key).
+  * @param id stream identifier, e.g. particle number.
+  * @param ctr position within the stream.
+  * @return Random number in the range (0,1), 53 bit resolution.
+  */
+double ran_ctr(unsigned long seed, unsigned long id, unsigned long ctr)
+{
+  uint32_t c0 = (uint32_t)ctr, c1 = (uint32_t)((uint64_t)ctr >> 32);
+  uint32_t c2 = (uint32_t)id, c3 = (uint32_t)((uint64_t)id >> 32);
+  uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)((uint64_t)seed >> 32);
+  uint64_t r;
+  int i;
+
+  for (i = 0; i < 10; i++) {
+    uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+    uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+    uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+    uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+    c1 = (uint32_t)p1;
+    c3 = (uint32_t)p0;
+    c0 = n0;
+    c2 = n2;
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+  r = ((uint64_t)c0 << 32 | c1) >> 11;
+  return (((double)r + 0.5) * (1.0 / 9007199254740992.0));
+}
+
+#undef PHILOX_M0
+#undef PHILOX_M1
+#undef PHILOX_W0
+#undef PHILOX_W1
@@ -10,6 +10,7 @@
  *  Contains a number of ODE integrators, including:
  *   - dopri8(): Solution of ODE by 7/8 order Dorman-Prince method
  *   - dopri5(): Solution of ODE by 4/5 order Dorman-Prince method
+ *   - dopri5_batch(): dopri5() for a batch of independent systems
  *
  *  \copyright
  *  Copyright (c) 2018. Commonwealth Scientific and Industrial
@@ -671,6 +672,283 @@ int dopri5(derivfn calc,        /** function computing the first derivatives */
   return 1;
 }
 
+/** dopri5_batch():
+ *
+ * Batched version of dopri5() that advances nl independent systems of the
+ * same dimension together. The stage arrays are kept in structure-of-arrays
+ * layout (y[i * nl + l] is variable i of lane l) so that the Runge-Kutta
+ * stage updates vectorise across lanes. Each lane has its own time, step
+ * size control and statistics; a lane whose step is rejected is repeated
+ * while the accepted lanes move on, and a lane is masked out of the
+ * derivative calls once it reaches xend. The arithmetic for every lane is
+ * identical to dopri5(), so each lane gives the same result as a scalar
+ * call.
+ *
+ * The call to `dopri5_batch()' returns 1 if all lanes succeeded; 0
+ * otherwise, with the status of each lane (1 or 0) stored in `status'.
+ * The lane states `y[l]' and initial stepsizes `h0[l]' are updated in
+ * place as for dopri5().
+ */
+int dopri5_batch(derivfn_batch calc, /** function computing the first derivatives
+                                         for all active lanes */
+                 int n,              /** dimension of each system */
+                 int nl,             /** number of lanes (systems) */
+                 double x0,          /** initial X-value */
+                 double **y,         /** Y-values of each lane */
+                 double xend,        /** final X-value */
+                 double eps,         /** local tolerance */
+                 double hmax,        /** maximal stepsize */
+                 double **h0,        /** initial stepsize guess of each lane */
+                 intfinal_batch final, /** final procedure */
+                 void *custom_data,  /** any custom data */
+                 int *status         /** lane status (output) */
+		 )
+{
+  /* Direction from x to xmax. */
+  double posneg = (xend > x0) ? 1.0 : -1.0;
+  int nn = n * nl;
+  /* Work arrays. */
+  double *k = malloc(nn * 7 * sizeof(double));
+  double *ys = k;
+  double *k1 = &k[nn];
+  double *k2 = &k[nn * 2];
+  double *k3 = &k[nn * 3];
+  double *k4 = &k[nn * 4];
+  double *k5 = &k[nn * 5];
+  double *y1 = &k[nn * 6];
+  /* Lane work arrays. */
+  double *lw = malloc(nl * 4 * sizeof(double));
+  double *x = lw;
+  double *xs = &lw[nl];
+  double *h = &lw[nl * 2];
+  double *err = &lw[nl * 3];
+  int *iw = malloc(nl * 7 * sizeof(int));
+  int *active = iw;
+  int *reject = &iw[nl];
+  int *trunc = &iw[nl * 2];
+  int *nfcn = &iw[nl * 3];
+  int *nstep = &iw[nl * 4];
+  int *naccpt = &iw[nl * 5];
+  int *nrejct = &iw[nl * 6];
+  double *yl = malloc(n * 2 * sizeof(double));
+  double *y1l = &yl[n];
+  double xph, fac, hnew;
+  int nactive = nl;
+  int ok = 1;
+  int i, l;
+
+  memset(k, 0, nn * 7 * sizeof(double));
+  eps = max(eps, 13.0 * UROUND);
+  for (l = 0; l < nl; ++l) {
+    x[l] = x0;
+    h[l] = min(max(1.0e-10, fabs(*h0[l])), hmax) * posneg;
+    active[l] = 1;
+    reject[l] = 0;
+    nfcn[l] = 1;
+    nstep[l] = naccpt[l] = nrejct[l] = 0;
+    status[l] = 1;
+    for (i = 0; i < n; ++i)
+      ys[i * nl + l] = y[l][i];
+  }
+
+  calc(nl, active, x, ys, k1, custom_data);
+
+  /* Main cycle. */
+  while (nactive) {
+
+    /* Retire the lanes that have reached the end point. */
+    for (l = 0; l < nl; ++l) {
+      if (!active[l])
+	continue;
+      if (((x[l] - xend) * posneg + UROUND) > 0.0) {
+	if (final != NULL) {
+	  for (i = 0; i < n; ++i) {
+	    yl[i] = ys[i * nl + l];
+	    y1l[i] = k1[i * nl + l];
+	  }
+	  final(l, n, x[l], yl, y1l, naccpt[l], nrejct[l], nfcn[l],
+		custom_data);
+	}
+	emslog(LMETRIC,"dopri5_batch lane %d iterations: %d \n", l, nstep[l]);
+	active[l] = 0;
+	nactive--;
+	continue;
+      }
+      if (nstep[l] > NMAX) {
+	emslog(LERROR, "dopri5_batch(): Could not proceed: nstep > NMAX in lane %d.\n", l);
+	stats(nfcn[l], nstep[l], naccpt[l], nrejct[l]);
+	status[l] = ok = 0;
+	active[l] = 0;
+	nactive--;
+	continue;
+      }
+      if ((x[l] + 0.1 * h[l]) == x[l]) {
+	emslog(LERROR,
+	       "dopri5_batch(): Could not proceed: (x + 0.1 * step) == x in lane %d.\n", l);
+	stats(nfcn[l], nstep[l], naccpt[l], nrejct[l]);
+	status[l] = ok = 0;
+	active[l] = 0;
+	nactive--;
+	continue;
+      }
+      if (((x[l] + h[l] - xend) * posneg) > 0.0) {
+	h[l] = xend - x[l];
+	trunc[l] = 1;
+      } else
+	trunc[l] = 0;
+    }
+    if (!nactive)
+      break;
+
+    /* First six stages. Retired lanes are carried along but not */
+    /* evaluated or updated.                                      */
+    for (i = 0; i < n; ++i)
+      for (l = 0; l < nl; ++l) {
+	int j = i * nl + l;
+	y1[j] = ys[j] + h[l] * 0.2 * k1[j];
+      }
+    for (l = 0; l < nl; ++l)
+      xs[l] = x[l] + 0.2 * h[l];
+    calc(nl, active, xs, y1, k2, custom_data);
+
+    for (i = 0; i < n; ++i)
+      for (l = 0; l < nl; ++l) {
+	int j = i * nl + l;
+	y1[j] = ys[j] + h[l] * ((3.0 / 40.0) * k1[j] + (9.0 / 40.0) * k2[j]);
+      }
+    for (l = 0; l < nl; ++l)
+      xs[l] = x[l] + 0.3 * h[l];
+    calc(nl, active, xs, y1, k3, custom_data);
+
+    for (i = 0; i < n; ++i)
+      for (l = 0; l < nl; ++l) {
+	int j = i * nl + l;
+	y1[j] =
+	  ys[j] + h[l] * ((44.0 / 45.0) * k1[j] - (56.0 / 15.0) * k2[j] +
+			  (32.0 / 9.0) * k3[j]);
+      }
+    for (l = 0; l < nl; ++l)
+      xs[l] = x[l] + 0.8 * h[l];
+    calc(nl, active, xs, y1, k4, custom_data);
+
+    for (i = 0; i < n; ++i)
+      for (l = 0; l < nl; ++l) {
+	int j = i * nl + l;
+	y1[j] =
+	  ys[j] + h[l] * ((19372.0 / 6561.0) * k1[j] -
+			  (25360.0 / 2187.0) * k2[j] +
+			  (64448.0 / 6561.0) * k3[j] - (212.0 / 729.0) * k4[j]);
+      }
+    for (l = 0; l < nl; ++l)
+      xs[l] = x[l] + (8.0 / 9.0) * h[l];
+    calc(nl, active, xs, y1, k5, custom_data);
+
+    for (i = 0; i < n; ++i)
+      for (l = 0; l < nl; ++l) {
+	int j = i * nl + l;
+	y1[j] =
+	  ys[j] + h[l] * ((9017.0 / 3168.0) * k1[j] - (355.0 / 33.0) * k2[j] +
+			  (46732.0 / 5247.0) * k3[j] + (49.0 / 176.0) * k4[j] -
+			  (5103.0 / 18656.0) * k5[j]);
+      }
+    for (l = 0; l < nl; ++l)
+      xs[l] = x[l] + h[l];
+    calc(nl, active, xs, y1, k2, custom_data);
+
+    for (i = 0; i < n; ++i)
+      for (l = 0; l < nl; ++l) {
+	int j = i * nl + l;
+	y1[j] =
+	  ys[j] + h[l] * ((35.0 / 384.0) * k1[j] + (500.0 / 1113.0) * k3[j] +
+			  (125.0 / 192.0) * k4[j] - (2187.0 / 6784.0) * k5[j] +
+			  (11.0 / 84.0) * k2[j]);
+      }
+
+    /* Compute intermediate sum. */
+    for (i = 0; i < nn; ++i)
+      k2[i] =
+        (71.0 / 57600.0) * k1[i] - (71.0 / 16695.0) * k3[i] +
+        (71.0 / 1920.0) * k4[i] - (17253.0 / 339200.0) * k5[i] +
+        (22.0 / 525.0) * k2[i];
+
+    /* Last stage. */
+    calc(nl, active, xs, y1, k3, custom_data);
+    for (i = 0; i < n; ++i)
+      for (l = 0; l < nl; ++l) {
+	int j = i * nl + l;
+	k4[j] = (k2[j] - (1.0 / 40.0) * k3[j]) * h[l];
+      }
+
+    /* Error estimation. */
+    for (l = 0; l < nl; ++l)
+      err[l] = 0.0;
+    for (i = 0; i < n; ++i)
+      for (l = 0; l < nl; ++l) {
+	int j = i * nl + l;
+	double denom =
+	  max(max(1.0e-5, fabs(y1[j])), max(fabs(ys[j]), 2.0 * UROUND / eps));
+	denom = k4[j] / denom;
+	err[l] += denom * denom;
+      }
+
+    /* Step size control for each lane */
+    for (l = 0; l < nl; ++l) {
+      if (!active[l])
+	continue;
+      nfcn[l] += 6;
+      err[l] = sqrt(err[l] / n);
+
+      if (isnan(err[l])) {
+	emslog(LERROR, "dopri5_batch: Stopped: err as NaN detected in lane %d\n", l);
+	status[l] = ok = 0;
+	active[l] = 0;
+	nactive--;
+	continue;
+      }
+
+      /* New step size. We require 0.2 <= hnew / w <= 10.0 */
+      fac = max(0.1, min(5.0, pow(err[l] / eps, 0.2) / 0.9));
+      hnew = h[l] / fac;
+      xph = xs[l];
+
+      if (err[l] < eps) {
+	naccpt[l]++;
+	for (i = 0; i < n; ++i) {
+	  int j = i * nl + l;
+	  k1[j] = k3[j];
+	  ys[j] = y1[j];
+	  y[l][i] = y1[j];
+	}
+	x[l] = xph;
+	if (fabs(hnew) > hmax)
+	  hnew = posneg * hmax;
+	if (reject[l])
+	  hnew = posneg * min(fabs(hnew), fabs(h[l]));
+	reject[l] = 0;
+	h[l] = hnew;
+	/* Store back the step size if this step has not been truncated */
+	/* to match the end point or it was the first step              */
+	if (naccpt[l] == 1 || !trunc[l])
+	  *h0[l] = hnew;
+      } else {
+	reject[l] = 1;
+	h[l] = hnew;
+	if (naccpt[l] >= 1)
+	  nrejct[l]++;
+      }
+
+      nstep[l]++;
+    }
+  }
+
+  free(yl);
+  free(iw);
+  free(lw);
+  free(k);
+
+  return ok;
+}
+
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 #undef NMAX
 #define NMAX 100000
@@ -41,6 +41,11 @@ void dp_init(master_t *master,
 
   int nn, n;
 
+  /* Windows are all stepped in this process unless distributed     */
+  dp.local = NULL;
+  dp.exchange = NULL;
+  dp.report = NULL;
+
   /* Setup the threading strategy (e.g. none, pthreads, etc). */
 #if defined(HAVE_PTHREADS)
   if (strcasecmp(master->params->dp_mode, "pthreads") == 0) {
@@ -60,6 +65,9 @@ void dp_init(master_t *master,
     dp.vel3d_gather_post_p2 = dp_pthread_vel3d_gather_post_p2;
     dp.tracer_step = dp_pthread_tracer_step;
     dp.tracer_gather_step = dp_pthread_tracer_gather_step;
+    dp.transport_step = dp_pthread_transport_step;
+    dp.transport_gather_step = dp_pthread_transport_gather_step;
+    dp.report = dp_pthread_report;
   } else
 #endif
 #if defined(HAVE_MPI)
@@ -80,6 +88,21 @@ void dp_init(master_t *master,
     dp.vel3d_gather_post_p2 = dp_mpi_vel3d_gather_post_p2;
     dp.tracer_step          = dp_mpi_tracer_step;
     dp.tracer_gather_step   = dp_mpi_tracer_gather_step;
+    dp.transport_step       = dp_mpi_transport_step;
+    dp.transport_gather_step = dp_mpi_transport_gather_step;
+    dp.local                = dp_mpi_local;
+    dp.exchange             = dp_mpi_exchange;
+    /* One window per process                                        */
+    if (mpi_size != nwindows)
+      hd_quit("DP_MODE of MPITHREADS requires one process per window (%d processes, %d windows).\n", mpi_size, nwindows);
+    if (master->ptn)
+      hd_quit("DP_MODE of MPITHREADS does not support particle tracking.\n");
+    /* Other windows are not in this address space                   */
+    master->win_p2p = 0;
+#if defined(HAVE_OMP)
+    /* MPI is initialised for calls from the main thread only        */
+    omp_set_num_threads(1);
+#endif
   } else
 #else
   if (strcasecmp(master->params->dp_mode, "mpithreads") == 0) {
@@ -104,6 +127,8 @@ void dp_init(master_t *master,
     dp.vel3d_gather_post_p2 = dp_none_vel3d_gather_post_p2;
     dp.tracer_step = dp_none_tracer_step;
     dp.tracer_gather_step = dp_none_tracer_gather_step;
+    dp.transport_step = dp_none_transport_step;
+    dp.transport_gather_step = dp_none_transport_gather_step;
     /*
      * Note: All of the above functions are indentical to the NONE
      *       case. There are additional directives in the gateway
@@ -148,6 +173,8 @@ void dp_init(master_t *master,
     dp.vel3d_gather_post_p2 = dp_none_vel3d_gather_post_p2;
     dp.tracer_step = dp_none_tracer_step;
     dp.tracer_gather_step = dp_none_tracer_gather_step;
+    dp.transport_step = dp_none_transport_step;
+    dp.transport_gather_step = dp_none_transport_gather_step;
   }
 
   /* Setup each window and initialise. */
@@ -309,6 +336,63 @@ void dp_tracer_step(void)
   }
 }
 
+void dp_transport_step(void)
+{
+  int nn, n;
+
+#if defined(HAVE_OMP)
+#pragma omp parallel for private(nn, n)
+#endif
+  for (nn = 1; nn <= dp.nwindows; nn++) {
+    n = dp.dp_windows[1].wincon->twin[nn];
+    dp.transport_step(&dp.dp_windows[n]);
+  }
+
+  for (nn = 1; nn <= dp.nwindows; nn++) {
+    n = dp.dp_windows[1].wincon->twin[nn];
+    dp.transport_gather_step(&dp.dp_windows[n]);
+  }
+}
+
+/*
+ * Returns 1 if window wn is stepped by this process. Master code
+ * looping over the windows between the distributed steps should
+ * skip windows that are not local.
+ */
+int dp_is_local(int wn)
+{
+  if (dp.local == NULL)
+    return(1);
+  return(dp.local(wn));
+}
+
+/* Returns 1 if the windows are spread over processes */
+int dp_is_distributed(void)
+{
+  return(dp.exchange != NULL);
+}
+
+/*
+ * Transfers master data written by the local windows outside the
+ * distributed steps to the other processes (see win_data_empty_3d()
+ * for the mode flags). Does nothing if all windows are local.
+ */
+void dp_exchange(int mode)
+{
+  if (dp.exchange != NULL)
+    dp.exchange(mode);
+}
+
+/* Writes the core and memory placement of each window thread */
+void dp_write_placement(FILE *fp)
+{
+  int n;
+
+  if (dp.report == NULL)
+    return;
+  for (n = 1; n <= dp.nwindows; n++)
+    dp.report(&dp.dp_windows[n], fp);
+}
 
 /* Cleanup distributed processing */
 void dp_cleanup(void)
@@ -321,4 +405,7 @@ void dp_cleanup(void)
   }
 
   free(dp.dp_windows);
+  dp.local = NULL;
+  dp.exchange = NULL;
+  dp.report = NULL;
 }
@@ -1,18 +1,27 @@
 /*
  *
  *  ENVIRONMENTAL MODELLING SUITE (EMS)
- *  
+ *
  *  File: model/hd-us/control/dp_mpi.c
- *  
+ *
  *  Description:
  *  Manage distributed processing using MPI.
- *  
+ *
+ *  Every process performs the same setup, so the master and all
+ *  window geometries are replicated. Window n is stepped by process
+ *  n-1 only; the master copy on each process is kept consistent at
+ *  the auxiliary cells each window reads by exchanging the values
+ *  the owning window empties into the master (s2m) with the
+ *  processes whose windows fill from them (m2s). The exchange for
+ *  each step is posted with non-blocking sends and receives in the
+ *  gather part of that step.
+ *
  *  Copyright:
  *  Copyright (c) 2018. Commonwealth Scientific and Industrial
  *  Research Organisation (CSIRO). ABN 41 687 119 230. All rights
  *  reserved. See the license file for disclaimer and full
  *  use/redistribution conditions.
- *  
+ *
  *  $Id: dp_mpi.c 5873 2018-07-06 07:23:48Z riz008 $
  *
  */
@@ -27,96 +36,773 @@
 #if defined(HAVE_MPI)
 #include <mpi.h>
 
+/* Index spaces of exchanged master arrays                           */
+#define DP_C2 0                 /* Surface cells                     */
+#define DP_C3 1                 /* 3D cells                          */
+#define DP_E2 2                 /* Surface edges                     */
+#define DP_E3 3                 /* 3D edges                          */
+#define DP_NS 4
+
+/* Exchanges performed at the end of each window step                */
+#define DP_X_NVEL2D   1         /* mode2d_step_window_p1()           */
+#define DP_X_VEL2D    2         /* mode2d_step_window_p2()           */
+#define DP_X_DEPTH    3         /* Face depths in mode2d_step()      */
+#define DP_X_MIXING   4         /* mode3d_step_window_p1()           */
+#define DP_X_VEL3D    5         /* mode3d_post_window_p1()           */
+#define DP_X_WVEL     6         /* mode3d_post_window_p2()           */
+#define DP_X_TRACERS  7         /* tracer_step_window()              */
+#define DP_X_FILL     8         /* master_fill()                     */
+
+/* Master coordinates in each index space                            */
+typedef struct {
+  int n[DP_NS];
+  int *v[DP_NS];
+} dp_mpi_map_t;
+
+/* A master array to exchange                                        */
+typedef struct {
+  int space;                    /* DP_C2 .. DP_E3                    */
+  double *d;                    /* Double array, or                  */
+  int *i;                       /* integer array                     */
+} dp_mpi_var_t;
+
+/* Communication with one neighbouring window                        */
+typedef struct {
+  int rank;                     /* Process of the neighbour          */
+  dp_mpi_map_t send;            /* Our cells the neighbour fills     */
+  dp_mpi_map_t recv;            /* Neighbour cells we fill           */
+  double *sbuf, *rbuf;          /* Message buffers                   */
+  int ssz, rsz;                 /* Size of the buffers               */
+} dp_mpi_nbr_t;
+
+typedef struct {
+  int wn;                       /* Window stepped by this process    */
+  int nnbr;                     /* Number of neighbours              */
+  dp_mpi_nbr_t *nbr;            /* Neighbours                        */
+  MPI_Request *req;             /* Requests, 2 per neighbour         */
+  dp_mpi_map_t *win;            /* Wet cells of every window         */
+  dp_mpi_var_t *var;            /* Exchange list                     */
+  int nvar;                     /* Arrays in var                     */
+  int nvarmax;                  /* Size of var                       */
+  double *buf;                  /* Buffer for whole window transfers */
+  int bsz;                      /* Size of buf                       */
+} dp_mpi_plan_t;
+
+static dp_mpi_plan_t *plan = NULL;
+
+
+/*-------------------------------------------------------------------*/
+/* Returns 1 if window wn is stepped by this process                 */
+/*-------------------------------------------------------------------*/
+int dp_mpi_local(int wn)
+{
+  return(wn == mpi_rank + 1);
+}
+
+/* END dp_mpi_local()                                                */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Appends the master coordinates of window cells in vec[1..nv] that */
+/* are owned by window wn to the list v. Returns the new list size.  */
+/*-------------------------------------------------------------------*/
+static int dp_mpi_select(int *v, int nv, int *vec, int nvec, int *map,
+			 int *owner, int wn)
+{
+  int cc, c;
+
+  for (cc = 1; cc <= nvec; cc++) {
+    c = map[vec[cc]];
+    if (owner[c] == wn)
+      v[nv++] = c;
+  }
+  return(nv);
+}
+
+/* END dp_mpi_select()                                               */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Sets the auxiliary cells of window wf that are owned by window wo */
+/*-------------------------------------------------------------------*/
+static void dp_mpi_halo(dp_mpi_map_t *map, geometry_t *wf, int *ownc,
+			int *owne, int wo)
+{
+  map->v[DP_C2] = i_alloc_1d(wf->nm2sS + 1);
+  map->v[DP_C3] = i_alloc_1d(wf->nm2s + 1);
+  map->v[DP_E2] = i_alloc_1d(wf->nm2se1S + 1);
+  map->v[DP_E3] = i_alloc_1d(wf->nm2se1 + 1);
+  map->n[DP_C2] = dp_mpi_select(map->v[DP_C2], 0, wf->m2s, wf->nm2sS,
+				wf->wsa, ownc, wo);
+  map->n[DP_C3] = dp_mpi_select(map->v[DP_C3], 0, wf->m2s, wf->nm2s,
+				wf->wsa, ownc, wo);
+  map->n[DP_E2] = dp_mpi_select(map->v[DP_E2], 0, wf->m2se1, wf->nm2se1S,
+				wf->wse, owne, wo);
+  map->n[DP_E3] = dp_mpi_select(map->v[DP_E3], 0, wf->m2se1, wf->nm2se1,
+				wf->wse, owne, wo);
+}
+
+/* END dp_mpi_halo()                                                 */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Sets the wet cells of a window, as used in s2m_2d() and s2m_3d()  */
+/*-------------------------------------------------------------------*/
+static void dp_mpi_wet(dp_mpi_map_t *map, geometry_t *window)
+{
+  int cc;
+
+  map->n[DP_C2] = window->b2_t;
+  map->n[DP_C3] = window->b3_t;
+  map->n[DP_E2] = window->b2_e1;
+  map->n[DP_E3] = window->b3_e1;
+  map->v[DP_C2] = i_alloc_1d(window->b2_t + 1);
+  map->v[DP_C3] = i_alloc_1d(window->b3_t + 1);
+  map->v[DP_E2] = i_alloc_1d(window->b2_e1 + 1);
+  map->v[DP_E3] = i_alloc_1d(window->b3_e1 + 1);
+  for (cc = 1; cc <= window->b2_t; cc++)
+    map->v[DP_C2][cc - 1] = window->wsa[window->w2_t[cc]];
+  for (cc = 1; cc <= window->b3_t; cc++)
+    map->v[DP_C3][cc - 1] = window->wsa[window->w3_t[cc]];
+  for (cc = 1; cc <= window->b2_e1; cc++)
+    map->v[DP_E2][cc - 1] = window->wse[window->w2_e1[cc]];
+  for (cc = 1; cc <= window->b3_e1; cc++)
+    map->v[DP_E3][cc - 1] = window->wse[window->w3_e1[cc]];
+}
+
+/* END dp_mpi_wet()                                                  */
+/*-------------------------------------------------------------------*/
+
+
+static void dp_mpi_map_free(dp_mpi_map_t *map)
+{
+  int s;
+  for (s = 0; s < DP_NS; s++)
+    i_free_1d(map->v[s]);
+}
+
+
+/*-------------------------------------------------------------------*/
+/* Builds the exchange plan. All processes hold every window         */
+/* geometry, so both sides of each exchange are derived locally and  */
+/* are listed in the same order without any communication.           */
+/*-------------------------------------------------------------------*/
+static void dp_mpi_plan_init(master_t *master)
+{
+  geometry_t *geom = master->geom;
+  int nwindows = master->nwindows;
+  int *ownc, *owne;
+  int n, cc, s, nn, size;
+
+  plan = (dp_mpi_plan_t *)malloc(sizeof(dp_mpi_plan_t));
+  memset(plan, 0, sizeof(dp_mpi_plan_t));
+  plan->wn = mpi_rank + 1;
+
+  /*-----------------------------------------------------------------*/
+  /* The owner of each cell is the window that transfers it to the   */
+  /* master for use in other windows.                                */
+  ownc = i_alloc_1d(geom->szc);
+  owne = i_alloc_1d(geom->sze);
+  memset(ownc, 0, geom->szc * sizeof(int));
+  memset(owne, 0, geom->sze * sizeof(int));
+  for (n = 1; n <= nwindows; n++) {
+    geometry_t *window = dp.dp_windows[n].geom;
+    for (cc = 1; cc <= window->ns2m; cc++)
+      ownc[window->wsa[window->s2m[cc]]] = n;
+    for (cc = 1; cc <= window->ns2me1; cc++)
+      owne[window->wse[window->s2me1[cc]]] = n;
+  }
+
+  /*-----------------------------------------------------------------*/
+  /* Neighbours are windows that fill from, or into, this window     */
+  plan->nbr = (dp_mpi_nbr_t *)malloc(nwindows * sizeof(dp_mpi_nbr_t));
+  for (n = 1; n <= nwindows; n++) {
+    dp_mpi_nbr_t *nbr = &plan->nbr[plan->nnbr];
+    if (n == plan->wn) continue;
+    memset(nbr, 0, sizeof(dp_mpi_nbr_t));
+    nbr->rank = n - 1;
+    dp_mpi_halo(&nbr->recv, dp.dp_windows[plan->wn].geom, ownc, owne, n);
+    dp_mpi_halo(&nbr->send, dp.dp_windows[n].geom, ownc, owne, plan->wn);
+    size = 0;
+    for (s = 0; s < DP_NS; s++)
+      size += nbr->recv.n[s] + nbr->send.n[s];
+    if (size)
+      plan->nnbr++;
+    else {
+      dp_mpi_map_free(&nbr->recv);
+      dp_mpi_map_free(&nbr->send);
+    }
+  }
+  plan->req = (MPI_Request *)malloc(2 * (plan->nnbr + 1) *
+				    sizeof(MPI_Request));
+
+  /*-----------------------------------------------------------------*/
+  /* Wet cells of all windows for master_fill()                      */
+  plan->win = (dp_mpi_map_t *)malloc((nwindows + 1) * sizeof(dp_mpi_map_t));
+  for (n = 1; n <= nwindows; n++)
+    dp_mpi_wet(&plan->win[n], dp.dp_windows[n].geom);
+
+  /*-----------------------------------------------------------------*/
+  /* Exchange list; sized for each step by dp_mpi_vars().            */
+  plan->var = NULL;
+  plan->nvar = plan->nvarmax = 0;
+
+  i_free_1d(ownc);
+  i_free_1d(owne);
+
+  nn = 0;
+  for (n = 0; n < plan->nnbr; n++)
+    nn += plan->nbr[n].recv.n[DP_C2];
+  emstag(LINFO, "hd:dp_mpi:dp_mpi_plan_init",
+	 "Window %d on rank %d : %d neighbours, %d surface halo cells\n",
+	 plan->wn, mpi_rank, plan->nnbr, nn);
+}
+
+/* END dp_mpi_plan_init()                                            */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Adds a master array to the exchange list                          */
+/*-------------------------------------------------------------------*/
+static void dp_mpi_add(int space, double *d, int *i)
+{
+  dp_mpi_var_t *v;
+
+  if (d == NULL && i == NULL) return;
+  if (plan->nvar >= plan->nvarmax)
+    hd_quit("dp_mpi_add: exchange list overflow (%d arrays)\n",
+	    plan->nvarmax);
+  v = &plan->var[plan->nvar++];
+  v->space = space;
+  v->d = d;
+  v->i = i;
+}
+
+/* END dp_mpi_add()                                                  */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Adds an array listed by win_data_empty_vars() to the exchange     */
+/* list.                                                             */
+/*-------------------------------------------------------------------*/
+static void dp_mpi_add_var(geometry_t *window, int map, double *Ag,
+			   double *Al, int *iAg, int *iAl, void *data)
+{
+  int space;
+
+  switch (map) {
+  case EV_S2M:
+  case EV_W3:
+    space = DP_C3;
+    break;
+  case EV_S2ME1:
+  case EV_W3E1:
+    space = DP_E3;
+    break;
+  case EV_S2ME1S:
+  case EV_W2E1:
+  case EV_VERTIN:
+    space = DP_E2;
+    break;
+  default:
+    space = DP_C2;
+    break;
+  }
+  dp_mpi_add(space, Ag, iAg);
+}
+
+/* END dp_mpi_add_var()                                              */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Counts an array listed by win_data_empty_vars() or s2m_vars()     */
+/*-------------------------------------------------------------------*/
+static void dp_mpi_count_var(geometry_t *window, int map, double *Ag,
+			     double *Al, int *iAg, int *iAl, void *data)
+{
+  (*(int *)data)++;
+}
+
+/* END dp_mpi_count_var()                                            */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Passes the arrays exchanged for a step to fn. The window steps    */
+/* exchange the arrays win_data_empty_2d() and win_data_empty_3d()   */
+/* transfer to the master, as listed by win_data_empty_vars(); the   */
+/* full fill those s2m_2d() and s2m_3d() transfer (s2m_vars()).      */
+/*-------------------------------------------------------------------*/
+static void dp_mpi_list(master_t *master, int mode,
+			void (*fn)(geometry_t *window, int map, double *Ag,
+				   double *Al, int *iAg, int *iAl,
+				   void *data),
+			void *data)
+{
+  geometry_t *window = dp.dp_windows[plan->wn].geom;
+  window_t *windat = dp.dp_windows[plan->wn].windata;
+  win_priv_t *wincon = window->wincon;
+
+  switch (mode) {
+
+  case DP_X_NVEL2D:
+    win_data_empty_vars(master, window, windat, 2, NVELOCITY, fn, data);
+    break;
+
+  case DP_X_VEL2D:
+    win_data_empty_vars(master, window, windat, 2, VELOCITY, fn, data);
+    break;
+
+  case DP_X_DEPTH:
+    win_data_empty_vars(master, window, windat, 2, DEPTH, fn, data);
+    break;
+
+  case DP_X_MIXING:
+    win_data_empty_vars(master, window, windat, 3, MIXING, fn, data);
+    break;
+
+  case DP_X_VEL3D:
+    win_data_empty_vars(master, window, windat, 3, VELOCITY, fn, data);
+    break;
+
+  case DP_X_WVEL:
+    win_data_empty_vars(master, window, windat, 3, WVEL, fn, data);
+    break;
+
+  case DP_X_TRACERS:
+    win_data_empty_vars(master, window, windat, 3, TRACERS, fn, data);
+    break;
+
+  case DP_X_FILL:
+    s2m_vars(master, window, windat, wincon, 2, fn, data);
+    s2m_vars(master, window, windat, wincon, 3, fn, data);
+    break;
+  }
+}
+
+/* END dp_mpi_list()                                                 */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Sets the exchange list for a step, growing it to the number of    */
+/* arrays dp_mpi_list() passes.                                      */
+/*-------------------------------------------------------------------*/
+static void dp_mpi_vars(master_t *master, int mode)
+{
+  int nvar = 0;
+
+  dp_mpi_list(master, mode, dp_mpi_count_var, &nvar);
+  if (nvar > plan->nvarmax) {
+    plan->var = (dp_mpi_var_t *)realloc(plan->var,
+					nvar * sizeof(dp_mpi_var_t));
+    plan->nvarmax = nvar;
+  }
+  plan->nvar = 0;
+  dp_mpi_list(master, mode, dp_mpi_add_var, NULL);
+}
+
+/* END dp_mpi_vars()                                                 */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Size, packing and unpacking of the exchange list over a map       */
+/*-------------------------------------------------------------------*/
+static int dp_mpi_size(dp_mpi_map_t *map)
+{
+  int nv, size = 0;
+
+  for (nv = 0; nv < plan->nvar; nv++)
+    size += map->n[plan->var[nv].space];
+  return(size);
+}
+
+static void dp_mpi_pack(dp_mpi_map_t *map, double *buf)
+{
+  int nv, cc, m = 0;
+
+  for (nv = 0; nv < plan->nvar; nv++) {
+    dp_mpi_var_t *v = &plan->var[nv];
+    int *vec = map->v[v->space];
+    int n = map->n[v->space];
+    if (v->d) {
+      for (cc = 0; cc < n; cc++)
+	buf[m++] = v->d[vec[cc]];
+    } else {
+      for (cc = 0; cc < n; cc++)
+	buf[m++] = (double)v->i[vec[cc]];
+    }
+  }
+}
+
+static void dp_mpi_unpack(dp_mpi_map_t *map, double *buf)
+{
+  int nv, cc, m = 0;
+
+  for (nv = 0; nv < plan->nvar; nv++) {
+    dp_mpi_var_t *v = &plan->var[nv];
+    int *vec = map->v[v->space];
+    int n = map->n[v->space];
+    if (v->d) {
+      for (cc = 0; cc < n; cc++)
+	v->d[vec[cc]] = buf[m++];
+    } else {
+      for (cc = 0; cc < n; cc++)
+	v->i[vec[cc]] = (int)buf[m++];
+    }
+  }
+}
+
+/* END dp_mpi_pack()                                                 */
+/*-------------------------------------------------------------------*/
+
+
+static double *dp_mpi_buf(double *buf, int *sz, int size)
+{
+  if (size > *sz) {
+    if (buf) d_free_1d(buf);
+    buf = d_alloc_1d(size);
+    *sz = size;
+  }
+  return(buf);
+}
+
+
+/*-------------------------------------------------------------------*/
+/* Exchanges the master auxiliary cells with the neighbours. All     */
+/* receives are posted before the sends, and the unpacking of each   */
+/* message proceeds as it arrives.                                   */
+/*-------------------------------------------------------------------*/
+static void dp_mpi_halo_exchange(master_t *master, int mode)
+{
+  int n, nr = 0, ns = 0, size;
+
+  dp_mpi_vars(master, mode);
+  if (!plan->nvar) return;
+
+  for (n = 0; n < plan->nnbr; n++) {
+    dp_mpi_nbr_t *nbr = &plan->nbr[n];
+    plan->req[n] = MPI_REQUEST_NULL;
+    if ((size = dp_mpi_size(&nbr->recv))) {
+      nbr->rbuf = dp_mpi_buf(nbr->rbuf, &nbr->rsz, size);
+      MPI_Irecv(nbr->rbuf, size, MPI_DOUBLE, nbr->rank, mode,
+		MPI_COMM_WORLD, &plan->req[n]);
+      nr++;
+    }
+  }
+  for (n = 0; n < plan->nnbr; n++) {
+    dp_mpi_nbr_t *nbr = &plan->nbr[n];
+    plan->req[plan->nnbr + n] = MPI_REQUEST_NULL;
+    if ((size = dp_mpi_size(&nbr->send))) {
+      nbr->sbuf = dp_mpi_buf(nbr->sbuf, &nbr->ssz, size);
+      dp_mpi_pack(&nbr->send, nbr->sbuf);
+      MPI_Isend(nbr->sbuf, size, MPI_DOUBLE, nbr->rank, mode,
+		MPI_COMM_WORLD, &plan->req[plan->nnbr + n]);
+      ns++;
+    }
+  }
+  while (nr--) {
+    MPI_Waitany(plan->nnbr, plan->req, &n, MPI_STATUS_IGNORE);
+    if (n == MPI_UNDEFINED) break;
+    dp_mpi_unpack(&plan->nbr[n].recv, plan->nbr[n].rbuf);
+  }
+  if (ns)
+    MPI_Waitall(plan->nnbr, &plan->req[plan->nnbr], MPI_STATUSES_IGNORE);
+}
+
+/* END dp_mpi_halo_exchange()                                        */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Copies the wet cells of every window to all processes, so that    */
+/* the master holds the complete solution (e.g. for output).         */
+/*-------------------------------------------------------------------*/
+static void dp_mpi_fill(master_t *master)
+{
+  int n, size;
+
+  dp_mpi_vars(master, DP_X_FILL);
+  for (n = 1; n <= master->nwindows; n++) {
+    size = dp_mpi_size(&plan->win[n]);
+    plan->buf = dp_mpi_buf(plan->buf, &plan->bsz, size);
+    if (n == plan->wn)
+      dp_mpi_pack(&plan->win[n], plan->buf);
+    MPI_Bcast(plan->buf, size, MPI_DOUBLE, n - 1, MPI_COMM_WORLD);
+    if (n != plan->wn)
+      dp_mpi_unpack(&plan->win[n], plan->buf);
+  }
+}
+
+/* END dp_mpi_fill()                                                 */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Copies the window mass totals to all processes so that the master */
+/* sums them in the same order as the threaded modes.                */
+/*-------------------------------------------------------------------*/
+static void dp_mpi_totals(master_t *master)
+{
+  int n, tn, m, size;
+
+  if (!master->totals) return;
+  for (n = 1; n <= master->nwindows; n++) {
+    geometry_t *window = dp.dp_windows[n].geom;
+    window_t *windat = dp.dp_windows[n].windata;
+    size = 2 + master->ntot + window->nobc;
+    plan->buf = dp_mpi_buf(plan->buf, &plan->bsz, size);
+    if (n == plan->wn) {
+      m = 0;
+      plan->buf[m++] = windat->tmass;
+      plan->buf[m++] = windat->tvol;
+      for (tn = 0; tn < master->ntot; tn++)
+	plan->buf[m++] = windat->trtot[tn];
+      for (tn = 0; tn < window->nobc; tn++)
+	plan->buf[m++] = windat->vf[tn];
+    }
+    MPI_Bcast(plan->buf, size, MPI_DOUBLE, n - 1, MPI_COMM_WORLD);
+    if (n != plan->wn) {
+      m = 0;
+      windat->tmass = plan->buf[m++];
+      windat->tvol = plan->buf[m++];
+      for (tn = 0; tn < master->ntot; tn++)
+	windat->trtot[tn] = plan->buf[m++];
+      for (tn = 0; tn < window->nobc; tn++)
+	windat->vf[tn] = plan->buf[m++];
+    }
+  }
+}
+
+/* END dp_mpi_totals()                                               */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Master state set within a window step that all processes need     */
+/*-------------------------------------------------------------------*/
+static void dp_mpi_sync(master_t *master, int mode)
+{
+  int nwindows = master->nwindows;
+  int rs, rsg, n;
+
+  /* Crash recovery restart requested in any window                  */
+  rs = (master->crf == RS_RESTART);
+  MPI_Allreduce(&rs, &rsg, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
+  if (rsg) master->crf = RS_RESTART;
+
+  /* Tracer increment flags; the master holds those of the last      */
+  /* window emptied, as in the serial mode.                          */
+  if (mode == DP_X_VEL2D && master->ntrS)
+    MPI_Bcast(master->trincS, master->ntrS, MPI_INT, nwindows - 1,
+	      MPI_COMM_WORLD);
+  if (mode == DP_X_TRACERS && master->ntr)
+    MPI_Bcast(master->trinc, master->ntr, MPI_INT, nwindows - 1,
+	      MPI_COMM_WORLD);
+
+  /* Window CPU times                                                */
+  if (mode == DP_X_TRACERS) {
+    window_t *windat = dp.dp_windows[plan->wn].windata;
+    plan->buf = dp_mpi_buf(plan->buf, &plan->bsz, nwindows);
+    MPI_Allgather(&windat->wclk, 1, MPI_DOUBLE, plan->buf, 1, MPI_DOUBLE,
+		  MPI_COMM_WORLD);
+    for (n = 1; n <= nwindows; n++)
+      if (n != plan->wn)
+	master->wclk[n] += plan->buf[n - 1];
+  }
+
+  /* Minimum CFL time-steps                                          */
+  if (mode == DP_X_VEL3D && !(master->cfl & NONE)) {
+    struct { double v; int r; } in, out;
+    double v;
+    MPI_Allreduce(&master->mcfl2d, &v, 1, MPI_DOUBLE, MPI_MIN,
+		  MPI_COMM_WORLD);
+    master->mcfl2d = v;
+    in.v = master->mcfl3d;
+    in.r = mpi_rank;
+    MPI_Allreduce(&in, &out, 1, MPI_DOUBLE_INT, MPI_MINLOC, MPI_COMM_WORLD);
+    master->mcfl3d = out.v;
+    MPI_Bcast(&master->cflc, 1, MPI_INT, out.r, MPI_COMM_WORLD);
+  }
+}
+
+/* END dp_mpi_sync()                                                 */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Performs the exchange following a window step                     */
+/*-------------------------------------------------------------------*/
+static void dp_mpi_gather(dp_window_t *dpw, int mode)
+{
+  master_t *master = dpw->master;
+
+  if (!dp_mpi_local(dpw->window_id)) return;
+  if (plan == NULL) dp_mpi_plan_init(master);
+  if (mode)
+    dp_mpi_halo_exchange(master, mode);
+  dp_mpi_sync(master, mode);
+}
+
+/* END dp_mpi_gather()                                               */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Exchanges requested outside the window steps (see dp_exchange())  */
+/*-------------------------------------------------------------------*/
+void dp_mpi_exchange(int mode)
+{
+  if (plan == NULL) dp_mpi_plan_init(master);
+
+  if (mode & DEPTH)
+    dp_mpi_halo_exchange(master, DP_X_DEPTH);
+  if (mode & TMASS)
+    dp_mpi_totals(master);
+  if (mode & MFILL)
+    dp_mpi_fill(master);
+}
+
+/* END dp_mpi_exchange()                                             */
+/*-------------------------------------------------------------------*/
+
 
 void dp_mpi_init(dp_window_t *dpw)
 {
-  
+  dpw->private_data = NULL;
 }
 
 
 void dp_mpi_cleanup(dp_window_t *dpw)
 {
-  
+  int n;
+
+  if (!dp_mpi_local(dpw->window_id) || plan == NULL) return;
+
+  for (n = 0; n < plan->nnbr; n++) {
+    dp_mpi_nbr_t *nbr = &plan->nbr[n];
+    dp_mpi_map_free(&nbr->recv);
+    dp_mpi_map_free(&nbr->send);
+    if (nbr->sbuf) d_free_1d(nbr->sbuf);
+    if (nbr->rbuf) d_free_1d(nbr->rbuf);
+  }
+  for (n = 1; n <= dpw->master->nwindows; n++)
+    dp_mpi_map_free(&plan->win[n]);
+  if (plan->buf) d_free_1d(plan->buf);
+  free(plan->win);
+  free(plan->nbr);
+  free(plan->req);
+  free(plan->var);
+  free(plan);
+  plan = NULL;
 }
 
 
 void dp_mpi_vel2d_step_p1(dp_window_t *dpw)
 {
-
+  if (dp_mpi_local(dpw->window_id))
+    dp_none_vel2d_step_p1(dpw);
 }
+
 void dp_mpi_vel2d_gather_step_p1(dp_window_t *dpw)
 {
-  
+  dp_mpi_gather(dpw, DP_X_NVEL2D);
 }
 
 void dp_mpi_vel2d_step_p2(dp_window_t *dpw)
 {
-  
+  if (dp_mpi_local(dpw->window_id))
+    dp_none_vel2d_step_p2(dpw);
 }
 
 void dp_mpi_vel2d_gather_step_p2(dp_window_t *dpw)
 {
-  
+  dp_mpi_gather(dpw, DP_X_VEL2D);
 }
 
 
 void dp_mpi_vel3d_step_p1(dp_window_t *dpw)
 {
-  
+  if (dp_mpi_local(dpw->window_id))
+    dp_none_vel3d_step_p1(dpw);
 }
 
 
 void dp_mpi_vel3d_gather_step_p1(dp_window_t *dpw)
 {
-  
+  dp_mpi_gather(dpw, DP_X_MIXING);
 }
 
 
 void dp_mpi_vel3d_step_p2(dp_window_t *dpw)
 {
-  
+  if (dp_mpi_local(dpw->window_id))
+    dp_none_vel3d_step_p2(dpw);
 }
 
 
 void dp_mpi_vel3d_gather_step_p2(dp_window_t *dpw)
 {
-  
+  dp_mpi_gather(dpw, 0);
 }
 
 
 void dp_mpi_vel3d_post_p1(dp_window_t *dpw)
 {
-  
+  if (dp_mpi_local(dpw->window_id))
+    dp_none_vel3d_post_p1(dpw);
 }
 
 
 void dp_mpi_vel3d_gather_post_p1(dp_window_t *dpw)
 {
-  
+  dp_mpi_gather(dpw, DP_X_VEL3D);
 }
 
 
 void dp_mpi_vel3d_post_p2(dp_window_t *dpw)
 {
-  
+  if (dp_mpi_local(dpw->window_id))
+    dp_none_vel3d_post_p2(dpw);
 }
 
 
 void dp_mpi_vel3d_gather_post_p2(dp_window_t *dpw)
 {
-  
+  dp_mpi_gather(dpw, DP_X_WVEL);
 }
 
 
 void dp_mpi_tracer_step(dp_window_t *dpw)
 {
-  
+  if (dp_mpi_local(dpw->window_id))
+    dp_none_tracer_step(dpw);
 }
 
 
 void dp_mpi_tracer_gather_step(dp_window_t *dpw)
 {
-  
+  dp_mpi_gather(dpw, DP_X_TRACERS);
+}
+
+
+void dp_mpi_transport_step(dp_window_t *dpw)
+{
+  if (dp_mpi_local(dpw->window_id))
+    dp_none_transport_step(dpw);
+}
+
+
+void dp_mpi_transport_gather_step(dp_window_t *dpw)
+{
+  dp_mpi_gather(dpw, 0);
 }
 
 
@@ -35,6 +35,9 @@ void mode2d_step_window_p2(master_t *master,
 void tracer_step_window(master_t *master,
                         geometry_t *window,
                         window_t *windat, win_priv_t *wincon);
+void transport_step_window(master_t *master,
+			   geometry_t *window,
+			   window_t *windat, win_priv_t *wincon);
 void mode3d_step_window_p1(master_t *master,
                            geometry_t *window,
                            window_t *windat, win_priv_t *wincon);
@@ -128,3 +131,14 @@ void dp_none_tracer_step(dp_window_t *dpw)
 void dp_none_tracer_gather_step(dp_window_t *dpw)
 {
 }
+
+void dp_none_transport_step(dp_window_t *dpw)
+{
+  TIMING_SET;
+  transport_step_window(dpw->master, dpw->geom, dpw->windata, dpw->wincon);
+  TIMING_DUMP_WIN(3, "   transport_win", dpw->window_id);
+}
+
+void dp_none_transport_gather_step(dp_window_t *dpw)
+{
+}
@@ -1,22 +1,47 @@
 /*
  *
  *  ENVIRONMENTAL MODELLING SUITE (EMS)
- *  
+ *
  *  File: model/hd-us/control/dp_pthreads.c
- *  
+ *
  *  Description:
  *  Manage distributed processing using pthreads.
- *  
+ *
+ *  Each window is stepped by a persistent thread. Commands are
+ *  handed to a window thread by bumping its request generation, and
+ *  completion is signalled by bumping its acknowledge generation.
+ *  Waiters spin for a short while before parking (on a futex under
+ *  Linux, otherwise a condition variable), so the fine grained
+ *  phases of the 2D mode are not dominated by the hand off.
+ *
+ *  The threads may be pinned to cores with DP_AFFINITY :
+ *    NONE    : no pinning (default)
+ *    COMPACT : fill the cores of one NUMA node before the next
+ *    SCATTER : alternate windows across NUMA nodes
+ *    list    : explicit core numbers, e.g. DP_AFFINITY 0 2 4 6
+ *  Windows are assigned cores in processing order, wrapping if
+ *  there are more windows than cores.
+ *
+ *  The window data is allocated and initialised by the master
+ *  thread, so it all lands on one NUMA node. Once a pinned thread
+ *  has started, its first command moves the pages of the window's
+ *  largest arrays (win_data_arrays()) to its own node, so each
+ *  socket steps windows out of local memory. The placement is
+ *  reported in the run setup file.
+ *
  *  Copyright:
  *  Copyright (c) 2018. Commonwealth Scientific and Industrial
  *  Research Organisation (CSIRO). ABN 41 687 119 230. All rights
  *  reserved. See the license file for disclaimer and full
  *  use/redistribution conditions.
- *  
+ *
  *  $Id: dp_pthreads.c 5873 2018-07-06 07:23:48Z riz008 $
  *
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
 #include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
@@ -26,7 +51,13 @@
 
 #if defined(HAVE_PTHREADS)
 #include <pthread.h>
-#include <semaphore.h>
+#include <sched.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <linux/mempolicy.h>
+#endif
 
 
 /*UR this is necessary to run -pg at compile time for multiple threads
@@ -36,6 +67,9 @@
 #include <sys/time.h>
 #endif
 
+/* Number of polls before a waiting thread parks. Spinning is only  */
+/* useful if every thread has a core of its own.                     */
+#define DP_SPIN 20000
 
 
 typedef enum {DP_CMD_VEL2D_STEP_P1=1,
@@ -45,22 +79,291 @@ typedef enum {DP_CMD_VEL2D_STEP_P1=1,
   DP_CMD_VEL3D_POST_P1,
   DP_CMD_VEL3D_POST_P2,
   DP_CMD_TRACER_STEP,
+  DP_CMD_TRANSPORT_STEP,
+  DP_CMD_PLACE,
   DP_CMD_EXIT = -1
 } dp_pthread_cmd_t;
 
+/* A generation counter that can be waited on                        */
+typedef struct {
+  int gen;                      /* Generation, bumped by the poster */
+  int parked;                   /* Non-zero if a waiter is parked */
+#if !defined(__linux__)
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+#endif
+} dp_gen_t;
+
 typedef struct {
   pthread_t thread;
   pthread_attr_t attr;
-  pthread_mutex_t mutex;
-  sem_t sem_request;
-  sem_t sem_response;
+  dp_gen_t req;                 /* Request generation */
+  dp_gen_t ack;                 /* Completed generation */
+  int seen;                     /* Last request processed */
+  int sent;                     /* Last request posted */
+  int cpu;                      /* Core the thread is pinned to */
+  int node;                     /* NUMA node of the window data */
+  double placed;                /* Bytes moved to node */
   dp_pthread_cmd_t cmd;
 #ifdef HAVE_GPROF
   struct itimerval itimer;
 #endif
 } dp_pthread_t;
 
+/* Core assignment, built when the first window is initialised       */
+static int *dp_cpus = NULL;
+static int dp_ncpu = 0;
+static int dp_nthread = 0;
+static int dp_spin = DP_SPIN;
+
+
+/*-------------------------------------------------------------------*/
+/* Generation counters                                               */
+/*-------------------------------------------------------------------*/
+static inline void dp_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+static void dp_gen_init(dp_gen_t *g)
+{
+  g->gen = 0;
+  g->parked = 0;
+#if !defined(__linux__)
+  pthread_mutex_init(&g->mutex, NULL);
+  pthread_cond_init(&g->cond, NULL);
+#endif
+}
+
+static void dp_gen_destroy(dp_gen_t *g)
+{
+#if !defined(__linux__)
+  pthread_cond_destroy(&g->cond);
+  pthread_mutex_destroy(&g->mutex);
+#endif
+}
+
+/*
+ * Waits until the generation differs from old and returns it
+ */
+static int dp_gen_wait(dp_gen_t *g, int old)
+{
+  int n, gen;
+
+  for (n = 0; n < dp_spin; n++) {
+    if ((gen = __atomic_load_n(&g->gen, __ATOMIC_ACQUIRE)) != old)
+      return(gen);
+    dp_relax();
+  }
+
+  /* Park. The parked flag is raised before the generation is       */
+  /* re-checked, and the poster bumps the generation before reading */
+  /* the flag, so a wake up cannot be missed.                       */
+  __atomic_store_n(&g->parked, 1, __ATOMIC_SEQ_CST);
+#if defined(__linux__)
+  while ((gen = __atomic_load_n(&g->gen, __ATOMIC_SEQ_CST)) == old)
+    syscall(SYS_futex, &g->gen, FUTEX_WAIT_PRIVATE, old, NULL, NULL, 0);
+#else
+  pthread_mutex_lock(&g->mutex);
+  while ((gen = __atomic_load_n(&g->gen, __ATOMIC_SEQ_CST)) == old)
+    pthread_cond_wait(&g->cond, &g->mutex);
+  pthread_mutex_unlock(&g->mutex);
+#endif
+  __atomic_store_n(&g->parked, 0, __ATOMIC_RELAXED);
+  return(gen);
+}
+
+/*
+ * Bumps the generation, waking the waiter if it has parked
+ */
+static void dp_gen_post(dp_gen_t *g)
+{
+  __atomic_add_fetch(&g->gen, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&g->parked, __ATOMIC_SEQ_CST)) {
+#if defined(__linux__)
+    syscall(SYS_futex, &g->gen, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+    pthread_mutex_lock(&g->mutex);
+    pthread_cond_signal(&g->cond);
+    pthread_mutex_unlock(&g->mutex);
+#endif
+  }
+}
+
+
+/*-------------------------------------------------------------------*/
+/* Core assignment                                                   */
+/*-------------------------------------------------------------------*/
+#if defined(__linux__)
+/*
+ * Reads a cpulist (e.g. 0-3,8-11) into mask
+ */
+static void dp_read_cpulist(char *fname, cpu_set_t *mask)
+{
+  FILE *fp;
+  char buf[MAXSTRLEN], *s;
+  int c0, c1, c;
+
+  CPU_ZERO(mask);
+  if ((fp = fopen(fname, "r")) == NULL)
+    return;
+  if (fgets(buf, MAXSTRLEN, fp) != NULL) {
+    s = buf;
+    while (*s && isdigit((int)*s)) {
+      c0 = c1 = (int)strtol(s, &s, 10);
+      if (*s == '-')
+	c1 = (int)strtol(s + 1, &s, 10);
+      for (c = c0; c <= c1 && c < CPU_SETSIZE; c++)
+	CPU_SET(c, mask);
+      if (*s == ',') s++;
+    }
+  }
+  fclose(fp);
+}
+#endif
 
+/*
+ * Builds the list of cores to pin window threads to
+ */
+static void dp_build_cpus(char *affinity)
+{
+#if defined(__linux__)
+  cpu_set_t allowed, node[64];
+  char fname[MAXSTRLEN], *s;
+  int nnode = 0, n, c, i, scatter = 0;
+
+  dp_ncpu = 0;
+  if (!strlen(affinity) || strcasecmp(affinity, "NONE") == 0)
+    return;
+  dp_cpus = i_alloc_1d(CPU_SETSIZE);
+
+  /* Explicit list of cores                                          */
+  if (isdigit((int)affinity[0])) {
+    s = affinity;
+    while (*s && dp_ncpu < CPU_SETSIZE) {
+      dp_cpus[dp_ncpu++] = (int)strtol(s, &s, 10);
+      while (*s && !isdigit((int)*s)) s++;
+    }
+    return;
+  }
+
+  if (strcasecmp(affinity, "COMPACT") == 0)
+    scatter = 0;
+  else if (strcasecmp(affinity, "SCATTER") == 0)
+    scatter = 1;
+  else
+    hd_quit("DP_AFFINITY %s not recognised; use NONE, COMPACT, SCATTER or a list of cores.\n", affinity);
+
+  /* Cores available to the process, grouped by NUMA node            */
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    hd_warn("DP_AFFINITY : can't get the process affinity; threads not pinned.\n");
+    return;
+  }
+  for (n = 0; n < 64; n++) {
+    sprintf(fname, "/sys/devices/system/node/node%d/cpulist", n);
+    dp_read_cpulist(fname, &node[nnode]);
+    CPU_AND(&node[nnode], &node[nnode], &allowed);
+    if (CPU_COUNT(&node[nnode])) nnode++;
+  }
+  if (!nnode) {
+    node[0] = allowed;
+    nnode = 1;
+  }
+
+  if (scatter) {
+    /* i-th core of each node in turn                                */
+    int *next = i_alloc_1d(nnode);
+    int found = 1;
+    memset(next, 0, nnode * sizeof(int));
+    while (found) {
+      found = 0;
+      for (n = 0; n < nnode; n++) {
+	for (c = next[n]; c < CPU_SETSIZE; c++)
+	  if (CPU_ISSET(c, &node[n])) break;
+	if (c < CPU_SETSIZE) {
+	  dp_cpus[dp_ncpu++] = c;
+	  next[n] = c + 1;
+	  found = 1;
+	}
+      }
+    }
+    i_free_1d(next);
+  } else {
+    for (n = 0; n < nnode; n++)
+      for (c = 0; c < CPU_SETSIZE; c++)
+	if (CPU_ISSET(c, &node[n])) dp_cpus[dp_ncpu++] = c;
+  }
+  if (DEBUG("init_w")) {
+    dlog("init_w", "DP_AFFINITY %s : %d cores on %d NUMA nodes\n",
+	 affinity, dp_ncpu, nnode);
+    for (i = 0; i < dp_ncpu; i++)
+      dlog("init_w", " %d", dp_cpus[i]);
+    dlog("init_w", "\n");
+  }
+#else
+  if (strlen(affinity) && strcasecmp(affinity, "NONE"))
+    hd_warn("DP_AFFINITY is only supported on Linux; threads not pinned.\n");
+  dp_ncpu = 0;
+#endif
+}
+
+
+/*-------------------------------------------------------------------*/
+/* Memory placement                                                  */
+/*-------------------------------------------------------------------*/
+#define DP_NARRAY 128
+
+/*
+ * Moves the pages of the window's largest arrays to the NUMA node
+ * of the calling thread. Only pages lying wholly within an array
+ * are moved, so neighbouring allocations are left alone.
+ */
+static void dp_place_window(dp_window_t *dpw)
+{
+  dp_pthread_t *td = (dp_pthread_t *)dpw->private_data;
+  void *ptr[DP_NARRAY];
+  size_t len[DP_NARRAY];
+  int n, na;
+
+  td->node = -1;
+  td->placed = 0.0;
+  if (dpw->master->nwindows <= 1) return;
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_getcpu)
+  {
+    unsigned long mask[16];
+    unsigned long page = (unsigned long)sysconf(_SC_PAGESIZE);
+    unsigned cpu, node;
+    int nb = 8 * sizeof(unsigned long);
+
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) || node >= 16 * nb)
+      return;
+    memset(mask, 0, sizeof(mask));
+    mask[node / nb] = 1UL << (node % nb);
+
+    na = win_data_arrays(dpw->geom, dpw->windata, dpw->wincon,
+			 ptr, len, DP_NARRAY);
+    for (n = 0; n < na; n++) {
+      unsigned long s = ((unsigned long)ptr[n] + page - 1) & ~(page - 1);
+      unsigned long e = ((unsigned long)ptr[n] + len[n]) & ~(page - 1);
+      if (e <= s) continue;
+      if (syscall(SYS_mbind, (void *)s, e - s, MPOL_PREFERRED, mask,
+		  16 * nb + 1, MPOL_MF_MOVE) == 0)
+	td->placed += (double)(e - s);
+    }
+    td->node = node;
+    if (DEBUG("init_w"))
+      dlog("init_w", "  Window %d : %d arrays, %.1f Mb placed on node %d\n",
+	   dpw->window_id, na, td->placed / 1048576.0, td->node);
+  }
+#endif
+}
+
+
+/*-------------------------------------------------------------------*/
+/* Window threads                                                    */
+/*-------------------------------------------------------------------*/
 static void *dp_window_thread(void *p)
 {
   dp_window_t *dpw = (dp_window_t *)p;
@@ -70,19 +373,11 @@ static void *dp_window_thread(void *p)
   while (!finished) {
 
     dp_pthread_cmd_t cmd;
-    /*printf("Thread %ld - Waiting for request from %i\n", pthread_self(),td);*/
-    /* Wait for request */
-    sem_wait(&td->sem_request);
-
-    /*printf("Thread %ld - Received request from %i\n", pthread_self(),td); */
 
-    /* Process request */
-    pthread_mutex_lock(&td->mutex);
+    /* Wait for request. The command is published before the        */
+    /* request generation, so it is visible once the wait returns.  */
+    td->seen = dp_gen_wait(&td->req, td->seen);
     cmd = td->cmd;
-    pthread_mutex_unlock(&td->mutex);
-
-    /*printf("Thread %ld - Processing request %d from %i\n", pthread_self(),cmd,td); */
-
 
     switch (cmd) {
 
@@ -114,14 +409,21 @@ static void *dp_window_thread(void *p)
       dp_none_tracer_step(dpw);
       break;
 
+    case DP_CMD_TRANSPORT_STEP:
+      dp_none_transport_step(dpw);
+      break;
+
+    case DP_CMD_PLACE:
+      dp_place_window(dpw);
+      break;
+
     case DP_CMD_EXIT:
       finished = 1;
       break;
     }
 
     /* Acknowledge completion */
-    sem_post(&td->sem_response);
-    /*printf("Thread %ld - Finished request %d from %i\n", pthread_self(),cmd,td); */
+    dp_gen_post(&td->ack);
   }
 
   pthread_exit((void *)NULL);
@@ -137,21 +439,19 @@ static void dp_pthread_send_cmd(dp_window_t *dpw, dp_pthread_cmd_t cmd)
   setitimer(ITIMER_PROF, &(td->itimer), NULL);
 #endif
 
-  pthread_mutex_lock(&td->mutex);
   td->cmd = cmd;
-  pthread_mutex_unlock(&td->mutex);
+  td->sent = __atomic_load_n(&td->ack.gen, __ATOMIC_ACQUIRE);
 
-  /* release the qeue to process the command */
-  sem_post(&td->sem_request);
+  /* release the thread to process the command */
+  dp_gen_post(&td->req);
 }
 
 static void dp_pthread_gather(dp_window_t *dpw)
 {
   dp_pthread_t *td = (dp_pthread_t *)dpw->private_data;
-/*printf("Thread %ld - wait for response %i \n", pthread_self(),td); */
-  /* wait for the qeue to finish the command */
-  sem_wait(&td->sem_response);
-/* printf("Thread %ld - past response %i \n", pthread_self(),td);*/
+
+  /* wait for the thread to finish the command */
+  dp_gen_wait(&td->ack, td->sent);
 }
 
 
@@ -159,17 +459,74 @@ static void dp_pthread_gather(dp_window_t *dpw)
 void dp_pthread_init(dp_window_t *dpw)
 {
   dp_pthread_t *td = (dp_pthread_t *)malloc(sizeof(dp_pthread_t));
+
+  if (dp_nthread == 0) {
+    long ncore = sysconf(_SC_NPROCESSORS_ONLN);
+    dp_build_cpus(dpw->master->params->dp_affinity);
+    /* The master thread also waits, so windows + 1 cores are needed */
+    dp_spin = (ncore > dpw->master->nwindows) ? DP_SPIN : 0;
+  }
+
   pthread_attr_init(&td->attr);
-  pthread_attr_setdetachstate(&td->attr, PTHREAD_CREATE_DETACHED);
+  pthread_attr_setdetachstate(&td->attr, PTHREAD_CREATE_JOINABLE);
   pthread_attr_setschedpolicy(&td->attr, SCHED_OTHER);
-  pthread_mutex_init(&td->mutex, NULL);
-  sem_init(&td->sem_request, 0,0);
-  sem_init(&td->sem_response, 0,0);
+  dp_gen_init(&td->req);
+  dp_gen_init(&td->ack);
+  td->seen = td->sent = 0;
+  td->cpu = td->node = -1;
+  td->placed = 0.0;
+#if defined(__linux__)
+  if (dp_ncpu) {
+    cpu_set_t mask;
+    td->cpu = dp_cpus[dp_nthread % dp_ncpu];
+    CPU_ZERO(&mask);
+    CPU_SET(td->cpu, &mask);
+    pthread_attr_setaffinity_np(&td->attr, sizeof(mask), &mask);
+    if (DEBUG("init_w"))
+      dlog("init_w", "  Window %d thread pinned to core %d\n",
+	   dpw->window_id, td->cpu);
+  }
+#endif
+  dp_nthread++;
 #ifdef HAVE_GPROF
   getitimer(ITIMER_PROF, &(td->itimer));
 #endif
   dpw->private_data = td;
-  pthread_create(&td->thread, &td->attr, dp_window_thread, dpw);
+  if (pthread_create(&td->thread, &td->attr, dp_window_thread, dpw)) {
+    /* Most likely a core that is not available to the process      */
+    if (td->cpu >= 0) {
+      hd_warn("dp_pthread_init: can't pin window %d to core %d; thread not pinned.\n",
+	      dpw->window_id, td->cpu);
+      pthread_attr_destroy(&td->attr);
+      pthread_attr_init(&td->attr);
+      pthread_attr_setdetachstate(&td->attr, PTHREAD_CREATE_JOINABLE);
+      td->cpu = -1;
+    }
+    if (pthread_create(&td->thread, &td->attr, dp_window_thread, dpw))
+      hd_quit("dp_pthread_init: can't create thread for window %d.\n",
+	      dpw->window_id);
+  }
+
+  /* Move the window data next to the core that steps it. Threads   */
+  /* that are not pinned may wander, so are left alone.             */
+  if (td->cpu >= 0) {
+    dp_pthread_send_cmd(dpw, DP_CMD_PLACE);
+    dp_pthread_gather(dpw);
+  }
+}
+
+void dp_pthread_report(dp_window_t *dpw, FILE *fp)
+{
+  dp_pthread_t *td = (dp_pthread_t *)dpw->private_data;
+
+  if (td->cpu < 0)
+    fprintf(fp, "  Window %d : thread not pinned\n", dpw->window_id);
+  else if (td->node < 0)
+    fprintf(fp, "  Window %d : core %d, data not placed\n",
+	    dpw->window_id, td->cpu);
+  else
+    fprintf(fp, "  Window %d : core %d, NUMA node %d, %.1f Mb placed\n",
+	    dpw->window_id, td->cpu, td->node, td->placed / 1048576.0);
 }
 
 void dp_pthread_cleanup(dp_window_t *dpw)
@@ -178,11 +535,19 @@ void dp_pthread_cleanup(dp_window_t *dpw)
 
   dp_pthread_send_cmd(dpw, DP_CMD_EXIT);
   dp_pthread_gather(dpw);
+  /* The thread may still be posting the acknowledgement            */
+  pthread_join(td->thread, NULL);
 
-  sem_destroy(&td->sem_response);
-  sem_destroy(&td->sem_request);
-  pthread_mutex_destroy(&td->mutex);
+  dp_gen_destroy(&td->ack);
+  dp_gen_destroy(&td->req);
+  pthread_attr_destroy(&td->attr);
   free(td);
+
+  if (--dp_nthread == 0 && dp_cpus) {
+    i_free_1d(dp_cpus);
+    dp_cpus = NULL;
+    dp_ncpu = 0;
+  }
 }
 
 void dp_pthread_vel2d_step_p1(dp_window_t *dpw)
@@ -255,4 +620,14 @@ void dp_pthread_tracer_gather_step(dp_window_t *dpw)
   dp_pthread_gather(dpw);
 }
 
+void dp_pthread_transport_step(dp_window_t *dpw)
+{
+  dp_pthread_send_cmd(dpw, DP_CMD_TRANSPORT_STEP);
+}
+
+void dp_pthread_transport_gather_step(dp_window_t *dpw)
+{
+  dp_pthread_gather(dpw);
+}
+
 #endif
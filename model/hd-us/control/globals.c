@@ -97,6 +97,7 @@ long tfp_pos = 0;
 int timing_counter = 1;
 int timing_level = TIMING_LEVEL_DEF;
 #endif // DO_TIMING
+int prof_on = 0;
 
 // EOF
 
@@ -523,6 +523,11 @@ int main(int argc, char *argv[])
   ems_init(prmfd, 0);
 
   INIT_TIMING;
+  prof_init(prmfd);
+
+  /* The set-up reads its files while the I/O threads may already  */
+  /* be reading ahead (see lib/io/dfprefetch.c).                   */
+  df_nc_lock();
 
 /* 
  * Schedule the events and the main data.
@@ -532,6 +537,7 @@ int main(int argc, char *argv[])
   TIMING_SET;
   hd_data = hd_init(prmfd);
   TIMING_DUMP(0, "hd_init");
+  df_nc_unlock();
 
   /* 
    * Start the main loop
@@ -567,23 +573,34 @@ int main(int argc, char *argv[])
 
     if (hd_data->master->runmode == VEL3D) {
       TIMING_SET;
+      PROF_BEGIN("hd_step", 0);
       hd_step(hd_data, stop_at);
+      PROF_END;
       TIMING_DUMP(0, "hd_step");
-    } else if (hd_data->master->runmode == VEL2D)
+    } else if (hd_data->master->runmode == VEL2D) {
+      PROF_BEGIN("hd_step_2d", 0);
       hd_step_2d(hd_data, stop_at);
-    else if (hd_data->master->runmode & TRANS) {
+      PROF_END;
+    } else if (hd_data->master->runmode & TRANS) {
       TIMING_SET;
+      PROF_BEGIN("hd_step_trans", 0);
       hd_step_trans(hd_data, stop_at);
+      PROF_END;
       TIMING_DUMP(0, "hd_step_trans");
     }
 
     TIMING_SET;
+    PROF_BEGIN("event", 0);
     sched_set_time(schedule, stop_at);
+    PROF_END;
     TIMING_DUMP(0, "event");
 
     TIMING_COUNTER;
   }
 
+  /* The final dumps and closes hold the netCDF lock as the set-up */
+  df_nc_lock();
+
   // Dump this time point when killed
   if (killed) {
     dump_snapshot(sched_get_even_by_name(schedule, "dumps"), schedule->t);
@@ -605,6 +622,11 @@ int main(int argc, char *argv[])
  */
   timeseries_end();
 
+/* Write the runtime profile, if requested.
+ */
+  prof_write(hd_data->master->opath, hd_data->master->geom->b3_t,
+	     hd_data->master->nstep);
+
 /* Destroy the grid, and deallocate any memory associated with them.
  */
   master_end(master);
@@ -612,6 +634,7 @@ int main(int argc, char *argv[])
 /* Remove the time scheduler.
  */
   sched_end(schedule);
+  df_nc_unlock();
 
 /* Close the parameter file.
  */
@@ -28,38 +28,14 @@
 #include <time.h>
 #include <unistd.h>
 
-typedef struct {
-  pthread_t thread;
-  pthread_attr_t attr;
-#ifdef HAVE_GPROF
-  struct itimerval itimer;
-#endif
-} sched_pthread_t;
-
+/* Dispatch for SCHED_MODE pthreads. The dispatch function only     */
+/* hands the event over to its persistent writer thread (see        */
+/* dump_dispatch()), so it is called directly rather than from a    */
+/* new thread per dispatch.                                         */
 double schedDPdispatch(sched_event_t* dispatch, double t)
 {
-  sched_pthread_t *td = (sched_pthread_t *)malloc(sizeof(sched_pthread_t));
-  pthread_attr_init(&td->attr);
-  pthread_attr_setschedpolicy(&td->attr, SCHED_OTHER);
-
-#ifdef HAVE_GPROF
-  getitimer(ITIMER_PROF, &(td->itimer));
-#endif
-
-  emstag(LDEBUG,"hd:scheduler:schedDPdispatch","dispatching event '%s', at %1.1d until %1.1d (sec)",dispatch->name,t,schedule->stop_time);
-
-  /* I'm not sure if this if statement is ever hit or is needed */
-  if(t >= schedule->stop_time) {
-    emstag(LDEBUG,"hd:scheduler:schedDPdispatch","Last call, joining thread...");
-    pthread_attr_setdetachstate(&td->attr, PTHREAD_CREATE_JOINABLE);
-    pthread_create(&td->thread, &td->attr, dispatch->dispatch, dispatch);
-    /* we are finished, join the thread to wait */
-    pthread_join(td->thread,NULL);
-  } else { 
-    /* normal case */
-    pthread_attr_setdetachstate(&td->attr, PTHREAD_CREATE_DETACHED);
-    pthread_create(&td->thread, &td->attr, dispatch->dispatch, dispatch);
-  }
+  emstag(LDEBUG,"hd:scheduler:schedDPdispatch","dispatching event '%s', at %1.1f until %1.1f (sec)",dispatch->name,t,schedule->stop_time);
+  dispatch->dispatch(dispatch);
   return 0;
 }
 
@@ -73,6 +49,20 @@ double schedDispatch(sched_event_t* dispatch, double t)
 }
 
 
+/* Release an event and its dependency list.
+ */
+static void sched_free_event(sched_event_t *e)
+{
+  int n;
+
+  for (n = 0; n < e->ndeps; n++)
+    free(e->deps[n]);
+  if (e->deps) free(e->deps);
+  if (e->depw) free(e->depw);
+  free(e);
+}
+
+
 /* Create a time schedular structure.
  * The prmfd variable is the FILE id of the parameter file
  * from which the TIME UNITS, MODEL TIME, etc will be read.
@@ -126,6 +116,19 @@ scheduler_t *sched_init(FILE * fp,  time_t exec_start_time)
       sched->dispatch = schedDispatch;
     }
 
+  /* Number of threads used to run independent events               */
+  sched->nthreads = 1;
+  prm_set_errfn(hd_silent_warn);
+  prm_read_int(fp, "SCHED_EVENT_THREADS", &sched->nthreads);
+  prm_set_errfn(hd_quit);
+  if (sched->nthreads < 1) sched->nthreads = 1;
+#if !defined(HAVE_OMP)
+  if (sched->nthreads > 1) {
+    hd_warn("sched_init: SCHED_EVENT_THREADS requires OpenMP : ignored.\n");
+    sched->nthreads = 1;
+  }
+#endif
+
   return sched;
 }
 
@@ -158,7 +161,7 @@ void sched_end(scheduler_t *sched)
 	free(cur->sm_dump);
       }
 #endif
-      free(cur);
+      sched_free_event(cur);
       cur = next;
     }
     
@@ -208,6 +211,11 @@ void sched_register(scheduler_t *sched,
   e->next_event = sched->start_time;
   e->sm_fill = NULL;
   e->sm_dump = NULL;
+  e->declared = 0;
+  e->ndeps = 0;
+  e->deps = NULL;
+  e->depw = NULL;
+  e->level = 0;
 
 
 /* Initialise the routines, and get the next event.
@@ -220,7 +228,7 @@ void sched_register(scheduler_t *sched,
     /* printf("%s initialised\n",e->name); */
   } else {
     /* printf("%s freed\n",e->name); */
-    free(e);
+    sched_free_event(e);
   }
 }
 
@@ -255,11 +263,81 @@ void sched_deregister(scheduler_t *sched, char *name)
  */
     if (event->cleanup != NULL)
       event->cleanup(event, sched->t);
-    free(event);
+    sched_free_event(event);
   }
 }
 
 
+/** Declare a field or resource used by an event. Called from the
+ * event's init function. A name declared as both read and written
+ * is kept as written.
+ *
+ * @param event - the event
+ * @param name - the master field or resource (eg. an input file name)
+ * @param write - non-zero if event() writes to it
+ */
+void sched_depends_on(sched_event_t *event, char *name, int write)
+{
+  int n;
+
+  event->declared = 1;
+  for (n = 0; n < event->ndeps; n++) {
+    if (strcmp(event->deps[n], name) == 0) {
+      event->depw[n] |= write;
+      return;
+    }
+  }
+  event->deps = (char **)realloc(event->deps,
+				 (event->ndeps + 1) * sizeof(char *));
+  event->depw = (int *)realloc(event->depw, (event->ndeps + 1) * sizeof(int));
+  event->deps[event->ndeps] = strdup(name);
+  event->depw[event->ndeps] = write;
+  event->ndeps++;
+}
+
+
+/** Declare the master fields an event reads and writes. Events
+ * with declared dependencies may be run concurrently (see
+ * SCHED_EVENT_THREADS) with events they do not conflict with.
+ *
+ * @param event - the event
+ * @param reads - whitespace separated fields read by event(), may be NULL
+ * @param writes - whitespace separated fields written by event(), may be NULL
+ */
+void sched_depends(sched_event_t *event, char *reads, char *writes)
+{
+  char buf[MAXSTRLEN], *tok;
+
+  event->declared = 1;
+  if (reads != NULL) {
+    strcpy(buf, reads);
+    for (tok = strtok(buf, " \t"); tok != NULL; tok = strtok(NULL, " \t"))
+      sched_depends_on(event, tok, 0);
+  }
+  if (writes != NULL) {
+    strcpy(buf, writes);
+    for (tok = strtok(buf, " \t"); tok != NULL; tok = strtok(NULL, " \t"))
+      sched_depends_on(event, tok, 1);
+  }
+}
+
+
+/* Returns non-zero if two declared events must be run in list order,
+ * ie. one writes a field the other reads or writes.
+ */
+static int sched_conflict(sched_event_t *e1, sched_event_t *e2)
+{
+  int i, j;
+
+  for (i = 0; i < e1->ndeps; i++)
+    for (j = 0; j < e2->ndeps; j++)
+      if ((e1->depw[i] || e2->depw[j]) &&
+	  strcmp(e1->deps[i], e2->deps[j]) == 0)
+	return 1;
+  return 0;
+}
+
+
 /* Calculates the time until the next event should occur.
  */
 double sched_get_next_event(scheduler_t *sched)
@@ -280,6 +358,96 @@ double sched_get_next_event(scheduler_t *sched)
 }
 
 
+/* Wait for the work dispatched by events to finish (see the event
+ * in_progress functions), eg. a dump being written by the dump
+ * writer. The output files read the master while they write, so
+ * this is called before any event or step may change the master.
+ */
+static void sched_wait_dispatched(scheduler_t *sched)
+{
+  sched_event_t *e;
+
+  for (e = sched->head; e != NULL; e = e->next)
+    if (e->dispatch != NULL && e->in_progress != NULL)
+      e->in_progress(e);
+}
+
+
+/* Run a single event that is due.
+ */
+static void sched_run_event(scheduler_t *sched, sched_event_t *e, double t)
+{
+  sched_wait_dispatched(sched);
+  /*printf("Event %s %f\n",e->name,e->next_event);*/
+  TIMING_SET;
+  PROF_BEGIN_DYN(e->name, 0);
+  e->next_event = e->event(e, t);
+  /*printf("Schedule %s\n",e->name);*/
+  if(e->dispatch != NULL) {
+    sched->dispatch(e,t);
+  }
+  PROF_END;
+  TIMING_PRINT(" ");
+  TIMING_DUMP(1, e->name);
+}
+
+
+/* Run a batch of due events with declared dependencies, in list
+ * order. Each event is given a level one greater than the highest
+ * level of any earlier event it conflicts with. Events on the same
+ * level are independent and are run concurrently; levels are run in
+ * turn, so conflicting events keep their list order and the results
+ * are the same as running the batch serially.
+ */
+static void sched_run_batch(scheduler_t *sched, sched_event_t **batch,
+			    int nb, double t)
+{
+  int i, j, m, lev, nlev = 0;
+  int depth;
+  sched_event_t **run;
+
+  if (nb == 1) {
+    sched_run_event(sched, batch[0], t);
+    return;
+  }
+
+  for (j = 0; j < nb; j++) {
+    batch[j]->level = 0;
+    for (i = 0; i < j; i++)
+      if (batch[i]->level >= batch[j]->level &&
+	  sched_conflict(batch[i], batch[j]))
+	batch[j]->level = batch[i]->level + 1;
+    if (batch[j]->level + 1 > nlev)
+      nlev = batch[j]->level + 1;
+  }
+
+  run = (sched_event_t **)malloc(nb * sizeof(sched_event_t *));
+  for (lev = 0; lev < nlev; lev++) {
+    m = 0;
+    for (j = 0; j < nb; j++)
+      if (batch[j]->level == lev)
+	run[m++] = batch[j];
+    if (m == 1) {
+      sched_run_event(sched, run[0], t);
+      continue;
+    }
+    sched_wait_dispatched(sched);
+    TIMING_SET;
+    /* Datafile reads of the events take the netCDF lock themselves */
+    depth = df_nc_release();
+#if defined(HAVE_OMP)
+#pragma omp parallel for private(i) num_threads(sched->nthreads) schedule(dynamic, 1)
+#endif
+    for (i = 0; i < m; i++)
+      run[i]->next_event = run[i]->event(run[i], t);
+    df_nc_restore(depth);
+    TIMING_PRINT(" ");
+    TIMING_DUMP(1, "sched:concurrent");
+  }
+  free(run);
+}
+
+
 void sched_set_time(scheduler_t *sched, double t)
 {
   sched_event_t *next = sched->head;
@@ -293,23 +461,47 @@ void sched_set_time(scheduler_t *sched, double t)
   /* Check the events to see if the next_event time has been passed.
    * if so, then update the event.
    */
-  while (next != NULL) {
-    if (next->event != NULL) {
-      if (t >= (next->next_event - DT_EPS)) {
-	/*printf("Event %s %f\n",next->name,next->next_event);*/
-	TIMING_SET;
-	next->next_event = next->event(next, t);
-	/*printf("Schedule %s\n",next->name);*/
-	if(next->dispatch != NULL) {
-	  sched->dispatch(next,t);
+  if (sched->nthreads > 1) {
+    /*
+     * Due events with declared dependencies (and no dispatch) are
+     * collected into a batch and run concurrently where they do not
+     * conflict. Any other due event flushes the batch and is then
+     * run on its own, so it sees every earlier event completed.
+     */
+    sched_event_t **batch;
+    int nb = 0, ne = 0;
+
+    for (next = sched->head; next != NULL; next = next->next)
+      ne++;
+    batch = (sched_event_t **)malloc((ne + 1) * sizeof(sched_event_t *));
+    next = sched->head;
+    while (next != NULL) {
+      if (next->event != NULL && t >= (next->next_event - DT_EPS)) {
+	if (next->declared && next->dispatch == NULL)
+	  batch[nb++] = next;
+	else {
+	  if (nb) sched_run_batch(sched, batch, nb, t);
+	  nb = 0;
+	  sched_run_event(sched, next, t);
 	}
-	TIMING_PRINT(" ");
-	TIMING_DUMP(1, next->name);
       }
+      next = next->next;
+    }
+    if (nb) sched_run_batch(sched, batch, nb, t);
+    free(batch);
+  } else {
+    while (next != NULL) {
+      if (next->event != NULL) {
+	if (t >= (next->next_event - DT_EPS))
+	  sched_run_event(sched, next, t);
+      }
+      next = next->next;
     }
-    next = next->next;
   }
 
+  /* The model step after the events changes the master            */
+  sched_wait_dispatched(sched);
+
   /*
    * If the model time is reset to a past time, then re-initialize
    * all the next_events to this past time, except data assimilation.
@@ -35,6 +35,7 @@
 #include <math.h>
 #include <string.h>
 #include <libgen.h>
+#include <sys/stat.h>
 #include "hd.h"
 
 #ifdef HAVE_DA
@@ -71,7 +72,8 @@ typedef struct {
 
 /* Local function declarations */
 static void read_previous_state(master_t *master, da_data_t *data);
-static void read_anom_file(da_data_t *data, master_t *master, char *fname);
+static void read_anom_file(da_data_t *data, master_t *master, char *fname,
+			   char *store);
 static void init_obs(da_data_t *data,master_t *master,parameters_t *params);
 static void init_maps(da_data_t *data, master_t *master);
 
@@ -136,6 +138,8 @@ int da_init(sched_event_t *event)
 
   /* Create the da object */
   data->daobj = da_create_object(params->da_ls);
+  if (params->da_lr > 0.0)
+    da_set_local(data->daobj, params->da_lr, params->da_nthreads);
 
   /*
    * Parse the anomaly fields and create & fill in the da_states
@@ -228,7 +232,8 @@ int da_init(sched_event_t *event)
 
   /* We're now ready to Read from file and create the A vector */
   if (params->da_anom_file != NULL && strlen(params->da_anom_file))
-    read_anom_file(data, master, params->da_anom_file);  
+    read_anom_file(data, master, params->da_anom_file,
+		   params->da_anom_store);
   else
     hd_quit("DA: Anomaly file not specified");
 
@@ -500,6 +505,7 @@ static void read_previous_state(master_t *master, da_data_t *data) {
   }
   
   /* Open the file                                                  */
+  df_nc_lock();
   if (nc_open(restart_fname, NC_NOWRITE, &dafid) != NC_NOERR)
     hd_quit("Can't find DA restart file %s\n", restart_fname);
 
@@ -508,6 +514,7 @@ static void read_previous_state(master_t *master, da_data_t *data) {
 
   /* We're done with the file */
   nc_close(dafid);
+  df_nc_unlock();
 
   /* Reset the windows                                              */
   for (i=1; i<=master->nwindows; i++)
@@ -562,17 +569,47 @@ static void init_maps(da_data_t *data, master_t *master)
 /*------------------------------------------------------------------*/
 
 /*------------------------------------------------------------------*/
-/* Read in the anomaly file and fill in the A matrix                */
+/* Read in the anomaly file and fill in the A matrix. If an anomaly */
+/* store is given A is mapped from it, and the store is created     */
+/* from the anomaly file the first time it is used. The store is    */
+/* keyed on the anomaly file name, size and modification time and   */
+/* the state list, and is rebuilt if any of these change.           */
 /*------------------------------------------------------------------*/
-static void read_anom_file(da_data_t *data, master_t *master, char *fname)
+static void read_anom_file(da_data_t *data, master_t *master, char *fname,
+			   char *store)
 {
   geometry_t *geom = master->geom;
-  datafile_t *df   = df_alloc();
+  datafile_t *df;
   int n, i, col, nrows, row;
   int index;
   int row_offset;
+  char *key = NULL;
+  struct stat st;
+
+  /* Count the number or rows */
+  nrows = 0;
+  for (n=0; n<data->nstates; n++)
+    nrows += data->states[n].size;
+
+  /* Map the store if we have a valid one */
+  if (store != NULL) {
+    if (stat(fname, &st))
+      memset(&st, 0, sizeof(st));
+    key = (char *)malloc(strlen(fname) + 64 +
+			 data->nstates * (MAXSTRLEN + 32));
+    sprintf(key, "%s %ld %ld", fname, (long)st.st_size, (long)st.st_mtime);
+    for (n=0; n<data->nstates; n++)
+      sprintf(key + strlen(key), " %s %d %d", data->states[n].name,
+	      data->states[n].is2D, data->states[n].size);
+    if (da_map_A(data->daobj, store, nrows, key) == 0) {
+      hd_warn("DA: anomalies mapped from store '%s'\n", store);
+      free(key);
+      return;
+    }
+  }
 
   /* Initialise the datafile struct */
+  df = df_alloc();
   df_read(fname, df);
 
   /* Let the library know which is the record variable */
@@ -582,11 +619,6 @@ static void read_anom_file(da_data_t *data, master_t *master, char *fname)
     hd_quit("DA: 'nmember' field not found in Anomaly file '%s'\n", fname);
   }
 
-  /* Count the number or rows */
-  nrows = 0;
-  for (n=0; n<data->nstates; n++)
-    nrows += data->states[n].size;
-  
   /* Allocate memory for the A matrix */
   if (da_allocA(data->daobj, nrows, df->nrecords))
     hd_quit("DA: Error in A matrix allocation");
@@ -646,6 +678,15 @@ static void read_anom_file(da_data_t *data, master_t *master, char *fname)
   if (!da_check_A(data->daobj))
     hd_quit("DA: Error in initialising A\n");
 
+  /* Create the store for subsequent runs */
+  if (store != NULL) {
+    if (da_store_A(data->daobj, store, key))
+      hd_warn("DA: unable to write anomaly store '%s'\n", store);
+    else
+      hd_warn("DA: anomalies written to store '%s'\n", store);
+    free(key);
+  }
+
   /* All done we can close the file and finish up */
   df_free(df);
 }
@@ -826,12 +867,17 @@ void dassim_run_setup(FILE *fp, sched_event_t *event)
   
   /* Name of anomaly file */
   fprintf(fp, "\n   Name of Anomaly file = %s\n", params->da_anom_file);
+  if (params->da_anom_store != NULL)
+    fprintf(fp, "   Name of Anomaly store = %s\n", params->da_anom_store);
   
   /* Localisation factor */
   if (params->da_ls > 0.0)
     fprintf(fp, "\n   Using localisation factor of %.2f degrees\n", params->da_ls);
   else
     fprintf(fp, "\n   Localisation not invoked\n");
+  if (params->da_lr > 0.0)
+    fprintf(fp, "   Local analysis within %.2f degrees on %d thread(s)\n",
+	    params->da_lr, params->da_nthreads);
 
   /* Names of all obervations */
   fprintf(fp, "\n");
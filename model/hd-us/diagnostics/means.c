@@ -575,6 +575,7 @@ void reset_means3d_m(master_t *master, int trm)
       t = prev_day(master->t, master->timeunit, &mon);
       sf = DAILY;
     }
+    df_nc_lock();
     if (read_mean_3d(master, t, sf, vname, master->tr_wc[trm], 
 		     dumpdata->tr_wc[trd])) {
       if (master->meanc[0]) {
@@ -583,6 +584,7 @@ void reset_means3d_m(master_t *master, int trm)
 	master->meanc[0] = 0.0;
       }
     }
+    df_nc_unlock();
   } else {
     memset(master->tr_wc[trm], 0, geom->szc * sizeof(double));
   }
@@ -756,6 +758,7 @@ void reset_means2d_m(master_t *master, int trm)
       t = prev_day(master->t, master->timeunit, &mon);
       sf = DAILY;
     }
+    df_nc_lock();
     if (read_mean_2d(master, t, sf, vname, master->tr_wcS[trm], 
 		     dumpdata->tr_wcS[trd])) {
       if (master->meanc[0]) {
@@ -764,6 +767,7 @@ void reset_means2d_m(master_t *master, int trm)
 	master->meanc[0] = 0.0;
       }
     }
+    df_nc_unlock();
   } else
     memset(master->tr_wcS[trm], 0, geom->szcS * sizeof(double));
 }
@@ -251,8 +251,10 @@ void write_run_setup(hd_data_t *hd_data)
     fprintf(fp, "Distributed processing : OpenMP\n");
 #endif
 #if defined(HAVE_PTHREADS)
-  if (strcasecmp(params->dp_mode,"pthreads") == 0)
+  if (strcasecmp(params->dp_mode,"pthreads") == 0) {
     fprintf(fp, "Distributed processing : pthreads\n");
+    dp_write_placement(fp);
+  }
 #endif
 #if defined(HAVE_ECOLOGY_MODULE)
   if (params->do_eco)
@@ -1580,8 +1582,14 @@ void write_run_setup(hd_data_t *hd_data)
     if (strlen(params->opath))fprintf(fp,"Output path = %s\n", master->opath);
     for(n = 0; n < master->dumpdata->ndf; n++) {
       fprintf(fp,"Output file #%d : %s",n,master->dumpdata->dumplist[n].name);
-      if (master->dumpdata->dumplist[n].compress)
-	fprintf(fp," (compressed)");
+      if (master->dumpdata->dumplist[n].compress) {
+	dump_file_t *df = &master->dumpdata->dumplist[n];
+	fprintf(fp," (compressed: level %d, %s chunks", df->compress,
+		(df->chunk_layout == CH_TS) ? "time series" : "map");
+	if (df->nsd)
+	  fprintf(fp,", %d significant digits", df->nsd);
+	fprintf(fp,")");
+      }
       if (master->dumpdata->dumplist[n].filter)
 	fprintf(fp," (filter: %s)",  master->dumpdata->dumplist[n].filter->name);
       fprintf(fp,"\n");
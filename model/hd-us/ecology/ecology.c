@@ -990,7 +990,9 @@ void eco_step(geometry_t *window)
     /* Run ecology if its the right time */
     if (!(windat->nstep % wincon->eco_timestep_ratio)) {
       TIMING_SET;
+      PROF_BEGIN("ecology_step", window->wn);
       ecology_step(wincon->e, wincon->ecodt);
+      PROF_END;
       TIMING_DUMP_WIN(3, "   eco_step", window->wn);
     }
   }
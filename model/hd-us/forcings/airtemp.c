@@ -137,6 +137,7 @@ int airtemp_init(sched_event_t *event)
     free(data);
     return 0;
   }
+  frc_sched_depends(event, NULL, "airtemp", data->tsfiles, data->ntsfiles);
   return 1;
 }
 
@@ -119,6 +119,7 @@ int cloud_init(sched_event_t *event)
     free(data);
     return 0;
   }
+  frc_sched_depends(event, NULL, "cloud", data->tsfiles, data->ntsfiles);
   return 1;
 }
 
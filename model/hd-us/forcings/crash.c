@@ -165,6 +165,7 @@ double crash_event(sched_event_t *event, double t)
     fp = fopen(crash->cname, "a");
     strcpy(restart_fname, crash->rsfname);
     /* Open the file                                                  */
+    df_nc_lock();
     if ((errf = nc_open(restart_fname, NC_NOWRITE, &fid)) != NC_NOERR)
       hd_quit("Can't find crash restart file %s (errf=%d)\n", restart_fname, errf);
         
@@ -173,6 +174,7 @@ double crash_event(sched_event_t *event, double t)
 
     /* Get the new start time                                         */
     schedule->t = newt = get_restart_time(restart_fname, schedule->units);
+    df_nc_unlock();
     /* Reset the dumpfile dump times, except the restart file         */
     for (i = 0; i < dumpdata->ndf - 1; ++i) {
       dumpdata->dumplist[i].reset(dumpdata, &dumpdata->dumplist[i], newt);
@@ -50,6 +50,7 @@ int evap_init(sched_event_t *event)
     return 0;
   }
 
+  frc_sched_depends(event, NULL, "evap", &data->ts, 1);
   return 1;
 }
 
@@ -339,6 +339,24 @@ timeseries_t *frcw_read_cell_ts(master_t *master, char *fname, double i_dt,
   return ts;
 }
 
+/*
+ * Declares the master fields a forcing event reads and writes, so
+ * that it may be run concurrently with other forcing events. The
+ * input files are declared as written since they may be shared
+ * between events through the timeseries cache, and evaluating a
+ * file updates its record buffers.
+ */
+void frc_sched_depends(sched_event_t *event, char *reads, char *writes,
+		       timeseries_t **ts, int nts)
+{
+  int n;
+
+  sched_depends(event, reads, writes);
+  for (n = 0; n < nts; n++)
+    if (ts[n] != NULL)
+      sched_depends_on(event, ts[n]->name, 1);
+}
+
 void frc_ts_eval_grid(master_t *master, double t, timeseries_t *ts, int id,
                       double *p, double conv)
 {
@@ -352,11 +370,18 @@ void frc_ts_eval_grid(master_t *master, double t, timeseries_t *ts, int id,
   if (ts->nt <= 0)
     hd_quit("frc_ts_eval_grid: Bad time series\n");
 
+  /* Gridded input is remapped with precomputed weights */
+  if (hd_ts_remap_eval(master, ts, id, t, geom->w2_t, geom->b2_t,
+		       geom->cellx, geom->celly, p, conv))
+    return;
+
   /* Evaluate values at cell centres */
+  PROF_BEGIN("df_eval", 0);
   for (cc = 1; cc <= geom->b2_t; ++cc) {
     c = geom->w2_t[cc];
     p[c] = conv * ts_eval_xyz(ts, id, t, geom->cellx[c], geom->celly[c], 0.0);
   }
+  PROF_END;
 }
 
 
@@ -394,12 +419,20 @@ void hd_trans_multifile_eval(master_t *master,
     ne3 = geom->n2_e1;
   */
 
+  /* Gridded input is remapped with precomputed weights */
+  if (hd_ts_multifile_remap_eval(master, ntsfiles, ts, id, t, geom->w2_t,
+				 geom->b2_t, geom->cellx, geom->celly, p,
+				 conv))
+    return;
+
   /* Evaluate values at cell centres */
+  PROF_BEGIN("df_eval", 0);
   for (cc = 1; cc <= geom->b2_t; ++cc) {
     c = geom->w2_t[cc];
     p[c] = conv * hd_ts_multifile_eval_xy(ntsfiles, ts, id,
 				      t, geom->cellx[c], geom->celly[c]);
   }
+  PROF_END;
 }
 
 
@@ -132,6 +132,7 @@ int patm_init(sched_event_t *event)
   }
   /* 
      data->dt=frc_get_input_dt(master->grid_dt,data->dt,"air pressure"); */
+  frc_sched_depends(event, NULL, "patm", data->tsfiles, data->ntsfiles);
   return 1;
 }
 
@@ -120,6 +120,7 @@ int precip_init(sched_event_t *event)
     free(data);
     return 0;
   }
+  frc_sched_depends(event, NULL, "precip", data->tsfiles, data->ntsfiles);
   return 1;
 }
 
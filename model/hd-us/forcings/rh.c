@@ -66,6 +66,7 @@ int rh_init(sched_event_t *event)
   }
 
 
+  frc_sched_depends(event, NULL, "rh", &data->ts, 1);
   return 1;
 }
 
@@ -67,6 +67,7 @@ int swr_init(sched_event_t *event)
     hd_quit("RADIATION requires ALBEDO parameter.\n");
   /*prm_read_double(master->prmfd, "SWR_ATTENUATION", &master->swr_attn);*/
 
+  frc_sched_depends(event, NULL, "swr", &data->ts, 1);
   return 1;
 }
 
@@ -147,6 +147,7 @@ int wetbulb_init(sched_event_t *event)
     free(data);
     return 0;
   }
+  frc_sched_depends(event, NULL, "wetb", data->tsfiles, data->ntsfiles);
   return 1;
 }
 
@@ -57,6 +57,21 @@ struct wind_data{
   double (*windstress) (master_t *, wind_data_t *, double *, double *, int);
 };
 
+/* Master fields read by each stress function                        */
+static struct {
+  double (*windstress) (master_t *, wind_data_t *, double *, double *, int);
+  char *reads;
+} wind_stress_reads[] = {
+  {windstress_orig, ""},
+  {windstress_bunker, " temp airtemp"},
+  {windstress_largepond, " temp airtemp"},
+  {windstress_kitiag, ""},
+  {windstress_kondo, " temp sal airtemp patm"},
+};
+
+static void wind_sched_depends(sched_event_t *event, master_t *master,
+			       wind_data_t *data);
+
 
 /* Functions for reading the schedule the wind forcings. */
 int wind_init(sched_event_t *event)
@@ -147,9 +162,44 @@ int wind_init(sched_event_t *event)
   }
   else
     data->windstress = windstress_orig;
+
+  wind_sched_depends(event, master, data);
   return 1;
 }
 
+/*
+ * Declares the master fields wind_event() reads and writes (see
+ * frc_sched_depends()) for the stress function and options it was
+ * set up with.
+ */
+static void wind_sched_depends(sched_event_t *event, master_t *master,
+			       wind_data_t *data)
+{
+  char reads[MAXSTRLEN], writes[MAXSTRLEN];
+  int n;
+
+  strcpy(reads, "");
+  strcpy(writes, "wind1 wind2 windspeed winddir");
+  if (data->type & SPEED) {
+    for (n = 0; n < (int)(sizeof(wind_stress_reads) /
+			  sizeof(wind_stress_reads[0])); n++)
+      if (wind_stress_reads[n].windstress == data->windstress)
+	strcat(reads, wind_stress_reads[n].reads);
+    if (master->numbers & WIND_CD) strcat(writes, " wind_Cd");
+    if (master->storm_dt) strcat(writes, " swind1");
+  }
+  if (master->waves & STOKES_DRIFT && master->tau_w1 && master->tau_diss1)
+    strcat(reads, " tau_w1 tau_w2 tau_diss1 tau_diss2");
+  if (master->waves & NEARSHORE)
+    strcat(reads, " wave_wfdx wave_wfdy wave_fwcapx wave_fwcapy"
+	   " wave_fbrex wave_fbrey wave_fsurx wave_fsury");
+  if (master->do_pt) strcat(writes, " swind1 swind2");
+#if defined(HAVE_WAVE_MODULE)
+  if (master->do_wave & W_SWAN) strcat(writes, " swind1 swind2");
+#endif
+  frc_sched_depends(event, reads, writes, data->tsfiles, data->ntsfiles);
+}
+
 double wind_event(sched_event_t *event, double t)
 {
   master_t *master = (master_t *)schedGetPublicData(event);
@@ -51,9 +51,17 @@ typedef struct dp_details {
   void (*vel3d_gather_post_p2) (dp_window_t *dpw);
   void (*tracer_step) (dp_window_t *dpw);
   void (*tracer_gather_step) (dp_window_t *dpw);
+  void (*transport_step) (dp_window_t *dpw);
+  void (*transport_gather_step) (dp_window_t *dpw);
+
+  int (*local) (int wn);        /* Window stepped by this process */
+  void (*exchange) (int mode);  /* Master transfers between processes */
+  void (*report) (dp_window_t *dpw, FILE *fp); /* Thread placement */
 
 } dp_details_t;
 
+extern dp_details_t dp;
+
 /* Distributed processing prototypes */
 void dp_init(master_t *master,
              geometry_t *geom[],
@@ -66,6 +74,11 @@ void dp_vel3d_step_p2();
 void dp_vel3d_post_p1();
 void dp_vel3d_post_p2();
 void dp_tracer_step();
+void dp_transport_step();
+int dp_is_local(int wn);
+int dp_is_distributed(void);
+void dp_exchange(int mode);
+void dp_write_placement(FILE *fp);
 void dp_cleanup();
 
 /* Protected methods. To be used by dp.c only! */
@@ -85,6 +98,8 @@ void dp_none_vel3d_post_p2(dp_window_t *dpw);
 void dp_none_vel3d_gather_post_p2(dp_window_t *dpw);
 void dp_none_tracer_step(dp_window_t *dpw);
 void dp_none_tracer_gather_step(dp_window_t *dpw);
+void dp_none_transport_step(dp_window_t *dpw);
+void dp_none_transport_gather_step(dp_window_t *dpw);
 
 #if defined(HAVE_PTHREADS)
 void dp_pthread_init(dp_window_t *dpw);
@@ -103,6 +118,9 @@ void dp_pthread_vel3d_post_p2(dp_window_t *dpw);
 void dp_pthread_vel3d_gather_post_p2(dp_window_t *dpw);
 void dp_pthread_tracer_step(dp_window_t *dpw);
 void dp_pthread_tracer_gather_step(dp_window_t *dpw);
+void dp_pthread_transport_step(dp_window_t *dpw);
+void dp_pthread_transport_gather_step(dp_window_t *dpw);
+void dp_pthread_report(dp_window_t *dpw, FILE *fp);
 #endif
 
 #if defined(HAVE_MPI)
@@ -122,6 +140,10 @@ void dp_mpi_vel3d_post_p2(dp_window_t *dpw);
 void dp_mpi_vel3d_gather_post_p2(dp_window_t *dpw);
 void dp_mpi_tracer_step(dp_window_t *dpw);
 void dp_mpi_tracer_gather_step(dp_window_t *dpw);
+void dp_mpi_transport_step(dp_window_t *dpw);
+void dp_mpi_transport_gather_step(dp_window_t *dpw);
+int dp_mpi_local(int wn);
+void dp_mpi_exchange(int mode);
 #endif
 
 #endif                          /* _DP_H */
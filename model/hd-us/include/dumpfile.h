@@ -42,6 +42,10 @@
 #define HP3PT  0x010
 #define SHU3PT 0x020
 
+/* NetCDF-4 chunk layouts */
+#define CH_MAP    1
+#define CH_TS     2
+
 #define MAXNUMVARS 350
 
 typedef struct dump_data dump_data_t;
@@ -526,6 +530,10 @@ struct dump_file {
   int da_cycle;                 /* Data assimilation cycle flag */
   int compress;                 /* Activate compression */
   int chunk;                    /* Output in chunks */
+  int chunk_layout;             /* NetCDF-4 chunk shape (CH_MAP or CH_TS) */
+  int chunk_nrec;               /* Records per chunk for CH_TS */
+  int nsd;                      /* Significant digits retained, 0 = all */
+  int nsb;                      /* Mantissa bits retained for nsd */
   int flag;                     /* General purpose flag */
   int obcid;                    /* Id for obc dumps */
   double bathymask;             /* Bathymetry mask */
@@ -559,6 +567,10 @@ int check_sparse_dumpfile(geometry_t *geom, int ntsfiles,
 			  cstring * names);
 void set_longitude(dump_data_t *dumpdata, dump_file_t *df, int mode);
 void set_chunk_name(dump_data_t *dumpdata, dump_file_t *df, double t);
+void df_def_var(dump_file_t *df, int cdfid, const char *name, nc_type type,
+		int ndims, int *dims, int nh, int *vid);
+void df_bitround(dump_file_t *df, double *v, size_t n);
+double df_bitround1(dump_file_t *df, double v);
 void df_parse_vars(dump_data_t *dumpdata, dump_file_t *df, char* excludevars, char* all_vars);
 void dump_eta_snapshot(master_t *master, geometry_t **window,
 		       window_t **windat, win_priv_t **wincon);
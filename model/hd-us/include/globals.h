@@ -103,6 +103,7 @@ extern FILE *tfp;
 extern long tfp_pos;
 extern int timing_counter;
 extern int timing_level;
+extern int prof_on;
 
 /*-------------------------------------------------------------------*/
 /* Valid SST import URLs                                             */
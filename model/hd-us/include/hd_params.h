@@ -329,6 +329,19 @@
 #define U2FLUX          64
 #define CFL             128
 #define TRACERS         256
+#define MFILL           512
+
+/* Maps over which window arrays are emptied into the master                */
+#define EV_S2M          1       /* 3D cells used by other windows          */
+#define EV_S2MS         2       /* 2D cells used by other windows          */
+#define EV_S2ME1        3       /* 3D edges used by other windows          */
+#define EV_S2ME1S       4       /* 2D edges used by other windows          */
+#define EV_W3           5       /* 3D wet cells                            */
+#define EV_W2           6       /* 2D wet cells                            */
+#define EV_ALL2         7       /* All 2D cells                            */
+#define EV_VERTIN       8       /* Tangential edges of VERTIN OBCs         */
+#define EV_W3E1         9       /* 3D wet edges                            */
+#define EV_W2E1         10      /* 2D wet edges                            */
 
 /* Master data memory free flags                                             */
 #define ALL             1
@@ -238,6 +238,8 @@ window_t *win_data_alloc(void);
 window_t **win_data_build(master_t *master, geometry_t **window);
 window_t *win_data_init(master_t *master, geometry_t *window);
 void win_data_clear(window_t *windat);
+int win_data_arrays(geometry_t *window, window_t *windat, win_priv_t *wincon,
+		    void **ptr, size_t *len, int nmax);
 win_priv_t *win_consts_alloc(void);
 win_priv_t **win_consts_init(master_t *master, geometry_t **window);
 void win_consts_clear(geometry_t **window, int nwindows);
@@ -472,6 +474,12 @@ void windat_fill(master_t *master, geometry_t *window, window_t *windat,
                  int nwindows, int mode);
 void build_transfer_maps(geometry_t *geom, geometry_t **window, int wn,
 			 int nwindows);
+void build_peer_maps(geometry_t *geom, geometry_t **window, int nwindows);
+void win_data_peer_2d(master_t *master, geometry_t *window,
+		      window_t *windat, window_t **peer, int mode);
+void win_data_peer_empty_2d(master_t *master, geometry_t **window,
+			    window_t **windat, int nwindows);
+int master_peer_obc(geometry_t *geom);
 void win_data_fill_3d(master_t *master, geometry_t *window,
                       window_t *windat, int nwindows);
 void win_data_refill_3d(master_t *master, geometry_t *window,
@@ -484,6 +492,13 @@ void win_data_refill_2d(master_t *master, geometry_t *window,
                         window_t *windat, int nwindows, int mode);
 void win_data_empty_2d(master_t *master, geometry_t *window,
                        window_t *windat, int mode);
+void win_data_empty_vars(master_t *master, geometry_t *window,
+			 window_t *windat, int dim, int mode,
+			 void (*fn)(geometry_t *window, int map, double *Ag,
+				    double *Al, int *iAg, int *iAl,
+				    void *data), void *data);
+void win_empty_var(geometry_t *window, int map, double *Ag, double *Al,
+		   int *iAg, int *iAl, void *data);
 void window_reset(master_t *master, geometry_t *window, window_t *windat, 
 		  win_priv_t *wincon, int mode);
 void get_sloc(geometry_t *geom, int c);
@@ -510,6 +525,10 @@ void c2v_2d(geometry_t *geom,  double *as, double **ac,
             int nx, int ny);
 void c2v_3d(geometry_t *geom,  double *as, double ***ac,
             int nx, int ny, int nz);
+void s2m_vars(master_t *master, geometry_t *window, window_t *windat,
+	      win_priv_t *wincon, int dim,
+	      void (*fn)(geometry_t *window, int map, double *Ag, double *Al,
+			 int *iAg, int *iAl, void *data), void *data);
 void s2m_3d(master_t *master, geometry_t *window, window_t *windat,
             win_priv_t *wincon);
 void s2m_2d(master_t *master, geometry_t *window, window_t *windat);
@@ -772,6 +791,8 @@ void error_norms_m(master_t *master, geometry_t *window, window_t *windat,
 int yrday(int year, int mon, int day);
 void forcings_init(master_t *master);
 void forcings_end();
+void frc_sched_depends(sched_event_t *event, char *reads, char *writes,
+		       timeseries_t **ts, int nts);
 void frc_ts_eval_grid(master_t *master, double t, timeseries_t *ts, int id,
                       double *p, double conv);
 void frc_ts_eval_grid_mult(master_t *master, double t, timeseries_t **ts, int *id,
@@ -1544,6 +1565,14 @@ void hd_ts_multifile_eval(master_t *master,
 			  int ntsfiles, timeseries_t **tsfiles,
 			  cstring * names, char *var, double *v, double t,
 			  int *vec, int nvec, int mode);
+int hd_ts_remap_eval(master_t *master, timeseries_t *ts, int id, double t,
+		     int *vec, int nvec, double *x, double *y, double *v,
+		     double conv);
+int hd_ts_multifile_remap_eval(master_t *master, int ntsfiles,
+			       timeseries_t **tsfiles, int *varids, double t,
+			       int *vec, int nvec, double *x, double *y,
+			       double *v, double conv);
+void hd_ts_remap_free(master_t *master);
 void hd_ts_multifile_evalp(master_t *master, 
 			  int ntsfiles, timeseries_t **tsfiles,
 			  cstring * names, char *var, double *v, double t,
@@ -1592,6 +1621,9 @@ void dump_windows(master_t *master, geometry_t **window, char *name, char *iname
 void read_windows(geometry_t *geom, geometry_t **window, char *name);
 void check_window_map_us(geometry_t *geom, geometry_t **window, char *name);
 void read_windows_us(geometry_t *geom, geometry_t **window, char *name);
+void window_cache_key(parameters_t *params, geometry_t *geom, char *key);
+int window_cache_check(char *name, char *key);
+void window_cache_write(master_t *master, geometry_t **window, char *name);
 void read_geom_us(parameters_t *params, geometry_t *geom, char *name);
 void dump_geom_us(master_t *master, char *iname);
 void check_geom_map_us(parameters_t *params, geometry_t *geom, char *name);
@@ -1907,6 +1939,11 @@ void smooth(master_t *master, double *A, int *ctp, int nctp);
 void free1ds(short *p);
 int ANY(int var, int array[], int ns);
 int ANY0(int var, int array[], int ns);
+void *ANY_map_build(int array[], int n0, int n1);
+void *ANY_map_init(int array[], int ns);
+int  ANY_map_find(void *arr, int var);
+void ANY_map_destroy(void *arr);
+int *ANY_invert(int array[], int ns, int size);
 char *fv_get_filename(char *ofn, char *buf);
 char *fv_get_varname(char *oprm, char *tag, char *buf);
 int is_true(const char *tag);
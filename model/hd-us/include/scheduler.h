@@ -47,6 +47,17 @@ struct sched_event {
   void *private_data;           /* Private data used in event functions */
   double next_event;            /* Time of next event */
 
+  /*
+   * Master fields (or other shared resources) read and written by
+   * event(). Events that declare these may be run concurrently with
+   * other declared events they do not conflict with.
+   */
+  int declared;                 /* Dependencies have been declared */
+  int ndeps;                    /* Number of dependencies */
+  char **deps;                  /* Names of fields / resources */
+  int *depw;                    /* Non-zero if the dependency is written */
+  int level;                    /* Dependency level when run concurrently */
+
 #ifdef HAVE_PTHREADS
   /* 
    * For synchronisation of threaded dispatches - currently only dumps
@@ -65,6 +76,7 @@ typedef struct {
   char units[MAXSTRLEN];        /* ISO units for time */
   time_t exec_start_time;       /* Execution start time */
   SchedEventFunc dispatch;      /* function to dispatch an events dispatch function */
+  int nthreads;                 /* Threads used to run independent events */
 } scheduler_t;
 
 
@@ -90,6 +102,13 @@ extern void sched_register(scheduler_t *sched, char *name,
                            SchedDispatchFunc dispatch, SchedInitFunc in_progress);
 extern void sched_deregister(scheduler_t *sched, char *name);
 
+/* Declare the fields an event reads and writes, so that it may be
+ * run concurrently with events it does not conflict with. Events
+ * that declare nothing are run on their own, in list order.
+ */
+extern void sched_depends(sched_event_t *event, char *reads, char *writes);
+extern void sched_depends_on(sched_event_t *event, char *name, int write);
+
 /* Process the events list to determine at which time the
  * next stop should occur. If that time has already been
  * reached, then call the event procedure for each pending
@@ -115,6 +115,24 @@ typedef struct {
   int ac;            /* Auxiliary cell centre in window             */
 } global_map_t;
 
+/*------------------------------------------------------------------*/
+/* Remapping operator from a gridded input variable to a set of     */
+/* model cells, stored as a CSR matrix over the flattened record.   */
+/*------------------------------------------------------------------*/
+typedef struct remap {
+  timeseries_t *ts;  /* Input file                                  */
+  char *name;        /* Input file name                             */
+  int id;            /* Variable id in the input file               */
+  int nsrc;          /* Size of a record of the variable            */
+  int *vec;          /* Cells mapped to                             */
+  int nvec;          /* Size of vec                                 */
+  double *x, *y;     /* Cell coordinates                            */
+  int *ia;           /* Row starts for vec[1..nvec], size nvec+2    */
+  int *ja;           /* Offsets into the input record               */
+  double *a;         /* Weights                                     */
+  struct remap *next;
+} remap_t;
+
 
 
 typedef struct {
@@ -194,6 +212,17 @@ typedef struct {
   double data;                  /* Private data */
 } pt_ts_t;
 
+/* Particle interpolation state for one thread of the move loop */
+typedef struct {
+  GRID_SPECS ***gsx;            /* Velocity interpolation per window [nwindows+1][nz+1] */
+  GRID_SPECS ***gsy;
+  GRID_SPECS ***gsz;
+  xytoij_tree_t *xyij_tree;     /* Tree for structured grid cell searches */
+  int cloned;                   /* The above are copies owned by this state */
+  int nwindows;                 /* Number of windows */
+  int *nz;                      /* Number of layers in each window */
+} pt_interp_t;
+
 typedef struct {
   int rlx;                 /* Relaxation flag */
   char rlxn[MAXSTRLEN];    /* Relaxation filename */
@@ -1083,6 +1112,10 @@ struct geometry {
   int ns2me1;                   /* Size of s2me1 */
   int ns2mS;                    /* Size of transfer vector for 2D arrays */
   int ns2me1S;                  /* Size of transfer vector for 2D arrays */
+  int *p2sw;                    /* Owner window of 2D m2s cells */
+  int *p2sc;                    /* Owner local cell of 2D m2s cells */
+  int *p2sw_e1;                 /* Owner window of 2D m2se1 edges */
+  int *p2se1;                   /* Owner local edge of 2D m2se1 edges */
   int ns2m_ts;                  /* Size of ns2m_ts */
   short **owc;                  /* Mapping of slave - master OBC's */
 
@@ -1314,6 +1347,7 @@ typedef struct {
   double *win_size;             /* Window partition */
   int metis_opts;               /* METIS options */
   int win_reset;                /* Number of steps to reset window loads */
+  int win_p2p;                  /* Window-to-window 2D halo transfers */
   int show_win;                 /* Create plot of windowing */
   int win_type;                 /* Type of partitioning */
   int win_block;                /* Blocking dimension */
@@ -1321,7 +1355,11 @@ typedef struct {
   char win_file[MAXSTRLEN];     /* Window map file; read */
   char wind_file[MAXSTRLEN];    /* Window map file; write */
   char geom_file[MAXSTRLEN];    /* geom map file; read & write */
+  char win_cache[MAXSTRLEN];    /* Window map cache file */
+  char win_key[MAXSTRLEN];      /* Mesh and decomposition key for cache */
+  int win_cached;               /* Windows were read from the cache */
   char dp_mode[MAXSTRLEN];      /* Distributed processing mode */
+  char dp_affinity[MAXSTRLEN];  /* Core pinning for pthreads */
   int trasc;                    /* Advection scheme type flag (tracers) */
   int momsc;                    /* Advection scheme type flag (velocity) */
   int momsc2d;                  /* Advection scheme type flag (velocity) */
@@ -1507,7 +1545,10 @@ typedef struct {
   int data_infill;              /* Use cascade search on input file data */
   char *da_anom_file;           /* File name for the anomaly fields */
   char *da_anom_states;         /* State names to read from the anomaly fields */
+  char *da_anom_store;          /* Binary anomaly store mapped in place of file */
   double da_ls;                 /* DA localisation spread */
+  double da_lr;                 /* DA local analysis radius */
+  int da_nthreads;              /* DA local analysis threads */
   int da_nobs;                  /* Number of Data assimilating observations */
   int meshinfo;                 /* Print meshing information */
   char **da_obs_names;
@@ -1636,9 +1677,12 @@ typedef struct {
 
   /* IO */
   int thIO;                     /* Whether to thread I/O */
+  double prefetch;              /* Input read-ahead budget per file (Mb) */
+  int prefetch_threads;         /* Number of input read-ahead threads */
 
   /* timeseries_t file cahcing */
   int tsfile_caching;           /* Flag for tsfile caching */
+  int tsfile_remap;             /* Flag for gridded input remapping */
 
   /* MOM conversion */
   momgrid_t *momgrid;           /* MOM format grid structure */
@@ -1859,6 +1903,7 @@ struct master {
   /* Flags */
   int nwindows;                 /* Number of windows */
   int win_reset;                /* Number of steps to reset window loads */
+  int win_p2p;                  /* Window-to-window 2D halo transfers */
   int show_win;                 /* Create plot of windowing */
   int runmode;                  /* Type of run (3D, 2D, transport) */
   int trasc;                    /* Advection scheme type flag (tracers) */
@@ -2456,7 +2501,11 @@ struct master {
   int do_pt;                    /* Particle tracking flag */
   int do_lag;                   /* Do Lagrangian streamline tracing */
   long ptn;                     /* Total number of particles */
-  particle_t *ptp;              /* Array of particles */
+  pt_store_t *pts;              /* Particle store (one array per attribute) */
+  unsigned long pt_seed;        /* Seed for particle random streams */
+  double pt_t0;                 /* Configured particle start time */
+  int pt_nomp;                  /* Threads for the particle move loop */
+  pt_interp_t **pt_int;         /* Interpolation state per move thread */
   char ptinname[MAXLINELEN];    /* particle input file name */
   int ptinrec;                  /* particle input record */
   char ptoutname[MAXLINELEN];   /* particle output name */
@@ -2508,6 +2557,11 @@ struct master {
   double *pt_z2;
   double *pt_accum;
   short *pt_sm;                 /* Particle source map */
+  long *pt_order;               /* Active particles sorted by host cell */
+  long *pt_cstart;              /* Start of each cell in pt_order */
+  long pt_nb;                   /* Number of particles in pt_order */
+  int pt_binok;                 /* pt_order holds the current host cells */
+  int *pt_c2cc;                 /* Surface cell to w2_t index map */
   sched_event_t *ts_parts_events; /* Time scheduler for particles */
   float *maxdiffw;              /* Maximum vert diffusion */
   profile_t **u1prof;
@@ -2530,6 +2584,8 @@ struct master {
   int tsfile_caching;           /* flag for tsfile caching */
   int ntscached;                /* Number of cached ts files.  */
   timeseries_t **tscache;       /* Cached tsfiles */
+  int tsfile_remap;             /* Flag for gridded input remapping */
+  remap_t *remaps;              /* Cached input remapping operators */
 
   /* Explicit maps */
   int exmapf;                   /* Explicit map flag */
@@ -2658,6 +2714,8 @@ struct master {
 
   /* IO */
   int thIO;                     /* Whether to thread I/O */
+  double prefetch;              /* Input read-ahead budget per file (Mb) */
+  int prefetch_threads;         /* Number of input read-ahead threads */
 
   /* Number of OMP threads to use in transport mode */
 #ifdef HAVE_OMP
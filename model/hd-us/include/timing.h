@@ -99,6 +99,58 @@ void print_timing_header(char *s, void *m);
 #define FLUSH_TIMING
 #endif
 
+/*
+ * Runtime profiler. This is always compiled and switched on with
+ * PROFILE YES in the parameter file (or EMS_PROFILE=1). Regions are
+ * timed with the cycle counter and logged to a per-thread ring
+ * buffer, so they may be used inside the window threads. A return
+ * from within a region simply drops that sample; use PROF_MARK
+ * before an early return that should still be counted.
+ */
+void prof_init(FILE *fp);
+int prof_region(char *name);
+unsigned long long prof_tick(void);
+void prof_record(int id, int win, unsigned long long t0,
+		 unsigned long long t1);
+void prof_write(char *opath, long ncells, long nsteps);
+
+/*
+ * The opening brace is closed out in PROF_END
+ */
+#define PROF_BEGIN(name,win) \
+         { \
+           static int _prof_id = -1; \
+           int _prof_win = (win); \
+           unsigned long long _prof_t0 = 0; \
+           if (prof_on) { \
+             if (_prof_id < 0) _prof_id = prof_region(name); \
+             _prof_t0 = prof_tick(); \
+           }
+
+/*
+ * As above for names that are only known at runtime
+ */
+#define PROF_BEGIN_DYN(name,win) \
+         { \
+           int _prof_id = -1; \
+           int _prof_win = (win); \
+           unsigned long long _prof_t0 = 0; \
+           if (prof_on) { \
+             _prof_id = prof_region(name); \
+             _prof_t0 = prof_tick(); \
+           }
+
+#define PROF_MARK \
+           if (prof_on && _prof_id >= 0) \
+             prof_record(_prof_id, _prof_win, _prof_t0, prof_tick());
+
+/*
+ * The final brace closes out the one in PROF_BEGIN
+ */
+#define PROF_END \
+           PROF_MARK \
+         }
+
 
 #endif                          /* _TIMING_H */
 
@@ -22,6 +22,8 @@
 #include <string.h>
 #include <math.h>
 #include <time.h>
+#include <sys/stat.h>
+#include <errno.h>
 #include "hd.h"
 /* JIGSAW grid generation */
 #ifdef HAVE_JIGSAWLIB
@@ -233,6 +235,7 @@ void set_default_param(parameters_t *params)
   params->map_type = 0;
   params->nwindows = 1;
   params->win_reset = 0;
+  params->win_p2p = 0;
   params->win_type = GROUPED;
   params->win_block = 0;
   params->win_size = NULL;
@@ -299,6 +302,7 @@ void set_default_param(parameters_t *params)
   params->do_pt = 0;
   params->do_lag = 0;
   strcpy(params->dp_mode, "none");
+  strcpy(params->dp_affinity, "NONE");
   params->waves = 0;
   params->decorr = 0;
   params->decf = NONE;
@@ -320,6 +324,7 @@ void set_default_param(parameters_t *params)
   params->saltflux = NONE;
   params->water_type = NONE;
   params->tsfile_caching = 1;
+  params->tsfile_remap = 1;
   params->etamax = 10.0;
   params->velmax = 3.87;
   params->velmax2d = 2.55;
@@ -941,6 +946,10 @@ parameters_t *params_read(FILE *fp)
 	params->da_anom_file = (char *)malloc((strlen(buf)+1)*sizeof(char));
 	strcpy(params->da_anom_file, buf);
       }
+      if (prm_read_char(fp, "DA_ANOMALY_STORE", buf)) {
+	params->da_anom_store = (char *)malloc((strlen(buf)+1)*sizeof(char));
+	strcpy(params->da_anom_store, buf);
+      }
       if (prm_read_char(fp, "DA_ANOMALY_STATES", buf)) {
 	params->da_anom_states = (char *)malloc((strlen(buf)+1)*sizeof(char));
 	strcpy(params->da_anom_states, buf);
@@ -954,6 +963,12 @@ parameters_t *params_read(FILE *fp)
       params->da_ls = 0.0;
       prm_read_double(fp, "DA_LS", &params->da_ls);
 
+      /* Local analysis with observations within a radius          */
+      params->da_lr = 0.0;
+      params->da_nthreads = 1;
+      prm_read_double(fp, "DA_LOCAL_RADIUS", &params->da_lr);
+      prm_read_int(fp, "DA_NTHREADS", &params->da_nthreads);
+
       if (prm_read_int(fp, "DA_NOBS", &params->da_nobs)) {
 	params->da_obs_names = (char **)malloc(params->da_nobs*sizeof(char *));
 	params->da_obs_files = (char **)malloc(params->da_nobs*sizeof(char *));
@@ -1949,6 +1964,12 @@ parameters_t *params_read(FILE *fp)
     params->tsfile_caching = 1;
   emstag(LDEBUG,"hd:readparam:params_read","Setting ts_file_cachinf to: %s",(params->tsfile_caching?"true":"false"));
 
+  /* Remapping of gridded input with cached weights                  */
+  if (prm_read_char(fp, "REMAP_TSFILES", buf) > 0)
+    params->tsfile_remap = is_true(buf);
+  else
+    params->tsfile_remap = 1;
+
   /* Explicit mappings                                               */
   read_explicit_maps(params, fp);
 
@@ -2032,6 +2053,12 @@ parameters_t *params_read(FILE *fp)
     }
   }
 
+  /* Read ahead of time varying input files (Mb buffer per file)     */
+  params->prefetch = 0.0;
+  params->prefetch_threads = 1;
+  if (prm_read_double(fp, "INPUT_PREFETCH", &params->prefetch))
+    prm_read_int(fp, "INPUT_PREFETCH_THREADS", &params->prefetch_threads);
+
   /* Output files to write to setup.txt                              */
   sprintf(keyword, "OutputFiles");
   if (prm_read_char(fp, keyword, buf)) {
@@ -6945,6 +6972,22 @@ void params_write(parameters_t *params, dump_data_t *dumpdata, char *name)
 	fprintf(op, " CHECK_W:%s", params->win_file);
       fprintf(op,"\n");
     }
+    if (strlen(params->win_cache))
+      fprintf(op, "WINDOW_CACHE         %s\n", params->win_cache);
+    if (params->win_p2p)
+      fprintf(op, "WINDOW_P2P           YES\n");
+    if (strcasecmp(params->dp_affinity, "NONE"))
+      fprintf(op, "DP_AFFINITY          %s\n", params->dp_affinity);
+  }
+  if (!params->tsfile_remap)
+    fprintf(op, "REMAP_TSFILES        NO\n");
+  if (params->prefetch > 0.0) {
+    fprintf(op, "INPUT_PREFETCH       %-6.1f\n", params->prefetch);
+    fprintf(op, "INPUT_PREFETCH_THREADS %d\n", params->prefetch_threads);
+  }
+  if (params->da && params->da_lr > 0.0) {
+    fprintf(op, "DA_LOCAL_RADIUS      %g\n", params->da_lr);
+    fprintf(op, "DA_NTHREADS          %d\n", params->da_nthreads);
   }
   fprintf(op, "NONLINEAR            %s\n", tf(params->nonlinear));
   fprintf(op, "CALCDENS             %s\n", tf(params->calc_dens));
@@ -9247,6 +9290,11 @@ void read_window_info(parameters_t *params, FILE *fp)
     sprintf(keyword, "CHECK_WIN_MAP");
     if (prm_read_char(fp, keyword, params->win_file)) params->win_type |= WIN_CHECK;
 
+    /* Window map cache, reused while the mesh and decomposition     */
+    /* are unchanged.                                                */
+    sprintf(keyword, "WINDOW_CACHE");
+    prm_read_char(fp, keyword, params->win_cache);
+
     sprintf(keyword, "SHOW_WINDOWS");
     if (prm_read_char(fp, keyword, buf)) {
       if (is_true(buf)) {
@@ -9259,6 +9307,11 @@ void read_window_info(parameters_t *params, FILE *fp)
       
     sprintf(keyword, "WINDOW_RESET");
     prm_read_int(fp, keyword, &params->win_reset);
+
+    /* Transfer 2D auxiliary cells directly between windows          */
+    sprintf(keyword, "WINDOW_P2P");
+    if (prm_read_char(fp, keyword, buf))
+      params->win_p2p = is_true(buf);
     params->win_size = NULL;
     sprintf(keyword, "WINDOW_SIZE");
     if (prm_read_char(fp, keyword, buf)) {
@@ -9317,6 +9370,10 @@ void read_window_info(parameters_t *params, FILE *fp)
     sprintf(keyword, "DPMODE");
     prm_read_char(fp, keyword, params->dp_mode);
   }
+
+  /* Pinning of window threads to cores (pthreads only)             */
+  sprintf(keyword, "DP_AFFINITY");
+  prm_read_char(fp, keyword, params->dp_affinity);
 }
 
 /* END read_window_info()                                            */
@@ -13107,6 +13164,18 @@ void get_output_path(parameters_t *params, FILE *fp) {
     }
     strcpy(params->opath, buf);
   }
+#ifdef HAVE_MPI
+  /* With distributed windows every process holds the complete      */
+  /* master; processes other than the first write their output to a */
+  /* sub-directory of the output path.                              */
+  if (strcasecmp(params->dp_mode, "mpithreads") == 0 && mpi_rank > 0) {
+    sprintf(buf, "%srank%d/", params->opath, mpi_rank);
+    if (mkdir(buf, 0755) && errno != EEXIST)
+      hd_quit("Can't create output directory %s : %s\n", buf,
+	      strerror(errno));
+    strcpy(params->opath, buf);
+  }
+#endif
 }
 
 int is_wet(parameters_t *params, double bathy) {
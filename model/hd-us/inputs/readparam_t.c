@@ -976,6 +976,12 @@ FILE *fp;
     params->tsfile_caching = 1;
   emstag(LDEBUG,"hd:readparam:params_read","Setting ts_file_cachinf to: %s",(params->tsfile_caching?"true":"false"));
 
+  /* Remapping of gridded input with cached weights                  */
+  if (prm_read_char(fp, "REMAP_TSFILES", buf) > 0)
+    params->tsfile_remap = is_true(buf);
+  else
+    params->tsfile_remap = 1;
+
   /* Explicit mappings */
   read_explicit_maps(params, fp);
 
@@ -1060,6 +1066,12 @@ FILE *fp;
     }
   }
 
+  /* Read ahead of time varying input files (Mb buffer per file)     */
+  params->prefetch = 0.0;
+  params->prefetch_threads = 1;
+  if (prm_read_double(fp, "INPUT_PREFETCH", &params->prefetch))
+    prm_read_int(fp, "INPUT_PREFETCH_THREADS", &params->prefetch_threads);
+
   /* Whether we read do threaded I/O on transport file resets */
   params->thIO = 0;
   if (prm_read_char(fp, "SCHED_MODE", buf)) {
@@ -332,6 +332,11 @@ hd_data_t *hd_init(FILE * prmfd)
     dump_geom_us(master, params->geom_file);
   if (params->map_type & WIN_DUMP && strlen(params->wind_file))
     dump_windows_us(master, window, params->wind_file, params->prmname);
+  /* Every MPI rank builds the same windows; only rank 0 writes the  */
+  /* cache so that the ranks don't write the same file together.     */
+  if (strlen(params->win_cache) && strlen(params->win_key) &&
+      !params->win_cached && mpi_rank == 0)
+    window_cache_write(master, window, params->win_cache);
 
   if (params->runmode & EXIT) {
     /*windows_clear(hd_data);*/
@@ -467,8 +472,10 @@ void master_free(master_t *master)
  * calloc, reallloc
  * */
   emstag(LDEBUG,"hd:hd_init:master_free","destroying master");
-  if (master != NULL)
+  if (master != NULL) {
+    hd_ts_remap_free(master);
     free(master);
+  }
   emstag(LDEBUG,"hd:hd_init:master_free","destroyed master");
 }
 
@@ -665,6 +672,16 @@ void compute_constants(parameters_t *params, /* Parameter structure  */
   else
     master->win_reset = 0;
 
+  /* Window-to-window transfers; multi-dt auxiliary cells are read   */
+  /* from the master during the 2D mode so these are not supported.  */
+  master->win_p2p = 0;
+  if (master->nwindows > 1 && params->win_p2p) {
+    if (params->stab & MULTI_DT)
+      hd_warn("WINDOW_P2P not supported with MULTI_DT : using master transfers.\n");
+    else
+      master->win_p2p = 1;
+  }
+
   master->decorr = params->decorr;
   master->decf = params->decf;
   if (params->decf & DEC_ETA)
@@ -2069,6 +2086,10 @@ master_t *master_build(parameters_t *params, geometry_t *geom)
   strcpy(master->autotrpath, params->autotrpath);
   strcpy(master->timeunit, params->timeunit);
   master->tsfile_caching = params->tsfile_caching;
+  master->tsfile_remap = params->tsfile_remap;
+  master->prefetch = params->prefetch;
+  if (master->prefetch > 0.0)
+    df_prefetch_set_threads(params->prefetch_threads);
 
   /* Constants                                                       */
   master->Cd = d_alloc_1d(geom->szcS);
@@ -133,7 +133,9 @@ void hd_step(hd_data_t *hd_data, double tstop)
     /*---------------------------------------------------------------*/
     /* Sources and sinks of water                                    */
     TIMING_SET;
+    PROF_BEGIN("sourcesink", 0);
     sourcesink(master);
+    PROF_END;
     TIMING_DUMP(1, " sourcesink");
 
     /*---------------------------------------------------------------*/
@@ -154,7 +156,9 @@ void hd_step(hd_data_t *hd_data, double tstop)
     /*---------------------------------------------------------------*/
     /* Solve the 3D mode in each window                              */
     TIMING_SET;
+    PROF_BEGIN("mode3d_step", 0);
     mode3d_step(geom, master, window, windat, wincon, master->nwindows);
+    PROF_END;
     TIMING_DUMP(1," mode3d_step");
     if (master->crf == RS_RESTART) return;
 #ifdef HAVE_MPI
@@ -174,7 +178,9 @@ void hd_step(hd_data_t *hd_data, double tstop)
       windat[n]->iratio = iratio;
 
     TIMING_SET;
+    PROF_BEGIN("mode2d_step", 0);
     mode2d_step(geom, master, window, windat, wincon, master->nwindows);
+    PROF_END;
     TIMING_DUMP(1," mode2d_step");
     if (master->crf == RS_RESTART) return;
 #ifdef HAVE_MPI
@@ -186,7 +192,9 @@ void hd_step(hd_data_t *hd_data, double tstop)
 
     /*---------------------------------------------------------------*/
     /* Do the post 3D mode calculations                              */
+    PROF_BEGIN("mode3d_post", 0);
     mode3d_post(geom, master, window, windat, wincon, master->nwindows);
+    PROF_END;
 #ifdef HAVE_MPI
     /* Compare velocity solution between single and multiwindows */
     if (mpi_check_multi_windows_velocity(geom, master, window, windat,
@@ -206,7 +214,9 @@ void hd_step(hd_data_t *hd_data, double tstop)
     /*---------------------------------------------------------------*/
     /* Solve the tracer equation in each window                      */
     TIMING_SET;
+    PROF_BEGIN("tracer_step", 0);
     tracer_step(master, window, windat, wincon, master->nwindows);
+    PROF_END;
     TIMING_DUMP(1," tracer_step");
 #ifdef HAVE_MPI
     /* Compare single tracer solution between single and multiwindows */
@@ -457,7 +467,9 @@ void hd_step_trans(hd_data_t *hd_data, double tstop)
     /*---------------------------------------------------------------*/
     /* Sources and sinks of water                                    */
     TIMING_SET;
+    PROF_BEGIN("sourcesink", 0);
     sourcesink(master);
+    PROF_END;
     TIMING_DUMP(1, " sourcesink");
 
     /*---------------------------------------------------------------*/
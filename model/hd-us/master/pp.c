@@ -1259,12 +1259,14 @@ void build_sparse_grid(parameters_t *params,
   /* reset the corresponding vertical maps.                          */
   sgrid->ngsed = num_scg;
   if (sgrid->ngsed) {
+    int *bptm;
     sgrid->gsed_t = i_alloc_1d(sgrid->ngsed + 1);
     sgrid->ised_t = i_alloc_1d(sgrid->ngsed + 1);
     for (i = 1; i <= sgrid->ngsed; i++) {
       sgrid->gsed_t[i] = cc;
       cc += 1;
     }
+    bptm = ANY_invert(sgrid->bpt, sgrid->nbpt, sgrid->sgsiz);
     cc = sgrid->gsed_t[1];
     /* Vertical maps first */
     for (i = 1; i <= sgrid->nbptS; i++) {
@@ -1272,12 +1274,13 @@ void build_sparse_grid(parameters_t *params,
       while (c != sgrid->zm1[c])
 	c = sgrid->zm1[c];
       /* Get the corresponding interior cells to gsed_t */
-      j = ANY(c, sgrid->bpt, sgrid->nbpt);
+      j = bptm[c];
       if (j) sgrid->ised_t[i] = sgrid->bin[j];
       sgrid->zm1[c] = cc;
       sgrid->zp1[cc] = c;
       cc += 1;
     }
+    i_free_1d(bptm);
 
     /* Horizontal maps */
     for (i = 1; i <= sgrid->ngsed; i++) {
@@ -1307,12 +1307,14 @@ void build_sparse_map(parameters_t *params  /* Input parameters data
   /* reset the corresponding vertical maps.                          */
   geom->ngsed = num_scg;
   if (geom->ngsed) {
+    int *bptm;
     geom->gsed_t = i_alloc_1d(geom->ngsed + 1);
     geom->ised_t = i_alloc_1d(geom->ngsed + 1);
     for (i = 1; i <= geom->ngsed; i++) {
       geom->gsed_t[i] = cc;
       cc += 1;
     }
+    bptm = ANY_invert(geom->bpt, geom->nbpt, geom->sgsiz);
     cc = geom->gsed_t[1];
     /* Vertical maps first */
     for (i = 1; i <= geom->nbptS; i++) {
@@ -1320,12 +1322,13 @@ void build_sparse_map(parameters_t *params  /* Input parameters data
       while (c != geom->zm1[c])
 	c = geom->zm1[c];
       /* Get the corresponding interior cells to gsed_t */
-      j = ANY(c, geom->bpt, geom->nbpt);
+      j = bptm[c];
       if (j) geom->ised_t[i] = geom->bin[j];
       geom->zm1[c] = cc;
       geom->zp1[cc] = c;
       cc += 1;
     }
+    i_free_1d(bptm);
     /* Horizontal maps */
     for (i = 1; i <= geom->ngsed; i++) {
       cc = geom->gsed_t[i];    /* Sediment ghost */
@@ -64,6 +64,9 @@ void hd_quit(const char *s, ...)
   va_end(args);
 
 #ifdef HAVE_MPI
+  /* Other processes may be waiting on this one                     */
+  if (mpi_size > 1)
+    MPI_Abort(MPI_COMM_WORLD, 1);
   MPI_Finalize();
 #endif
   
@@ -84,4 +84,349 @@ void print_timing_header(char *str, void *m)
 }
 #endif
 
+/*-------------------------------------------------------------------*/
+/* Runtime profiler. Each thread that enters a region registers a    */
+/* ring buffer of the most recent PROFILE_BUFFER samples and a table */
+/* of accumulated ticks and calls per window and region. Nothing is  */
+/* shared on the record path apart from registration, so the window */
+/* threads do not contend. The tables are written by prof_write()    */
+/* once the run has finished.                                        */
+/*-------------------------------------------------------------------*/
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#if defined(HAVE_PTHREADS)
+#include <pthread.h>
+#elif defined(HAVE_OMP)
+#include <omp.h>
+#endif
+
+#define PROF_MAXREG 256
+#define PROF_MAXTHR 256
+#define PROF_BUFDEF 65536
+
+typedef struct {
+  unsigned long long t0, t1;    /* Start and end ticks               */
+  int id;                       /* Region                            */
+  int win;                      /* Window (0 = master)               */
+} prof_rec_t;
+
+typedef struct {
+  int n;                        /* Thread index                      */
+  prof_rec_t *buf;              /* Ring buffer                       */
+  long nrec;                    /* Total samples recorded            */
+  int nwin;                     /* Windows allocated in tot, ncalls  */
+  double *tot;                  /* Ticks [win * PROF_MAXREG + id]    */
+  long *ncalls;                 /* Calls [win * PROF_MAXREG + id]    */
+} prof_thread_t;
+
+static char *prof_name[PROF_MAXREG];
+static int prof_nreg = 0;
+static prof_thread_t *prof_thr[PROF_MAXTHR];
+static int prof_nthr = 0;
+static long prof_nbuf = PROF_BUFDEF;
+static unsigned long long prof_tick0;
+static double prof_wall0;
+static __thread prof_thread_t *prof_self = NULL;
+
+#if defined(HAVE_PTHREADS)
+static pthread_mutex_t prof_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define PROF_LOCK pthread_mutex_lock(&prof_mutex)
+#define PROF_UNLOCK pthread_mutex_unlock(&prof_mutex)
+#elif defined(HAVE_OMP)
+static omp_lock_t prof_mutex;
+#define PROF_LOCK omp_set_lock(&prof_mutex)
+#define PROF_UNLOCK omp_unset_lock(&prof_mutex)
+#else
+#define PROF_LOCK
+#define PROF_UNLOCK
+#endif
+
+/*-------------------------------------------------------------------*/
+/* Returns the wall clock in seconds                                 */
+/*-------------------------------------------------------------------*/
+static double prof_wall(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec);
+}
+
+/* END prof_wall()                                                   */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Returns the cycle counter, or nanoseconds where there is none     */
+/*-------------------------------------------------------------------*/
+unsigned long long prof_tick(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return(__rdtsc());
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((unsigned long long)ts.tv_sec * 1000000000ULL +
+	 (unsigned long long)ts.tv_nsec);
+#endif
+}
+
+/* END prof_tick()                                                   */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Reads the profiler parameters and starts the clock                */
+/*-------------------------------------------------------------------*/
+void prof_init(FILE *fp)
+{
+  char buf[MAXSTRLEN];
+  char *env = getenv("EMS_PROFILE");
+
+  prof_on = 0;
+  if (env != NULL && atoi(env))
+    prof_on = 1;
+  if (fp != NULL && prm_read_char(fp, "PROFILE", buf))
+    prof_on = is_true(buf);
+  if (fp != NULL && prm_read_char(fp, "PROFILE_BUFFER", buf)) {
+    prof_nbuf = atol(buf);
+    if (prof_nbuf < 1) {
+      hd_warn("prof_init: PROFILE_BUFFER must be positive; using %d.\n",
+	      PROF_BUFDEF);
+      prof_nbuf = PROF_BUFDEF;
+    }
+  }
+#if !defined(HAVE_PTHREADS) && defined(HAVE_OMP)
+  omp_init_lock(&prof_mutex);
+#endif
+  prof_wall0 = prof_wall();
+  prof_tick0 = prof_tick();
+}
+
+/* END prof_init()                                                   */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Returns the index of a named region, adding it if required        */
+/*-------------------------------------------------------------------*/
+int prof_region(char *name)
+{
+  int n, id = -1;
+
+  PROF_LOCK;
+  for (n = 0; n < prof_nreg; n++) {
+    if (strcmp(prof_name[n], name) == 0) {
+      id = n;
+      break;
+    }
+  }
+  if (id < 0 && prof_nreg < PROF_MAXREG) {
+    prof_name[prof_nreg] = strdup(name);
+    id = prof_nreg++;
+  }
+  PROF_UNLOCK;
+  return(id);
+}
+
+/* END prof_region()                                                 */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Registers the calling thread                                      */
+/*-------------------------------------------------------------------*/
+static prof_thread_t *prof_thread(void)
+{
+  prof_thread_t *pt = NULL;
+
+  PROF_LOCK;
+  if (prof_nthr < PROF_MAXTHR) {
+    pt = (prof_thread_t *)calloc(1, sizeof(prof_thread_t));
+    pt->buf = (prof_rec_t *)malloc(prof_nbuf * sizeof(prof_rec_t));
+    pt->n = prof_nthr;
+    prof_thr[prof_nthr++] = pt;
+  }
+  PROF_UNLOCK;
+  return(pt);
+}
+
+/* END prof_thread()                                                 */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Logs a sample for region id on window win                         */
+/*-------------------------------------------------------------------*/
+void prof_record(int id, int win, unsigned long long t0,
+		 unsigned long long t1)
+{
+  prof_thread_t *pt = prof_self;
+  prof_rec_t *r;
+  int i;
+
+  if (pt == NULL) {
+    if ((pt = prof_thread()) == NULL) return;
+    prof_self = pt;
+  }
+  if (win < 0) win = 0;
+
+  r = &pt->buf[pt->nrec % prof_nbuf];
+  r->t0 = t0;
+  r->t1 = t1;
+  r->id = id;
+  r->win = win;
+  pt->nrec++;
+
+  if (win >= pt->nwin) {
+    int nwin = win + 1;
+    pt->tot = (double *)realloc(pt->tot, nwin * PROF_MAXREG * sizeof(double));
+    pt->ncalls = (long *)realloc(pt->ncalls, nwin * PROF_MAXREG * sizeof(long));
+    for (i = pt->nwin * PROF_MAXREG; i < nwin * PROF_MAXREG; i++) {
+      pt->tot[i] = 0.0;
+      pt->ncalls[i] = 0;
+    }
+    pt->nwin = nwin;
+  }
+  i = win * PROF_MAXREG + id;
+  pt->tot[i] += (double)(t1 - t0);
+  pt->ncalls[i]++;
+}
+
+/* END prof_record()                                                 */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Writes the profile summary (profile.txt) and a Chrome trace       */
+/* (profile.json) which loads in chrome://tracing, Perfetto and      */
+/* speedscope. Throughput of each region is given in 3D cell-steps   */
+/* per second, using ncells wet cells over nsteps steps.             */
+/*-------------------------------------------------------------------*/
+void prof_write(char *opath, long ncells, long nsteps)
+{
+  FILE *fp;
+  char buf[MAXSTRLEN];
+  double tps, *tot, *wt;
+  long *ncalls, n0, nr, r;
+  int nwin = 0, id, n, w, wmax, wmin, first;
+
+  if (!prof_on || prof_nthr == 0) return;
+
+  /* Calibrate the tick rate against the wall clock                  */
+  tps = (double)(prof_tick() - prof_tick0) / (prof_wall() - prof_wall0);
+  if (tps <= 0.0) tps = 1e9;
+
+  /* Sum the per-thread tables                                       */
+  for (n = 0; n < prof_nthr; n++)
+    if (prof_thr[n]->nwin > nwin) nwin = prof_thr[n]->nwin;
+  tot = d_alloc_1d(nwin * PROF_MAXREG);
+  ncalls = (long *)calloc(nwin * PROF_MAXREG, sizeof(long));
+  memset(tot, 0, nwin * PROF_MAXREG * sizeof(double));
+  for (n = 0; n < prof_nthr; n++) {
+    prof_thread_t *pt = prof_thr[n];
+    for (r = 0; r < pt->nwin * PROF_MAXREG; r++) {
+      tot[r] += pt->tot[r];
+      ncalls[r] += pt->ncalls[r];
+    }
+  }
+  wt = d_alloc_1d(nwin);
+
+  /*-----------------------------------------------------------------*/
+  /* Summary                                                         */
+  sprintf(buf, "%sprofile.txt", opath);
+  if ((fp = fopen(buf, "w")) == NULL)
+    hd_warn("prof_write: Can't open file '%s'.\n", buf);
+  else {
+    fprintf(fp, "Profile : %d threads, %d windows, %.4e ticks/s\n",
+	    prof_nthr, nwin - 1, tps);
+    fprintf(fp, "Size    : %ld cells, %ld steps\n\n", ncells, nsteps);
+    fprintf(fp, "%-24s %10s %12s %12s %14s\n", "region", "calls", "total(s)",
+	    "mean(ms)", "cell-steps/s");
+    for (id = 0; id < prof_nreg; id++) {
+      double t = 0.0;
+      long nc = 0;
+      for (w = 0; w < nwin; w++) {
+        t += tot[w * PROF_MAXREG + id];
+        nc += ncalls[w * PROF_MAXREG + id];
+      }
+      if (!nc) continue;
+      fprintf(fp, "%-24s %10ld %12.4f %12.4f %14.4e\n", prof_name[id], nc,
+	      t / tps, 1e3 * t / tps / (double)nc,
+	      (t > 0.0) ? (double)ncells * (double)nsteps * tps / t : 0.0);
+    }
+
+    /* Load imbalance over windows for regions timed per window    */
+    if (nwin > 2) {
+      fprintf(fp, "\nWindow imbalance (seconds)\n");
+      fprintf(fp, "%-24s %10s %10s %10s %8s   per window\n", "region",
+	      "max(win)", "mean", "min", "max/mean");
+      for (id = 0; id < prof_nreg; id++) {
+        double tmax = 0.0, tmin = HUGE, tmean = 0.0;
+        long nc = 0;
+        wmax = wmin = 1;
+        for (w = 1; w < nwin; w++) {
+	  wt[w] = tot[w * PROF_MAXREG + id] / tps;
+	  nc += ncalls[w * PROF_MAXREG + id];
+	  tmean += wt[w];
+	  if (wt[w] > tmax) {
+	    tmax = wt[w];
+	    wmax = w;
+	  }
+	  if (wt[w] < tmin) {
+	    tmin = wt[w];
+	    wmin = w;
+	  }
+        }
+        if (!nc) continue;
+        tmean /= (double)(nwin - 1);
+        fprintf(fp, "%-24s %7.4f(%d) %10.4f %7.4f(%d) %8.2f  ", prof_name[id],
+	        tmax, wmax, tmean, tmin, wmin, (tmean > 0.0) ? tmax / tmean : 0.0);
+        for (w = 1; w < nwin; w++)
+	  fprintf(fp, " %.4f", wt[w]);
+        fprintf(fp, "\n");
+      }
+    }
+    fclose(fp);
+  }
+
+  /*-----------------------------------------------------------------*/
+  /* Trace events, most recent PROFILE_BUFFER samples per thread     */
+  sprintf(buf, "%sprofile.json", opath);
+  if ((fp = fopen(buf, "w")) == NULL)
+    hd_warn("prof_write: Can't open file '%s'.\n", buf);
+  else {
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    first = 1;
+    for (n = 0; n < prof_nthr; n++) {
+      prof_thread_t *pt = prof_thr[n];
+      fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+	      "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+	      first ? "" : ",\n", pt->n, pt->n);
+      first = 0;
+      n0 = (pt->nrec > prof_nbuf) ? pt->nrec - prof_nbuf : 0;
+      for (nr = n0; nr < pt->nrec; nr++) {
+        prof_rec_t *rc = &pt->buf[nr % prof_nbuf];
+        fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"ems\",\"ph\":\"X\","
+	        "\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%d,"
+	        "\"args\":{\"window\":%d}}", prof_name[rc->id],
+	        1e6 * (double)(rc->t0 - prof_tick0) / tps,
+	        1e6 * (double)(rc->t1 - rc->t0) / tps, pt->n, rc->win);
+      }
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+  }
+
+  d_free_1d(tot);
+  d_free_1d(wt);
+  free(ncalls);
+}
+
+/* END prof_write()                                                  */
+/*-------------------------------------------------------------------*/
+
 // EOF
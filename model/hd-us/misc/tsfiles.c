@@ -136,6 +136,11 @@ timeseries_t *hd_ts_read(master_t *master, char *name, int check)
       ts_convert_time_units(ts, master->timeunit);
     }
 
+    /* Read records ahead of the model on the I/O threads            */
+    if (master->prefetch > 0.0)
+      df_prefetch_init(ts->df, master->grid_dt,
+		       (size_t)(master->prefetch * 1e6));
+
     if (check)
       hd_ts_check(master, ts);
 
@@ -207,6 +212,11 @@ timeseries_t *hd_ts_read_us(master_t *master, char *name, int check, char *i_rul
       ts_convert_time_units(ts, master->timeunit);
     }
 
+    /* Read records ahead of the model on the I/O threads            */
+    if (master->prefetch > 0.0)
+      df_prefetch_init(ts->df, master->grid_dt,
+		       (size_t)(master->prefetch * 1e6));
+
     if (check)
       hd_ts_check(master, ts);
 
@@ -460,6 +470,24 @@ char *hd_ts_multifile_get_text_att(int ntsfiles, timeseries_t **tsfiles,
 }
 
 
+/** Flags the open boundaries for reconfiguration if the file run
+  * code asks for it. Forcing events may evaluate their files
+  * concurrently (see SCHED_EVENT_THREADS), so the flag is set in a
+  * critical section.
+  *
+  * @param ts Timeseries file just evaluated.
+  */
+static void hd_ts_obcset(timeseries_t *ts)
+{
+  if (ts_eval_runcode(ts)) {
+#if defined(HAVE_OMP)
+#pragma omp critical (hd_regf)
+#endif
+    master->regf = RS_OBCSET;
+  }
+}
+
+
 /** Evaluate in the first appropriate file the specified variable
   * at the given point and time.
   *
@@ -515,7 +543,7 @@ double hd_ts_multifile_eval_xyz(int ntsfiles, timeseries_t **tsfiles,
 
     assert(index >= 0);
     val = ts_eval_xyz(tsfiles[index], varids[index], t, x, y, z);
-    if (ts_eval_runcode(tsfiles[index])) master->regf = RS_OBCSET;
+    hd_ts_obcset(tsfiles[index]);
 
     return val;
 
@@ -570,6 +598,251 @@ double hd_ts_multifile_eval_xyz_by_name(int ntsfiles, timeseries_t **tsfiles,
 }
 
 
+/*-------------------------------------------------------------------*/
+/* Remapping operators for gridded input.                            */
+/* Evaluating a gridded input with ts_eval_xy() at every cell        */
+/* locates each cell in the input grid whenever the input is         */
+/* updated. For variables interpolated with interp_linear() the      */
+/* result is a fixed weighting of the input record, so the weights   */
+/* are built once per (file, variable, cells) and cached on the      */
+/* master. Each update is then a sparse matrix-vector product over   */
+/* the bracketing records. Other interpolation rules are still       */
+/* evaluated point by point. REMAP_TSFILES NO evaluates every        */
+/* variable point by point.                                          */
+/*-------------------------------------------------------------------*/
+
+/* Size of a record of a variable                                    */
+static int remap_nsrc(datafile_t *df, df_variable_t *v)
+{
+  int i, n = 1;
+
+  for (i = 0; i < v->nd; i++)
+    n *= df->dimensions[v->dimids[i]].size;
+  return(n);
+}
+
+static void remap_free(remap_t *r)
+{
+  if (r->ia) i_free_1d(r->ia);
+  if (r->ja) i_free_1d(r->ja);
+  if (r->a) d_free_1d(r->a);
+  free(r->name);
+  free(r);
+}
+
+/*
+ * Builds the operator for the cells vec[1..nvec] at (x[c], y[c]).
+ * If the variable is not interpolated with interp_linear() the
+ * operator is returned with no weights (ia = NULL).
+ */
+static remap_t *remap_build(timeseries_t *ts, int id, int *vec, int nvec,
+			    double *x, double *y)
+{
+  datafile_t *df = ts->df;
+  df_variable_t *v = df_get_variable(df, id);
+  int *coordtypes = df_get_coord_types(df, v);
+  int nc = df_get_num_coords(df, v);
+  int offsets[16];
+  double weights[16], coords[MAXNUMCOORDS];
+  int cc, c, i, n, nnz = 0;
+  remap_t *r;
+
+  r = (remap_t *)malloc(sizeof(remap_t));
+  memset(r, 0, sizeof(remap_t));
+  r->ts = ts;
+  r->name = strdup(ts->name);
+  r->id = id;
+  r->nsrc = remap_nsrc(df, v);
+  r->vec = vec;
+  r->nvec = nvec;
+  r->x = x;
+  r->y = y;
+
+  if (nc != 2 || v->nd > 4)
+    return(r);
+
+  r->ia = i_alloc_1d(nvec + 2);
+  r->ja = i_alloc_1d(nvec * (1 << v->nd));
+  r->a = d_alloc_1d(nvec * (1 << v->nd));
+  r->ia[1] = 0;
+  for (cc = 1; cc <= nvec; cc++) {
+    c = vec[cc];
+    for (i = 0; i < nc; ++i)
+      coords[i] = (coordtypes[i] & (VT_X | VT_LONGITUDE)) ? x[c] : y[c];
+    n = df_linear_weights(df, v, coords, offsets, weights);
+    if (n < 0) {
+      i_free_1d(r->ia);
+      i_free_1d(r->ja);
+      d_free_1d(r->a);
+      r->ia = r->ja = NULL;
+      r->a = NULL;
+      return(r);
+    }
+    for (i = 0; i < n; i++) {
+      r->ja[nnz] = offsets[i];
+      r->a[nnz++] = weights[i];
+    }
+    r->ia[cc + 1] = nnz;
+  }
+  if (DEBUG("init_m"))
+    dlog("init_m", "  Remapping %s in %s to %d cells : %d weights\n",
+	 v->name, ts->name, nvec, nnz);
+  return(r);
+}
+
+/*
+ * Returns the cached operator for the cells, building it if required.
+ * Returns NULL if the input is not gridded.
+ */
+static remap_t *remap_get(master_t *master, timeseries_t *ts, int id,
+			  int *vec, int nvec, double *x, double *y)
+{
+  datafile_t *df = ts->df;
+  df_variable_t *v = df_get_variable(df, id);
+  remap_t *r, **rp;
+
+  /* Leave ungridded or not yet located variables to ts_eval_xy()    */
+  if (v == NULL || v->nd == 0 || v->csystem == NULL)
+    return(NULL);
+
+  for (rp = &master->remaps; (r = *rp) != NULL; rp = &r->next) {
+    if (r->ts == ts && r->id == id && r->vec == vec && r->nvec == nvec &&
+	r->x == x && r->y == y) {
+      /* The file may have been freed and another read in its place  */
+      if (strcmp(r->name, ts->name) == 0 && r->nsrc == remap_nsrc(df, v))
+	return(r);
+      *rp = r->next;
+      remap_free(r);
+      break;
+    }
+  }
+  r = remap_build(ts, id, vec, nvec, x, y);
+  r->next = master->remaps;
+  master->remaps = r;
+  return(r);
+}
+
+/** Evaluate a gridded input at cells vec[1..nvec] with a cached
+  * remapping operator, i.e. v[c] = conv * ts_eval_xy(x[c], y[c]).
+  *
+  * @param master Master data structure
+  * @param ts Input file
+  * @param id Variable id
+  * @param t time value
+  * @param vec Cells to process vector
+  * @param nvec Size of vec
+  * @param x Cell x coordinates
+  * @param y Cell y coordinates
+  * @param v Variable to update
+  * @param conv Conversion factor
+  * @return 1 if evaluated, 0 if the variable should be evaluated
+  * point by point.
+  */
+int hd_ts_remap_eval(master_t *master, timeseries_t *ts, int id, double t,
+		     int *vec, int nvec, double *x, double *y, double *v,
+		     double conv)
+{
+  datafile_t *df = ts->df;
+  df_variable_t *var;
+  remap_t *r;
+  double rfrac, *d0, *d1 = NULL;
+  int r0, r1, cc, n;
+
+  if (!master->tsfile_remap)
+    return(0);
+
+  /* The operator cache is shared by events that may run            */
+  /* concurrently (see SCHED_EVENT_THREADS).                         */
+#if defined(HAVE_OMP)
+#pragma omp critical (hd_remap)
+#endif
+  r = remap_get(master, ts, id, vec, nvec, x, y);
+  if (r == NULL || r->ia == NULL)
+    return(0);
+
+  /* Bracketing records, as for df_eval_coords()                     */
+  PROF_BEGIN("df_eval_remap", 0);
+  var = df_get_variable(df, id);
+  if ((var->dim_as_record) && (df->records != NULL))
+    df_find_record(df, get_file_time(ts, t), &r0, &r1, &rfrac);
+  else {
+    r0 = r1 = 0;
+    rfrac = 0.0;
+  }
+  if ((df->rec_modulus) && (r0 > r1))
+    r1 += df->nrecords;
+  df_read_records(df, var, r0, r1 - r0 + 1);
+  d0 = df_get_record_data(df, var, r0);
+  if (r1 > r0)
+    d1 = df_get_record_data(df, var, r0 + 1);
+
+#if defined(HAVE_OMP)
+#pragma omp parallel for private(cc,n)
+#endif
+  for (cc = 1; cc <= nvec; cc++) {
+    double v0 = 0.0, v1 = 0.0;
+    for (n = r->ia[cc]; n < r->ia[cc + 1]; n++) {
+      v0 += r->a[n] * d0[r->ja[n]];
+      if (d1) v1 += r->a[n] * d1[r->ja[n]];
+    }
+    v[vec[cc]] = conv * (v0 * (1.0 - rfrac) + v1 * rfrac);
+  }
+  PROF_END;
+  return(1);
+}
+
+/** As for hd_ts_remap_eval(), using the first appropriate file.
+  *
+  * @param master Master data structure
+  * @param ntsfiles Number of timeseries files in array.
+  * @param tsfiles Array of timeseries files.
+  * @param varids Array of variable ids.
+  * @param t time value
+  * @param vec Cells to process vector
+  * @param nvec Size of vec
+  * @param x Cell x coordinates
+  * @param y Cell y coordinates
+  * @param v Variable to update
+  * @param conv Conversion factor
+  * @return 1 if evaluated, 0 if the variable should be evaluated
+  * point by point.
+  */
+int hd_ts_multifile_remap_eval(master_t *master, int ntsfiles,
+			       timeseries_t **tsfiles, int *varids, double t,
+			       int *vec, int nvec, double *x, double *y,
+			       double *v, double conv)
+{
+  int i, index = -1;
+
+  for (i = 0; i < ntsfiles; ++i) {
+    timeseries_t *ts = tsfiles[i];
+    if (varids[i] < 0) continue;
+    index = i;
+    if (((ts->t_mod_type != MOD_NONE) ||
+	 ((t >= ts->t[0]) && (t <= ts->t[ts->nt - 1]))))
+      break;
+  }
+  if (index < 0)
+    return(0);
+
+  if (!hd_ts_remap_eval(master, tsfiles[index], varids[index], t, vec, nvec,
+			x, y, v, conv))
+    return(0);
+  hd_ts_obcset(tsfiles[index]);
+  return(1);
+}
+
+void hd_ts_remap_free(master_t *master)
+{
+  remap_t *r;
+
+  while ((r = master->remaps) != NULL) {
+    master->remaps = r->next;
+    remap_free(r);
+  }
+}
+
+
 
 /** Locate a timeseries file in the cache that matchs that provided.
   *
@@ -690,6 +963,12 @@ void hd_ts_multifile_eval(master_t *master,
 	process_ghrsst(master);
 
       } else {
+	int varids[MAXNUMTSFILES];
+	if (hd_ts_multifile_get_index(ntsfiles, tsfiles, names, var, varids) &&
+	    hd_ts_multifile_remap_eval(master, ntsfiles, tsfiles, varids, t,
+				       vec, nvec, geom->cellx, geom->celly,
+				       v, 1.0))
+	  return;
 	for (cc = 1; cc <= nvec; cc++) {
 	  c = vec[cc];
 	  v[c] = hd_ts_multifile_eval_xy_by_name(ntsfiles, tsfiles,
@@ -1040,8 +1319,11 @@ void hd_ts_multifile_eval_sparse(int ntsfiles, timeseries_t **tsfiles,
      */
     if (thio)
       nc_buffered_get_vara_double(df->ncid, v, varids[index], start, count, var);
-    else
+    else {
+      df_nc_lock();
       nc_get_vara_double(df->ncid, varids[index], start, count, var);
+      df_nc_unlock();
+    }
 
   } else
     hd_quit("hd_ts_multifile_eval_sparse: No timeseries files specified.\n");
@@ -1164,8 +1446,11 @@ void hd_ts_multifile_eval_ugrid(master_t *master, int ntsfiles, timeseries_t **t
      */
     if (thio)
       nc_buffered_get_vara_double(df->ncid, v, varids[index], start, count, in[0]);
-    else
+    else {
+      df_nc_lock();
       nc_get_vara_double(df->ncid, varids[index], start, count, in[0]);
+      df_nc_unlock();
+    }
 
     /* Map to the mesh indexing                                      */
     for (k = 0; k < nz; k++) {
@@ -1285,8 +1570,11 @@ void hd_ts_multifile_eval_ugrid2D(master_t *master, int ntsfiles, timeseries_t *
      */
     if (thio)
       nc_buffered_get_vara_double(df->ncid, v, varids[index], start, count, in);
-    else
+    else {
+      df_nc_lock();
       nc_get_vara_double(df->ncid, varids[index], start, count, in);
+      df_nc_unlock();
+    }
 
     for (cc = istart; cc < ns; cc++) {
       c = cc + oset;
@@ -1403,8 +1691,11 @@ void frc_multifile_eval_ugrid2D(master_t *master, int ntsfiles,
      */
     if (thio)
       nc_buffered_get_vara_double(df->ncid, v, varids[index], start, count, in);
-    else
+    else {
+      df_nc_lock();
       nc_get_vara_double(df->ncid, varids[index], start, count, in);
+      df_nc_unlock();
+    }
 
     for (cc = istart; cc < ns; cc++) {
       c = cc + oset;
@@ -1435,6 +1726,7 @@ int dump_choose_multifile(datafile_t *df, double t)
     for (i=fd->last_fidx; i<fd->nfiles; ++i) {
       df_multi_file_t *f = &fd->files[i];
       /* Open the netcdf file                                        */
+      df_nc_lock();
       if (nc_open(f->filename, NC_NOWRITE, &df->ncid) == NC_NOERR) {
 	/* Update index */
 	fd->last_fidx = i;
@@ -1442,6 +1734,7 @@ int dump_choose_multifile(datafile_t *df, double t)
 	/* timeunit and reset df->nrecords = f->nrecords.            */
 	memset(timeunits, 0, MAXSTRLEN);
 	nc_get_att_text(df->ncid, ncw_var_id(df->ncid, "t"), "units", timeunits);
+	df_nc_unlock();
 	df->nrecords = f->nrecords;
 	for (n = 0; n < f->nrecords; n++) {
 	  df->records[n] = f->records[n];
@@ -1452,7 +1745,9 @@ int dump_choose_multifile(datafile_t *df, double t)
 	if (r0 == r1 && fabs(t - df->records[r0]) > START_EPS) {
 	  /* Reached the end of this file, go to the next */
 	  nc_buffered_clean_up_all_vars(df);
+	  df_nc_lock();
 	  nc_close(df->ncid);
+	  df_nc_unlock();
 	  df->ncid = -1;
 	} else if (r0 < r1 && fabs(t - df->records[r0]) > START_EPS) {
 	  /* Not an exact match, bail out */
@@ -1460,7 +1755,8 @@ int dump_choose_multifile(datafile_t *df, double t)
 	} else {
 	  return(r0);
 	}
-      }
+      } else
+	df_nc_unlock();
     }
   }
   return(-1);
@@ -62,6 +62,7 @@ void mode2d_step_window_p1(master_t *master,
 			   geometry_t *window,
 			   window_t *windat, win_priv_t *wincon)
 {
+  PROF_BEGIN("mode2d_step_window_p1", window->wn);
   /* If tiled coupling occurs at the barotropic level, update the    */
   /* barotropic variables.                                           */
   if (wincon->obcf & DF_BARO) {
@@ -91,6 +92,7 @@ void mode2d_step_window_p1(master_t *master,
   /* then used to get fluxes to update eta.                          */
   if (master->nwindows > 1)
     win_data_empty_2d(master, window, windat, NVELOCITY);
+  PROF_END;
 }
 
 /* END mode2d_step_window_p1()                                       */
@@ -106,6 +108,7 @@ void mode2d_step_window_p2(master_t *master,
 {
   double clock = dp_clock();
 
+  PROF_BEGIN("mode2d_step_window_p2", window->wn);
   /*-----------------------------------------------------------------*/
   /* Fill the window with updated velocities.                        */
   if (master->nwindows > 1)
@@ -149,11 +152,13 @@ void mode2d_step_window_p2(master_t *master,
 
   /*-----------------------------------------------------------------*/
   /* Refill the master with elevation and velocity data from the     */
-  /* window data structure.                                          */
-  if (master->nwindows > 1)
+  /* window data structure. With window-to-window transfers this is  */
+  /* deferred to the end of the 2D mode.                             */
+  if (master->nwindows > 1 && !master->win_p2p)
     win_data_empty_2d(master, window, windat, VELOCITY);
 
   windat->wclk += (dp_clock() - clock);
+  PROF_END;
 }
 
 /* END mode2d_step_window_p2()                                       */
@@ -175,6 +180,9 @@ void mode2d_step(geometry_t *geom,    /* Global geometry             */
   int n, nn;                          /* Counters                    */
   int ic;                             /* 2D mode counter             */
   double oldtime = master->t;
+  int p2p_obc = 0;                    /* Master OBCs need 2D data    */
+
+  if (master->win_p2p) p2p_obc = master_peer_obc(geom);
 
   /*-----------------------------------------------------------------*/
   /* Initialise                                                      */
@@ -199,6 +207,8 @@ void mode2d_step(geometry_t *geom,    /* Global geometry             */
 
     /*---------------------------------------------------------------*/
     /* Do the custom elevation routines on the master                */
+    if (p2p_obc && ic)
+      win_data_peer_empty_2d(master, window, windat, nwindows);
     master->t3d = oldtime + (double)(ic+ico) * master->dt2d;
     bdry_eval_eta_m(geom, master);
     bdry_eval_u1av_m(geom, master);
@@ -229,11 +239,14 @@ void mode2d_step(geometry_t *geom,    /* Global geometry             */
 
     for (nn = 1; nn <= nwindows; nn++) {
       n = wincon[1]->twin[nn];
+      if (!dp_is_local(n)) continue;
       wincon[n]->ic = ic;
 
       /*-------------------------------------------------------------*/
       /* Fill 2D variables into the window data structures.          */
       win_data_fill_2d(master, window[n], windat[n], master->nwindows);
+      if (master->win_p2p)
+	win_data_peer_2d(master, window[n], windat[n], windat, VELOCITY);
 
       /*-------------------------------------------------------------*/
       /* Set the lateral boundary conditions                         */
@@ -267,7 +280,11 @@ void mode2d_step(geometry_t *geom,    /* Global geometry             */
 
     /* Do the 2nd part of the 2D step : elevation and fluxes         */
     dp_vel2d_step_p2();
-    if (master->crf == RS_RESTART) return;
+    if (master->crf == RS_RESTART) {
+      if (master->win_p2p)
+	win_data_peer_empty_2d(master, window, windat, nwindows);
+      return;
+    }
 
 #if TR_CK
     check_transfers(geom, window, windat, wincon, nwindows, VEL2D|FLUX);
@@ -280,6 +297,7 @@ void mode2d_step(geometry_t *geom,    /* Global geometry             */
     /* Do the 3rd part of the 2D step : depth at e1 and e2 faces     */
     for (nn = 1; nn <= nwindows; nn++) {
       n = wincon[1]->twin[nn];
+      if (!dp_is_local(n)) continue;
 
       /* Set the master time here so that boundary data is read in   */
       /* on the 2D time-step. This is over-written below to remove   */
@@ -292,14 +310,18 @@ void mode2d_step(geometry_t *geom,    /* Global geometry             */
       }
       windat[n]->days = master->days;
 
-      if (master->nwindows > 1)
+      if (master->win_p2p)
+	win_data_peer_2d(master, window[n], windat[n], windat, ETA_A);
+      else if (master->nwindows > 1)
 	win_data_refill_2d(master, window[n], windat[n], master->nwindows,
 			   ETA_A);
 
       get_depths(window[n], windat[n], wincon[n]);
-      if (master->nwindows > 1)
+      if (master->nwindows > 1 && !master->win_p2p)
 	win_data_empty_2d(master, window[n], windat[n], DEPTH);
     }
+    /* Depths from windows in other processes                        */
+    dp_exchange(DEPTH);
 
     /* Couple at the barotropic level for 2-way nesting              */
     if (master->obcf & DF_BARO) {
@@ -307,6 +329,10 @@ void mode2d_step(geometry_t *geom,    /* Global geometry             */
     }
   }
 
+  /* Refresh the master after window-to-window transfers             */
+  if (master->win_p2p)
+    win_data_peer_empty_2d(master, window, windat, nwindows);
+
   /* This is to synchronise the master time onto 3D time-steps.      */
   /* If we don't do this then over time accumulation errors build up */
   /* and we get out of sync, causing, for one, the mean velocities   */
@@ -60,6 +60,7 @@ void mode3d_step_window_p1(master_t *master,   /* Master data        */
 
   double clock = dp_clock();
 
+  PROF_BEGIN("mode3d_step_window_p1", window->wn);
   /*-----------------------------------------------------------------*/
   /* Fill 3D  velocities into the window data structures. This can   */
   /* be done inside this  window loop  (contrary to tracers) since   */
@@ -138,6 +139,7 @@ void mode3d_step_window_p1(master_t *master,   /* Master data        */
     win_data_empty_3d(master, window, windat, MIXING);
 
   windat->wclk = (dp_clock() - clock);
+  PROF_END;
 }
 
 /* END mode3d_step_window_p1()                                       */
@@ -157,6 +159,7 @@ void mode3d_step_window_p2(master_t *master,   /* Master data        */
   double clock = dp_clock();
   windat->dt = windat->dtf + windat->dtb;
 
+  PROF_BEGIN("mode3d_step_window_p2", window->wn);
   /*-----------------------------------------------------------------*/
   /* Fill the window with u1 data (dzu1, dzu2, Vz, Kz) from the      */
   /* master.                                                         */
@@ -174,6 +177,7 @@ void mode3d_step_window_p2(master_t *master,   /* Master data        */
 
   windat->dt = windat->dtf;
   windat->wclk += (dp_clock() - clock);
+  PROF_END;
 
 }
 
@@ -435,6 +439,7 @@ void mode3d_prep(geometry_t *geom,      /* Global geometry           */
   /* coefficients and set the vertical grid spacings.                */
   for (nn = 1; nn <= nwindows; nn++) {
     n = wincon[1]->twin[nn];
+    if (!dp_is_local(n)) continue;
     ramp = (wincon[n]->rampf & WIND) ? windat[n]->rampval : 1.0;
 
     /*---------------------------------------------------------------*/
@@ -466,6 +466,7 @@ void df_mom_write(dump_data_t *dumpdata, dump_file_t *df, double t)
     void *p = vn.v;
     int gid = vn.xylocation;
     int ne1 = 0, ne2 = 0, nz = momgrid->nz;
+    df_nc_yield();
     if (vn.ndims == 2) {
       start[1] = df->jlower;
       start[2] = df->ilower;
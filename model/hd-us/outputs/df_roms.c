@@ -523,6 +523,7 @@ void df_roms_write(dump_data_t *dumpdata, dump_file_t *df, double t)
     df_roms_var_t vn = data->vars[n];
     void *p = vn.v;
     double **pdn, **pd = *((double ***)p);
+    df_nc_yield();
     if (vn.ndims == 2) {
       int j,i;
       start[1] = df->jlower;
@@ -591,6 +592,7 @@ void df_roms_write_bdry(dump_data_t *dumpdata, dump_file_t *df, double t)
   for (n = 0; n < df->nvars; n++) {
     df_roms_var_t vn = data->vars[n];
     void *p = vn.v;
+    df_nc_yield();
     if (vn.ndims == 2) {
       df_roms_get_dimsizes_bdry(df, vn, romsgrid, start, count, NULL);
       roms_nc_d_writesub_sigma_bdry_1d(fid, ncw_var_id(fid, df->vars[n]), 
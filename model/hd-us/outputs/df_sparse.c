@@ -536,7 +536,7 @@ void *df_sp_create(dump_data_t *dumpdata, dump_file_t *df)
   for (n = 0; n < df->nvars; n++) {
     if (data->vars[n].ndims == 1) {
       df_sp_get_dimids(cdfid, data->vars[n], &dims[1]);
-      ncw_def_var2(df->name,cdfid, df->vars[n], data->vars[n].type, 2, dims, &vid, df->compress);
+      df_def_var(df, cdfid, df->vars[n], data->vars[n].type, 2, dims, 1, &vid);
     } else {
       hd_quit
         ("dumpfile_create: Unable to create variable, incorrect number of dimensions '%d'",
@@ -588,6 +588,7 @@ void df_sp_write(dump_data_t *dumpdata, dump_file_t *df, double t)
   for (n = 0; n < df->nvars; n++) {
     df_sp_var_t vn = data->vars[n];
     void *p = vn.v;
+    df_nc_yield();
 
     if (vn.ndims == 1) {
       int nx = geom->nce1;
@@ -616,6 +617,7 @@ void df_sp_write(dump_data_t *dumpdata, dump_file_t *df, double t)
       /* Pack into dummy array and dump to file */
       pack_sparse(dumpdata->i1, count[1], dumpdata->w1s, dumpdata->w1);
       start[1] = df->ilower;
+      df_bitround(df, &dumpdata->w1[start[1]], count[1]);
       nc_d_writesub_1d(fid, ncw_var_id(fid, df->vars[n]), start, count,
                        dumpdata->w1);
     }
@@ -1290,31 +1290,16 @@ void *df_ugrid_create(dump_data_t *dumpdata, dump_file_t *df)
   data = (df_ugrid_data_t *)df->private_data;
 
   /*
-   * Set chunksizes to be a single horizontal layer
+   * Compressed files have chunk sizes set to a single horizontal
+   * layer, unless a TIMESERIES chunk_layout is requested
    */
   for (n = 0; n < df->nvars; n++) {
-    size_t chunksize[] = {1,1,1};
     if (data->vars[n].ndims == 1) {
       df_ugrid_get_dimids(cdfid, data->vars[n], &dims[1], NULL);
-      ncw_def_var2(df->name,cdfid, df->vars[n], data->vars[n].type, 2, dims, &vid, df->compress);
-#ifdef NC_NETCDF4
-      if (nc_mode & NC_NETCDF4) {
-	chunksize[0] = 1;
-	(void)nc_inq_dimlen(cdfid, dims[1], &chunksize[1]);
-	ncw_def_var_chunking(df->name, cdfid, vid, chunksize);
-      }
-#endif
+      df_def_var(df, cdfid, df->vars[n], data->vars[n].type, 2, dims, 1, &vid);
     } else if (data->vars[n].ndims == 2) {
       df_ugrid_get_dimids(cdfid, data->vars[n], &dims[2], &dims[1]);
-      ncw_def_var2(df->name,cdfid, df->vars[n], data->vars[n].type, 3, dims, &vid, df->compress);
-#ifdef NC_NETCDF4
-      if (nc_mode & NC_NETCDF4) {
-	chunksize[0] = 1;
-	chunksize[1] = 1;
-	(void)nc_inq_dimlen(cdfid, dims[2], &chunksize[2]);
-	ncw_def_var_chunking(df->name, cdfid, vid, chunksize);
-      }
-#endif
+      df_def_var(df, cdfid, df->vars[n], data->vars[n].type, 3, dims, 1, &vid);
     } else {
       hd_quit
         ("dumpfile_create: Unable to create variable, incorrect number of dimensions '%d'",
@@ -1475,7 +1460,7 @@ void *df_ugrid3_create(dump_data_t *dumpdata, dump_file_t *df)
   data = (df_ugrid_data_t *)df->private_data;
   for (n = 0; n < df->nvars; n++) {
     df_ugrid3_get_dimids(cdfid, data->vars[n], &dims[1]);
-    ncw_def_var2(df->name,cdfid, df->vars[n], data->vars[n].type, 2, dims, &vid, df->compress);
+    df_def_var(df, cdfid, df->vars[n], data->vars[n].type, 2, dims, 1, &vid);
   }
 
   write_dump_attributes_ugrid3(dumpdata, df, cdfid, fptype, df->modulo);
@@ -1559,6 +1544,7 @@ void df_ugrid_write(dump_data_t *dumpdata, dump_file_t *df, double t)
   for (n = 0; n < df->nvars; n++) {
     df_ugrid_var_t vn = data->vars[n];
     void *p = vn.v;
+    df_nc_yield();
     start[1] = df->ilower;
 
     if (vn.ndims == 1) {
@@ -1566,6 +1552,7 @@ void df_ugrid_write(dump_data_t *dumpdata, dump_file_t *df, double t)
       df_ugrid_get_dimsizes(df, vn, NULL, &count[1], NULL);
 
       pack_ugrid1(vn.hmap, count[1], (*(double **)p), dumpdata->w1s, oset);
+      df_bitround(df, &dumpdata->w1s[start[1]], count[1]);
       nc_d_writesub_1d(fid, ncw_var_id(fid, df->vars[n]), start, count,
 		       dumpdata->w1s);
       /*
@@ -1586,6 +1573,8 @@ void df_ugrid_write(dump_data_t *dumpdata, dump_file_t *df, double t)
 	  for (cc = 0; cc < count[2]; cc++)
 	    w[k][cc] = NaN;
 	pack_ugrid2(vn.hmap, vn.vmap, vn.m2d, sz, (*(double **)p), w, oset);
+	for (k = 0; k < count[1]; k++)
+	  df_bitround(df, w[start[1] + k], count[2]);
 	nc_d_writesub_2d(fid, ncw_var_id(fid, df->vars[n]), start, count,
 			 w);
       } else {
@@ -1596,6 +1585,8 @@ void df_ugrid_write(dump_data_t *dumpdata, dump_file_t *df, double t)
 	  for (cc = 0; cc < count[2]; cc++)
 	    w[k][cc] = NaN;
 	pack_ugrids(dumpdata->sednz, count[2], (*(double ***)p), w, oset);
+	for (k = 0; k < count[1]; k++)
+	  df_bitround(df, w[k], count[2]);
 	nc_d_writesub_2d(fid, ncw_var_id(fid, df->vars[n]), start, count, w);
       }
     }
@@ -1640,6 +1631,7 @@ void df_ugrid3_write(dump_data_t *dumpdata, dump_file_t *df, double t)
   for (n = 0; n < df->nvars; n++) {
     df_ugrid_var_t vn = data->vars[n];
     void *p = vn.v;
+    df_nc_yield();
 
     if (df->flag & DF_OBC) {
       open_bdrys_t *open = geom->open[df->obcid];
@@ -1649,15 +1641,18 @@ void df_ugrid3_write(dump_data_t *dumpdata, dump_file_t *df, double t)
 	void *v1 = vn.v;
 	void *v2 = vn.vt;
 	pack_obc3_e1(open, (*(double **)v1), (*(double **)v2), dumpdata->w1);
+	df_bitround(df, dumpdata->w1, count[1]);
 	nc_d_writesub_1d(fid, ncw_var_id(fid, df->vars[n]), start, count, dumpdata->w1);
       } else {
 	pack_obc_t(count[1], (*(double **)p), dumpdata->w1);
+	df_bitround(df, dumpdata->w1, count[1]);
 	nc_d_writesub_1d(fid, ncw_var_id(fid, df->vars[n]), start, count, dumpdata->w1);
       }
     } else {
       memset(dumpdata->w1,  0, geom->szm*sizeof(double));
       df_ugrid3_get_dimsizes(df, vn, &count[1]);
       pack_ugrid3(vn.hmap, count[1], (*(double **)p), dumpdata->w1, oset);
+      df_bitround(df, dumpdata->w1, count[1]);
       nc_d_writesub_1d(fid, ncw_var_id(fid, df->vars[n]), start, count,
 		       dumpdata->w1);
     }
@@ -2750,6 +2745,10 @@ void dump_windows_us(master_t *master, geometry_t **window, char *name, char *in
   ncw_def_dim(name, cdfid, "k_grid",   geom->nz + 1, &kgridid);
   ncw_def_dim(name, cdfid, "nwp1",     nwins+1,      &nwinsid);
 
+  /* Key identifying the mesh and decomposition, for the window cache */
+  if (strlen(params->win_key))
+    write_text_att(cdfid, NC_GLOBAL, "window_key", params->win_key);
+
   /* Variables of length 1 */
   ncw_def_dim(name, cdfid, "one", 1, &oid);
   ncw_def_dim(name, cdfid, "two", 2, &tid);
@@ -4319,6 +4318,141 @@ void read_windows_us(geometry_t *geom, geometry_t **window, char *name)
 /*-------------------------------------------------------------------*/
 
 
+/*-------------------------------------------------------------------*/
+/* Window cache. The window map written by dump_windows_us() is      */
+/* tagged with a key hashed from the mesh and the decomposition      */
+/* parameters. On start up a cache whose key matches is read with    */
+/* read_windows_us() in place of rebuilding the windows and transfer */
+/* maps. Bump WIN_CACHE_VERSION whenever the window construction or  */
+/* the map format changes.                                           */
+/*-------------------------------------------------------------------*/
+#define WIN_CACHE_VERSION 1
+
+static unsigned long long win_hash(unsigned long long h, void *p, size_t n)
+{
+  unsigned char *b = (unsigned char *)p;
+  size_t i;
+
+  /* FNV-1a                                                          */
+  for (i = 0; i < n; i++) {
+    h ^= b[i];
+    h *= 1099511628211ULL;
+  }
+  return(h);
+}
+
+/*-------------------------------------------------------------------*/
+/* Returns the cache key for the mesh and decomposition in key       */
+/*-------------------------------------------------------------------*/
+void window_cache_key(parameters_t *params, geometry_t *geom, char *key)
+{
+  unsigned long long h = 14695981039346656037ULL;
+  int sz[16], j, n, e;
+
+  sz[0] = geom->szc;  sz[1] = geom->szcS;
+  sz[2] = geom->sze;  sz[3] = geom->szeS;
+  sz[4] = geom->szv;  sz[5] = geom->szvS;
+  sz[6] = geom->nz;   sz[7] = geom->sednz;
+  sz[8] = geom->npem; sz[9] = geom->nobc;
+  sz[10] = geom->nwindows;
+  sz[11] = params->win_type;
+  sz[12] = params->win_block;
+  sz[13] = params->metis_opts;
+  sz[14] = params->compatible;
+  sz[15] = geom->us_type;
+  h = win_hash(h, sz, sizeof(sz));
+  h = win_hash(h, &params->smagorinsky, sizeof(double));
+  if (geom->win_size)
+    h = win_hash(h, &geom->win_size[1], geom->nwindows * sizeof(double));
+
+  /* Region decompositions depend on the region file                 */
+  if (params->win_type & WIN_REG) {
+    FILE *fp = fopen(params->win_file, "rb");
+    char buf[4096];
+    size_t nr;
+    if (fp != NULL) {
+      while ((nr = fread(buf, 1, sizeof(buf), fp)) > 0)
+	h = win_hash(h, buf, nr);
+      fclose(fp);
+    }
+  }
+
+  /* Mesh topology and bathymetry                                    */
+  h = win_hash(h, geom->layers, (geom->nz + 1) * sizeof(double));
+  h = win_hash(h, geom->botz, geom->szcS * sizeof(double));
+  h = win_hash(h, geom->npe, geom->szcS * sizeof(int));
+  h = win_hash(h, geom->cellx, geom->szcS * sizeof(double));
+  h = win_hash(h, geom->celly, geom->szcS * sizeof(double));
+  h = win_hash(h, geom->zp1, geom->szc * sizeof(int));
+  h = win_hash(h, geom->zm1, geom->szc * sizeof(int));
+  for (j = 1; j <= geom->npem; j++)
+    h = win_hash(h, geom->c2c[j], geom->szc * sizeof(int));
+  for (e = 0; e < geom->sze; e++)
+    h = win_hash(h, geom->e2c[e], 2 * sizeof(int));
+  h = win_hash(h, geom->w3_t, (geom->n3_t + 1) * sizeof(int));
+  h = win_hash(h, geom->w3_e1, (geom->n3_e1 + 1) * sizeof(int));
+  h = win_hash(h, geom->w3_e2, (geom->n3_e2 + 1) * sizeof(int));
+  for (n = 0; n < geom->nobc; n++) {
+    open_bdrys_t *open = geom->open[n];
+    h = win_hash(h, &open->type, sizeof(int));
+    h = win_hash(h, open->obc_t, (open->no3_t + 1) * sizeof(int));
+    h = win_hash(h, open->obc_e1, (open->no3_e1 + 1) * sizeof(int));
+  }
+
+  sprintf(key, "v%d:%s:%016llx", WIN_CACHE_VERSION, version, h);
+}
+
+/* END window_cache_key()                                            */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Returns 1 if the window cache exists and was made with key        */
+/*-------------------------------------------------------------------*/
+int window_cache_check(char *name, char *key)
+{
+  char buf[MAXSTRLEN];
+  size_t len;
+  int fid, ret = 0;
+
+  if (nc_open(name, NC_NOWRITE, &fid) != NC_NOERR)
+    return(0);
+  if (nc_inq_attlen(fid, NC_GLOBAL, "window_key", &len) == NC_NOERR &&
+      len < MAXSTRLEN &&
+      nc_get_att_text(fid, NC_GLOBAL, "window_key", buf) == NC_NOERR) {
+    buf[len] = '\0';
+    ret = (strcmp(buf, key) == 0);
+  }
+  nc_close(fid);
+  return(ret);
+}
+
+/* END window_cache_check()                                          */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Writes the window cache. The map is written to a temporary file   */
+/* and renamed so that a concurrent start never reads a partial one. */
+/*-------------------------------------------------------------------*/
+void window_cache_write(master_t *master, geometry_t **window, char *name)
+{
+  parameters_t *params = master->params;
+  char tmp[MAXSTRLEN];
+
+  sprintf(tmp, "%s.tmp", name);
+  remove(tmp);
+  dump_windows_us(master, window, tmp, params->prmname);
+  if (rename(tmp, name))
+    hd_warn("window_cache_write: Can't create window cache %s\n", name);
+  else
+    hd_warn("Window cache %s written\n", name);
+}
+
+/* END window_cache_write()                                          */
+/*-------------------------------------------------------------------*/
+
+
 /*-------------------------------------------------------------------*/
 /*-------------------------------------------------------------------*/
 
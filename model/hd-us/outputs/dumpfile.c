@@ -24,8 +24,12 @@
 #include <netcdf.h>
 #include <string.h>
 #include <libgen.h>
+#include <stdint.h>
 #include "hd.h"
 #include "tracer.h"
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 #define MAXDUMPFILES (300)
 #define TYPE_FROM_FILE (-9999)
@@ -34,6 +38,9 @@
 #define STD_ALL_VARS "u1av u2av wtop topz eta wind1 wind2 patm u1 u2 w u v dens dens_0 Kz Vz u1bot u2bot Cd flag u1vh u2vh "
 #define SIMPLE_ALL_VARS "uav vav avg_speed avg_dir u v current_speed current_dir w eta wind_u wind_v wind_mag wind_dir patm dens dens_0 Kz Vz bottom_u bottom_v bottom_speed bottom_dir Cd "
 #define FORCING_VARS "wind1 patm air_temp cloud precipitation dew_point "
+#define CH_TS_NREC   64         /* Default records per TIMESERIES chunk */
+#define CH_TS_SIZE   262144     /* Target values per TIMESERIES chunk */
+#define CH_CACHE_MAX 268435456  /* Largest chunk cache per file */
 
 #define PARRAY_MISSING_VALUE 1e35
 #define PARRAY_SHORT_MISSING_VALUE -32767
@@ -65,8 +72,17 @@ typedef struct {
 /*Structure for data when dispatching event */
 
 typedef struct {
-  double t;                      /* Netcdf file id */
-  void* data ;                  /* Netcdf record number */
+  double t;                     /* Time of the pending dump */
+#ifdef HAVE_PTHREADS
+  int pending;                  /* Flag; = 1 from fill until written */
+  int ready;                    /* Flag; = 1 once dispatched */
+  int threaded;                 /* Flag; = 1 if the writer thread is used */
+  int quit;                     /* Flag; = 1 to stop the writer thread */
+  pthread_t thread;             /* Persistent dump writer thread */
+  pthread_mutex_t lock;         /* Lock for the flags above */
+  pthread_cond_t have_dump;     /* Signalled when a dump is queued */
+  pthread_cond_t have_idle;     /* Signalled when the writer is idle */
+#endif
 } df_dispatch_data_t;
 
 
@@ -157,20 +173,21 @@ static struct {
   void (*close) (dump_data_t *dumpdata, dump_file_t *df);
   void (*reset) (dump_data_t *dumpdata, dump_file_t *df, double t);
   int xyGridOutput;
+  int bitround;                 /* Writer applies df_bitround() */
 } df_func_map[] = {
   {
-    "standard", df_std_create, df_std_write, df_std_close, df_std_reset, 1}, {
-    "simple", df_simple_create, df_simple_write, df_simple_close, df_simple_reset, 1}, {
-    "simple_cf", df_simple_cf_create, df_simple_write, df_simple_close, df_simple_reset, 1}, {
-    "parray", df_parray_create, df_parray_write, df_parray_close, df_parray_reset, 0}, {
-    "memory", df_memory_create, df_memory_write, df_memory_close, df_null_reset, 0}, {
-    "sparse", df_ugrid3_create, df_ugrid3_write, df_ugrid_close, df_ugrid_reset, 2}, {
-    "ugrid", df_ugrid_create, df_ugrid_write, df_ugrid_close, df_ugrid_reset, 1}, {
-    "mom", df_mom_create, df_mom_write, df_mom_close, df_mom_reset, 1}, {
-    "roms", df_roms_create, df_roms_write, df_roms_close, df_roms_reset, 1}, {
-    "roms-bdry", df_roms_create_bdry, df_roms_write_bdry, df_roms_close, df_roms_reset_bdry, 1}, {
-    "restart", df_restart_create, df_restart_write, df_restart_close, df_ugrid_reset, 1}, {
-    NULL, NULL, NULL, NULL, NULL}
+    "standard", df_std_create, df_std_write, df_std_close, df_std_reset, 1, 0}, {
+    "simple", df_simple_create, df_simple_write, df_simple_close, df_simple_reset, 1, 1}, {
+    "simple_cf", df_simple_cf_create, df_simple_write, df_simple_close, df_simple_reset, 1, 1}, {
+    "parray", df_parray_create, df_parray_write, df_parray_close, df_parray_reset, 0, 0}, {
+    "memory", df_memory_create, df_memory_write, df_memory_close, df_null_reset, 0, 0}, {
+    "sparse", df_ugrid3_create, df_ugrid3_write, df_ugrid_close, df_ugrid_reset, 2, 1}, {
+    "ugrid", df_ugrid_create, df_ugrid_write, df_ugrid_close, df_ugrid_reset, 1, 1}, {
+    "mom", df_mom_create, df_mom_write, df_mom_close, df_mom_reset, 1, 0}, {
+    "roms", df_roms_create, df_roms_write, df_roms_close, df_roms_reset, 1, 0}, {
+    "roms-bdry", df_roms_create_bdry, df_roms_write_bdry, df_roms_close, df_roms_reset_bdry, 1, 0}, {
+    "restart", df_restart_create, df_restart_write, df_restart_close, df_ugrid_reset, 1, 0}, {
+    NULL, NULL, NULL, NULL, NULL, 0, 0}
 };
 
 int barof = 0;  /* Global flag for standard OBCs */
@@ -180,6 +197,70 @@ void df_null_reset(dump_data_t *dumpdata, dump_file_t *df, double t)
   return;
 }
 
+/*------------------------------------------------------------------*/
+/* Waits until the dump writer has no dump queued or being written. */
+/*------------------------------------------------------------------*/
+static void dump_wait(df_dispatch_data_t *df_data)
+{
+#ifdef HAVE_PTHREADS
+  int depth;
+
+  if (df_data == NULL || !df_data->threaded) return;
+  /* The writer needs the netCDF lock, which the caller may hold    */
+  depth = df_nc_release();
+  pthread_mutex_lock(&df_data->lock);
+  while (df_data->pending)
+    pthread_cond_wait(&df_data->have_idle, &df_data->lock);
+  pthread_mutex_unlock(&df_data->lock);
+  df_nc_restore(depth);
+#endif
+}
+
+/* END dump_wait()                                                  */
+/*------------------------------------------------------------------*/
+
+
+#ifdef HAVE_PTHREADS
+/*------------------------------------------------------------------*/
+/* Persistent dump writer thread. Waits for dump_dispatch() to      */
+/* release the dump filled by dump_event(), then writes it with     */
+/* dumpfiles(). The output files read the master arrays directly,   */
+/* so the scheduler waits for the writer (dump_progress()) before   */
+/* the model next changes the master.                               */
+/*------------------------------------------------------------------*/
+static void *dump_writer(void *data)
+{
+  sched_event_t* event = (sched_event_t*) data;
+  master_t *master = (master_t *)schedGetPublicData(event);
+  df_dispatch_data_t* df_data = (df_dispatch_data_t*) schedGetPrivateData(event);
+  int diagn_set;
+
+  pthread_mutex_lock(&df_data->lock);
+  while (1) {
+    while (!df_data->ready && !df_data->quit)
+      pthread_cond_wait(&df_data->have_dump, &df_data->lock);
+    if (!df_data->ready) break;
+    df_data->ready = 0;
+    pthread_mutex_unlock(&df_data->lock);
+
+    diagn_set = dumpfiles(master->dumpdata, df_data->t, master->prmfd);
+
+    /* The model reads df_diagn_set after dump_wait()               */
+    pthread_mutex_lock(&df_data->lock);
+    master->df_diagn_set = diagn_set;
+    df_data->pending = 0;
+    pthread_cond_broadcast(&df_data->have_idle);
+  }
+  pthread_mutex_unlock(&df_data->lock);
+
+  return NULL;
+}
+
+/* END dump_writer()                                                */
+/*------------------------------------------------------------------*/
+#endif
+
+
 /*------------------------------------------------------------------*/
 /* Time scheduler_t functions for outputing the model results       */
 /*------------------------------------------------------------------*/
@@ -190,35 +271,30 @@ double dump_event(sched_event_t *event, double t)
   master_t *master = (master_t *)schedGetPublicData(event);
   geometry_t *geom = master->geom;
   dump_data_t *dumpdata = master->dumpdata;
-  df_dispatch_data_t* dispatch_data = malloc(sizeof(df_dispatch_data_t));
-  int debug = 0;
-
-  /* Output dump and test point values if required */
-  master_fill(master, window, windat, wincon);
+  df_dispatch_data_t* dispatch_data = (df_dispatch_data_t*) schedGetPrivateData(event);
 
   /*
-   * Wait for dumps to finish before filling buffer
+   * Wait for the previous dump to finish before filling. The output
+   * files read the master and dumpdata buffers while they write, so
+   * these must not change under the writer.
    */
-#ifdef HAVE_PTHREADS
-  if (event->sm_dump) {
-    if (debug) {
-      while (sem_trywait(event->sm_dump)) {
-	if (errno == EAGAIN)
-	  hd_warn("dump_event: waiting at %f\n", t);
-	else
-	  hd_quit("dump_event: bad errno\n");
-	sleep(1);
-      }
-    } else {
-      /* Block until buffer is filled */
-      sem_wait(event->sm_dump);
-    }
-  }
-#endif
+  PROF_BEGIN("dump_wait", 0);
+  dump_wait(dispatch_data);
+  PROF_END;
 
+  /* Output dump and test point values if required */
+  PROF_BEGIN("dump_event", 0);
+  master_fill(master, window, windat, wincon);
   dumpdata_fill(geom, master, dumpdata);
+  PROF_END;
   dispatch_data->t = t;
-  schedSetPrivateData(event,dispatch_data);
+#ifdef HAVE_PTHREADS
+  if (dispatch_data->threaded) {
+    pthread_mutex_lock(&dispatch_data->lock);
+    dispatch_data->pending = 1;
+    pthread_mutex_unlock(&dispatch_data->lock);
+  }
+#endif
 
   /* Run through the list of dumpfiles and find the the one that        */
   /* next fires off - after the current one
@@ -258,10 +334,6 @@ double dump_event(sched_event_t *event, double t)
     }
   }
 
-#ifdef HAVE_PTHREADS
-  if (event->sm_fill) sem_post(event->sm_fill);
-#endif
-
   emstag(LDEBUG,"hd:output:dumpfile:dump_event","Next dump event at %f days.\n", tout / 86400.0);
 
   event->next_event = tout;
@@ -284,6 +356,9 @@ void dump_snapshot(sched_event_t *event, double t)
   geometry_t *geom = master->geom;
   dump_data_t *dumpdata = master->dumpdata;
 
+  /* Don't fill while the dump writer is busy */
+  dump_wait((df_dispatch_data_t *)schedGetPrivateData(event));
+
   /* Output dump and test point values if required */
   master_fill(master, window, windat, wincon);
   dumpdata_fill(geom, master, dumpdata);
@@ -345,6 +420,9 @@ void dump_f_snapshot(sched_event_t *event, int f, double t)
   geometry_t *geom = master->geom;
   dump_data_t *dumpdata = master->dumpdata;
 
+  /* Don't fill while the dump writer is busy */
+  dump_wait((df_dispatch_data_t *)schedGetPrivateData(event));
+
   /* Output dump and test point values if required */
   master_fill(master, window, windat, wincon);
   dumpdata_fill(geom, master, dumpdata);
@@ -595,20 +673,22 @@ void dumpfile_setup(master_t *master)
 int dump_init(sched_event_t *event)
 {
   master_t *master = (master_t *)schedGetPublicData(event);
-  dump_data_t *dumpdata = master->dumpdata;
+  df_dispatch_data_t *dispatch_data = calloc(1, sizeof(df_dispatch_data_t));
   char buf[MAXSTRLEN];
 
+  schedSetPrivateData(event, dispatch_data);
+
 #ifdef HAVE_PTHREADS
   if (prm_read_char(master->prmfd, "SCHED_MODE", buf))
     if (strcasecmp(buf, "pthreads") == 0) {
-      /* Allocate and initialise semaphores */
-      event->sm_fill = malloc(sizeof(sem_t));
-      event->sm_dump = malloc(sizeof(sem_t));
-
-      if (sem_init(event->sm_fill, 0, 0))
-	hd_quit("dump_init: error initialising semaphore fill\n");
-      if (sem_init(event->sm_dump, 0, 1))
-	hd_quit("dump_init: error initialising semaphore dump\n");
+      /* Start the dump writer. This thread is kept for the whole   */
+      /* run and writes each dump handed over by dump_dispatch().   */
+      pthread_mutex_init(&dispatch_data->lock, NULL);
+      pthread_cond_init(&dispatch_data->have_dump, NULL);
+      pthread_cond_init(&dispatch_data->have_idle, NULL);
+      dispatch_data->threaded = 1;
+      if (pthread_create(&dispatch_data->thread, NULL, dump_writer, event))
+	hd_quit("dump_init: error creating dump writer thread\n");
     }
 #endif
 
@@ -662,48 +742,31 @@ void* dump_dispatch(void* data)
   sched_event_t* event = (sched_event_t*) data;
   master_t *master = (master_t *)schedGetPublicData(event);
   df_dispatch_data_t* df_data = (df_dispatch_data_t*) schedGetPrivateData(event);
-  int debug = 0;
 
 #ifdef HAVE_PTHREADS
-  if (event->sm_fill) {
-    if (debug) {
-      while (sem_trywait(event->sm_fill)) {
-	if (errno == EAGAIN)
-	  hd_warn("dump_dispatch: waiting at %f\n", df_data->t);
-	else
-	  hd_quit("dump_dispatch: bad errno\n");
-	sleep(1);
-      }
-    } else {
-      /* Block until buffer is filled */
-      sem_wait(event->sm_fill);
-    }
+  if (df_data->threaded) {
+    /* Hand the dump over to the writer thread */
+    pthread_mutex_lock(&df_data->lock);
+    df_data->ready = 1;
+    pthread_cond_signal(&df_data->have_dump);
+    pthread_mutex_unlock(&df_data->lock);
+    return 0;
   }
 #endif
   
   master->df_diagn_set = dumpfiles(master->dumpdata, df_data->t, master->prmfd);
 
-#ifdef HAVE_PTHREADS
-  /* Done, signal dumped */
-  if (event->sm_dump) sem_post(event->sm_dump);
-#endif
-
   return 0;
 }
 
 
 /*------------------------------------------------------------------*/
-/* Initialise the output dumps                                      */
+/* Waits for a dump handed to the writer by dump_dispatch()         */
 /*------------------------------------------------------------------*/
 int dump_progress(sched_event_t *event)
 {
-  /*
-   * Synchronisation is now achieved via a pari of semaphores so this
-   * function is no longer used. It's possible we'll need this in the
-   * future if we move to multi dispatch threads
-   */
-  hd_quit("dumpfile:dump_progress called when it should not have!\n");
-  return 0;
+  dump_wait((df_dispatch_data_t *)schedGetPrivateData(event));
+  return 1;
 }
 
 
@@ -715,12 +778,33 @@ void dump_cleanup(sched_event_t *event, double t)
   master_t *master = (master_t *)schedGetPublicData(event);
   geometry_t *geom = master->geom;
   dump_data_t *dumpdata = master->dumpdata;
+  df_dispatch_data_t* df_data = (df_dispatch_data_t*) schedGetPrivateData(event);
+
+  /* Write any outstanding dump and stop the writer thread */
+  dump_wait(df_data);
+#ifdef HAVE_PTHREADS
+  if (df_data != NULL && df_data->threaded) {
+    pthread_mutex_lock(&df_data->lock);
+    df_data->quit = 1;
+    pthread_cond_signal(&df_data->have_dump);
+    pthread_mutex_unlock(&df_data->lock);
+    pthread_join(df_data->thread, NULL);
+    pthread_cond_destroy(&df_data->have_idle);
+    pthread_cond_destroy(&df_data->have_dump);
+    pthread_mutex_destroy(&df_data->lock);
+  }
+#endif
 
   /* Fill the dumpdata structure with master data */
   master_fill(master, window, windat, wincon);
   dumpdata_fill(geom, master, dumpdata);
 
   dumpfile_close(dumpdata, dumpdata->t, master->prmfd);
+
+  if (df_data != NULL) {
+    free(df_data);
+    schedSetPrivateData(event, NULL);
+  }
 }
 
 /* END dump_cleanup()                                               */
@@ -783,6 +867,10 @@ int dumpfiles(dump_data_t *dumpdata, double t, FILE * fp)
   int ymd[3];
   double newt;
 
+  /* The writers give the netCDF lock to waiting input reads between */
+  /* variables (df_nc_yield()).                                      */
+  df_nc_lock();
+
   /* Loop through dump file dumplist, writing any file which needs it */
   for (f = 0; f < dumpdata->ndf; f++) {
     /* Skip dump if the DA flag doesn't match for this dumpfile */
@@ -862,6 +950,8 @@ int dumpfiles(dump_data_t *dumpdata, double t, FILE * fp)
         && !(dumpdata->dumplist[f].finished))
       dumpdata->dumplist[f].close(dumpdata, &dumpdata->dumplist[f]);
   }
+  df_nc_unlock();
+
   /* Re-initialise diagnostic tracers if necessary */
   if (init_diagn) {
     for (n = 0; n < dumpdata->ntr; ++n) {
@@ -1194,10 +1284,51 @@ void read_dumpfiles(FILE *fp, dump_file_t *list, dump_data_t *dumpdata,
     }
   }
 
+  /* Compression : YES uses deflate level 2, else a level 1 to 9 */
   list->compress = 0;
   sprintf(key, "file%d.compress", f);
-  if (prm_read_char(fp, key, buf))
-    list->compress = is_true(buf);
+  if (prm_read_char(fp, key, buf)) {
+    if (sscanf(buf, "%d", &list->compress) == 1) {
+      if (list->compress < 0 || list->compress > 9)
+	hd_quit("dumpfile_init: file%d.compress level must be 0 to 9\n", f);
+    } else
+      list->compress = is_true(buf) ? 2 : 0;
+  }
+
+  /* NetCDF-4 chunk shape : MAP (default) stores a horizontal layer */
+  /* per record, TIMESERIES stores runs of records for few columns. */
+  list->chunk_layout = CH_MAP;
+  list->chunk_nrec = 0;
+  sprintf(key, "file%d.chunk_layout", f);
+  if (prm_read_char(fp, key, buf)) {
+    char cl[MAXSTRLEN];
+    int nr = 0;
+    if (sscanf(buf, "%s %d", cl, &nr) < 1)
+      hd_quit("dumpfile_init: bad file%d.chunk_layout '%s'\n", f, buf);
+    if (contains_token(cl, "MAP"))
+      list->chunk_layout = CH_MAP;
+    else if (contains_token(cl, "TIMESERIES")) {
+      list->chunk_layout = CH_TS;
+      list->chunk_nrec = max(nr, 0);
+    } else
+      hd_quit("dumpfile_init: unknown file%d.chunk_layout '%s'\n", f, buf);
+  }
+
+  /* Bit-round output to a number of significant decimal digits.    */
+  /* The zeroed trailing mantissa bits compress to almost nothing.  */
+  list->nsd = list->nsb = 0;
+  sprintf(key, "file%d.significant_digits", f);
+  if (prm_read_int(fp, key, &list->nsd)) {
+    if (list->nsd < 1 || list->nsd > 15)
+      hd_quit("dumpfile_init: file%d.significant_digits must be 1 to 15\n", f);
+    /* Only formats whose writers call df_bitround() are rounded     */
+    if (df_func_map[mapIndex].bitround)
+      list->nsb = (int)ceil(list->nsd * log2(10.0));
+    else
+      hd_warn("dumpfile_init: file%d.significant_digits is not applied to '%s' files\n", f, list->type);
+    if (!list->compress)
+      hd_warn("dumpfile_init: file%d.significant_digits has no effect on file size without compression\n", f);
+  }
   list->da_cycle = NONE;
   if (params->da) {
     /* Make forecast mode the default */
@@ -1584,7 +1715,7 @@ void dumpfile_init(dump_data_t *dumpdata, double t, FILE * fp, int *n,
     list[nfiles].compress = 0;
     list[nfiles].bathymask = 9999.0;
     if (prm_read_char(fp, "restart_compress", buf))
-      list[nfiles].compress = is_true(buf);
+      list[nfiles].compress = is_true(buf) ? 2 : 0;
     strcpy(list[nfiles].tunit, dumpdata->output_tunit);
   }
 
@@ -2164,13 +2295,11 @@ void *df_std_create(dump_data_t *dumpdata, dump_file_t *df)
   for (n = 0; n < df->nvars; n++) {
     if (data->vars[n].ndims == 2) {
       df_std_get_dimids(cdfid, data->vars[n], &dims[2], &dims[1], NULL);
-      ncw_def_var2(df->name, cdfid, df->vars[n], data->vars[n].type, 
-			    3, dims, &vid, df->compress);
+      df_def_var(df, cdfid, df->vars[n], data->vars[n].type, 3, dims, 2, &vid);
     } else if (data->vars[n].ndims == 3) {
       df_std_get_dimids(cdfid, data->vars[n],
                         &dims[3], &dims[2], &dims[1]);
-      ncw_def_var2(df->name, cdfid, df->vars[n], data->vars[n].type, 
-			    4, dims, &vid, df->compress);
+      df_def_var(df, cdfid, df->vars[n], data->vars[n].type, 4, dims, 2, &vid);
     } else {
       hd_quit
         ("dumpfile_create: Unable to create variable, incorrect number of dimensions '%d'",
@@ -2380,6 +2509,7 @@ void df_std_write(dump_data_t *dumpdata, dump_file_t *df, double t)
   for (n = 0; n < df->nvars; n++) {
     df_std_var_t vn = data->vars[n];
     void *p = vn.v;
+    df_nc_yield();
 
     if (strcmp("flag", df->vars[n]) == 0) {
       start[1] = df->klower;
@@ -3045,7 +3175,7 @@ static void *df_simple_create(dump_data_t *dumpdata, dump_file_t *df)
       dims[1] = jid;
       dims[2] = iid;
 
-      ncw_def_var2(df->name, cdfid, data->vars[n].name, data->vars[n].fptype, 3, dims, &vid, df->compress);
+      df_def_var(df, cdfid, data->vars[n].name, data->vars[n].fptype, 3, dims, 2, &vid);
       if (is_geog)
         write_text_att(cdfid, vid, "coordinates",
                        "time, latitude, longitude");
@@ -3058,7 +3188,7 @@ static void *df_simple_create(dump_data_t *dumpdata, dump_file_t *df)
       dims[1] = kid;
       dims[2] = jid;
       dims[3] = iid;
-      ncw_def_var2(df->name, cdfid, data->vars[n].name, data->vars[n].fptype, 4, dims, &vid, df->compress);
+      df_def_var(df, cdfid, data->vars[n].name, data->vars[n].fptype, 4, dims, 2, &vid);
 
       if (is_geog)
         write_text_att(cdfid, vid, "coordinates",
@@ -3074,7 +3204,7 @@ static void *df_simple_create(dump_data_t *dumpdata, dump_file_t *df)
       dims[1] = kid_sed;
       dims[2] = jid;
       dims[3] = iid;
-      ncw_def_var2(df->name, cdfid, data->vars[n].name, data->vars[n].fptype, 4, dims,&vid,df->compress);
+      df_def_var(df, cdfid, data->vars[n].name, data->vars[n].fptype, 4, dims, 2, &vid);
       if (is_geog)
         write_text_att(cdfid, vid, "coordinates",
                        "time, zc_sed, latitude, longitude");
@@ -3315,7 +3445,7 @@ static void *df_simple_cf_create(dump_data_t *dumpdata, dump_file_t *df)
       dims[1] = jid;
       dims[2] = iid;
 
-      ncw_def_var2(df->name, cdfid, data->vars[n].name, data->vars[n].fptype, 3, dims,&vid,df->compress);
+      df_def_var(df, cdfid, data->vars[n].name, data->vars[n].fptype, 3, dims, 2, &vid);
       if (is_geog)
         write_text_att(cdfid, vid, "coordinates",
                        "time latitude longitude");
@@ -3328,7 +3458,7 @@ static void *df_simple_cf_create(dump_data_t *dumpdata, dump_file_t *df)
       dims[1] = kid;
       dims[2] = jid;
       dims[3] = iid;
-      ncw_def_var2(df->name,cdfid, data->vars[n].name, data->vars[n].fptype, 4, dims,&vid,df->compress);
+      df_def_var(df, cdfid, data->vars[n].name, data->vars[n].fptype, 4, dims, 2, &vid);
 
       if (is_geog)
         write_text_att(cdfid, vid, "coordinates",
@@ -3344,7 +3474,7 @@ static void *df_simple_cf_create(dump_data_t *dumpdata, dump_file_t *df)
       dims[1] = kid_sed;
       dims[2] = jid;
       dims[3] = iid;
-      ncw_def_var2(df->name,cdfid, data->vars[n].name, data->vars[n].fptype, 4, dims, &vid,df->compress);
+      df_def_var(df, cdfid, data->vars[n].name, data->vars[n].fptype, 4, dims, 2, &vid);
       if (is_geog)
         write_text_att(cdfid, vid, "coordinates",
                        "time zcsed latitude longitude");
@@ -3470,6 +3600,7 @@ static void df_simple_write(dump_data_t *dumpdata, dump_file_t *df,
   for (n = 0; n < df->nvars; n++) {
     df_simple_var_t *var = &data->vars[n];
     void *p = var->v;
+    df_nc_yield();
     if (var->ndims == 2) {
       start[1] = df->jlower;
       start[2] = df->ilower;
@@ -4193,7 +4324,7 @@ static void df_simple_writesub_2d(dump_data_t *dumpdata, dump_file_t *df,
 	    df->landfill == locate_landfill_function("default"))
           nvals[j][i] = SIMPLE_MISSING_VALUE;
         else {
-          nvals[j][i] = values[oj][oi];
+          nvals[j][i] = df_bitround1(df, values[oj][oi]);
 	}
       }
     }
@@ -4247,7 +4378,7 @@ static void df_simple_writesub_3d(dump_data_t *dumpdata, dump_file_t *df,
 		df->landfill == locate_landfill_function("default"))
               nvals[k][j][i] = SIMPLE_MISSING_VALUE;
             else
-              nvals[k][j][i] = values[ok][oj][oi];
+              nvals[k][j][i] = df_bitround1(df, values[ok][oj][oi]);
           }
         }
       }
@@ -4273,7 +4404,7 @@ static void df_simple_writesub_3d(dump_data_t *dumpdata, dump_file_t *df,
 		df->landfill == locate_landfill_function("default"))
               nvals[k][j][i] = SIMPLE_MISSING_VALUE;
             else
-              nvals[k][j][i] = values[ok][oj][oi];
+              nvals[k][j][i] = df_bitround1(df, values[ok][oj][oi]);
           }
         }
       }
@@ -4968,7 +5099,7 @@ void *df_parray_create(dump_data_t *dumpdata, dump_file_t *df)
     if (!data->vars[n].sediment && data->vars[n].ndims == 2) {
       dims[1] = npid;
 
-      ncw_def_var2(df->name,cdfid, data->vars[n].name, data->vars[n].fptype, 2, dims,&vid, df->compress);
+      df_def_var(df, cdfid, data->vars[n].name, data->vars[n].fptype, 2, dims, 1, &vid);
       if (is_geog)
         write_text_att(cdfid, vid, "coordinates",
                        "time, latitude, longitude");
@@ -4980,7 +5111,7 @@ void *df_parray_create(dump_data_t *dumpdata, dump_file_t *df)
     } else if (!data->vars[n].sediment && data->vars[n].ndims == 3) {
       dims[1] = kid;
       dims[2] = npid;
-      ncw_def_var2(df->name, cdfid, data->vars[n].name, data->vars[n].fptype, 3, dims, &vid, df->compress);
+      df_def_var(df, cdfid, data->vars[n].name, data->vars[n].fptype, 3, dims, 1, &vid);
 
       if (is_geog)
         write_text_att(cdfid, vid, "coordinates",
@@ -4996,7 +5127,7 @@ void *df_parray_create(dump_data_t *dumpdata, dump_file_t *df)
              data->vars[n].ndims == 3) {
       dims[1] = kid_sed;
       dims[2] = npid;
-      ncw_def_var2(df->name, cdfid, data->vars[n].name, data->vars[n].fptype, 3, dims, &vid, df->compress);
+      df_def_var(df, cdfid, data->vars[n].name, data->vars[n].fptype, 3, dims, 1, &vid);
       if (is_geog)
         write_text_att(cdfid, vid, "coordinates",
                        "time, z_sed, latitude, longitude");
@@ -5104,6 +5235,7 @@ void df_parray_write(dump_data_t *dumpdata, dump_file_t *df, double t)
   /* Loop over each variable */
   for (n = 0; n < df->nvars; n++) {
     df_parray_var_t *var = &data->vars[n];
+    df_nc_yield();
 
     if (var->ndims == 2) {
 
@@ -6768,6 +6900,7 @@ void *df_memory_create(dump_data_t *dumpdata, dump_file_t *df)
   mem = (df_parray_data_t *)df->private_data;
   mem->data = (df_mempack_t *)malloc(sizeof(df_mempack_t));
   data = mem->data;
+  data->shm = NULL;
   data->runcode =  (dumpdata->crf == RS_FAIL) ? DF_FAIL : DF_RUN;
 
   /* Get the number of variables and populate the headers */
@@ -6902,8 +7035,11 @@ void df_memory_write(dump_data_t *dumpdata, dump_file_t *df, double t)
       v3d += (data->npoints * data->nz);
     }
   }
-  /* Print to ascii file if required */
-  df_memory_dump(df);
+  /* Publish to shared memory, or print to ascii file */
+  if (endswith(df->name, ".shm"))
+    shmpack_write(data, df->name);
+  else
+    df_memory_dump(df);
 }
 
 void df_memory_close(dump_data_t *dumpdata, dump_file_t *df)
@@ -6911,6 +7047,7 @@ void df_memory_close(dump_data_t *dumpdata, dump_file_t *df)
   df_parray_data_t *mem = (df_parray_data_t *)df->private_data;
   df_mempack_t *data = mem->data;
 
+  shmpack_close(data);
   d_free_1d(data->xyz);
   if (data->v2d)
     d_free_1d(data->v2d);
@@ -7956,3 +8093,123 @@ int get_nc_mode(dump_file_t *df)
   }
   return(nc_mode);
 }
+
+
+/*------------------------------------------------------------------*/
+/* Defines a time dependent output variable. For compressed          */
+/* (netCDF-4) files the deflate level and chunk shape requested for  */
+/* the file are applied. nh is the number of trailing horizontal     */
+/* dimensions (1 for unstructured and sparse, 2 for structured).     */
+/* CH_MAP stores one horizontal layer of one record per chunk, which */
+/* suits reading whole maps. CH_TS stores a run of records over a    */
+/* tile of columns, so extracting a time series at a point reads a   */
+/* few chunks rather than one per record; the chunk cache is sized   */
+/* to hold a run of records so chunks are only compressed once full. */
+/*------------------------------------------------------------------*/
+void df_def_var(dump_file_t *df,  /* Dump file                      */
+		int cdfid,        /* netCDF id                      */
+		const char *name, /* Variable name                  */
+		nc_type type,     /* Variable type                  */
+		int ndims,        /* Number of dimensions           */
+		int *dims,        /* Dimension ids                  */
+		int nh,           /* Number of horizontal dims      */
+		int *vid          /* Variable id returned           */
+		)
+{
+  ncw_def_var(df->name, cdfid, name, type, ndims, dims, vid);
+
+#ifdef NC_NETCDF4
+  if (df->compress) {
+    size_t chunk[NC_MAX_VAR_DIMS], len[NC_MAX_VAR_DIMS];
+    size_t nv = 1, ncol = 1;
+    int n, recid = -1, nr = 1, nvars;
+
+    ncw_def_var_deflate(df->name, cdfid, *vid, NC_SHUFFLE, df->compress);
+
+    nc_inq_unlimdim(cdfid, &recid);
+    if (ndims < 2 || dims[0] != recid) return;
+    nh = min(nh, ndims - 1);
+
+    /* Vertical (non-horizontal) dimensions are whole for CH_TS,   */
+    /* and one layer for CH_MAP.                                   */
+    for (n = 1; n < ndims; n++) {
+      nc_inq_dimlen(cdfid, dims[n], &len[n]);
+      chunk[n] = (n < ndims - nh && df->chunk_layout == CH_TS) ? len[n] : 1;
+      nv *= chunk[n];
+    }
+    if (df->chunk_layout == CH_TS) {
+      /* Records per chunk, limited to the number this file holds */
+      nr = (df->chunk_nrec) ? df->chunk_nrec : CH_TS_NREC;
+      if (df->tinc > 0.0 && df->tstop > df->tstart)
+	nr = min(nr, (int)((df->tstop - df->tstart) / df->tinc) + 1);
+      nr = max(nr, 1);
+      /* Square tile of columns (or a run of faces) per chunk */
+      ncol = max(CH_TS_SIZE / (nr * nv), 1);
+      if (nh > 1) ncol = max((size_t)sqrt((double)ncol), 1);
+      for (n = ndims - nh; n < ndims; n++)
+	chunk[n] = min(ncol, len[n]);
+    } else {
+      for (n = ndims - nh; n < ndims; n++)
+	chunk[n] = len[n];
+    }
+    chunk[0] = nr;
+    ncw_def_var_chunking(df->name, cdfid, *vid, chunk);
+
+    /* A record writes across one row of chunks, which are only     */
+    /* compressed once their nr records are filled: cache that row. */
+    /* The caches of the file's variables share CH_CACHE_MAX.       */
+    if (nr > 1) {
+      size_t sz = nr * (type == NC_DOUBLE ? 8 : 4), nchunk = 1;
+      for (n = 1; n < ndims; n++) {
+	size_t nc = (len[n] + chunk[n] - 1) / chunk[n];
+	nchunk *= nc;
+	sz *= nc * chunk[n];
+      }
+      nvars = max(df->nvars, 1);
+      sz = min(sz, CH_CACHE_MAX / nvars);
+      nc_set_var_chunk_cache(cdfid, *vid, sz, max(2 * nchunk + 1, 1009),
+			     0.75);
+    }
+  }
+#endif
+
+  /* nsb is only set for formats that bit-round (df_func_map)       */
+  if (df->nsb && (type == NC_DOUBLE || type == NC_FLOAT))
+    nc_put_att_int(cdfid, *vid, "quantization_nsb", NC_INT, 1, &df->nsb);
+}
+
+/* END df_def_var()                                                 */
+/*------------------------------------------------------------------*/
+
+
+/*------------------------------------------------------------------*/
+/* Bit-rounds a value to the mantissa bits retained for the file,    */
+/* rounding to nearest with ties to even. Trailing mantissa bits are */
+/* zeroed so the shuffle and deflate filters remove them; the error  */
+/* is within half a unit of the last retained bit. This is done on   */
+/* the writer thread on the packed output buffers, never in place on */
+/* model arrays. Non-finite values (land NaNs) pass unchanged.       */
+/*------------------------------------------------------------------*/
+double df_bitround1(dump_file_t *df, double v)
+{
+  union { double d; uint64_t u; } b;
+  int drop = 52 - df->nsb;
+
+  if (df->nsb <= 0 || drop <= 0 || !isfinite(v)) return(v);
+  b.d = v;
+  b.u += ((uint64_t)1 << (drop - 1)) - 1 + ((b.u >> drop) & 1);
+  b.u &= ~(((uint64_t)1 << drop) - 1);
+  return(b.d);
+}
+
+void df_bitround(dump_file_t *df, double *v, size_t n)
+{
+  size_t i;
+
+  if (df->nsb <= 0) return;
+  for (i = 0; i < n; i++)
+    v[i] = df_bitround1(df, v[i]);
+}
+
+/* END df_bitround()                                                */
+/*------------------------------------------------------------------*/
@@ -273,7 +273,6 @@ double plas_init(master_t *master)
   int n, sm, class, type;
 
   for (n = 0; n < master->ptn; n++) {
-    particle_t *p = &master->ptp[n];
     sm = master->pt_sm[n];          /* Particle source map          */
     class = master->pt_ptype[sm];
     type = master->macrop[class]->type;
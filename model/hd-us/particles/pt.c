@@ -24,6 +24,10 @@
 #include <netcdf.h>
 #include "hd.h"
 
+#if defined(HAVE_OMP)
+#include <omp.h>
+#endif
+
 #define RADIUS 6370997.0
 #define ECC 0.0
 
@@ -33,23 +37,79 @@
 #define DEG2RAD(d) ((d)*M_PI/180.0)
 #define RAD2DEG(r) ((r)*180.0/M_PI)
 
+/* Random streams drawn per particle and particle step               */
+#define PT_RAN_U1  0
+#define PT_RAN_U2  1
+#define PT_RAN_W   2
+#define PT_RAN_X   3
+#define PT_RAN_Z   4
+#define PT_RAN_NS  8
+
 /* Prototypes */
-void particles_to_conc(master_t *master, long np, particle_t *p);
-void ptgrid_xytoij(master_t *master, long np, particle_t *p);
-void ptgrid_ijtoxy(master_t *master, long np, particle_t *p);
-void pt_fit_to_grid(master_t *master, long np, particle_t *p);
+void particles_to_conc(master_t *master, long np, pt_store_t *ps);
+void ptgrid_xytoij(master_t *master, long np, pt_store_t *ps);
+void ptgrid_ijtoxy(master_t *master, long np, pt_store_t *ps);
+void pt_fit_to_grid(master_t *master, long np, pt_store_t *ps);
 void pt_write_at_t(master_t *master, double t);
-void pt_move(master_t *master, dump_data_t *dumpdata, particle_t *p,
-             double dt, double maxdh, int sm, int *c2cc);
-void pt_set_age(master_t *master, particle_t *p, double dt);
-void pt_set_size(master_t *master, particle_t *p, double dt, int n);
-void pt_set_svel(master_t *master, particle_t *p, double dt, int n);
-void pt_new(master_t *master, long np, particle_t *p);
+void pt_move(master_t *master, dump_data_t *dumpdata, pt_store_t *ps,
+             long n, double dt, double maxdh, int sm, int *c2cc,
+             double *dage, double *dagec, pt_interp_t *pi);
+void pt_set_age(master_t *master, pt_store_t *ps, long n, double dt);
+void pt_set_size(master_t *master, pt_store_t *ps, long n, double dt);
+void pt_set_svel(master_t *master, pt_store_t *ps, long n, double dt);
+void pt_new(master_t *master, long np, pt_store_t *ps);
 int hd_pt_create(master_t *master, char *name);
-int get_pos_m(master_t *master, particle_t *p, int c, int ci, double u, double v, double w,
-	      double *cx, double *cy, double *cz, double dt);
+int get_pos_m(master_t *master, pt_store_t *ps, long n, int c, int ci,
+	      double u, double v, double w, double *cx, double *cy,
+	      double *cz, double dt, double *dage, double *dagec,
+	      pt_interp_t *pi);
 void pt_auto_init(master_t *master);
-void pt_pl_ma2mi(master_t *master, particle_t *p, double rate, double dt, int n);
+void pt_pl_ma2mi(master_t *master, pt_store_t *ps, long n, double rate,
+		 double dt);
+void pt_bin_init(master_t *master);
+void pt_bin(master_t *master, long np, pt_store_t *ps);
+void pt_bin_add(master_t *master, pt_store_t *ps, long n);
+static void pt_hist(master_t *master, int b);
+static void pt_interp_init(master_t *master, geometry_t **window,
+			   window_t **windat, win_priv_t **wincon);
+static void pt_interp_free(master_t *master);
+
+
+/*-------------------------------------------------------------------*/
+/* Returns a uniform random number for particle n. Draws come from a */
+/* counter based generator keyed on (seed, particle, step, stream),  */
+/* so a particle's sequence does not depend on the order in which    */
+/* particles are moved, or on the number of threads moving them.     */
+/* The step is counted from the model time rather than kept as a     */
+/* running total, so a restarted run draws the same numbers.         */
+/*-------------------------------------------------------------------*/
+static double pt_ran(master_t *master, long n, int stream)
+{
+  double ns = floor((master->t - master->pt_t0) / master->ptstep);
+  unsigned long step = (ns > 0.0) ? (unsigned long)ns : 0;
+
+  return(ran_ctr(master->pt_seed, (unsigned long)n,
+		 step * PT_RAN_NS + stream));
+}
+
+/* END pt_ran()                                                      */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Increments bin b of the particle age histogram. May be called by  */
+/* several threads moving particles concurrently.                    */
+/*-------------------------------------------------------------------*/
+static void pt_hist(master_t *master, int b)
+{
+#if defined(HAVE_OMP)
+#pragma omp atomic
+#endif
+  master->phist[b]++;
+}
+
+/* END pt_hist()                                                     */
+/*-------------------------------------------------------------------*/
 
 
 /*-------------------------------------------------------------------*/
@@ -81,12 +141,12 @@ double ptrack_event(sched_event_t *event, double t)
     if (DEBUG("particles"))
       dlog("particles", "Reseting particles at t=%f\n", master->t);
 
-    pt_read(master->ptinname, master->ptinrec, &master->ptn,
-            &master->ptp, NULL, NULL, NULL);
+    pt_read_s(master->ptinname, master->ptinrec, &master->pts,
+	      NULL, NULL, NULL);
 
     if (master->pt_nsource <= 0) {
-      ptgrid_xytoij(master, master->ptn, master->ptp);
-      pt_fit_to_grid(master, master->ptn, master->ptp);
+      ptgrid_xytoij(master, master->ptn, master->pts);
+      pt_fit_to_grid(master, master->ptn, master->pts);
     }
     master->ptreset_t += master->ptreset;
   }
@@ -149,7 +209,9 @@ void ptrack_cleanup(sched_event_t *event, double t)
     if (t + master->dt / 10 >= master->ptout_t)
       pt_write_at_t(master, t);
     if (master->ptmsk) s_free_1d(master->ptmsk);
+    df_nc_lock();
     nc_close(master->ptfid);
+    df_nc_unlock();
   }
   master->ptfid = -1;
 }
@@ -216,6 +278,7 @@ void pt_params_init(master_t *master, FILE * fp)
   prm_get_time_in_secs(fp, "PT_TimeStep", &master->ptstep);
   prm_get_time_in_secs(fp, "PT_ResetStep", &master->ptreset);
 
+  master->pt_t0 = master->ptstart;
   if (master->ptstart < master->t)
     master->ptstart = master->t;
 
@@ -238,6 +301,20 @@ void pt_params_init(master_t *master, FILE * fp)
 
   prm_set_errfn(hd_silent_warn);
 
+  /* Read the seed for the particle random number streams            */
+  master->pt_seed = 0;
+  if (prm_read_char(fp, "PT_RandomSeed", buf))
+    master->pt_seed = strtoul(buf, NULL, 10);
+
+  /* Read the number of threads used to move particles               */
+  master->pt_nomp = 1;
+  prm_read_int(fp, "PT_OMP_NUM_THREADS", &master->pt_nomp);
+  if (master->pt_nomp < 1) master->pt_nomp = 1;
+#if !defined(HAVE_OMP)
+  if (master->pt_nomp > 1)
+    hd_warn("pt_params_init: PT_OMP_NUM_THREADS ignored; not built with OpenMP.\n");
+#endif
+
   master->pt_dumpf = 0;
   /* Read the age colour stretch                                     */
   if (master->compatible & V7367) {
@@ -582,36 +659,30 @@ void pt_params_init(master_t *master, FILE * fp)
   }
 
   /* Read particles and convert to grid coords */
-  pt_read(master->ptinname,
-          master->ptinrec, &master->ptn, &master->ptp, NULL, NULL, NULL);
+  pt_read_s(master->ptinname, master->ptinrec, &master->pts,
+	    NULL, NULL, NULL);
+  master->ptn = master->pts->np;
 
   /* Allocate memory for the particle to source map */
   master->pt_sm = s_alloc_1d(master->ptn);
 
+  /* Allocate memory for the cell binned particle order */
+  pt_bin_init(master);
+
   if (master->pt_nsource > 0) {
-    pt_new(master, master->ptn, master->ptp);
-    for (i = 0; i < master->ptn; i++) {
-      /*
-      master->ptp[i].e1 = master->pt_x1[0];
-      master->ptp[i].e2 = master->pt_y1[0];
-
-      master->ptp[i].e1 = 0.0;
-      master->ptp[i].e2 = 0.0;
-      master->ptp[i].e3 = 0.0;
-      */
-    }
+    pt_new(master, master->ptn, master->pts);
     if (restart) {
-      ptgrid_xytoij(master, master->ptn, master->ptp);
-      pt_fit_to_grid(master, master->ptn, master->ptp);
+      ptgrid_xytoij(master, master->ptn, master->pts);
+      pt_fit_to_grid(master, master->ptn, master->pts);
     }
   } else {
     master->pt_sizelim = 0.0;
-    ptgrid_xytoij(master, master->ptn, master->ptp);
-    pt_fit_to_grid(master, master->ptn, master->ptp);
+    ptgrid_xytoij(master, master->ptn, master->pts);
+    pt_fit_to_grid(master, master->ptn, master->pts);
   }
 
   /* Initialise the particle concentrations */
-  particles_to_conc(master, master->ptn, master->ptp);
+  particles_to_conc(master, master->ptn, master->pts);
 
 
   /* Allocate array for max vert diffusion values */
@@ -622,21 +693,6 @@ void pt_params_init(master_t *master, FILE * fp)
   sched_register(schedule, "particles", ptrack_init,
                  ptrack_event, ptrack_cleanup, master, NULL, NULL);
 
-  /* Throw away some random numbers. This is an attempt to avoid rather
-     bizzare behaviour which can occur under certain circustances. If the
-     utility used to generate initial particle positions uses the same set
-     of random numbers as those used on the first timestep for
-     diffusivities (see ptmove below), the particle positions and
-     diffusivities are correlated, which can lead to unexpected and
-     entertaining results for the first time step! It probably isn't
-     necessary to throw away as many as shown below, but it probably
-     doesn't hurt, either. */
-  for (i = 0; i < master->ptn; i++) {
-    int raninit = 0;
-    ran3(&raninit);
-    ran3(&raninit);
-    ran3(&raninit);
-  }
 }
 
 /* END pt_params_init()                                              */
@@ -676,6 +732,9 @@ void pt_auto_init(master_t *master)
   master->pt_wsf = 0.0;
   master->pt_mass = 1.0;
   master->pt_stickybdry = 0;
+  master->pt_seed = 0;
+  master->pt_t0 = master->ptstart;
+  master->pt_nomp = 1;
   master->pt_agelim = master->ptend - master->ptstart;
   master->pt_dumpf |= (PT_AGE|PT_FATT);
   master->shist = HIST_SCALE * master->pt_agelim / 86400;
@@ -729,18 +788,22 @@ void pt_auto_init(master_t *master)
   }
 
   /* Read particles and convert to grid coords */
-  pt_read(master->ptinname,
-          master->ptinrec, &master->ptn, &master->ptp, NULL, NULL, NULL);
+  pt_read_s(master->ptinname, master->ptinrec, &master->pts,
+	    NULL, NULL, NULL);
+  master->ptn = master->pts->np;
 
   /* Allocate memory for the particle to source map */
   master->pt_sm = s_alloc_1d(master->ptn);
 
+  /* Allocate memory for the cell binned particle order */
+  pt_bin_init(master);
+
   if (master->pt_nsource > 0) {
-    pt_new(master, master->ptn, master->ptp);
+    pt_new(master, master->ptn, master->pts);
   }
 
   /* Initialise the particle concentrations */
-  particles_to_conc(master, master->ptn, master->ptp);
+  particles_to_conc(master, master->ptn, master->pts);
 
   /* Allocate array for max vert diffusion values */
   master->maxdiffw = f_alloc_1d(geom->szcS);
@@ -750,21 +813,6 @@ void pt_auto_init(master_t *master)
   sched_register(schedule, "particles", ptrack_init,
                  ptrack_event, ptrack_cleanup, master, NULL, NULL);
 
-  /* Throw away some random numbers. This is an attempt to avoid rather
-     bizzare behaviour which can occur under certain circustances. If the
-     utility used to generate initial particle positions uses the same set
-     of random numbers as those used on the first timestep for
-     diffusivities (see ptmove below), the particle positions and
-     diffusivities are correlated, which can lead to unexpected and
-     entertaining results for the first time step! It probably isn't
-     necessary to throw away as many as shown below, but it probably
-     doesn't hurt, either. */
-  for (i = 0; i < master->ptn; i++) {
-    int raninit = 0;
-    ran3(&raninit);
-    ran3(&raninit);
-    ran3(&raninit);
-  }
 }
 /* END pt_auto_init()                                                */
 /*-------------------------------------------------------------------*/
@@ -794,6 +842,9 @@ void pt_setup(master_t *master,
 	}
       }
     }
+
+    /* Interpolation state for the threads moving particles          */
+    pt_interp_init(master, window, windat, wincon);
   }
 }
 
@@ -801,14 +852,130 @@ void pt_setup(master_t *master,
 /*-------------------------------------------------------------------*/
 
 
+/*-------------------------------------------------------------------*/
+/* Sets up the interpolation state of each thread moving particles.  */
+/* Thread 0 uses the window velocity GRID_SPECS and the master xytoij */
+/* tree. The other threads get copies that share the interpolation   */
+/* weights and the grid partition, but keep their own search state,  */
+/* so they can find velocities and host cells concurrently. If the   */
+/* velocity interpolation rule can't be copied, particles are moved  */
+/* by one thread.                                                    */
+/*-------------------------------------------------------------------*/
+static void pt_interp_init(master_t *master,
+			   geometry_t **window,
+			   window_t **windat,
+			   win_priv_t **wincon
+			   )
+{
+  int nwindows = master->geom->nwindows;
+  int nomp, t, wn, k;
+
+  pt_interp_free(master);
+
+  /* Check the interpolation rule can be copied                      */
+  if (master->pt_nomp > 1 && windat[1]->d != NULL) {
+    for (k = 0; k <= window[1]->nz; k++) {
+      if (windat[1]->d[k] != NULL) {
+	GRID_SPECS *gc = grid_spec_clone(windat[1]->gsx[k]);
+	if (gc == NULL) {
+	  hd_warn("pt_interp_init: '%s' velocity interpolation can't be used by several threads; moving particles with one thread.\n", wincon[1]->momsr);
+	  master->pt_nomp = 1;
+	} else
+	  grid_spec_clone_destroy(gc);
+	break;
+      }
+    }
+  }
+  nomp = master->pt_nomp;
+
+  master->pt_int = (pt_interp_t **)calloc(nomp, sizeof(pt_interp_t *));
+  for (t = 0; t < nomp; t++) {
+    pt_interp_t *pi = (pt_interp_t *)calloc(1, sizeof(pt_interp_t));
+
+    master->pt_int[t] = pi;
+    pi->cloned = (t > 0) ? 1 : 0;
+    pi->nwindows = nwindows;
+    pi->nz = i_alloc_1d(nwindows + 1);
+    pi->gsx = (GRID_SPECS ***)calloc(nwindows + 1, sizeof(GRID_SPECS **));
+    pi->gsy = (GRID_SPECS ***)calloc(nwindows + 1, sizeof(GRID_SPECS **));
+    pi->gsz = (GRID_SPECS ***)calloc(nwindows + 1, sizeof(GRID_SPECS **));
+    for (wn = 1; wn <= nwindows; wn++) {
+      int nz = window[wn]->nz;
+      pi->nz[wn] = nz;
+      if (!pi->cloned) {
+	pi->gsx[wn] = windat[wn]->gsx;
+	pi->gsy[wn] = windat[wn]->gsy;
+	pi->gsz[wn] = windat[wn]->gsz;
+	continue;
+      }
+      pi->gsx[wn] = (GRID_SPECS **)calloc(nz + 1, sizeof(GRID_SPECS *));
+      pi->gsy[wn] = (GRID_SPECS **)calloc(nz + 1, sizeof(GRID_SPECS *));
+      pi->gsz[wn] = (GRID_SPECS **)calloc(nz + 1, sizeof(GRID_SPECS *));
+      if (windat[wn]->d == NULL) continue;
+      for (k = 0; k <= nz; k++) {
+	if (windat[wn]->d[k] == NULL) continue;
+	pi->gsx[wn][k] = grid_spec_clone(windat[wn]->gsx[k]);
+	pi->gsy[wn][k] = grid_spec_clone(windat[wn]->gsy[k]);
+	pi->gsz[wn][k] = grid_spec_clone(windat[wn]->gsz[k]);
+      }
+    }
+    if (!pi->cloned)
+      pi->xyij_tree = master->xyij_tree;
+    else if (master->xyij_tree != NULL)
+      pi->xyij_tree = grid_xytoij_clone(master->xyij_tree);
+  }
+}
+
+/* END pt_interp_init()                                              */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Frees the interpolation state of the particle move threads        */
+/*-------------------------------------------------------------------*/
+static void pt_interp_free(master_t *master)
+{
+  int t, wn, k;
+
+  if (master->pt_int == NULL) return;
+
+  for (t = 0; t < master->pt_nomp; t++) {
+    pt_interp_t *pi = master->pt_int[t];
+    if (pi->cloned) {
+      for (wn = 1; wn <= pi->nwindows; wn++) {
+	for (k = 0; k <= pi->nz[wn]; k++) {
+	  if (pi->gsx[wn][k]) grid_spec_clone_destroy(pi->gsx[wn][k]);
+	  if (pi->gsy[wn][k]) grid_spec_clone_destroy(pi->gsy[wn][k]);
+	  if (pi->gsz[wn][k]) grid_spec_clone_destroy(pi->gsz[wn][k]);
+	}
+	free(pi->gsx[wn]);
+	free(pi->gsy[wn]);
+	free(pi->gsz[wn]);
+      }
+      if (pi->xyij_tree) grid_xytoij_clone_destroy(pi->xyij_tree);
+    }
+    i_free_1d(pi->nz);
+    free(pi->gsx);
+    free(pi->gsy);
+    free(pi->gsz);
+    free(pi);
+  }
+  free(master->pt_int);
+  master->pt_int = NULL;
+}
+
+/* END pt_interp_free()                                              */
+/*-------------------------------------------------------------------*/
+
+
 /*-------------------------------------------------------------------*/
 /* Convert horizontal particle world coords to grid coords           */
 /*-------------------------------------------------------------------*/
-void ptgrid_xytoij(master_t *master, long np, particle_t *p)
+void ptgrid_xytoij(master_t *master, long np, pt_store_t *ps)
 {
   int n, i, j;
   for (n = 0; n < np; n++) {
-    p[n].c = hd_grid_xytoij(master, p[n].e1, p[n].e2, &i, &j);
+    ps->c[n] = hd_grid_xytoij(master, ps->e1[n], ps->e2[n], &i, &j);
   }
 }
 
@@ -819,7 +986,7 @@ void ptgrid_xytoij(master_t *master, long np, particle_t *p)
 /*-------------------------------------------------------------------*/
 /* Convert horizontal particle grid coords to world coords           */
 /*-------------------------------------------------------------------*/
-void ptgrid_ijtoxy(master_t *master, long np, particle_t *p)
+void ptgrid_ijtoxy(master_t *master, long np, pt_store_t *ps)
 {
   int n;
   return;
@@ -834,11 +1001,10 @@ void ptgrid_ijtoxy(master_t *master, long np, particle_t *p)
 /* defined by the two points (pt_x1,pt_y1,pt_z1) and                 */
 /* (pt_x2,pt_y2,pt_z2).                                              */
 /*-------------------------------------------------------------------*/
-void pt_new(master_t *master, long np, particle_t *p)
+void pt_new(master_t *master, long np, pt_store_t *ps)
 {
   int i = 0;
   int n = 0;
-  int raninit = 0;
 
   for (i = 0; i < master->pt_nsource; ++i) {
     /* Number of particles introduced per particle step */
@@ -866,58 +1032,60 @@ void pt_new(master_t *master, long np, particle_t *p)
     while (count < ptint) {
       /* Look for inactive or lost particles */
 
-      if (!(p[n].flag & PT_ACTIVE) || (p[n].flag & PT_LOST)) {
-        double r1 = ran3(&raninit);
-        double r2 = ran3(&raninit);
+      if (!(ps->flag[n] & PT_ACTIVE) || (ps->flag[n] & PT_LOST)) {
+        double r1 = pt_ran(master, n, PT_RAN_X);
+        double r2 = pt_ran(master, n, PT_RAN_Z);
+        int ci, cj;
 
         /* Having computed the frational hrizontal and vertical */
         /* distances, compute the XYZ location and convert the XY */
         /* into an appropraite IJ position.  */
-        p[n].e1 = master->pt_x1[i] + r1 * diffx;
-        p[n].e2 = master->pt_y1[i] + r1 * diffy;
-        ptgrid_xytoij(master, 1, &master->ptp[n]);
-        p[n].e3 = master->pt_z1[i] + r2 * diffz;
+        ps->e1[n] = master->pt_x1[i] + r1 * diffx;
+        ps->e2[n] = master->pt_y1[i] + r1 * diffy;
+        ps->c[n] = hd_grid_xytoij(master, ps->e1[n], ps->e2[n], &ci, &cj);
+        ps->e3[n] = master->pt_z1[i] + r2 * diffz;
 
         /* Set flag to indicate that this particle is now active     */
-        p[n].flag = PT_ACTIVE | master->pt_colour[i];
-	p[n].dumpf = 0;
+        pt_bin_add(master, ps, n);
+        ps->flag[n] = PT_ACTIVE | master->pt_colour[i];
+	ps->dumpf[n] = 0;
 
 	/* Set the age equal to zero. Only the variable out_age is   */
 	/* written to the output file and this is scaled to a short  */
 	/* integer using the scaling agelim. This is done to reduce  */
 	/* the size of the output file.                              */
-	p[n].age = 0.0;
-	p[n].out_age = 0;
+	ps->age[n] = 0.0;
+	ps->out_age[n] = 0;
 	if (master->pt_agelim) {
 	  if (master->compatible & V7367)
-	    p[n].dumpf |= PT_AGE;
+	    ps->dumpf[n] |= PT_AGE;
 	  else
-	    p[n].dumpf |= (PT_AGE|PT_FATT);
+	    ps->dumpf[n] |= (PT_AGE|PT_FATT);
 	}
 	/* Set the size equal to the initial size. Size is scaled as */
 	/* per age to sizelim.                                       */
-	p[n].size = master->pt_size[i];
+	ps->size[n] = master->pt_size[i];
 	if(master->pt_decay[i] < 0.0)
-	  p[n].out_size = MAX_COL;
+	  ps->out_size[n] = MAX_COL;
 	else
-	  p[n].out_size = 0;
+	  ps->out_size[n] = 0;
 	if (master->pt_sizelim) {
 	  if (master->compatible & V7367)
-	    p[n].dumpf |= PT_SIZE;
+	    ps->dumpf[n] |= PT_SIZE;
 	  else
-	    p[n].dumpf |= (PT_SIZE|PT_FATT);
+	    ps->dumpf[n] |= (PT_SIZE|PT_FATT);
 	}
 	/* Initialise the settling velocity */
-	p[n].svel = 0.0;
+	ps->svel[n] = 0.0;
 
 	/* Get the source map for this particle                      */
 	master->pt_sm[n] = i;
 
-	if (master->ptmsk) p[n].flag |= PT_IN;
+	if (master->ptmsk) ps->flag[n] |= PT_IN;
 
 	/* Macro-plastics account for windage */
 	if ((master->pt_stype[i] & PT_PLASTIC) && master->swind1 && master->swind2)
-	  p[n].flag |= PT_WIND;
+	  ps->flag[n] |= PT_WIND;
         count++;
       }
       n++;
@@ -939,58 +1107,56 @@ void pt_new(master_t *master, long np, particle_t *p)
 /* defined by the two points (pt_x1,pt_y1,pt_z1) and                 */
 /* (pt_x2,pt_y2,pt_z2).                                              */
 /*-------------------------------------------------------------------*/
-void pt_split(master_t *master, long np, particle_t *p, 
+void pt_split(master_t *master, long np, pt_store_t *ps, 
 	      double x, double y, double z)
 {
   int i = 0;
   int n = 0;
-  int raninit = 0;
 
   int count = 0;
 
   /* Process the new release particles */
   while (count < 1) {
     /* Look for inactive or lost particles */
-    if (!(p[n].flag & PT_ACTIVE) || (p[n].flag & PT_LOST)) {
-      double r1 = ran3(&raninit);
-      double r2 = ran3(&raninit);
-
-      /* Having computed the frational hrizontal and vertical */
-      /* distances, compute the XYZ location and convert the XY */
-      /* into an appropraite IJ position.  */
-      p[n].e1 = x;
-      p[n].e2 = y;
-      ptgrid_xytoij(master, 1, &master->ptp[n]);
-      p[n].e3 = z;
+    if (!(ps->flag[n] & PT_ACTIVE) || (ps->flag[n] & PT_LOST)) {
+      int ci, cj;
+
+      /* Set the XYZ location and convert the XY into an appropraite */
+      /* IJ position.                                                */
+      ps->e1[n] = x;
+      ps->e2[n] = y;
+      ps->c[n] = hd_grid_xytoij(master, ps->e1[n], ps->e2[n], &ci, &cj);
+      ps->e3[n] = z;
 
       /* Set flag to indicate that this particle is now active     */
-      p[n].flag = PT_ACTIVE | master->pt_colour[i];
-      p[n].dumpf = 0;
+      pt_bin_add(master, ps, n);
+      ps->flag[n] = PT_ACTIVE | master->pt_colour[i];
+      ps->dumpf[n] = 0;
 
       /* Set the age equal to zero. Only the variable out_age is   */
       /* written to the output file and this is scaled to a short  */
       /* integer using the scaling agelim. This is done to reduce  */
       /* the size of the output file.                              */
-      p[n].age = 0.0;
-      p[n].out_age = 0;
+      ps->age[n] = 0.0;
+      ps->out_age[n] = 0;
       if (master->pt_agelim) {
 	if (master->compatible & V7367)
-	  p[n].dumpf |= PT_AGE;
+	  ps->dumpf[n] |= PT_AGE;
 	else
-	  p[n].dumpf |= (PT_AGE|PT_FATT);
+	  ps->dumpf[n] |= (PT_AGE|PT_FATT);
       }
       /* Set the size equal to the initial size. Size is scaled as */
       /* per age to sizelim.                                       */
-      p[n].size = 1e-5;;
-      p[n].out_size = 0;
+      ps->size[n] = 1e-5;;
+      ps->out_size[n] = 0;
       if (master->pt_sizelim) {
 	if (master->compatible & V7367)
-	  p[n].dumpf |= PT_SIZE;
+	  ps->dumpf[n] |= PT_SIZE;
 	else
-	  p[n].dumpf |= (PT_SIZE|PT_FATT);
+	  ps->dumpf[n] |= (PT_SIZE|PT_FATT);
       }
       /* Initialise the settling velocity */
-      p[n].svel = 0.0;
+      ps->svel[n] = 0.0;
 
       count++;
     }
@@ -1006,30 +1172,140 @@ void pt_split(master_t *master, long np, particle_t *p,
 /*-------------------------------------------------------------------*/
 
 
+/*-------------------------------------------------------------------*/
+/* Allocates the arrays used to keep particles binned by host cell,  */
+/* and the map from surface cells to w2_t indices used in pt_move(). */
+/*-------------------------------------------------------------------*/
+void pt_bin_init(master_t *master)
+{
+  geometry_t *geom = master->geom;
+  int c, cc;
+
+  master->pt_order = (long *)malloc(sizeof(long) * max(master->ptn, 1));
+  master->pt_cstart = (long *)malloc(sizeof(long) * (geom->szc + 1));
+  master->pt_nb = 0;
+  master->pt_binok = 0;
+  master->pt_c2cc = i_alloc_1d(geom->szcS);
+  for (cc = 1; cc <= geom->n2_t; cc++) {
+    c = geom->w2_t[cc];
+    master->pt_c2cc[c] = cc;
+  }
+}
+
+/* END pt_bin_init()                                                 */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Sorts active particles by host cell using a counting sort. On     */
+/* return pt_order[pt_cstart[c]] to pt_order[pt_cstart[c+1]-1] are   */
+/* the particles in cell c, in increasing particle number. Particles */
+/* with an invalid host cell are put in cell 0 so that pt_move() can */
+/* flag them as lost.                                                */
+/* Only the particle numbers are sorted; the particle store itself   */
+/* keeps its order. Physically reordering the store would also make  */
+/* the position and flag reads in pt_move() contiguous, but every    */
+/* per particle array (including pt_sm and the random number         */
+/* streams keyed on the particle number) would have to be permuted   */
+/* each step and the output order would change. The bins are built   */
+/* once per step in particles_to_conc() and reused for the next move */
+/* (see pt_bin_add()).                                               */
+/*-------------------------------------------------------------------*/
+void pt_bin(master_t *master, long np, pt_store_t *ps)
+{
+  geometry_t *geom = master->geom;
+  long *cs = master->pt_cstart;
+  long *order = master->pt_order;
+  int szc = geom->szc;
+  long n;
+  int c;
+
+  /* Count the active particles in each cell                         */
+  memset(cs, 0, (szc + 1) * sizeof(long));
+  for (n = 0; n < np; n++) {
+    if ((ps->flag[n] & PT_ACTIVE) && !(ps->flag[n] & PT_LOST)) {
+      c = ps->c[n];
+      if (c < 0 || c >= szc) c = 0;
+      cs[c + 1]++;
+    }
+  }
+
+  /* Convert counts to the start of each cell's segment              */
+  for (c = 1; c <= szc; c++)
+    cs[c] += cs[c - 1];
+  master->pt_nb = cs[szc];
+
+  /* Scatter particle numbers into their segments. This advances     */
+  /* cs[c] to the start of cell c+1, so shift back afterwards.       */
+  for (n = 0; n < np; n++) {
+    if ((ps->flag[n] & PT_ACTIVE) && !(ps->flag[n] & PT_LOST)) {
+      c = ps->c[n];
+      if (c < 0 || c >= szc) c = 0;
+      order[cs[c]++] = n;
+    }
+  }
+  for (c = szc; c > 0; c--)
+    cs[c] = cs[c - 1];
+  cs[0] = 0;
+  master->pt_binok = 1;
+}
+
+/* END pt_bin()                                                      */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Keeps the bins valid for the move when particle n is about to be  */
+/* activated. An inactive particle is not in pt_order, so it is      */
+/* appended (after the cell segments, which only the move uses until */
+/* the next pt_bin()). A lost particle may already be in pt_order,   */
+/* so the bins are rebuilt before the move instead.                  */
+/*-------------------------------------------------------------------*/
+void pt_bin_add(master_t *master, pt_store_t *ps, long n)
+{
+  if (!master->pt_binok) return;
+  if (ps->flag[n] & PT_LOST)
+    master->pt_binok = 0;
+  else
+    master->pt_order[master->pt_nb++] = n;
+}
+
+/* END pt_bin_add()                                                  */
+/*-------------------------------------------------------------------*/
+
+
 /*-------------------------------------------------------------------*/
 /* Routine to calculate concentrations from particle positions.      */
+/* Particles are binned by cell, so each cell's mass is a reduction  */
+/* over its own segment of pt_order and cells can be filled in       */
+/* parallel without atomics.                                         */
 /*-------------------------------------------------------------------*/
-void particles_to_conc(master_t *master, long np, particle_t *p)
+void particles_to_conc(master_t *master, long np, pt_store_t *ps)
 {
-  int c, n;
+  int c;
   int cc;
   double mass = master->pt_mass;
   double *dz = master->dz;
   geometry_t *geom = master->geom;
+  long *cst = master->pt_cstart;
 
   /* Clear the particle concentration array */
   memset(master->ptconc, 0, geom->sgsiz * sizeof(double));
 
-  /* Count the number of particles per cell.  */
-  for (n = 0; n < np; n++) {
-    unsigned long f = p[n].flag;
-    c = p[n].c;
-    if ((f & PT_ACTIVE) && (!(f & PT_LOST))) {
-      master->ptconc[c] += mass;
-    }
+  /* Sum the mass of particles in each cell.  */
+  pt_bin(master, np, ps);
+#if defined(HAVE_OMP)
+#pragma omp parallel for private(c) num_threads(master->pt_nomp)
+#endif
+  for (c = 0; c < geom->szc; c++) {
+    if (cst[c + 1] > cst[c])
+      master->ptconc[c] = mass * (double)(cst[c + 1] - cst[c]);
   }
 
   /* Calculate cell concentrations */
+#if defined(HAVE_OMP)
+#pragma omp parallel for private(cc) num_threads(master->pt_nomp)
+#endif
   for (cc = 1; cc < geom->b3_t; cc++) {
     int c = geom->w3_t[cc];
     int cs = geom->m2d[c];
@@ -1044,40 +1320,40 @@ void particles_to_conc(master_t *master, long np, particle_t *p)
 /*-------------------------------------------------------------------*/
 /* Routine to mark only those particles in the water as active       */
 /*-------------------------------------------------------------------*/
-void pt_fit_to_grid(master_t *master, long np, particle_t *p)
+void pt_fit_to_grid(master_t *master, long np, pt_store_t *ps)
 {
   int n;
 
   for (n = 0; n < np; n++) {
-    int c = p[n].c;
+    int c = ps->c[n];
     int cs = geom->m2d[c];
-    if (!c || p[n].e3 < geom->botz[cs] || p[n].e3 > master->topz[cs])
-      p[n].flag &= ~PT_ACTIVE;
+    if (!c || ps->e3[n] < geom->botz[cs] || ps->e3[n] > master->topz[cs])
+      ps->flag[n] &= ~PT_ACTIVE;
     else
-      p[n].flag |= PT_ACTIVE;
+      ps->flag[n] |= PT_ACTIVE;
 
     /* Set the age equal to zero. Only the variable out_age is       */
     /* written to the output file and this is scaled to a short      */
     /* integer using the scaling agelim. This is done to reduce      */
     /* the size of the output file.                                  */
-    p[n].age = 0.0;
-    p[n].out_age = 0;
+    ps->age[n] = 0.0;
+    ps->out_age[n] = 0;
     if (master->pt_agelim) {
       if (master->compatible & V7367)
-	p[n].dumpf |= PT_AGE;
+	ps->dumpf[n] |= PT_AGE;
       else
-	p[n].dumpf |= (PT_AGE|PT_FATT);
+	ps->dumpf[n] |= (PT_AGE|PT_FATT);
     }
     /* Set the flag whether a particle is within the age region      */
     if (master->ptmsk) {
       if(master->ptmsk[c]) 
-	p[n].flag |= PT_IN;
+	ps->flag[n] |= PT_IN;
       else
-	p[n].flag |= PT_OUT;
+	ps->flag[n] |= PT_OUT;
     }
     /* Set the windage flag if required                              */
     if (master->pt_wsf && master->swind1 && master->swind2)
-	p[n].flag |= PT_WIND;
+	ps->flag[n] |= PT_WIND;
   }
 }
 
@@ -1090,21 +1366,21 @@ void pt_fit_to_grid(master_t *master, long np, particle_t *p)
 /*-------------------------------------------------------------------*/
 void pt_write_at_t(master_t *master, double t)
 {
-  particle_t *pcopy;
   double newt = t;
-  int n;
   if (DEBUG("particles"))
     dlog("particles", "Writing particles to file at t=%f\n", master->t);
 
   /* Write particles and free memory */
   tm_change_time_units(master->timeunit, master->output_tunit, &newt, 1);
-  pt_write(master->ptfid, master->ptrec, newt, master->ptn, master->ptp);
+  df_nc_lock();
+  pt_write_s(master->ptfid, master->ptrec, newt, master->pts);
   master->ptrec++;
   master->ptout_t += master->ptoutinc;
   if (master->ptout_t > master->ptend) {
     nc_close(master->ptfid);
     master->ptfid = -1;
   }
+  df_nc_unlock();
 }
 
 /* END pt_write_at_t()                                               */
@@ -1139,7 +1415,9 @@ void pt_update(master_t *master,
     pt_ts_t *v_i = master->vvel_i;
     pt_ts_t *w_i = master->wvel_i;
     pt_ts_t *m_i = master->mort_i;
-    int *c2cc;
+    pt_store_t *ps = master->pts;
+    double *dage, *dagec;
+    long m;
   
     if (DEBUG("particles"))
       dlog("particles", "Moving particles, t=%.0f\n", master->t);
@@ -1187,14 +1465,14 @@ void pt_update(master_t *master,
     }
 
     if (master->pt_nsource > 0)
-      pt_new(master, master->ptn, master->ptp);
+      pt_new(master, master->ptn, master->pts);
 
     /*---------------------------------------------------------------*/
     /* Set the settling velocity of each particle from a source if   */
     /* required.                                                     */
     if(master->pt_svel) {
       for (n = 0; n < master->ptn; n++) {
-      	pt_set_svel(master, &master->ptp[n], master->ptstep, n);
+      	pt_set_svel(master, ps, n, master->ptstep);
       }
     }
 
@@ -1207,10 +1485,9 @@ void pt_update(master_t *master,
       m_i->data = ts_eval(m_i->ts, m_i->id, master->t);
       for (n = 0; n < master->ptn; n++) {
 	part_numb++;
-	if (((master->ptp[n].flag) & PT_ACTIVE) &&
-	    !((master->ptp[n].flag) & PT_LOST)) {
+	if ((ps->flag[n] & PT_ACTIVE) && !(ps->flag[n] & PT_LOST)) {
 	  part_numb_act++;
-	} else if(((master->ptp[n].flag) & PT_LOST)) {
+	} else if(ps->flag[n] & PT_LOST) {
 	  part_numb_lost++;
 	}
       }
@@ -1219,7 +1496,7 @@ void pt_update(master_t *master,
       if(dp > 0){
 	int interval = round(part_numb_act/dp);
 	for (n = 0; n < master->ptn; n += interval) {
-	  master->ptp[n].flag |= PT_LOST;
+	  ps->flag[n] |= PT_LOST;
 	}
       }
     }
@@ -1231,25 +1508,47 @@ void pt_update(master_t *master,
 
     /*---------------------------------------------------------------*/
     /* Loop to move each particle                                    */
-    c2cc = i_alloc_1d(geom->szcS);
-    for (c2 = 1; c2 <= geom->n2_t; c2++) {
-      c = geom->w2_t[c2];
-      c2cc[c] = c2;
+    /* Particles are independent apart from the mean age and age     */
+    /* histogram diagnostics. Age contributions are accumulated per  */
+    /* particle and summed in particle order after the loop, so the  */
+    /* result does not depend on the number of threads. Particles    */
+    /* are moved in host cell order so that neighbouring iterations  */
+    /* sample the same velocity and diffusivity data. The bins from  */
+    /* the last particles_to_conc() are used unless a new release    */
+    /* invalidated them; particles lost since are skipped.           */
+    if (!master->pt_binok)
+      pt_bin(master, master->ptn, ps);
+    dage = d_alloc_1d(master->ptn);
+    dagec = d_alloc_1d(master->ptn);
+    memset(dage, 0, master->ptn * sizeof(double));
+    memset(dagec, 0, master->ptn * sizeof(double));
+#if defined(HAVE_OMP)
+#pragma omp parallel for private(m, n) num_threads(master->pt_nomp) schedule(dynamic, 64)
+#endif
+    for (m = 0; m < master->pt_nb; m++) {
+      pt_interp_t *pi = master->pt_int[0];
+#if defined(HAVE_OMP)
+      pi = master->pt_int[omp_get_thread_num()];
+#endif
+      n = master->pt_order[m];
+      if (!(ps->flag[n] & PT_ACTIVE) || (ps->flag[n] & PT_LOST))
+	continue;
+      pt_move(master, dumpdata, ps, n, master->ptstep, 
+	      maxdh, master->pt_sm[n], master->pt_c2cc, dage, dagec, pi);
     }
+    master->pt_binok = 0;
     for (n = 0; n < master->ptn; n++) {
-      if (((master->ptp[n].flag) & PT_ACTIVE) &&
-	  !((master->ptp[n].flag) & PT_LOST)) {
-        pt_move(master, dumpdata, &master->ptp[n], master->ptstep, 
-		maxdh, master->pt_sm[n], c2cc);
-      }
+      master->mage += dage[n];
+      master->magec += dagec[n];
     }
-    i_free_1d(c2cc);
+    d_free_1d(dage);
+    d_free_1d(dagec);
 
     /*---------------------------------------------------------------*/
     /* Set the age of each particle if required                      */
     if (master->pt_agelim) {
       for (n = 0; n < master->ptn; n++) {
-	pt_set_age(master, &master->ptp[n], master->ptstep);
+	pt_set_age(master, ps, n, master->ptstep);
       }
     }
 
@@ -1257,7 +1556,7 @@ void pt_update(master_t *master,
     /* Set the size of each particle if required                     */
     if (master->pt_sizelim) {
       for (n = 0; n < master->ptn; n++) {
-	pt_set_size(master, &master->ptp[n], master->ptstep, n);
+	pt_set_size(master, ps, n, master->ptstep);
       }
     }
 
@@ -1265,7 +1564,7 @@ void pt_update(master_t *master,
 
     /*---------------------------------------------------------------*/
     /* Calculate new particle concentrations in model cells          */
-    particles_to_conc(master, master->ptn, master->ptp);
+    particles_to_conc(master, master->ptn, master->pts);
   }
 
   /*-----------------------------------------------------------------*/
@@ -1288,20 +1587,21 @@ void pt_update(master_t *master,
 /* This routine sets the age of all particles                        */
 /*-------------------------------------------------------------------*/
 void pt_set_age(master_t *master, /*  Master data                    */
-		particle_t *p,    /* Pointer to particle to be moved */
+		pt_store_t *ps,   /* Particle store                  */
+		long n,           /* Particle number                 */
 		double dt         /* Time interval for which to move */
   )
 {
 
   /* Set the age                                                     */
-  if ((p->flag & PT_ACTIVE) && !(p->flag & PT_LOST)) {
-    p->age += dt;
-    p->out_age = min((short)(MAX_COL * p->age / master->pt_agelim),
+  if ((ps->flag[n] & PT_ACTIVE) && !(ps->flag[n] & PT_LOST)) {
+    ps->age[n] += dt;
+    ps->out_age[n] = min((short)(MAX_COL * ps->age[n] / master->pt_agelim),
 		     MAX_COL);
   } else {
     /* Particle is lost - reset age to zero                          */
-    p->age = 0.0;
-    p->out_age = 0;
+    ps->age[n] = 0.0;
+    ps->out_age[n] = 0;
   }
 }
 
@@ -1313,39 +1613,39 @@ void pt_set_age(master_t *master, /*  Master data                    */
 /* This routine sets the size of all particles                       */
 /*-------------------------------------------------------------------*/
 void pt_set_size(master_t *master, /* Master data                    */
-		 particle_t *p,    /* Pointer to particle            */
-		 double dt,        /* Time interval for moving       */
-		 int n             /* Particle number                */
+		 pt_store_t *ps,   /* Particle store                 */
+		 long n,           /* Particle number                */
+		 double dt         /* Time interval for moving       */
   )
 {
   double tol = 1e-10;
   double rate;
 
   /* Set the size                                                    */
-  if ((p->flag & PT_ACTIVE) && !(p->flag & PT_LOST)) {
+  if ((ps->flag[n] & PT_ACTIVE) && !(ps->flag[n] & PT_LOST)) {
     /* If the size decreases below the minimum set the particle as   */
     /* lost.                                                         */
     rate = master->pt_decay[master->pt_sm[n]];
-    if(p->size < tol) {
-      p->size = tol;
-      p->flag |= PT_LOST;
+    if(ps->size[n] < tol) {
+      ps->size[n] = tol;
+      ps->flag[n] |= PT_LOST;
     } else if (master->do_pt & PT_PLASTIC) {
       /* Degrades macro-plasics to the micro-plastic class           */
-      pt_pl_ma2mi(master, p, rate, dt, n);
+      pt_pl_ma2mi(master, ps, n, rate, dt);
     } else {
       /* Increase / decrease the size                                */
-      p->size += p->size * dt / rate;
+      ps->size[n] += ps->size[n] * dt / rate;
       if(rate < 0)
-	p->out_size = max((short)(MAX_COL * p->size / master->pt_sizelim), 0);
+	ps->out_size[n] = max((short)(MAX_COL * ps->size[n] / master->pt_sizelim), 0);
       else {
 	double size = master->pt_size[master->pt_sm[n]];
-	p->out_size = max((short)(MAX_COL * (p->size - size) /
+	ps->out_size[n] = max((short)(MAX_COL * (ps->size[n] - size) /
 				  (master->pt_sizelim - size)), 0);
       }
     }
   } else {
     /* Particle is lost - reset size to zero                         */
-    p->out_size = 0;
+    ps->out_size[n] = 0;
   }
 }
 
@@ -1357,9 +1657,9 @@ void pt_set_size(master_t *master, /* Master data                    */
 /* This routine sets the settling velocity of all particles          */
 /*-------------------------------------------------------------------*/
 void pt_set_svel(master_t *master, /* Master data                    */
-                 particle_t *p,    /* Pointer to particle            */
-                 double dt,        /* Time interval for moving)      */
-                 int n             /* Particle number                */
+                 pt_store_t *ps,   /* Particle store                 */
+                 long n,           /* Particle number                */
+                 double dt         /* Time interval for moving)      */
 )
 
 {
@@ -1372,27 +1672,27 @@ void pt_set_svel(master_t *master, /* Master data                    */
   double kmu = 1.0035e-6; /* Kinematic viscosity at 20C (m2s-1)      */
 
   if (!(master->pt_stype[sm] & PT_SVEL)) {
-    p->svel = 0.0;
+    ps->svel[n] = 0.0;
     return;
   }
 
   /* Set the settling type velocity                                  */
-  if ((p->flag & PT_ACTIVE) && !(p->flag & PT_LOST)) {
+  if ((ps->flag[n] & PT_ACTIVE) && !(ps->flag[n] & PT_LOST)) {
     if (stype == NONE) {
       /* No settling                                                 */
-      p->svel = 0.0;
+      ps->svel[n] = 0.0;
     } else if (stype == CONSTANT) {
       /* Constant settling                                           */
-      p->svel = vel;
+      ps->svel[n] = vel;
     } else if (stype == PSTOKES) {
       /* Stokes settling                                             */
-      int c = p->c;
-      p->svel = -master->g * (dens - master->dens[c]) *
-	p->size * p->size / (18.0 * mu);
+      int c = ps->c[n];
+      ps->svel[n] = -master->g * (dens - master->dens[c]) *
+	ps->size[n] * ps->size[n] / (18.0 * mu);
     } else if (stype == PLSTOKES) {
       /* Settling of plastics from Elliot (1986) :                   */
       /* doi: 10.1007/BF02408134                                     */
-      int c = p->c;
+      int c = ps->c[n];
       double ot = 1.0 / 3.0;
       double c1 = 8.0 / 3.0;
       double d1 = 1.0 - dens / master->dens[c];
@@ -1400,19 +1700,19 @@ void pt_set_svel(master_t *master, /* Master data                    */
       double d = master->macrop[class]->diam;
       double dcrit = 9.52 * pow(kmu, 2.0/3.0) / (pow(master->g, ot) * pow(d1,ot));
       if (d < dcrit)
-	p->svel = master->g * d1 * p->size * p->size / (18.0 * kmu);
+	ps->svel[n] = master->g * d1 * ps->size[n] * ps->size[n] / (18.0 * kmu);
       else {
 	double sgn = (d1 > 0.0) ? 1.0 : -1.0;
-	p->svel = c1 * master->g * p->size * sgn * sqrt(fabs(d1));
+	ps->svel[n] = c1 * master->g * ps->size[n] * sgn * sqrt(fabs(d1));
       }
-      /*p->svel = 0.0;*/
+      /*ps->svel[n] = 0.0;*/
     } else if (stype == DIURNAL) {
       /* Diurnal settling                                            */
       double frac = (master->t/(per))-(floor(master->t/(per)));
-      p->svel = (-vel * cos(frac * 2*PI));
+      ps->svel[n] = (-vel * cos(frac * 2*PI));
     } else if (stype == FILEIN) {
       /* Reading svel from a ts file                                 */
-      p->svel = vel;
+      ps->svel[n] = vel;
     }
   }
 }
@@ -1425,25 +1725,25 @@ void pt_set_svel(master_t *master, /* Master data                    */
 /* Degrades macro-plastics to micro-plastics                         */
 /*-------------------------------------------------------------------*/
 void pt_pl_ma2mi(master_t *master, /* Master data                    */
-                 particle_t *p,    /* Pointer to particle            */
+                 pt_store_t *ps,   /* Particle store                 */
+                 long n,           /* Particle number                */
 		 double rate,      /* Loss rate                      */
-                 double dt,        /* Time interval for moving)      */
-                 int n             /* Particle number                */
+                 double dt         /* Time interval for moving)      */
 )
 {
   geometry_t *geom = master->geom;
   int sm = master->pt_sm[n];       /* Particle source map            */
   int class = master->pt_ptype[sm];
   int tn, i = 0;
-  double loss = p->size * dt / rate;
+  double loss = ps->size[n] * dt / rate;
 
   while ((tn = master->macrop[class]->microtr[i]) >= 0) {
-    p->size = max(p->size + loss, 0.0);
-    p->out_size = max((short)(MAX_COL * p->size / master->pt_sizelim), 0);
+    ps->size[n] = max(ps->size[n] + loss, 0.0);
+    ps->out_size[n] = max((short)(MAX_COL * ps->size[n] / master->pt_sizelim), 0);
     if (tn >= 0) {
       double r = master->macrop[class]->ptr[i];
-      double loss = r * p->size * dt / rate;
-      int c = p->c;
+      double loss = r * ps->size[n] * dt / rate;
+      int c = ps->c[n];
       int cs = geom->m2d[c];
       double vol = geom->cellarea[cs] * master->dz[c];
       master->tr_wc[tn][c] = (master->tr_wc[tn][c] * vol - loss) / vol; 
@@ -1471,18 +1771,25 @@ void pt_pl_ma2mi(master_t *master, /* Master data                    */
 /*-------------------------------------------------------------------*/
 /* This routine moves a single particle for a specified time         */
 /* The position of the particle is :                                 */
-/* p->c = mesh index of the particle                                 */
-/* p->e1 = x location of the particle                                */
-/* p->e2 = y location of the particle                                */
-/* p->e3 = depth of particle                                         */
+/* ps->c[n] = mesh index of the particle                             */
+/* ps->e1[n] = x location of the particle                            */
+/* ps->e2[n] = y location of the particle                            */
+/* ps->e3[n] = depth of particle                                     */
+/* Called concurrently for different particles; the interpolation    */
+/* routines are not reentrant so are serialised, and age diagnostics */
+/* are returned in dage[n] and dagec[n] rather than master.          */
 /*-------------------------------------------------------------------*/
 void pt_move(master_t *master,    /* Pointer to model grid structure */
              dump_data_t *dumpdata, /* Dump data structure           */
-             particle_t *p, /* Pointer to the particle to be moved   */
+             pt_store_t *ps, /* Particle store                       */
+             long n,        /* Particle to be moved                  */
              double dt,     /* The amount of time for which to move  */
              double maxdh,  /* Maximum possible horizontal diffusion */
 	     int sm,        /* Source map                            */
-	     int *c2cc      /* Index to counter map                  */
+	     int *c2cc,     /* Index to counter map                  */
+	     double *dage,  /* Age of particles leaving the region   */
+	     double *dagec, /* Count of particles leaving the region */
+	     pt_interp_t *pi /* Interpolation state of this thread   */
   )
 {
   geometry_t *geom = master->geom;
@@ -1494,7 +1801,6 @@ void pt_move(master_t *master,    /* Pointer to model grid structure */
   double upt, vpt, wpt;
   double cx, cy, cz;
   double SCALE = 0.95;          /* Use 95% of allowable sub-timestep */
-  int raninit = 0;
   int nloop = 0;
   int c, c2, co, wn, cl;
   pt_ts_t *u_i = master->uvel_i;
@@ -1504,11 +1810,11 @@ void pt_move(master_t *master,    /* Pointer to model grid structure */
   /*-----------------------------------------------------------------*/
   /* Find the horizontal (i,j) indices for the model cell that the   */
   /* particle is currently in, and check that it is sensible.        */
-  c = co = p->c;
+  c = co = ps->c[n];
   c2 = geom->m2d[c];
-  cx = p->e1;
-  cy = p->e2;
-  cz = p->e3;
+  cx = ps->e1[n];
+  cy = ps->e2[n];
+  cz = ps->e3[n];
 
   /*-----------------------------------------------------------------*/
   /* Convert the p.e1 sparse coordinate to Cartesian                 */
@@ -1518,31 +1824,31 @@ void pt_move(master_t *master,    /* Pointer to model grid structure */
     /* ghost cells.                                                  */
     hd_warn
       ("ptmove start: Particle not in water horizontally, %d %.12f %.12f\n",
-       c, p->e1, p->e2);
-    p->flag |= PT_LOST;
+       c, ps->e1[n], ps->e2[n]);
+    ps->flag[n] |= PT_LOST;
     return;
   }
 
   /* Surface may have moved since we last did a particle step, so    */
   /* truncate particles to surface.                                  */
-  if (p->e3 > master->eta[c2])
-    p->e3 = master->eta[c2];
+  if (ps->e3[n] > master->eta[c2])
+    ps->e3[n] = master->eta[c2];
 
-  if (p->e3 < geom->botz[c2]) {
+  if (ps->e3[n] < geom->botz[c2]) {
     /* Something wrong - print a message, flag this particle as lost */
     /* and give up.                                                  */
     if (DEBUG("particles"))
       dlog("particles", "Particle not in water vertically, c=%d k=%d x=%.12f y=%.12f z=%.12f\n",
-	   c, geom->s2k[c], p->e1, p->e2, p->e3);
-    p->flag |= PT_LOST;
+	   c, geom->s2k[c], ps->e1[n], ps->e2[n], ps->e3[n]);
+    ps->flag[n] |= PT_LOST;
     return;
   }
 
   /*-----------------------------------------------------------------*/
   /* Calculate random diffusion velocities for this step             */
-  diffu1 = maxdh * (2 * ran3(&raninit) - 1);
-  diffu2 = maxdh * (2 * ran3(&raninit) - 1);
-  diffw = master->maxdiffw[c2] * (2 * ran3(&raninit) - 1);
+  diffu1 = maxdh * (2 * pt_ran(master, n, PT_RAN_U1) - 1);
+  diffu2 = maxdh * (2 * pt_ran(master, n, PT_RAN_U2) - 1);
+  diffw = master->maxdiffw[c2] * (2 * pt_ran(master, n, PT_RAN_W) - 1);
 
   /*-----------------------------------------------------------------*/
   /* Set the settling/swimming velocity for each particle from an    */
@@ -1557,19 +1863,19 @@ void pt_move(master_t *master,    /* Pointer to model grid structure */
   wpt = (w_i) ? w_i->val[c] : 0.0;
 
   /* Particle settling velocity */
-  wpt += p->svel;
+  wpt += ps->svel[n];
 
   /* Stokes drift velocity                                           */
   if (master->do_wave & W_SWAN && master->waves & STOKES_DRIFT) {
     double k = master->wave_k[c2];
-    double depth = p->e3;
+    double depth = ps->e3[n];
     upt += master->wave_ste1[c2] * exp(2.0 * k * depth);
     vpt += master->wave_ste2[c2] * exp(2.0 * k * depth);
   }
 
   /*-----------------------------------------------------------------*/
   /* Windage                                                         */
-  if (p->flag & PT_WIND) {
+  if (ps->flag[n] & PT_WIND) {
     double wx, wy, sr = 0.0;
     double kw = 0.03;
     if (sm >= 0 && master->pt_stype[sm] & PT_PLASTIC) {
@@ -1601,9 +1907,9 @@ void pt_move(master_t *master,    /* Pointer to model grid structure */
 
     /*---------------------------------------------------------------*/
     /* Get the velocities at the particle location                   */
-    u = hd_trans_interp(window[wn], windat[wn]->gsx, cx, cy, cz, cl, 0, 0);
-    v = hd_trans_interp(window[wn], windat[wn]->gsy, cx, cy, cz, cl, 0, 1);
-    w = hd_trans_interp(window[wn], windat[wn]->gsz, cx, cy, cz, cl, 0, 2);
+    u = hd_trans_interp(window[wn], pi->gsx[wn], cx, cy, cz, cl, 0, 0);
+    v = hd_trans_interp(window[wn], pi->gsy[wn], cx, cy, cz, cl, 0, 1);
+    w = hd_trans_interp(window[wn], pi->gsz[wn], cx, cy, cz, cl, 0, 2);
 
     /*---------------------------------------------------------------*/
     /* Add diffusion velocities                                      */
@@ -1622,15 +1928,16 @@ void pt_move(master_t *master,    /* Pointer to model grid structure */
 
     /*---------------------------------------------------------------*/
     /* Get the new location and cell the particle resides in         */
-    c = get_pos_m(master, p, co, c, u, v, w, &cx, &cy, &cz, tmin);
+    c = get_pos_m(master, ps, n, co, c, u, v, w, &cx, &cy, &cz, tmin,
+		  dage, dagec, pi);
     c2 = geom->m2d[c];
 
     /*---------------------------------------------------------------*/
     /* Check if it landed in unknown territory                       */
     if (c <= 0 || c >= geom->szc) {
       hd_warn
-	("ptmove end: Particle not in water horizontally, c=%d x=%.12f y=%.12f z=%.12f\n",c, p->e1, p->e2, p->e3);
-      p->flag |= PT_LOST;
+	("ptmove end: Particle not in water horizontally, c=%d x=%.12f y=%.12f z=%.12f\n",c, ps->e1[n], ps->e2[n], ps->e3[n]);
+      ps->flag[n] |= PT_LOST;
       return;
     }
 
@@ -1647,34 +1954,34 @@ void pt_move(master_t *master,    /* Pointer to model grid structure */
     /*---------------------------------------------------------------*/
     /* If the particle lands in a ghost cell, flag it as lost        */
     if (geom->wgst[c]) {
-      p->flag |= PT_LOST;
+      ps->flag[n] |= PT_LOST;
       tmin = tleft;
       if (master->ptmsk == NULL) {
-	master->mage += p->age;
-	master->magec += 1.0;
+	dage[n] += ps->age[n];
+	dagec[n] += 1.0;
 	if(master->phist)
-	  master->phist[(int)min(master->shist,
-				 floor(p->age / 86400))]++;
+	  pt_hist(master, (int)min(master->shist,
+				   floor(ps->age[n] / 86400)));
       }
     }
 
     /*---------------------------------------------------------------*/
     /* Update the particle position                                  */
-    p->e1 = cx;
-    p->e2 = cy;
-    p->e3 = cz;
-    p->c = c;
+    ps->e1[n] = cx;
+    ps->e2[n] = cy;
+    ps->e3[n] = cz;
+    ps->c[n] = c;
 
     /*---------------------------------------------------------------*/
     /* Sanity checks                                                 */
     if (++nloop > 100) {
       if (DEBUG("particles")) {
-	dlog("particles", "nloop = %d, tmin = %g, %d %.12f %.12f %.12f\n",nloop, tmin, c, p->e1, p->e2, p->e3);
+	dlog("particles", "nloop = %d, tmin = %g, %d %.12f %.12f %.12f\n",nloop, tmin, c, ps->e1[n], ps->e2[n], ps->e3[n]);
       }
       if (nloop > 110) {
 	if (DEBUG("particles"))
 	  dlog("particles", "Abandoning this particle\n");
-        p->flag |= PT_LOST;
+        ps->flag[n] |= PT_LOST;
         tmin = tleft;
       }
     }
@@ -1682,19 +1989,19 @@ void pt_move(master_t *master,    /* Pointer to model grid structure */
     /*---------------------------------------------------------------*/
     /* Check whether it has left the age region                      */
     if (master->ptmsk) {
-      if (p->flag & PT_IN && !master->ptmsk[c]) {
-	master->mage += p->age;
-	master->magec += 1.0;
+      if (ps->flag[n] & PT_IN && !master->ptmsk[c]) {
+	dage[n] += ps->age[n];
+	dagec[n] += 1.0;
 	if(master->phist)
-	  master->phist[(int)min(master->shist,
-				 floor(p->age) / 86400)]++;
-	p->flag &= ~ PT_IN;
-	p->flag |= PT_OUT;
+	  pt_hist(master, (int)min(master->shist,
+				   floor(ps->age[n]) / 86400));
+	ps->flag[n] &= ~ PT_IN;
+	ps->flag[n] |= PT_OUT;
       }
-      if (p->flag & PT_OUT && master->ptmsk[c]) {
-	p->flag &= ~ PT_OUT;
-	p->flag |= PT_IN;
-	p->age = 0;
+      if (ps->flag[n] & PT_OUT && master->ptmsk[c]) {
+	ps->flag[n] &= ~ PT_OUT;
+	ps->flag[n] |= PT_IN;
+	ps->age[n] = 0;
       }
     }
     /* Decrease time left for this step                              */
@@ -1717,7 +2024,8 @@ void pt_move(master_t *master,    /* Pointer to model grid structure */
 /* The new geographic location is returned in cx, cy and cz.         */
 /*-------------------------------------------------------------------*/
 int get_pos_m(master_t *master,   /* Window geometry                 */
-	      particle_t *p,      /* Particle                        */
+	      pt_store_t *ps,     /* Particle store                  */
+	      long n,             /* Particle number                 */
 	      int c,              /* Location of destination         */
 	      int ci,             /* Current source cell             */
 	      double u,           /* East velocity                   */
@@ -1726,7 +2034,10 @@ int get_pos_m(master_t *master,   /* Window geometry                 */
 	      double *cx,         /* x location of streamline        */
 	      double *cy,         /* y location of streamline        */
 	      double *cz,         /* z location of streamline        */
-	      double dt           /* Time step                       */
+	      double dt,          /* Time step                       */
+	      double *dage,       /* Age of particles lost           */
+	      double *dagec,      /* Count of particles lost         */
+	      pt_interp_t *pi     /* Interpolation state             */
 	      )
 {
   geometry_t *geom = master->geom;
@@ -1774,8 +2085,9 @@ int get_pos_m(master_t *master,   /* Window geometry                 */
   /* the same depth as that of the input location, c.                */
   if (geom->us_type & US_IJ) {
     /* Structured grids: use the xytoi tree                          */
-    int i = -1, j = -1;
-    if (grid_xytoij(master->xyij_tree, slon, slat, &i, &j))
+    int i = -1, j = -1, ok;
+    ok = grid_xytoij(pi->xyij_tree, slon, slat, &i, &j);
+    if (ok)
       cn = geom->map[geom->nz - 1][j][i];
     else {
       cn = geom->m2d[ci];
@@ -1822,8 +2134,9 @@ int get_pos_m(master_t *master,   /* Window geometry                 */
       slat = yin - dist * sinth;
 
       if (geom->us_type & US_IJ) {
-	int i = -1, j = -1;
-	if (grid_xytoij(master->xyij_tree, slon, slat, &i, &j))
+	int i = -1, j = -1, ok;
+	ok = grid_xytoij(pi->xyij_tree, slon, slat, &i, &j);
+	if (ok)
 	  cn = geom->map[geom->nz - 1][j][i];
 	else
 	  cn = geom->m2d[ci];
@@ -1833,17 +2146,17 @@ int get_pos_m(master_t *master,   /* Window geometry                 */
 	cns = geom->m2d[cns];
       }
     } else {
-      p->flag |= PT_LOST;
+      ps->flag[n] |= PT_LOST;
       if (master->ptmsk == NULL) {
-	master->mage += p->age;
-	master->magec += 1.0;
+	dage[n] += ps->age[n];
+	dagec[n] += 1.0;
 	if(master->phist)
-	  master->phist[(int)min(master->shist,
-				 floor(p->age / 86400))]++;
+	  pt_hist(master, (int)min(master->shist,
+				   floor(ps->age[n] / 86400)));
       }
     }
   }
-  if (isghost && !found) p->flag |= PT_LOST;
+  if (isghost && !found) ps->flag[n] |= PT_LOST;
   *cx = slon;
   *cy = slat;
   *cz += w * dt;
@@ -1585,6 +1585,7 @@ void render_hydro_parameters(master_t *master, FILE *fp, char *name)
   fprintf(fp, "  .saltflux = 0x%x,\n", params->saltflux);
   fprintf(fp, "  .water_type = 0x%x,\n", params->water_type);
   fprintf(fp, "  .tsfile_caching = %d,\n", params->tsfile_caching);
+  fprintf(fp, "  .tsfile_remap = %d,\n", params->tsfile_remap);
   fprintf(fp, "  .etamax = %f,\n", params->etamax);
   fprintf(fp, "  .velmax = %f,\n", params->velmax);
   fprintf(fp, "  .velmax2d = %f,\n", params->velmax2d);
@@ -2053,6 +2054,7 @@ void copy_hydroparameter_info(parameters_t *params, parameters_t *in) {
   params->saltflux = in->saltflux;
   params->water_type = in->water_type;
   params->tsfile_caching = in->tsfile_caching;
+  params->tsfile_remap = in->tsfile_remap;
   params->etamax = in->etamax;
   params->velmax = in->velmax;
   params->velmax2d = in->velmax2d;
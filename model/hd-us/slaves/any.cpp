@@ -1,60 +1,124 @@
 /*
  *
  *  ENVIRONMENTAL MODELLING SUITE (EMS)
- *  
+ *
  *  File: model/hd-us/slaves/any.cpp
- *  
+ *
  *  Description:
- *  Optimised ANY function - use STL map as the look up table
+ *  Optimised ANY function - use a hash table as the look up table
  *
- *  This data structure is effectively a sorted array that does a
- *  binary search
+ *  The table uses open addressing with linear probing in flat key
+ *  and value arrays, sized to at most half full, so a lookup is
+ *  usually a single probe.
  *
  *  To use:
  *    o) Initialise the array
  *    o) Use the find function within the loop, and
  *    o) Destroy the map
- *  
+ *
+ *  ANY_invert() is the bulk alternative when the values are bounded
+ *  by a known size (e.g. sparse cell or edge indices); it returns a
+ *  dense inverse vector that is indexed directly.
+ *
  *  Copyright:
  *  Copyright (c) 2018. Commonwealth Scientific and Industrial
  *  Research Organisation (CSIRO). ABN 41 687 119 230. All rights
  *  reserved. See the license file for disclaimer and full
  *  use/redistribution conditions.
- *  
+ *
  *  $Id:$
  *
  */
 #include <stdio.h>
-#include <map>
+#include <stdlib.h>
+#include <limits.h>
+
+extern "C" {
+  void hd_quit(const char *s, ...);
+  int *i_alloc_1d(int n1);
+}
+
+/* Marks an empty slot; sparse indices are never negative */
+#define ANY_EMPTY INT_MIN
+
+typedef struct {
+  unsigned int mask;     /* Table size - 1                          */
+  int shift;             /* 32 - log2(table size)                   */
+  int *key;              /* Array values                            */
+  int *val;              /* Array indices                           */
+} any_map_t;
 
 /*
- * Uses the values of the array to create the map
- *  - inserts into a sorted binary tree
+ * Fibonacci hashing; consecutive sparse indices spread evenly
+ */
+static inline unsigned int any_hash(any_map_t *m, int var)
+{
+  return(((unsigned int)var * 2654435769u) >> m->shift);
+}
+
+/*
+ * Uses the values of array[n0..n1] to create the map. The first
+ * occurrence of a value wins, as for ANY().
  */
 extern "C"
-void *ANY_map_init(int array[], int ns)
+void *ANY_map_build(int array[], int n0, int n1)
 {
-  std::map<int, int> *mparr = new std::map<int, int>;
-  /* First create the map -no prealloc */
-  for (int i=0; i<ns; i++) {
-    mparr->insert( std::pair<int,int>(array[i], i) );
+  any_map_t *m = (any_map_t *)malloc(sizeof(any_map_t));
+  unsigned int size = 2;
+  int ns = n1 - n0 + 1;
+  int i, bits = 1;
+
+  if (m == NULL)
+    hd_quit("ANY_map_build: Can't allocate memory\n");
+
+  /* Power of two at least twice the number of entries */
+  while (size < 2 * (unsigned int)(ns > 0 ? ns : 1)) {
+    size <<= 1;
+    bits++;
   }
-  return(mparr);
+  m->mask = size - 1;
+  m->shift = 32 - bits;
+  m->key = (int *)malloc(size * sizeof(int));
+  m->val = (int *)malloc(size * sizeof(int));
+  if (m->key == NULL || m->val == NULL)
+    hd_quit("ANY_map_build: Can't allocate memory\n");
+  for (i = 0; i < (int)size; i++)
+    m->key[i] = ANY_EMPTY;
+
+  for (i = n0; i <= n1; i++) {
+    unsigned int h = any_hash(m, array[i]);
+    while (m->key[h] != ANY_EMPTY && m->key[h] != array[i])
+      h = (h + 1) & m->mask;
+    if (m->key[h] == ANY_EMPTY) {
+      m->key[h] = array[i];
+      m->val[h] = i;
+    }
+  }
+  return(m);
 }
 
 /*
- * Need to use te find() method as the square brackets method [] will
- * create the key if it doesn't exist, whereas find does not
+ * Map of array[0..ns-1]
+ */
+extern "C"
+void *ANY_map_init(int array[], int ns)
+{
+  return(ANY_map_build(array, 0, ns - 1));
+}
+
+/*
+ * Returns the index of var in the array, or 0 if not present
  */
 extern "C"
 int ANY_map_find(void *arr, int var)
 {
-  std::map <int, int> *mparr = static_cast< std::map <int, int> *> (arr);
-  std::map <int, int>::iterator it;
-  it = mparr->find(var);
-  if (it != mparr->end()) {
-    // value
-    return((*it).second);
+  any_map_t *m = (any_map_t *)arr;
+  unsigned int h = any_hash(m, var);
+
+  while (m->key[h] != ANY_EMPTY) {
+    if (m->key[h] == var)
+      return(m->val[h]);
+    h = (h + 1) & m->mask;
   }
   return(0);
 }
@@ -65,7 +129,30 @@ int ANY_map_find(void *arr, int var)
 extern "C"
 void ANY_map_destroy(void *arr)
 {
-  std::map <int, int> *mparr = static_cast< std::map <int, int> *> (arr);
-  mparr->clear();
-  delete mparr;
+  any_map_t *m = (any_map_t *)arr;
+  free(m->key);
+  free(m->val);
+  free(m);
+}
+
+/*
+ * Returns the inverse of array[1..ns], i.e. a vector of length size
+ * where inv[array[nn]] = nn and all other entries are zero. This
+ * gives the same result as ANY(var, array, ns) for every var in one
+ * pass. Values outside 0..size-1 are ignored. Free with i_free_1d().
+ */
+extern "C"
+int *ANY_invert(int array[], int ns, int size)
+{
+  int *inv = i_alloc_1d(size);
+  int nn;
+
+  for (nn = 0; nn < size; nn++)
+    inv[nn] = 0;
+  for (nn = ns; nn >= 1; nn--) {
+    int var = array[nn];
+    if (var >= 0 && var < size)
+      inv[var] = nn;
+  }
+  return(inv);
 }
@@ -33,8 +33,13 @@ int is_ghost(geometry_t *geom, int c);
 /* win_data_refill2d() : Re-fills updated 2D window data with master */
 /* win_data_empty_3d()  : Empties local 3D arrays from the master    */
 /* win_data_empty_2d()  : Empties local 2D arrays from the master    */
+/* win_data_empty_vars() : Lists the arrays emptied to the master    */
 /* build_transfer_maps() : Sets up the transfer vectors              */
+/* build_peer_maps() : Sets up window-to-window 2D transfer vectors  */
+/* win_data_peer_2d()  : Fills local 2D arrays from other windows    */
+/* win_data_peer_empty_2d() : Refreshes the master after peer fills  */
 /* master_fill() : Fills the master with local data                  */
+/* s2m_vars()    : Lists the arrays s2m_2d() and s2m_3d() transfer   */
 /* s2m_3d()      : Transfers a 3D local array to the master          */
 /* s2m_2d()      : Transfers a 2D local array to the master          */
 /* s2m_vel()     : Transfers a local velocity array to the master    */
@@ -64,6 +69,7 @@ void win_data_fill_3d(master_t *master,   /* Master data             */
   int tn, tt;                   /* Tracer counter                    */
   int s, ce1;     
 
+  PROF_BEGIN("win_data_fill_3d", window->wn);
   /*-----------------------------------------------------------------*/
   /* Variables to transfer for one or multiple windows               */
   windat->t = master->t;
@@ -98,6 +104,7 @@ void win_data_fill_3d(master_t *master,   /* Master data             */
         windat->tflux[tt][s] = master->tflux[tt][s];
       }
     }
+    PROF_MARK
     return;
   }
 
@@ -432,6 +439,7 @@ void win_data_fill_3d(master_t *master,   /* Master data             */
   /* Copy the tracer increment flags to the window                   */
   memcpy(windat->trinc, master->trinc, master->ntr * sizeof(int));
   memcpy(windat->trincS, master->trincS, master->ntrS * sizeof(int));
+  PROF_END;
 
 }
 
@@ -454,6 +462,7 @@ void win_data_fill_2d(master_t *master,     /* Master data           */
 {
   int c, cc, lc, ce1;           /* Local sparse coordinate / counter */
 
+  PROF_BEGIN("win_data_fill_2d", window->wn);
   windat->dtb2 = windat->dtf2;
   windat->dtf2 = master->dt2d;
   windat->dt2d = windat->dtf2 + windat->dtb2;
@@ -464,6 +473,7 @@ void win_data_fill_2d(master_t *master,     /* Master data           */
   if (nwindows == 1) {
     bdry_transfer_eta(master, window, windat);
     bdry_transfer_u1av(master, window, windat);
+    PROF_MARK
     return;
   }
 
@@ -474,30 +484,34 @@ void win_data_fill_2d(master_t *master,     /* Master data           */
   /*-----------------------------------------------------------------*/
   /* Auxiliary cells only. This includes variables that require      */
   /* auxiliary cells only to be transfered to the slave since the    */
-  /* wet cells already exist on the slave.                           */
-  for (cc = 1; cc <= window->nm2sS; cc++) {
-    lc = window->m2s[cc];
-    c = window->wsa[lc];
-    windat->eta[lc] = master->eta[c];
-    /*
-    windat->uav[lc] = master->uav[c];
-    windat->vav[lc] = master->vav[c];
-    */
-    windat->detadt[lc] = master->detadt[c];
-    windat->etab[lc] = master->etab[c];
-    /* Uncomment to check master to slave transfer indicies          */
-    /*
-    printf("m2se1 %d window%d (%d %d)m->(%d %d)s\n",cc,window->wn,geom->s2i[ce1],
-	   geom->s2j[ce1],window->s2i[lc],window->s2j[lc]);
-    */
+  /* wet cells already exist on the slave. With window-to-window     */
+  /* transfers these are copied from the owning windows in           */
+  /* win_data_peer_2d() instead.                                     */
+  if (!master->win_p2p) {
+    for (cc = 1; cc <= window->nm2sS; cc++) {
+      lc = window->m2s[cc];
+      c = window->wsa[lc];
+      windat->eta[lc] = master->eta[c];
+      /*
+      windat->uav[lc] = master->uav[c];
+      windat->vav[lc] = master->vav[c];
+      */
+      windat->detadt[lc] = master->detadt[c];
+      windat->etab[lc] = master->etab[c];
+      /* Uncomment to check master to slave transfer indicies        */
+      /*
+      printf("m2se1 %d window%d (%d %d)m->(%d %d)s\n",cc,window->wn,geom->s2i[ce1],
+	     geom->s2j[ce1],window->s2i[lc],window->s2j[lc]);
+      */
 
-  }
-  for (cc = 1; cc <= window->nm2se1S; cc++) {
-    lc = window->m2se1[cc];
-    ce1 = window->wse[lc];
-    windat->u1av[lc] = master->u1av[ce1];
-    windat->u2av[lc] = master->u2av[ce1];
-    windat->depth_e1[lc] = master->depth_e1[ce1];
+    }
+    for (cc = 1; cc <= window->nm2se1S; cc++) {
+      lc = window->m2se1[cc];
+      ce1 = window->wse[lc];
+      windat->u1av[lc] = master->u1av[ce1];
+      windat->u2av[lc] = master->u2av[ce1];
+      windat->depth_e1[lc] = master->depth_e1[ce1];
+    }
   }
   /* These fluxes do not need to be transferred unless diagnostic    */
   /* checks are required for continuity across windows.              */
@@ -519,6 +533,7 @@ void win_data_fill_2d(master_t *master,     /* Master data           */
   /* Transfer any custom data from the master to the slaves          */
   bdry_transfer_eta(master, window, windat);
   bdry_transfer_u1av(master, window, windat);
+  PROF_END;
 
 }
 
@@ -541,12 +556,14 @@ void win_data_refill_3d(master_t *master,   /* Master data           */
   int c, cc, lc, ce1;           /* Local sparse coordinate / counter */
   int e, ee, le;
 
+  PROF_BEGIN("win_data_refill_3d", window->wn);
   /* Set the crash recovery flags if required                        */
   if (master->crf & RS_WINSET) master->crf &= ~RS_WINSET;
   if (master->crf & RS_RESET) master->crf = NONE;
 
   if (nwindows == 1 && mode & MIXING) {
     bdry_transfer_u1(master, window, windat);
+    PROF_MARK
     return;
   }
 
@@ -696,6 +713,7 @@ void win_data_refill_3d(master_t *master,   /* Master data           */
       windat->wbot[lc] = master->wbot[c];
     }
   }
+  PROF_END;
 }
 
 /* END win_data_refill_3d()                                          */
@@ -717,6 +735,7 @@ void win_data_refill_2d(master_t *master,   /* Master data           */
   int cc, lc, ce1;              /* Local sparse coordinate / counter */
   int e, ee, le;
 
+  PROF_BEGIN("win_data_refill_2d", window->wn);
   /* mode = NVELOCITY : updated velocities. This is required to      */
   /* maintain continuity by using the correct nuav when setting uav  */
   /* in asselin() at auxiliary cells; uav is subsequently used to    */
@@ -759,6 +778,7 @@ void win_data_refill_2d(master_t *master,   /* Master data           */
       windat->eta[lc] = master->eta[ce1];
     }
   }
+  PROF_END;
 }
 
 /* END win_data_refill_2d()                                          */
@@ -778,11 +798,12 @@ void win_data_empty_3d(master_t *master,   /* Master data            */
                        int mode            /* Data flag              */
   )
 {
-  int c, cc, lc;                /* Local sparse coordinate / counter */
-  int e, ee, le;                /* Edge counter                      */
+  int c, lc;                    /* Local sparse coordinate / counter */
+  int cc;                       /* Counter                           */
   int tn, tt;                   /* Tracer counter                    */
   geometry_t *geom = master->geom;
 
+  PROF_BEGIN("win_data_empty_3d", window->wn);
   /* Set the CFL diagnostics                                         */
   if (mode & CFL) {
     if (!(master->cfl & NONE)) {
@@ -808,413 +829,360 @@ void win_data_empty_3d(master_t *master,   /* Master data            */
 	  master->vf[nb] += windat->vf[wn];
       }
     }
-    if (master->errornorm & N_ERRN)
-      error_norms_m(master, window, windat, window->wincon);
-    if (geom->nregions)
-      region_transfer(master, window);
+    if (dp_is_local(window->wn)) {
+      if (master->errornorm & N_ERRN)
+	error_norms_m(master, window, windat, window->wincon);
+      if (geom->nregions)
+	region_transfer(master, window);
+    }
   }
   /* Set tracer flags                                                */
   for (tt = 0; tt < master->ntr; tt++)
     master->trinfo_3d[tt].flag = window->wincon->trinfo_3d[tt].flag;
 
-  if(window->nwindows == 1)
+  if(window->nwindows == 1) {
+    PROF_MARK
     return;
+  }
+
+  /* mode = TRACERS : counters calculated in the tracer routine      */
+  if (mode & TRACERS) {
+    master->wclk[window->wn] += windat->wclk;
+    memcpy(master->trinc, windat->trinc, master->ntr * sizeof(int));
+    if (master->means & RESET) master->means &= ~RESET;
+  }
 
   /*-----------------------------------------------------------------*/
-  /* Variables that require wet cells which are used by other        */
-  /* windows to be transfered to the master.                         */
-  /* mode = MIXING : vertical mixing coefficients and cell           */
-  /* thicknesses at the e1 and e2 faces.                             */
-  if (mode & MIXING) {
-    geometry_t *geom = master->geom;
-    /* Transfer to the master                                        */
-    s2m_vel(master->dzu1, windat->dzu1,
-            window->s2me1, window->wse, window->ns2me1);
+  /* Transfer the arrays listed in win_data_empty_vars() to the      */
+  /* master.                                                         */
+  win_data_empty_vars(master, window, windat, 3, mode, win_empty_var, NULL);
 
-    for (cc = 1; cc <= window->ns2m; cc++) {
-      lc = window->s2m[cc];
-      c = window->wsa[lc];
-      master->Kz[c] = windat->Kz[lc];
-      master->Vz[c] = windat->Vz[lc];
-    }
-    for (ee = 1; ee <= window->ns2me1S; ee++) {
-      le = window->s2me1[ee];
-      e = window->wse[le];
-      geom->sur_e1[e] = windat->sur_e1[le];
-    }
-    if (windat->tke && windat->diss) {
-      for (cc = 1; cc <= window->ns2m; cc++) {
-	lc = window->s2m[cc];
-	c = window->wsa[lc];
-	master->tke[c] = windat->tke[lc];
-	master->diss[c] = windat->diss[lc];
-      }
-    }
-    if (windat->tke && windat->omega) {
-      for (cc = 1; cc <= window->ns2m; cc++) {
-	lc = window->s2m[cc];
-	c = window->wsa[lc];
-	master->tke[c] = windat->tke[lc];
-	master->omega[c] = windat->omega[lc];
+  /*-----------------------------------------------------------------*/
+  /* Particle tracking: get the surface sparse coordinates           */
+  if (mode & TRACERS && master->ptn && !master->sigma) {
+    int zm1;
+    for (cc = 1; cc <= geom->b2_t; cc++) {
+      c = lc = geom->w2_t[cc];
+      zm1 = geom->zm1[c];
+      while (c != zm1 && geom->gridz[c] > master->eta[lc]) {
+	c = zm1;
+	zm1 = geom->zm1[c];
       }
+      geom->sur_t[cc] = c;
     }
+  }
+  PROF_END;
+}
+
+/* END win_data_empty_3d()                                           */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/*-------------------------------------------------------------------*/
+/* Routine to empty the window data structure back into the master   */
+/* (cells which are used as auxiliary cells in other windows only)   */
+/* for the 2D mode. If only one window exists the master points to   */
+/* the windat data structure - no need to empty.                     */
+/*-------------------------------------------------------------------*/
+void win_data_empty_2d(master_t *master,    /* Master data           */
+                       geometry_t *window,  /* Window geometry       */
+                       window_t *windat,    /* Window data           */
+                       int mode             /* Data flag             */
+  )
+{
+  PROF_BEGIN("win_data_empty_2d", window->wn);
+  if (mode & VELOCITY)
+    memcpy(master->trincS, windat->trincS, master->ntrS * sizeof(int));
+
+  /*-----------------------------------------------------------------*/
+  /* Transfer the arrays listed in win_data_empty_vars() to the      */
+  /* master.                                                         */
+  win_data_empty_vars(master, window, windat, 2, mode, win_empty_var, NULL);
+  PROF_END;
+}
+
+/* END win_data_empty_2d()                                           */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Lists the window arrays that win_data_empty_2d() (dim = 2) and    */
+/* win_data_empty_3d() (dim = 3) transfer to the master for a mode.  */
+/* Each array is passed to fn with the map (EV_*) over which it is   */
+/* transferred; double arrays in Ag/Al, integer arrays in iAg/iAl.   */
+/* This list is also the MPI exchange list (see dp_mpi_vars()), so   */
+/* any array added to the window empty is exchanged with it.         */
+/*-------------------------------------------------------------------*/
+void win_data_empty_vars(master_t *master,    /* Master data         */
+			 geometry_t *window,  /* Window geometry     */
+			 window_t *windat,    /* Window data         */
+			 int dim,             /* 2D or 3D mode       */
+			 int mode,            /* Data flag           */
+			 void (*fn)(geometry_t *window, int map, double *Ag,
+				    double *Al, int *iAg, int *iAl,
+				    void *data),
+			 void *data           /* Passed to fn        */
+  )
+{
+  win_priv_t *wincon = window->wincon;
+  geometry_t *geom = master->geom;
+  int tn, tt;
+
+  /*-----------------------------------------------------------------*/
+  /* 2D mode                                                         */
+  if (dim == 2) {
+    /* mode = VELOCITY : updated velocity and elevation data.        */
+    if (mode & VELOCITY) {
+      fn(window, EV_S2ME1S, master->u1av, windat->u1av, NULL, NULL, data);
+      fn(window, EV_S2ME1S, master->u2av, windat->u2av, NULL, NULL, data);
+      fn(window, EV_S2MS, master->eta, windat->eta, NULL, NULL, data);
+      fn(window, EV_S2MS, master->detadt, windat->detadt, NULL, NULL, data);
+      fn(window, EV_S2MS, master->etab, windat->etab, NULL, NULL, data);
+    }
+    /* mode = DEPTH : total depth at the cell faces                  */
+    if (mode & DEPTH)
+      fn(window, EV_S2ME1S, master->depth_e1, windat->depth_e1, NULL, NULL,
+	 data);
+    /* mode = NVELOCITY : updated velocity. Used in asselin(). For   */
+    /* VERTIN OBCs the depth is reset so copy tangential OBC depths, */
+    /* so that tangential OBC auxiliaries are set in other windows.  */
+    if (mode & NVELOCITY) {
+      fn(window, EV_S2ME1S, master->nu1av, windat->nu1av, NULL, NULL, data);
+      fn(window, EV_VERTIN, master->depth_e1, windat->depth_e1, NULL, NULL,
+	 data);
+    }
+    if (mode & ETA_A)
+      fn(window, EV_S2MS, master->eta, windat->eta, NULL, NULL, data);
+    return;
+  }
+
+  /*-----------------------------------------------------------------*/
+  /* 3D mode                                                         */
+  /* mode = MIXING : vertical mixing coefficients and cell           */
+  /* thicknesses at the e1 and e2 faces.                             */
+  if (mode & MIXING) {
+    fn(window, EV_S2ME1, master->dzu1, windat->dzu1, NULL, NULL, data);
+    fn(window, EV_S2M, master->Kz, windat->Kz, NULL, NULL, data);
+    fn(window, EV_S2M, master->Vz, windat->Vz, NULL, NULL, data);
+    fn(window, EV_S2ME1S, NULL, NULL, geom->sur_e1, windat->sur_e1, data);
+    if (windat->tke && (windat->diss || windat->omega))
+      fn(window, EV_S2M, master->tke, windat->tke, NULL, NULL, data);
+    if (windat->tke && windat->diss)
+      fn(window, EV_S2M, master->diss, windat->diss, NULL, NULL, data);
+    if (windat->tke && windat->omega)
+      fn(window, EV_S2M, master->omega, windat->omega, NULL, NULL, data);
     if (windat->Q2 && windat->Q2L) {
-      for (cc = 1; cc <= window->ns2m; cc++) {
-	lc = window->s2m[cc];
-	c = window->wsa[lc];
-	master->Q2[c] = windat->Q2[lc];
-	master->Q2L[c] = windat->Q2L[lc];
-      }
-    }
-    if (windat->sdc) {
-      for (cc = 1; cc <= window->ns2m; cc++) {
-	lc = window->s2m[cc];
-	c = window->wsa[lc];
-	master->sdc[c] = windat->sdc[lc];
-      }
-    }
-    if (master->waves & NEARSHORE) {
-      for (cc = 1; cc <= window->ns2mS; cc++) {
-	lc = window->s2m[cc];
-	c = window->wsa[lc];
-	master->wave_P[c] = windat->wave_P[lc];
-      }
+      fn(window, EV_S2M, master->Q2, windat->Q2, NULL, NULL, data);
+      fn(window, EV_S2M, master->Q2L, windat->Q2L, NULL, NULL, data);
     }
+    if (windat->sdc)
+      fn(window, EV_S2M, master->sdc, windat->sdc, NULL, NULL, data);
+    if (master->waves & NEARSHORE)
+      fn(window, EV_S2MS, master->wave_P, windat->wave_P, NULL, NULL, data);
   }
 
   /* mode = VELOCITY : depth averaged adjusted velocities for the    */
   /* vertical velocity equation and 3D fluxes for the tracer         */
   /* equation.                                                       */
   if (mode & VELOCITY) {
-    s2m_vel(master->u1, windat->u1,
-            window->s2me1, window->wse, window->ns2me1);
-    /*
-    s2m_vel(master->u2, windat->u2,
-            window->s2me1, window->wse, window->ns2me1);
-    */
-    s2m_vel(master->u1flux3d, windat->u1flux3d,
-            window->s2me1, window->wse, window->ns2me1);
-    s2m_vel(master->u1b, windat->u1b,
-            window->s2me1, window->wse, window->ns2me1);
-    s2m_vel(master->u2b, windat->u2b,
-            window->s2me1, window->wse, window->ns2me1);
+    fn(window, EV_S2ME1, master->u1, windat->u1, NULL, NULL, data);
+    fn(window, EV_S2ME1, master->u1flux3d, windat->u1flux3d, NULL, NULL,
+       data);
+    fn(window, EV_S2ME1, master->u1b, windat->u1b, NULL, NULL, data);
+    fn(window, EV_S2ME1, master->u2b, windat->u2b, NULL, NULL, data);
     if (master->means & TRANSPORT) {
-      s2m_vel(master->u1vm, windat->u1vm,
-	      window->s2me1, window->wse, window->ns2me1);
-      s2m_vel(master->ume, windat->ume,
-	      window->s2me1, window->wse, window->ns2me1);
+      fn(window, EV_S2ME1, master->u1vm, windat->u1vm, NULL, NULL, data);
+      fn(window, EV_S2ME1, master->ume, windat->ume, NULL, NULL, data);
     }
     /* Set in set_new_cells_ and used in tracer horz diffusion       */
-    s2m_vel(master->dzu1, windat->dzu1,
-	    window->s2me1, window->wse, window->ns2me1);
-
+    fn(window, EV_S2ME1, master->dzu1, windat->dzu1, NULL, NULL, data);
     /* Cell centered velocity                                        */
-    for (cc = 1; cc <= window->ns2m; cc++) {
-      lc = window->s2m[cc];
-      c = window->wsa[lc];
-      master->u[c] = windat->u[lc];
-      master->v[c] = windat->v[lc];
-    }
-
+    fn(window, EV_S2M, master->u, windat->u, NULL, NULL, data);
+    fn(window, EV_S2M, master->v, windat->v, NULL, NULL, data);
   }
+
   /* mode = WVEL : 3D vertical velocity and 2D surface and bottom    */
   /* vertical velocities. Also include the 3D velocity deviations    */
   /* from the depth averaged velocity which was calculated in        */
   /* velocity_adjust() here.                                         */
   if (mode & WVEL) {
-    /* Transfer to the master                                        */
-    for (cc = 1; cc <= window->ns2m; cc++) {
-      lc = window->s2m[cc];
-      c = window->wsa[lc];
-      master->w[c] = windat->w[lc];
-    }
-    s2m_vel(master->u2, windat->u2,
-            window->s2me1, window->wse, window->ns2me1);
-    s2m_vel(master->u1bot, windat->u1bot,
-            window->s2me1, window->wse, window->ns2me1S);
-    for (cc = 1; cc <= window->ns2mS; cc++) {
-      lc = window->s2m[cc];
-      c = window->wsa[lc];
-      master->wtop[c] = windat->wtop[lc];
-      master->wbot[c] = windat->wbot[lc];
-    }
-    if (master->trasc & FFSL) {
-      win_priv_t *wincon = window->wincon;
-      for (cc = 1; cc <= window->ns2m; cc++) {
-	lc = window->s2m[cc];
-	c = window->wsa[lc];
-	master->dz[c] = wincon->dz[lc];
-      }
-    }
-
-    /*
-    if (master->means & TRANSPORT) {
-      for (cc = 1; cc <= window->ns2m; cc++) {
-	lc = window->s2m[cc];
-	c = window->wsa[lc];
-	master->u1m[c] = windat->u1m[lc];
-	master->u2m[c] = windat->u2m[lc];
-	master->wm[c] = windat->wm[lc];
-      }
-    }
-    */
+    fn(window, EV_S2M, master->w, windat->w, NULL, NULL, data);
+    fn(window, EV_S2ME1, master->u2, windat->u2, NULL, NULL, data);
+    fn(window, EV_S2ME1S, master->u1bot, windat->u1bot, NULL, NULL, data);
+    fn(window, EV_S2MS, master->wtop, windat->wtop, NULL, NULL, data);
+    fn(window, EV_S2MS, master->wbot, windat->wbot, NULL, NULL, data);
+    if (master->trasc & FFSL)
+      fn(window, EV_S2M, master->dz, wincon->dz, NULL, NULL, data);
   }
+
   /* mode = TRACERS : variables calculated in the tracer routine     */
   if (mode & TRACERS) {
-    master->wclk[window->wn] += windat->wclk;
-    memcpy(master->trinc, windat->trinc, master->ntr * sizeof(int));
-    if (master->means & RESET) master->means &= ~RESET;
-    /* Transfer to the master                                        */
-    for (cc = 1; cc <= window->ns2m; cc++) {
-      lc = window->s2m[cc];
-      c = window->wsa[lc];
-      master->dens[c] = windat->dens[lc];
-      for (tt = 0; tt < master->ntrmap_s2m_3d; tt++) {
-	tn = master->trmap_s2m_3d[tt];
-	master->tr_wc[tn][c] = windat->tr_wc[tn][lc];
-      }
+    fn(window, EV_S2M, master->dens, windat->dens, NULL, NULL, data);
+    for (tt = 0; tt < master->ntrmap_s2m_3d; tt++) {
+      tn = master->trmap_s2m_3d[tt];
+      fn(window, EV_S2M, master->tr_wc[tn], windat->tr_wc[tn], NULL, NULL,
+	 data);
     }
-    /*---------------------------------------------------------------*/
     /* All wet cells (cell centered). Include relaxation and reset   */
-    /* tracers since tracers may be altered by updates. Include      */
-    /* OBC cells.                                                    */
-    for (cc = 1; cc <= window->b3_t; cc++) {
-      lc = window->w3_t[cc];
-      c = window->wsa[lc];
-      for (tt = 0; tt < master->nrlx; tt++) {
-        tn = master->relax[tt];
-        master->tr_wc[tn][c] = windat->tr_wc[tn][lc];
-      }
-      for (tt = 0; tt < master->nres; tt++) {
-        tn = master->reset[tt];
-        master->tr_wc[tn][c] = windat->tr_wc[tn][lc];
-      }
-      /* Cell centered velocity for Lagrange    tracking             */
-      master->u[c] = windat->u[lc];
-      master->v[c] = windat->v[lc];
-      master->w[c] = windat->w[lc];
+    /* tracers since tracers may be altered by updates. Include OBC  */
+    /* cells.                                                        */
+    for (tt = 0; tt < master->nrlx; tt++) {
+      tn = master->relax[tt];
+      fn(window, EV_W3, master->tr_wc[tn], windat->tr_wc[tn], NULL, NULL,
+	 data);
+    }
+    for (tt = 0; tt < master->nres; tt++) {
+      tn = master->reset[tt];
+      fn(window, EV_W3, master->tr_wc[tn], windat->tr_wc[tn], NULL, NULL,
+	 data);
     }
+    /* Cell centered velocity for Lagrange tracking                  */
+    fn(window, EV_W3, master->u, windat->u, NULL, NULL, data);
+    fn(window, EV_W3, master->v, windat->v, NULL, NULL, data);
+    fn(window, EV_W3, master->w, windat->w, NULL, NULL, data);
     if (master->heatflux & ADVANCED) {
-      for (cc = 1; cc <= window->b2_t; cc++) {
-	lc = window->w2_t[cc];
-	c = window->wsa[lc];
-	master->tr_wc[master->tno][c] = windat->tr_wc[windat->tno][lc];
-	master->tr_wc[master->sno][c] = windat->tr_wc[windat->sno][lc];
-	master->dens[c] = windat->dens[lc];
-      }
+      fn(window, EV_W2, master->tr_wc[master->tno],
+	 windat->tr_wc[windat->tno], NULL, NULL, data);
+      fn(window, EV_W2, master->tr_wc[master->sno],
+	 windat->tr_wc[windat->sno], NULL, NULL, data);
+      fn(window, EV_W2, master->dens, windat->dens, NULL, NULL, data);
     }
     if (master->waves & TAN_RAD) {
-      for (cc = 1; cc <= window->b2_t; cc++) {
-	lc = window->w2_t[cc];
-	c = window->wsa[lc];
-	master->wave_Sxy[c] = windat->wave_Sxy[lc];
-	master->wave_Syx[c] = windat->wave_Syx[lc];
-      }
+      fn(window, EV_W2, master->wave_Sxy, windat->wave_Sxy, NULL, NULL, data);
+      fn(window, EV_W2, master->wave_Syx, windat->wave_Syx, NULL, NULL, data);
     }
     if (master->waves & WAVE_FOR) {
-      for (cc = 1; cc <= window->b2_t; cc++) {
-	lc = window->w2_t[cc];
-	c = window->wsa[lc];
-	master->wave_Fx[c] = windat->wave_Fx[lc];
-	master->wave_Fy[c] = windat->wave_Fy[lc];
-      }
+      fn(window, EV_W2, master->wave_Fx, windat->wave_Fx, NULL, NULL, data);
+      fn(window, EV_W2, master->wave_Fy, windat->wave_Fy, NULL, NULL, data);
     }
     if (master->waves & STOKES) {
-      for (cc = 1; cc <= window->b2_t; cc++) {
-	lc = window->w2_t[cc];
-	c = window->wsa[lc];
-	master->wave_ste1[c] = windat->wave_ste1[lc];
-	master->wave_ste2[c] = windat->wave_ste2[lc];
-	if (master->tau_w1) master->tau_w1[c] = windat->tau_w1[lc];
-	if (master->tau_w2) master->tau_w2[c] = windat->tau_w2[lc];
-	if (master->tau_diss1) master->tau_diss1[c] = windat->tau_diss1[lc];
-	if (master->tau_diss2) master->tau_diss2[c] = windat->tau_diss2[lc];
-      }
+      fn(window, EV_W2, master->wave_ste1, windat->wave_ste1, NULL, NULL,
+	 data);
+      fn(window, EV_W2, master->wave_ste2, windat->wave_ste2, NULL, NULL,
+	 data);
+      fn(window, EV_W2, master->tau_w1, windat->tau_w1, NULL, NULL, data);
+      fn(window, EV_W2, master->tau_w2, windat->tau_w2, NULL, NULL, data);
+      fn(window, EV_W2, master->tau_diss1, windat->tau_diss1, NULL, NULL,
+	 data);
+      fn(window, EV_W2, master->tau_diss2, windat->tau_diss2, NULL, NULL,
+	 data);
     }
     /* Wave variables on the slaves are not updated; no need to      */
-    /* transfer back to the master.                                  
-    if (master->waves & NEARSHORE) {
-      for (cc = 1; cc <= window->b2_t; cc++) {
-	lc = window->w2_t[cc];
-	c = window->wsa[lc];
-	if (master->wave_k) master->wave_k[c] = windat->wave_k[lc];
-	if (master->wave_Kb) master->wave_Kb[c] = windat->wave_Kb[lc];
-	if (master->wave_P) master->wave_P[c] = windat->wave_P[lc];
-	if (master->wave_fwcapx) master->wave_fwcapx[cc] = windat->wave_fwcapx[c];
-	if (master->wave_fwcapy) master->wave_fwcapy[cc] = windat->wave_fwcapy[c];
-	if (master->wave_fbrex) master->wave_fbrex[cc] = windat->wave_fbrex[c];
-	if (master->wave_fbrey) master->wave_fbrey[cc] = windat->wave_fbrey[c];
-	if (master->wave_fbotx) master->wave_fbotx[cc] = windat->wave_fbotx[c];
-	if (master->wave_fboty) master->wave_fboty[cc] = windat->wave_fboty[c];
-	if (master->wave_fsurx) master->wave_fsurx[cc] = windat->wave_fsurx[c];
-	if (master->wave_fsury) master->wave_fsury[cc] = windat->wave_fsury[c];
-	if (master->wave_wfdx) master->wave_wfdx[cc] = windat->wave_wfdx[c];
-	if (master->wave_wfdy) master->wave_wfdy[cc] = windat->wave_wfdy[c];
-	if (master->wave_wovsx) master->wave_wovsx[cc] = windat->wave_wovsx[c];
-	if (master->wave_wovsy) master->wave_wovsy[cc] = windat->wave_wovsy[c];
-	if (master->wave_frolx) master->wave_frolx[cc] = windat->wave_frolx[c];
-	if (master->wave_froly) master->wave_froly[cc] = windat->wave_froly[c];
-      }
-    }
-    */
+    /* transfer back to the master.                                  */
     for (tt = 0; tt < master->ndhw; tt++) {
-      if (master->dhwf[tt] & DHW_NOAA) {
-	for (cc = 1; cc <= window->b3_t; cc++) {
-	  lc = window->w3_t[cc];
-	  c = window->wsa[lc];
-	  master->dhd[tt][c] = windat->dhd[tt][lc];
-	}
-      }
+      if (master->dhwf[tt] & DHW_NOAA)
+	fn(window, EV_W3, master->dhd[tt], windat->dhd[tt], NULL, NULL, data);
     }
     if (!(master->decf & NONE)) {
-      if (master->decf == DEC_ETA) {
-	for (cc = 1; cc <= window->b2_t; cc++) {
-	  lc = window->w2_t[cc];
-	  c = window->wsa[lc];
-	  master->decv[c] = windat->eta[lc];
-	}
-      } else {
-	for (cc = 1; cc <= window->b3_t; cc++) {
-	  lc = window->w3_t[cc];
-	  c = window->wsa[lc];
-	  if (master->decf == DEC_U1)
-	    master->decv[c] = windat->u1[lc];
-	  else
-	    master->decv[c] = windat->tr_wc[master->decn][lc];
-	}
-      }
+      if (master->decf == DEC_ETA)
+	fn(window, EV_W2, master->decv, windat->eta, NULL, NULL, data);
+      else if (master->decf == DEC_U1)
+	fn(window, EV_W3, master->decv, windat->u1, NULL, NULL, data);
+      else
+	fn(window, EV_W3, master->decv, windat->tr_wc[master->decn], NULL,
+	   NULL, data);
     }
-
-    /*---------------------------------------------------------------*/
     /* Particle tracking variables                                   */
     if (master->ptn) {
-      win_priv_t *wincon = window->wincon;
-      for (cc = 1; cc <= window->b3_t; cc++) {
-        lc = window->w3_t[cc];
-        c = window->wsa[lc];
-        master->Kz[c] = windat->Kz[lc];
-        master->dz[c] = wincon->dz[lc];
-      }
-      for (cc = 1; cc <= window->b2_t; cc++) {
-        lc = window->w2_t[cc];
-        c = window->wsa[lc];
-        master->eta[c] = windat->eta[lc];
-      }
-      /* Get the surface sparse coordinates                          */
-      if (!master->sigma) {
-        int zm1;
-        for (cc = 1; cc <= geom->b2_t; cc++) {
-          c = lc = geom->w2_t[cc];
-          zm1 = geom->zm1[c];
-           while (c != zm1 && geom->gridz[c] > master->eta[lc]) {
-            c = zm1;
-            zm1 = geom->zm1[c];
-          }
-          geom->sur_t[cc] = c;
-        }
-      }
+      fn(window, EV_W3, master->Kz, windat->Kz, NULL, NULL, data);
+      fn(window, EV_W3, master->dz, wincon->dz, NULL, NULL, data);
+      fn(window, EV_W2, master->eta, windat->eta, NULL, NULL, data);
     }
     /* Mean iteration counter                                        */
-    if (!(master->means & NONE)) {
-      for (cc = 1; cc <= window->enonS; cc++) {
-	c = window->wsa[cc];
-	master->meanc[c] = windat->meanc[cc];
-      }
-    }
+    if (!(master->means & NONE))
+      fn(window, EV_ALL2, master->meanc, windat->meanc, NULL, NULL, data);
   }
 }
 
-/* END win_data_empty_3d()                                           */
+/* END win_data_empty_vars()                                         */
 /*-------------------------------------------------------------------*/
 
 
 /*-------------------------------------------------------------------*/
+/* Transfers one window array to the master over a map (EV_*); used  */
+/* with win_data_empty_vars().                                       */
 /*-------------------------------------------------------------------*/
-/* Routine to empty the window data structure back into the master   */
-/* (cells which are used as auxiliary cells in other windows only)   */
-/* for the 2D mode. If only one window exists the master points to   */
-/* the windat data structure - no need to empty.                     */
-/*-------------------------------------------------------------------*/
-void win_data_empty_2d(master_t *master,    /* Master data           */
-                       geometry_t *window,  /* Window geometry       */
-                       window_t *windat,    /* Window data           */
-                       int mode             /* Data flag             */
+void win_empty_var(geometry_t *window,  /* Window geometry           */
+		   int map,             /* Map to transfer over      */
+		   double *Ag,          /* Master double array       */
+		   double *Al,          /* Window double array       */
+		   int *iAg,            /* Master integer array      */
+		   int *iAl,            /* Window integer array      */
+		   void *data           /* Not used                  */
   )
 {
-  int c, cc, lc;                /* Local sparse coordinate / counter */
-
-  /*-----------------------------------------------------------------*/
-  /* Cell centered 2D arrays.                                        */
-  /* Variables that require wet cells which are used by other        */
-  /* windows to be transfered to the master.                         */
-  /* mode = VELOCITY : updated velocity and elevation data.          */
-  if (mode & VELOCITY) {
-    s2m_vel(master->u1av, windat->u1av,
-	    window->s2me1, window->wse, window->ns2me1S);
-    s2m_vel(master->u2av, windat->u2av,
-	    window->s2me1, window->wse, window->ns2me1S);
-
-    for (cc = 1; cc <= window->ns2mS; cc++) {
-      lc = window->s2m[cc];
-      c = window->wsa[lc];
-      master->eta[c] = windat->eta[lc];
-      /*
-      master->uav[c] = windat->uav[lc];
-      master->vav[c] = windat->vav[lc];
-      */
-      master->detadt[c] = windat->detadt[lc];
-      master->etab[c] = windat->etab[lc];
-    }
-    memcpy(master->trincS, windat->trincS, master->ntrS * sizeof(int));
-  }
-  /* mode = DEPTH : total depth at the cell faces                    */
-  if (mode & DEPTH) {
-    s2m_vel(master->depth_e1, windat->depth_e1,
-            window->s2me1, window->wse, window->ns2me1S);
-  }
-  /* mode = NVELOCITY : updated velocity. Used in asselin().         */
-  if (mode & NVELOCITY) {
-    int n, ee, e, le;
-    s2m_vel(master->nu1av, windat->nu1av,
-	    window->s2me1, window->wse, window->ns2me1S);
-    /* For VERTIN OBCs the depth is reset so copy tangential OBC     */
-    /* depths, so that tangential OBC auxiliaries are set in other   */
-    /* windows.                                                      */
+  int *vec = NULL;              /* Window cells / edges              */
+  int *evec = window->wsa;      /* Window to master map              */
+  int nvec = 0;                 /* Size of vec                       */
+  int c, cc, lc, n;
+
+  switch (map) {
+  case EV_S2M:
+    vec = window->s2m;
+    nvec = window->ns2m;
+    break;
+  case EV_S2MS:
+    vec = window->s2m;
+    nvec = window->ns2mS;
+    break;
+  case EV_S2ME1:
+    vec = window->s2me1;
+    evec = window->wse;
+    nvec = window->ns2me1;
+    break;
+  case EV_S2ME1S:
+    vec = window->s2me1;
+    evec = window->wse;
+    nvec = window->ns2me1S;
+    break;
+  case EV_W3:
+    vec = window->w3_t;
+    nvec = window->b3_t;
+    break;
+  case EV_W2:
+    vec = window->w2_t;
+    nvec = window->b2_t;
+    break;
+  case EV_W3E1:
+    vec = window->w3_e1;
+    evec = window->wse;
+    nvec = window->b3_e1;
+    break;
+  case EV_W2E1:
+    vec = window->w2_e1;
+    evec = window->wse;
+    nvec = window->b2_e1;
+    break;
+  case EV_ALL2:
+    nvec = window->enonS;
+    break;
+  case EV_VERTIN:
     for (n = 0; n < window->nobc; n++) {
       open_bdrys_t *open = window->open[n];
-      if (open->bcond_tan2d & VERTIN) {
-	for (ee = open->no3_e1 + 1; ee <= open->to2_e1; ee++) {
-	  le = open->obc_e1[ee];
-	  e = window->wse[le];
-	  master->depth_e1[e] = windat->depth_e1[le];
-	}
-      }
+      if (open->bcond_tan2d & VERTIN)
+	s2m_vel(Ag, Al, open->obc_e1 + open->no3_e1, window->wse,
+		open->to2_e1 - open->no3_e1);
     }
+    return;
   }
 
-  if (mode & ETA_A) {
-    for (cc = 1; cc <= window->ns2mS; cc++) {
-      lc = window->s2m[cc];
-      c = window->wsa[lc];
-      master->eta[c] = windat->eta[lc];
+  if (Ag != NULL) {
+    for (cc = 1; cc <= nvec; cc++) {
+      lc = (vec) ? vec[cc] : cc;
+      c = evec[lc];
+      Ag[c] = Al[lc];
+    }
+  } else if (iAg != NULL) {
+    for (cc = 1; cc <= nvec; cc++) {
+      lc = (vec) ? vec[cc] : cc;
+      c = evec[lc];
+      iAg[c] = iAl[lc];
     }
   }
-
-  /* Uncomment to check slave to master transfer indicies            */
-  /*
-  for (cc=1; cc <= window->ns2mS; cc++) {
-    c = window->s2me1[cc];
-    lc = window->s2m[cc];
-    printf("s2me1 window%d (%d %d)s->(%d %d)m\n",window->wn,window->s2i[lc], 
-	   window->s2j[lc],geom->s2i[c],geom->s2j[c]);
-    c = window->s2me2[cc];
-    printf("s2me2 window%d (%d %d)s->(%d %d)m\n",window->wn,window->s2i[lc], 
-	   window->s2j[lc],geom->s2i[c],geom->s2j[c]);
-  }
-  */
 }
 
-/* END win_data_empty_2d()                                           */
+/* END win_empty_var()                                               */
 /*-------------------------------------------------------------------*/
 
 
@@ -1576,6 +1544,189 @@ void build_transfer_maps(geometry_t *geom,    /* Global geometry     */
 /*-------------------------------------------------------------------*/
 
 
+/*-------------------------------------------------------------------*/
+/*-------------------------------------------------------------------*/
+/* Routine to generate vectors for window-to-window transfers of 2D  */
+/* auxiliary cells. For every surface entry of m2s and m2se1 the     */
+/* window that writes that cell to the master (via s2m and s2me1)    */
+/* and its local coordinate in that window are stored, so that the   */
+/* value may be copied directly from the owning window. Entries not  */
+/* written by any window (owner = 0) continue to be read from the    */
+/* master. The maps are built from the transfer vectors rather than  */
+/* the global-local maps so they are valid for windows read from a   */
+/* cache.                                                            */
+/*-------------------------------------------------------------------*/
+void build_peer_maps(geometry_t *geom,    /* Global geometry         */
+		     geometry_t **window, /* Local geometry          */
+		     int nwindows         /* Number of windows       */
+		     )
+{
+  int *ownc, *locc;             /* Owner window / local cell         */
+  int *owne, *loce;             /* Owner window / local edge         */
+  int c, cc, lc, e, ee, le;     /* Sparse coordinates / counters     */
+  int n, np = 0;
+
+  ownc = i_alloc_1d(geom->szcS);
+  locc = i_alloc_1d(geom->szcS);
+  owne = i_alloc_1d(geom->szeS);
+  loce = i_alloc_1d(geom->szeS);
+  memset(ownc, 0, geom->szcS * sizeof(int));
+  memset(owne, 0, geom->szeS * sizeof(int));
+
+  /* Owners of cells and edges written to the master                 */
+  for (n = 1; n <= nwindows; n++) {
+    for (cc = 1; cc <= window[n]->ns2mS; cc++) {
+      lc = window[n]->s2m[cc];
+      c = window[n]->wsa[lc];
+      ownc[c] = n;
+      locc[c] = lc;
+    }
+    for (ee = 1; ee <= window[n]->ns2me1S; ee++) {
+      le = window[n]->s2me1[ee];
+      e = window[n]->wse[le];
+      owne[e] = n;
+      loce[e] = le;
+    }
+  }
+
+  /* Sources of the auxiliary cells and edges in each window         */
+  for (n = 1; n <= nwindows; n++) {
+    window[n]->p2sw = i_alloc_1d(window[n]->nm2sS + 1);
+    window[n]->p2sc = i_alloc_1d(window[n]->nm2sS + 1);
+    for (cc = 1; cc <= window[n]->nm2sS; cc++) {
+      c = window[n]->wsa[window[n]->m2s[cc]];
+      window[n]->p2sw[cc] = (ownc[c] != n) ? ownc[c] : 0;
+      window[n]->p2sc[cc] = locc[c];
+      if (window[n]->p2sw[cc]) np++;
+    }
+    window[n]->p2sw_e1 = i_alloc_1d(window[n]->nm2se1S + 1);
+    window[n]->p2se1 = i_alloc_1d(window[n]->nm2se1S + 1);
+    for (ee = 1; ee <= window[n]->nm2se1S; ee++) {
+      e = window[n]->wse[window[n]->m2se1[ee]];
+      window[n]->p2sw_e1[ee] = (owne[e] != n) ? owne[e] : 0;
+      window[n]->p2se1[ee] = loce[e];
+      if (window[n]->p2sw_e1[ee]) np++;
+    }
+  }
+  i_free_1d(ownc);
+  i_free_1d(locc);
+  i_free_1d(owne);
+  i_free_1d(loce);
+
+  if (DEBUG("init_w"))
+    dlog("init_w", "  %d window-to-window 2D transfers\n", np);
+}
+
+/* END build_peer_maps()                                             */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/*-------------------------------------------------------------------*/
+/* Routine to fill 2D auxiliary cells directly from the windows that */
+/* own them, bypassing the master. Only valid when the owning        */
+/* windows are not updating the variables concerned, i.e. between    */
+/* the parallel phases of the 2D mode.                               */
+/* mode = VELOCITY : elevation and 2D velocity at the start of the   */
+/*                   2D step (replaces the master transfers in       */
+/*                   win_data_fill_2d()).                            */
+/* mode = ETA_A : updated elevation (replaces win_data_refill_2d()). */
+/*-------------------------------------------------------------------*/
+void win_data_peer_2d(master_t *master,   /* Master data             */
+		      geometry_t *window, /* Window geometry         */
+		      window_t *windat,   /* Window data             */
+		      window_t **peer,    /* Data for all windows    */
+		      int mode            /* Data flag               */
+		      )
+{
+  int cc, lc, sc, wn;           /* Counters / coordinates            */
+
+  if (mode & (VELOCITY|ETA_A)) {
+    for (cc = 1; cc <= window->nm2sS; cc++) {
+      lc = window->m2s[cc];
+      if ((wn = window->p2sw[cc])) {
+	sc = window->p2sc[cc];
+	windat->eta[lc] = peer[wn]->eta[sc];
+	if (mode & VELOCITY) {
+	  windat->detadt[lc] = peer[wn]->detadt[sc];
+	  windat->etab[lc] = peer[wn]->etab[sc];
+	}
+      } else {
+	sc = window->wsa[lc];
+	windat->eta[lc] = master->eta[sc];
+	if (mode & VELOCITY) {
+	  windat->detadt[lc] = master->detadt[sc];
+	  windat->etab[lc] = master->etab[sc];
+	}
+      }
+    }
+  }
+  if (mode & VELOCITY) {
+    for (cc = 1; cc <= window->nm2se1S; cc++) {
+      lc = window->m2se1[cc];
+      if ((wn = window->p2sw_e1[cc])) {
+	sc = window->p2se1[cc];
+	windat->u1av[lc] = peer[wn]->u1av[sc];
+	windat->u2av[lc] = peer[wn]->u2av[sc];
+	windat->depth_e1[lc] = peer[wn]->depth_e1[sc];
+      } else {
+	sc = window->wse[lc];
+	windat->u1av[lc] = master->u1av[sc];
+	windat->u2av[lc] = master->u2av[sc];
+	windat->depth_e1[lc] = master->depth_e1[sc];
+      }
+    }
+  }
+}
+
+/* END win_data_peer_2d()                                            */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Refreshes the master 2D arrays that are not updated during the 2D */
+/* mode when window-to-window transfers are used. This is done once  */
+/* at the end of the 2D mode for outputs and the 3D mode, or before  */
+/* master-side boundary evaluation that may use these arrays.        */
+/*-------------------------------------------------------------------*/
+void win_data_peer_empty_2d(master_t *master,    /* Master data      */
+			    geometry_t **window, /* Window geometry  */
+			    window_t **windat,   /* Window data      */
+			    int nwindows         /* Number of windows */
+			    )
+{
+  int n;
+
+  for (n = 1; n <= nwindows; n++)
+    win_data_empty_2d(master, window[n], windat[n], VELOCITY|DEPTH);
+}
+
+/* END win_data_peer_empty_2d()                                      */
+/*-------------------------------------------------------------------*/
+
+
+/*-------------------------------------------------------------------*/
+/* Returns 1 if any open boundary evaluates a custom 2D function on  */
+/* the master, which may read the master elevation or velocity.      */
+/*-------------------------------------------------------------------*/
+int master_peer_obc(geometry_t *geom)
+{
+  int n;
+
+  for (n = 0; n < geom->nobc; n++) {
+    open_bdrys_t *open = geom->open[n];
+    if ((open->bcond_ele & CUSTOM && open->etadata.custom_m) ||
+	(open->bcond_nor2d & CUSTOM && open->datau1av.custom_m) ||
+	(open->bcond_tan2d & CUSTOM && open->datau2av.custom_m))
+      return(1);
+  }
+  return(0);
+}
+
+/* END master_peer_obc()                                             */
+/*-------------------------------------------------------------------*/
+
+
 /*-------------------------------------------------------------------*/
 /*-------------------------------------------------------------------*/
 /* Routine to populate the master with window data                   */
@@ -1593,9 +1744,12 @@ void master_fill(master_t *master,    /* Master data                 */
   if (master->is_filled)
     return;
   for (n = 1; n <= master->nwindows; n++) {
+    if (!dp_is_local(n)) continue;
     s2m_2d(master, window[n], windat[n]);
     s2m_3d(master, window[n], windat[n], wincon[n]);
   }
+  /* Windows stepped in other processes                              */
+  dp_exchange(MFILL);
   master->is_filled = 1;
 }
 
@@ -1623,6 +1777,12 @@ void master_fill_ts(master_t *master,     /* Master data             */
   if (master->is_filled)
     return;
 
+  /* Time series points may lie in any window                        */
+  if (dp_is_distributed()) {
+    master_fill(master, window, windat, wincon);
+    return;
+  }
+
   for (n = 1; n <= master->nwindows; n++) {
     if (window[n]->ns2m_ts == 0) continue;
     for (cc = 1; cc <= window[n]->ns2m_ts; cc++) {
@@ -1720,6 +1880,85 @@ void master_fill_glider(master_t *master,     /* Master data         */
 /*-------------------------------------------------------------------*/
 
 
+/*-------------------------------------------------------------------*/
+/* Lists the window arrays that s2m_2d() (dim = 2) and s2m_3d()      */
+/* (dim = 3) transfer to the master over the window wet cells and    */
+/* edges, in the same way as win_data_empty_vars(). This list is     */
+/* also the MPI exchange list for master_fill() (see dp_mpi_vars()). */
+/* Note: wind1, patm and Cd are already on the master since these    */
+/* variables are read onto the master and transferred to the window  */
+/* at the start of the step.                                         */
+/*-------------------------------------------------------------------*/
+void s2m_vars(master_t *master,    /* Master data                    */
+	      geometry_t *window,  /* Window geometry                */
+	      window_t *windat,    /* Window data                    */
+	      win_priv_t *wincon,  /* Private window data            */
+	      int dim,             /* 2D or 3D transfer              */
+	      void (*fn)(geometry_t *window, int map, double *Ag,
+			 double *Al, int *iAg, int *iAl, void *data),
+	      void *data           /* Passed to fn                   */
+  )
+{
+  int tn, tt, k;
+
+  if (dim == 2) {
+    /* Cell centered variables                                       */
+    fn(window, EV_W2, master->eta, windat->eta, NULL, NULL, data);
+    fn(window, EV_W2, master->topz, windat->topz, NULL, NULL, data);
+    fn(window, EV_W2, master->wtop, windat->wtop, NULL, NULL, data);
+    fn(window, EV_W2, master->uav, windat->uav, NULL, NULL, data);
+    fn(window, EV_W2, master->vav, windat->vav, NULL, NULL, data);
+    for (tn = 0; tn < master->ntrS; tn++) {
+      if (master->do_wave & W_SWAN && master->trinfo_2d[tn].type & WAVE)
+	continue;
+      fn(window, EV_W2, master->tr_wcS[tn], windat->tr_wcS[tn], NULL, NULL,
+	 data);
+    }
+    if (master->wave_P)
+      fn(window, EV_W2, master->wave_P, windat->wave_P, NULL, NULL, data);
+    for (tn = 0; tn < windat->nsed; tn++)
+      for (k = 0; k < window->sednz; k++)
+	fn(window, EV_W2, master->tr_sed[tn][k], windat->tr_sed[tn][k],
+	   NULL, NULL, data);
+    /* Edge centered variables                                       */
+    fn(window, EV_W2E1, master->u1av, windat->u1av, NULL, NULL, data);
+    fn(window, EV_W2E1, master->u2av, windat->u2av, NULL, NULL, data);
+    return;
+  }
+
+  /* Cell centered variables                                         */
+  fn(window, EV_W3, master->w, windat->w, NULL, NULL, data);
+  fn(window, EV_W3, master->dens, windat->dens, NULL, NULL, data);
+  fn(window, EV_W3, master->dens_0, windat->dens_0, NULL, NULL, data);
+  fn(window, EV_W3, master->Vz, windat->Vz, NULL, NULL, data);
+  fn(window, EV_W3, master->Kz, windat->Kz, NULL, NULL, data);
+  fn(window, EV_W3, master->u, windat->u, NULL, NULL, data);
+  fn(window, EV_W3, master->v, windat->v, NULL, NULL, data);
+  fn(window, EV_W3, master->dz, wincon->dz, NULL, NULL, data);
+  fn(window, EV_W3, master->u1kh, wincon->u1kh, NULL, NULL, data);
+  for (tt = 0; tt < master->ntrmap_s2m_3d; tt++) {
+    tn = master->trmap_s2m_3d[tt];
+    fn(window, EV_W3, master->tr_wc[tn], windat->tr_wc[tn], NULL, NULL,
+       data);
+  }
+
+  /* Edge centered variables                                         */
+  fn(window, EV_W3E1, master->u1, windat->u1, NULL, NULL, data);
+  fn(window, EV_W3E1, master->u2, windat->u2, NULL, NULL, data);
+  fn(window, EV_W3E1, master->dzu1, windat->dzu1, NULL, NULL, data);
+  fn(window, EV_W3E1, master->u1vh, wincon->u1vh, NULL, NULL, data);
+  if (master->means & VEL3D)
+    fn(window, EV_W3E1, master->ume, windat->ume, NULL, NULL, data);
+  if (master->means & VOLFLUX)
+    fn(window, EV_W3E1, master->u1vm, windat->u1vm, NULL, NULL, data);
+  if (master->means & VEL2D)
+    fn(window, EV_W2E1, master->uame, windat->uame, NULL, NULL, data);
+}
+
+/* END s2m_vars()                                                    */
+/*-------------------------------------------------------------------*/
+
+
 /*-------------------------------------------------------------------*/
 /* Packs 3d local arrays into the master                             */
 /*-------------------------------------------------------------------*/
@@ -1730,59 +1969,11 @@ void s2m_3d(master_t *master,   /* Master data                       */
   )
 {
   int cc, c, lc;                /* Cell centers / counters           */
-  int ee, e, le;                /* Edge centers / counters           */
+  int ee;                       /* Edge counter                      */
   int n, tn, tt;                /* Counters                          */
 
-  /* Cell centre variables                                           */
-  for (cc = 1; cc <= window->b3_t; cc++) {
-    lc = window->w3_t[cc];
-    c = window->wsa[lc];
-    
-    master->w[c] = windat->w[lc];
-    master->dens[c] = windat->dens[lc];
-    master->dens_0[c] = windat->dens_0[lc];
-    master->Vz[c] = windat->Vz[lc];
-    master->Kz[c] = windat->Kz[lc];
-    master->u[c] = windat->u[lc];
-    master->v[c] = windat->v[lc];
-    master->dz[c] = wincon->dz[lc];
-    master->u1kh[c] = wincon->u1kh[lc];
-    for (tt = 0; tt < master->ntrmap_s2m_3d; tt++) {
-      tn = master->trmap_s2m_3d[tt];
-      master->tr_wc[tn][c] = windat->tr_wc[tn][lc];
-    }
-  }
-  
-  /* Edge centered variables                                        */
-  for (ee = 1; ee <= window->b3_e1; ee++) {
-    le = window->w3_e1[ee];
-    e = window->wse[le];
-    master->u1[e] = windat->u1[le];
-    master->u2[e] = windat->u2[le];
-    master->dzu1[e] = windat->dzu1[le];
-    master->u1vh[e] = wincon->u1vh[le];
-  }
-  if (master->means & VEL3D) {
-    for (ee = 1; ee <= window->b3_e1; ee++) {
-      le = window->w3_e1[ee];
-      e = window->wse[le];
-      master->ume[e] = windat->ume[le];
-    }
-  }
-  if (master->means & VOLFLUX) {
-    for (ee = 1; ee <= window->b3_e1; ee++) {
-      le = window->w3_e1[ee];
-      e = window->wse[le];
-      master->u1vm[e] = windat->u1vm[le];
-    }
-  }
-  if (master->means & VEL2D) {
-    for (ee = 1; ee <= window->b2_e1; ee++) {
-      le = window->w2_e1[ee];
-      e = window->wse[le];
-      master->uame[e] = windat->uame[le];
-    }
-  }
+  /* Transfer the arrays listed in s2m_vars()                        */
+  s2m_vars(master, window, windat, wincon, 3, win_empty_var, NULL);
 
   /* Fill the R_EDGE and F_EDGE cell centres if required            */
   for (n = 0; n < window->nobc; n++) {
@@ -1815,44 +2006,8 @@ void s2m_2d(master_t *master,   /* Master data                       */
             window_t *windat    /* Window data                       */
 	    )
 {
-  int cc, c, lc;                /* Cell centers / counters           */
-  int ee, e, le;                /* Edge centers / counters           */
-  int cb, tn, k = 0; 
-
-  /* Grid centered variables. Note: wind1, patm and Cd are           */
-  /* already on the master since these variables are read onto the   */
-  /* master and transferred to the window at the start of the step.  */
-  for (cc = 1; cc <= window->b2_t; cc++) {
-    lc = window->w2_t[cc];
-    c = window->wsa[lc];
-    master->eta[c] = windat->eta[lc];
-    master->topz[c] = windat->topz[lc];
-    master->wtop[c] = windat->wtop[lc];
-    master->uav[c] = windat->uav[lc];
-    master->vav[c] = windat->vav[lc];
-    for (tn = 0; tn < master->ntrS; tn++) {
-      if (master->do_wave & W_SWAN && master->trinfo_2d[tn].type & WAVE) continue;
-      master->tr_wcS[tn][c] = windat->tr_wcS[tn][lc];
-    }
-    if (master->wave_P) master->wave_P[c] = windat->wave_P[lc];
-    for (tn = 0; tn < windat->nsed; tn++) {
-      for (k = 0; k < window->sednz; k++)
-        master->tr_sed[tn][k][c] = windat->tr_sed[tn][k][lc];
-    }
-  }
-  
-  /* Edge centered variables                                         */
-  for (ee = 1; ee <= window->b2_e1; ee++) {
-    le = window->w2_e1[ee];
-    cb = window->wse[window->bot_e1[ee]];
-    e = window->wse[le];
-    master->u1av[e] = windat->u1av[le];
-    master->u2av[e] = windat->u2av[le];
-    /* Re-setting the master for printing purposes can interfere     */
-    /* with master-slave transfers.                                  */
-    /* master->u1bot[e]=windat->u1[cb]; */
-    /* master->u1bot[e] = windat->u1bot[le]; */
-  }
+  /* Transfer the arrays listed in s2m_vars()                        */
+  s2m_vars(master, window, windat, window->wincon, 2, win_empty_var, NULL);
 }
 
 /* END s2m_2d()                                                      */
@@ -3116,8 +3271,9 @@ int mpi_check_multi_windows_sparse_arrays(geometry_t *geom)
 #ifdef HAVE_MPI
   int mpi_rank_other = (mpi_rank == 0 ? 1 : 0);
 
-  /* Only works for exactly 2 processes */
-  if (mpi_size != 2)
+  /* Only works for exactly 2 processes, comparing a single and  */
+  /* multiple window run; not used for distributed windows.       */
+  if (mpi_size != 2 || dp_is_distributed())
     return(0);
 
   /*
@@ -3323,8 +3479,9 @@ int mpi_check_multi_windows_velocity(geometry_t *geom, master_t *master,
   int win_v_size, *win_w_e1;
   double *win_vel;
   
-  /* Only works for exactly 2 processes */
-  if (mpi_size != 2)
+  /* Only works for exactly 2 processes, comparing a single and  */
+  /* multiple window run; not used for distributed windows.       */
+  if (mpi_size != 2 || dp_is_distributed())
     return(0);
 
   /* Set up sizes and arrays for this process */
@@ -3468,8 +3625,9 @@ int mpi_check_multi_windows_Vz(geometry_t *geom, master_t *master,
   int win_v_size, *win_w_t;
   double *win_vel;
   
-  /* Only works for exactly 2 processes */
-  if (mpi_size != 2)
+  /* Only works for exactly 2 processes, comparing a single and  */
+  /* multiple window run; not used for distributed windows.       */
+  if (mpi_size != 2 || dp_is_distributed())
     return(0);
 
   /* Set up sizes and arrays for this process */
@@ -3587,8 +3745,9 @@ int mpi_check_multi_windows_tracer(geometry_t *geom, master_t *master,
   int win_v_size, *win_w_t;
   double *win_vel;
   
-  /* Only works for exactly 2 processes */
-  if (mpi_size != 2)
+  /* Only works for exactly 2 processes, comparing a single and  */
+  /* multiple window run; not used for distributed windows.       */
+  if (mpi_size != 2 || dp_is_distributed())
     return(0);
 
   /* Set up sizes and arrays for this process */
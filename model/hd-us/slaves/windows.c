@@ -80,6 +80,13 @@ void update_ev2(local_t *l, lvector_t *lv, int e, int c, int *n, int *em, int **
 void write_mesh_order(parameters_t *params, geometry_t *geom, geometry_t *window);
 void write_mesh_order_e(parameters_t *params, geometry_t *geom, geometry_t *window);
 void reorder_metis(geometry_t *geom, int nwindows, int **ws2, int *wsize);
+static void win_alloc_vars(geometry_t *window, window_t *windat,
+			   win_priv_t *wincon,
+			   void (*fn)(void *a, int type, size_t n1, size_t n2,
+				      void *data),
+			   void *data);
+static void win_alloc_var(void *a, int type, size_t n1, size_t n2,
+			  void *data);
 
 /* Codes for edges */
 #define W_GHOST 2
@@ -96,6 +103,10 @@ void reorder_metis(geometry_t *geom, int nwindows, int **ws2, int *wsize);
 #define E_B  2
 #define E_G  4
 
+/* Array types listed by win_alloc_vars() */
+#define WA_D1 0
+#define WA_D2 1
+
 /*-------------------------------------------------------------------*/
 /* Routine to check if an integer is a member of an integer array    */
 /*-------------------------------------------------------------------*/
@@ -131,51 +142,10 @@ int ANY0(
       return (1);
   return (0);
 }
-  
-/*
- * Same routine as above, but executes in parallel
- */
-#if defined(HAVE_OMP)
-int ANY_OMP(int var,      /* Integer variable */
-	    int array[],  /* Integer array    */
-	    int ns)       /* Size of array    */
-{
-  int nn;
-  int done = 0; /* flag */
-  int ret  = 0; /* This is the return value */
-
-#pragma omp parallel for private(nn), shared(done,ret)
-  for (nn = 1; nn <= ns; nn++) {
-    if (!done) {
-      if (var == array[nn]) {
-#pragma omp critical
-	{
-	  ret  = nn;
-	  done = 1;
-	}
-      }
-    }
-  }	
-  
-  return (ret);
-}
-#endif
-
-/* ANYf stands for ANY function */
-#ifdef HAVE_OMP
-#define ANYf(x,y,z) ANY_OMP(x,y,z)
-#else
-#define ANYf(x,y,z) ANY(x,y,z)
-#endif
 
 /*
- * Mapped arrays, definied in any.cpp
- *   - Will need to move these definitions to proto.h when other files
- *     start using them
+ * Hashed versions of ANY for repeated lookups are in any.cpp
  */
-void *ANY_map_init(int array[], int ns);
-int  ANY_map_find(void *arr, int var);
-void ANY_map_destroy(void *arr);
 
 /*-------------------------------------------------------------------*/
 /*-------------------------------------------------------------------*/
@@ -205,6 +175,18 @@ void window_build(geometry_t *geom,     /* Global geometry           */
   if (params->runmode & MANUAL && nwindows > 1 && params->map_type & WIN_READ)
     readwin = 1;
 
+  /* Use the window cache if it was made for this mesh and           */
+  /* decomposition.                                                  */
+  params->win_cached = 0;
+  if (!readwin && params->runmode & MANUAL && nwindows > 1 &&
+      strlen(params->win_cache)) {
+    window_cache_key(params, geom, params->win_key);
+    if (window_cache_check(params->win_cache, params->win_key)) {
+      readwin = params->win_cached = 1;
+      hd_warn("Reading windows from cache %s\n", params->win_cache);
+    }
+  }
+
   /*-----------------------------------------------------------------*/
   /* Allocate memory                                                 */
   geom->fm = (global_map_t *)malloc(sizeof(global_map_t) * geom->szm);
@@ -315,7 +297,8 @@ void window_build(geometry_t *geom,     /* Global geometry           */
   else {
     /* Partition the surface layer into windows                      */
     if (readwin) {
-      read_windows_us(geom, window, params->win_file);
+      read_windows_us(geom, window, params->win_cached ?
+		      params->win_cache : params->win_file);
     } else {
       if (params->win_type & STRIPE_E2)
 	window_cells_linear_e2(geom, nwindows, ws2, wsz2D);
@@ -669,6 +652,11 @@ void window_build(geometry_t *geom,     /* Global geometry           */
     }
   }
 
+  /*-----------------------------------------------------------------*/
+  /* Window-to-window 2D transfer vectors                            */
+  if (nwindows > 1 && params->win_p2p)
+    build_peer_maps(geom, window, nwindows);
+
   /*-----------------------------------------------------------------*/
   /* Check the window map if required                                */
   if (params->map_type & WIN_CHECK)
@@ -1355,12 +1343,24 @@ void window_cells_linear_e2(geometry_t *geom, /* Global geometery    */
   int c, cc, n, m;
   int c1, i, j;
   int *mask, *wetc;
+  void **obcm, **oi1m;
 
   /*-----------------------------------------------------------------*/
   /* Initialise                                                      */
   wetc = i_alloc_1d(geom->enonS + 1);
   mask = i_alloc_1d(geom->enonS + 1);
 
+  /* Lookup tables for the cells on and interior to U2BDRY OBCs      */
+  obcm = (void **)calloc(geom->nobc + 1, sizeof(void *));
+  oi1m = (void **)calloc(geom->nobc + 1, sizeof(void *));
+  for (n = 0; n < geom->nobc; n++) {
+    open_bdrys_t *open = geom->open[n];
+    if (open->type == U2BDRY) {
+      obcm[n] = ANY_map_build(open->obc_t, 1, open->no2_t);
+      oi1m[n] = ANY_map_build(open->oi1_t, 1, open->no2_t);
+    }
+  }
+
   /*-----------------------------------------------------------------*/
   /* Make a mask of wet cells                                        */
   memset(wetc, 0, (geom->enonS + 1) * sizeof(int));
@@ -1409,12 +1409,12 @@ void window_cells_linear_e2(geometry_t *geom, /* Global geometery    */
 	  /* Don't allow window transition to occur on OBCs          */
 	  for (nn = 0; nn < geom->nobc; nn++) {
 	    open_bdrys_t *open = geom->open[nn];
-	    if (open->type == U2BDRY && ANYf(c, open->obc_t, open->no2_t)) {
+	    if (open->type == U2BDRY && ANY_map_find(obcm[nn], c)) {
 	      bf = 0;
 	      wsizeS[n]+=1;
 	      wsizeS[nwindows]-=1;
 	    }
-	    if (open->type == U2BDRY && ANYf(c, open->oi1_t, open->no2_t)) {
+	    if (open->type == U2BDRY && ANY_map_find(oi1m[nn], c)) {
 	      bf = 0;
 	      wsizeS[n]+=2;
 	      wsizeS[nwindows]-=2;
@@ -1452,6 +1452,14 @@ void window_cells_linear_e2(geometry_t *geom, /* Global geometery    */
   if (DEBUG("init_w")) {
     dlog("init_w", "Found %d unallocated cells\n", m);
   }
+  for (n = 0; n < geom->nobc; n++) {
+    if (obcm[n] != NULL) {
+      ANY_map_destroy(obcm[n]);
+      ANY_map_destroy(oi1m[n]);
+    }
+  }
+  free(obcm);
+  free(oi1m);
   i_free_1d(wetc);
   i_free_1d(mask);
 }
@@ -5095,7 +5103,6 @@ void get_local_ghost(geometry_t *geom,   /* Global; geometry         */
         window->nbptS++;
     }
   }
-  ANY_map_destroy(any_array);
 
   /* Allocate memory and initialise counters                         */
   window->bpt = i_alloc_1d(window->nbpt + 1);
@@ -5111,7 +5118,6 @@ void get_local_ghost(geometry_t *geom,   /* Global; geometry         */
   window->nbptS = 1;
 
   /* Assign the lateral ghost cells to the boundary vectors          */
-  any_array =  ANY_map_init(window->wsa, window->enon);
   for (cc = 1; cc <= geom->nbpt; cc++) {
     c = geom->bpt[cc];            /* Global boundary cell            */
     // cin = geom->bin[cc];
@@ -5136,13 +5142,11 @@ void get_local_ghost(geometry_t *geom,   /* Global; geometry         */
       window->wgst[lc] = ic1;
     }
   }
-  ANY_map_destroy(any_array);
   
   window->nbpt--;
   window->nbptS--;
 
   /* Assign 2D OBC ghost cells to the window ghost array             */
-  any_array =  ANY_map_init(window->wsa, window->enon);
   for (nb = 0; nb < geom->nobc; nb++) {
     open_bdrys_t *open = geom->open[nb];
     for (ee = 1; ee <= open->no2_e1; ee++) {
@@ -5229,7 +5233,6 @@ void get_local_ghost(geometry_t *geom,   /* Global; geometry         */
         window->nbpte1S++;
     }
   }
-  ANY_map_destroy(any_array);
 
   /* Allocate memory and initialise counters                         */
   window->bpte1 = i_alloc_1d(window->nbpte1 + 1);
@@ -5245,7 +5248,6 @@ void get_local_ghost(geometry_t *geom,   /* Global; geometry         */
   window->nbe1 = window->nbe1S = 0;
 
   /* Assign the lateral ghost cells to the boundary vectors          */
-  any_array =  ANY_map_init(window->wse, window->sze-1);
   for (ee = 1; ee <= geom->nbpte1; ee++) {
     e = geom->bpte1[ee];        /* Global boundary edge              */
     ei = geom->bin[ee];         /* Global interior edge              */
@@ -6129,40 +6131,15 @@ window_t *win_data_init(master_t *master,   /* Master data structure */
   if (master->nwindows > 1) {
 
     /*---------------------------------------------------------------*/
-    /* 3D arrays                                                     */
-    /* Cell centred                                                  */
-    winsize = window->szc;
+    /* Arrays required in every window (see win_alloc_vars())        */
     windat->ntr = master->ntr;
-    windat->tr_wc = d_alloc_2d(winsize, windat->ntr);
-    windat->w = d_alloc_1d(winsize);
-    windat->Kz = d_alloc_1d(winsize);
-    windat->Vz = d_alloc_1d(winsize);
-    windat->dens = d_alloc_1d(winsize);
-    windat->dens_0 = d_alloc_1d(winsize);
-    windat->waterss = d_alloc_1d(winsize);
-    windat->nrvorc = d_alloc_1d(winsize);
-    windat->kec = d_alloc_1d(winsize);
-    windat->div = d_alloc_1d(winsize);
-    windat->u = d_alloc_1d(winsize);
-    windat->v = d_alloc_1d(winsize);
-    /* Edges                                                         */
-    winsize = window->sze;
-    windat->u1 = d_alloc_1d(winsize);
-    windat->u2 = d_alloc_1d(winsize);
-    windat->dzu1 = d_alloc_1d(winsize);
-    windat->u1flux3d = d_alloc_1d(winsize);
-    windat->u1b = d_alloc_1d(winsize);
-    windat->u2b = d_alloc_1d(winsize);
-    windat->nrvore = d_alloc_1d(winsize);
-    windat->npvore = d_alloc_1d(winsize);
-    /* Vertices                                                      */
-    winsize = window->szv;
-    windat->fv = d_alloc_1d(winsize);
-    windat->circ = d_alloc_1d(winsize);
-    windat->rvor = d_alloc_1d(winsize);
-    windat->nrvor = d_alloc_1d(winsize);
-    windat->npvor = d_alloc_1d(winsize);
+    windat->ntrS = master->ntrS;
+    win_alloc_vars(window, windat, NULL, win_alloc_var, NULL);
+
+    /*---------------------------------------------------------------*/
+    /* 3D arrays                                                     */
     /* Others                                                        */
+    winsize = window->szv;
     if (master->means & MTRA2D) windat->tram = NULL;
     if (master->velrlx & RELAX) {
       relax_info_t *relax = master->vel_rlx;
@@ -6173,22 +6150,8 @@ window_t *win_data_init(master_t *master,   /* Master data structure */
 
     /*---------------------------------------------------------------*/
     /* 2D arrays                                                     */
-    windat->ntrS = master->ntrS;
     /* Cell centred                                                  */
     winsize = window->szcS;
-    if (windat->ntrS)
-      windat->tr_wcS = d_alloc_2d(winsize, windat->ntrS);
-    windat->eta = d_alloc_1d(winsize);
-    windat->topz = d_alloc_1d(winsize);
-    windat->wdiff2d = d_alloc_1d(winsize);
-    windat->detadt = d_alloc_1d(winsize);
-    windat->wtop = d_alloc_1d(winsize);
-    windat->wbot = d_alloc_1d(winsize);
-    windat->patm = d_alloc_1d(winsize);
-    windat->waterss2d = d_alloc_1d(winsize);
-    windat->etab = d_alloc_1d(winsize);
-    windat->uav = d_alloc_1d(winsize);
-    windat->vav = d_alloc_1d(winsize);
     if (!(master->means & NONE)) {
       windat->meanc = d_alloc_1d(winsize);
       if (master->means & TIDAL) {
@@ -6246,17 +6209,6 @@ window_t *win_data_init(master_t *master,   /* Master data structure */
 
     /* Edges                                                         */
     winsize = window->szeS;
-    windat->u1av = d_alloc_1d(winsize);
-    windat->u2av = d_alloc_1d(winsize);
-    windat->nu1av = d_alloc_1d(winsize);
-    windat->u1flux = d_alloc_1d(winsize);
-    windat->depth_e1 = d_alloc_1d(winsize);
-    windat->u1bot = d_alloc_1d(winsize);
-    windat->wind1 = d_alloc_1d(winsize);
-    windat->wind2 = d_alloc_1d(winsize);
-    windat->windspeed = d_alloc_1d(winsize);
-    windat->winddir   = d_alloc_1d(winsize);
-    windat->u1avb = d_alloc_1d(winsize);
     windat->nsed = master->nsed;
     if (windat->nsed)
       windat->tr_sed = d_alloc_3d(winsize, window->sednz, windat->nsed);
@@ -7010,12 +6962,11 @@ win_priv_t **win_consts_init(master_t *master,    /* Master data     */
     wincon[n]->togn = master->togn;
     wincon[n]->sflux = i_alloc_1d(master->ntr);
 
+    /* Work arrays required in every window (see win_alloc_vars())  */
+    win_alloc_vars(window[n], NULL, wincon[n], win_alloc_var, NULL);
+
     /* 3D work arrays                                               */
     winsize = window[n]->sgsiz = window[n]->enon + 1;
-    wincon[n]->w1 = d_alloc_1d(szm);
-    wincon[n]->w2 = d_alloc_1d(szm);
-    wincon[n]->w3 = d_alloc_1d(szm);
-    wincon[n]->w4 = d_alloc_1d(szm);
     /* Also allocate the parallel versions, if required              */
 #ifdef HAVE_OMP
     wincon[n]->trans_num_omp = master->trans_num_omp;
@@ -7026,12 +6977,6 @@ win_priv_t **win_consts_init(master_t *master,    /* Master data     */
       wincon[n]->w4n = d_alloc_2d(szm, wincon[n]->trans_num_omp);
     }
 #endif
-    wincon[n]->w5 = d_alloc_1d(szm);
-    wincon[n]->w6 = d_alloc_1d(szm);
-    wincon[n]->w7 = d_alloc_1d(szm);
-    wincon[n]->w8 = d_alloc_1d(szm);
-    wincon[n]->w9 = d_alloc_1d(szm);
-    wincon[n]->w10 = d_alloc_1d(szm);
     wincon[n]->rdens = d_alloc_1d(winsize);
     wincon[n]->s1 = i_alloc_1d(szm);
     wincon[n]->s2 = i_alloc_1d(szm);
@@ -7040,8 +6985,6 @@ win_priv_t **win_consts_init(master_t *master,    /* Master data     */
     wincon[n]->c1 = c_alloc_1d(szm);
     wincon[n]->ba = d_alloc_1d(window[n]->npem+1);
     wincon[n]->gmap = i_alloc_1d(szm);
-    wincon[n]->tend3d = d_alloc_2d(window[n]->sze, TEND3D);
-    wincon[n]->tend2d = d_alloc_2d(window[n]->szeS, TEND2D);
     wincon[n]->tr_rk = d_alloc_2d(window[n]->szc, master->rkstage);
     wincon[n]->tr_gr = d_alloc_2d(window[n]->szc, master->rkstage);
     memset(wincon[n]->s1, 0, szm * sizeof(int));
@@ -7118,13 +7061,6 @@ win_priv_t **win_consts_init(master_t *master,    /* Master data     */
 #endif
     /* 2D work arrays                                                */
     winsize = window[n]->sgsizS = window[n]->enonS + 1;
-    wincon[n]->d1 = d_alloc_1d(szmS);
-    wincon[n]->d2 = d_alloc_1d(szmS);
-    wincon[n]->d3 = d_alloc_1d(szmS);
-    wincon[n]->d4 = d_alloc_1d(szmS);
-    wincon[n]->d5 = d_alloc_1d(szmS);
-    wincon[n]->d6 = d_alloc_1d(szmS);
-    wincon[n]->d7 = d_alloc_1d(szmS);
     wincon[n]->c2 = c_alloc_1d(szmS);
     if (master->thin_merge) {
       wincon[n]->kth_e1 = i_alloc_1d(szmS);
@@ -9169,6 +9105,12 @@ void win_geom_clear(geometry_t **window,  /* Window geometry         */
     i_free_1d(window[n]->m2se1);
     i_free_1d(window[n]->s2m);
     i_free_1d(window[n]->s2me1);
+    if (window[n]->p2sw) {
+      i_free_1d(window[n]->p2sw);
+      i_free_1d(window[n]->p2sc);
+      i_free_1d(window[n]->p2sw_e1);
+      i_free_1d(window[n]->p2se1);
+    }
     i_free_1d(window[n]->sur_t);
     i_free_1d(window[n]->nsur_t);
     i_free_1d(window[n]->bot_t);
@@ -9435,6 +9377,207 @@ window_t *win_data_alloc(void)
 /*-------------------------------------------------------------------*/
 
 
+/*-------------------------------------------------------------------*/
+/*-------------------------------------------------------------------*/
+/* Routine to list the arrays allocated for every window by          */
+/* win_data_init() (windat != NULL) and win_consts_init() (wincon    */
+/* != NULL). fn is called with the address of each array pointer,    */
+/* its type and dimensions (n2 rows of n1 values for WA_D2). The     */
+/* arrays are allocated from this list, and win_data_arrays()        */
+/* returns them for placement, so new arrays are added here.         */
+/*-------------------------------------------------------------------*/
+static void win_alloc_vars(geometry_t *window,  /* Window geometry    */
+			   window_t *windat,    /* Window data        */
+			   win_priv_t *wincon,  /* Window constants   */
+			   void (*fn)(void *a, int type, size_t n1, size_t n2,
+				      void *data),
+			   void *data           /* Passed to fn       */
+			   )
+{
+  size_t szc = window->szc, sze = window->sze, szv = window->szv;
+  size_t szcS = window->szcS, szeS = window->szeS;
+  size_t szm = window->szm, szmS = window->szmS;
+
+  if (windat != NULL) {
+    /* 3D cell centred                                               */
+    fn(&windat->tr_wc, WA_D2, szc, windat->ntr, data);
+    fn(&windat->w, WA_D1, szc, 1, data);
+    fn(&windat->Kz, WA_D1, szc, 1, data);
+    fn(&windat->Vz, WA_D1, szc, 1, data);
+    fn(&windat->dens, WA_D1, szc, 1, data);
+    fn(&windat->dens_0, WA_D1, szc, 1, data);
+    fn(&windat->waterss, WA_D1, szc, 1, data);
+    fn(&windat->nrvorc, WA_D1, szc, 1, data);
+    fn(&windat->kec, WA_D1, szc, 1, data);
+    fn(&windat->div, WA_D1, szc, 1, data);
+    fn(&windat->u, WA_D1, szc, 1, data);
+    fn(&windat->v, WA_D1, szc, 1, data);
+    /* 3D edges                                                      */
+    fn(&windat->u1, WA_D1, sze, 1, data);
+    fn(&windat->u2, WA_D1, sze, 1, data);
+    fn(&windat->dzu1, WA_D1, sze, 1, data);
+    fn(&windat->u1flux3d, WA_D1, sze, 1, data);
+    fn(&windat->u1b, WA_D1, sze, 1, data);
+    fn(&windat->u2b, WA_D1, sze, 1, data);
+    fn(&windat->nrvore, WA_D1, sze, 1, data);
+    fn(&windat->npvore, WA_D1, sze, 1, data);
+    /* 3D vertices                                                   */
+    fn(&windat->fv, WA_D1, szv, 1, data);
+    fn(&windat->circ, WA_D1, szv, 1, data);
+    fn(&windat->rvor, WA_D1, szv, 1, data);
+    fn(&windat->nrvor, WA_D1, szv, 1, data);
+    fn(&windat->npvor, WA_D1, szv, 1, data);
+    /* 2D cell centred                                               */
+    if (windat->ntrS)
+      fn(&windat->tr_wcS, WA_D2, szcS, windat->ntrS, data);
+    fn(&windat->eta, WA_D1, szcS, 1, data);
+    fn(&windat->topz, WA_D1, szcS, 1, data);
+    fn(&windat->wdiff2d, WA_D1, szcS, 1, data);
+    fn(&windat->detadt, WA_D1, szcS, 1, data);
+    fn(&windat->wtop, WA_D1, szcS, 1, data);
+    fn(&windat->wbot, WA_D1, szcS, 1, data);
+    fn(&windat->patm, WA_D1, szcS, 1, data);
+    fn(&windat->waterss2d, WA_D1, szcS, 1, data);
+    fn(&windat->etab, WA_D1, szcS, 1, data);
+    fn(&windat->uav, WA_D1, szcS, 1, data);
+    fn(&windat->vav, WA_D1, szcS, 1, data);
+    /* 2D edges                                                      */
+    fn(&windat->u1av, WA_D1, szeS, 1, data);
+    fn(&windat->u2av, WA_D1, szeS, 1, data);
+    fn(&windat->nu1av, WA_D1, szeS, 1, data);
+    fn(&windat->u1flux, WA_D1, szeS, 1, data);
+    fn(&windat->depth_e1, WA_D1, szeS, 1, data);
+    fn(&windat->u1bot, WA_D1, szeS, 1, data);
+    fn(&windat->wind1, WA_D1, szeS, 1, data);
+    fn(&windat->wind2, WA_D1, szeS, 1, data);
+    fn(&windat->windspeed, WA_D1, szeS, 1, data);
+    fn(&windat->winddir, WA_D1, szeS, 1, data);
+    fn(&windat->u1avb, WA_D1, szeS, 1, data);
+  }
+
+  if (wincon != NULL) {
+    /* 3D work arrays                                                */
+    fn(&wincon->w1, WA_D1, szm, 1, data);
+    fn(&wincon->w2, WA_D1, szm, 1, data);
+    fn(&wincon->w3, WA_D1, szm, 1, data);
+    fn(&wincon->w4, WA_D1, szm, 1, data);
+    fn(&wincon->w5, WA_D1, szm, 1, data);
+    fn(&wincon->w6, WA_D1, szm, 1, data);
+    fn(&wincon->w7, WA_D1, szm, 1, data);
+    fn(&wincon->w8, WA_D1, szm, 1, data);
+    fn(&wincon->w9, WA_D1, szm, 1, data);
+    fn(&wincon->w10, WA_D1, szm, 1, data);
+    fn(&wincon->tend3d, WA_D2, sze, TEND3D, data);
+    /* 2D work arrays                                                */
+    fn(&wincon->d1, WA_D1, szmS, 1, data);
+    fn(&wincon->d2, WA_D1, szmS, 1, data);
+    fn(&wincon->d3, WA_D1, szmS, 1, data);
+    fn(&wincon->d4, WA_D1, szmS, 1, data);
+    fn(&wincon->d5, WA_D1, szmS, 1, data);
+    fn(&wincon->d6, WA_D1, szmS, 1, data);
+    fn(&wincon->d7, WA_D1, szmS, 1, data);
+    fn(&wincon->tend2d, WA_D2, szeS, TEND2D, data);
+  }
+}
+
+/* END win_alloc_vars()                                              */
+/*-------------------------------------------------------------------*/
+
+
+/* Allocates an array listed by win_alloc_vars()                     */
+static void win_alloc_var(void *a, int type, size_t n1, size_t n2,
+			  void *data)
+{
+  if (type == WA_D2)
+    *(double ***)a = d_alloc_2d(n1, n2);
+  else
+    *(double **)a = d_alloc_1d(n1);
+}
+
+
+/*-------------------------------------------------------------------*/
+/*-------------------------------------------------------------------*/
+/* Routine to list the largest arrays of a window, i.e. the          */
+/* geometric maps and the arrays listed by win_alloc_vars(). The     */
+/* pages of these arrays are moved to the NUMA node of the thread    */
+/* stepping the window (see dp_pthreads.c). The start address and    */
+/* size in bytes of each array are returned in ptr and len, up to    */
+/* nmax arrays.                                                      */
+/*-------------------------------------------------------------------*/
+typedef struct {
+  void **ptr;                   /* Array start addresses             */
+  size_t *len;                  /* Array sizes (bytes)               */
+  int na;                       /* Number of arrays                  */
+  int nmax;                     /* Size of ptr and len               */
+} win_arrays_t;
+
+static void win_array_add(win_arrays_t *wa, void *p, size_t size)
+{
+  if (p == NULL || size == 0 || wa->na >= wa->nmax) return;
+  wa->ptr[wa->na] = p;
+  wa->len[wa->na] = size;
+  wa->na += 1;
+}
+
+/* Adds an array listed by win_alloc_vars()                          */
+static void win_array_var(void *a, int type, size_t n1, size_t n2,
+			  void *data)
+{
+  if (type == WA_D2) {
+    double **p = *(double ***)a;
+    if (p != NULL)
+      win_array_add((win_arrays_t *)data, p[0], n1 * n2 * sizeof(double));
+  } else
+    win_array_add((win_arrays_t *)data, *(double **)a, n1 * sizeof(double));
+}
+
+int win_data_arrays(geometry_t *window,  /* Window geometry          */
+		    window_t *windat,    /* Window data              */
+		    win_priv_t *wincon,  /* Window constants         */
+		    void **ptr,          /* Array start addresses    */
+		    size_t *len,         /* Array sizes (bytes)      */
+		    int nmax             /* Size of ptr and len      */
+		    )
+{
+  size_t szc = window->szc, sze = window->sze;
+  size_t szcS = window->szcS, szeS = window->szeS;
+  size_t npe = window->npem + 1;
+  size_t sd = sizeof(double), si = sizeof(int);
+  win_arrays_t wa;
+
+  wa.ptr = ptr;
+  wa.len = len;
+  wa.na = 0;
+  wa.nmax = nmax;
+
+  /* Geometry, allocated with the window maps (alloc_geom_us())      */
+  if (window->c2c) win_array_add(&wa, window->c2c[0], szc * npe * si);
+  if (window->c2e) win_array_add(&wa, window->c2e[0], szc * npe * si);
+  if (window->e2c) win_array_add(&wa, window->e2c[0], 2 * sze * si);
+  if (window->e2e) win_array_add(&wa, window->e2e[0], 2 * sze * si);
+  if (window->wAe) win_array_add(&wa, window->wAe[0],
+				 (window->neem + 1) * sze * sd);
+  win_array_add(&wa, window->m2d, szc * si);
+  win_array_add(&wa, window->zp1, szc * si);
+  win_array_add(&wa, window->zm1, szc * si);
+  win_array_add(&wa, window->m2de, sze * si);
+  win_array_add(&wa, window->zp1e, sze * si);
+  win_array_add(&wa, window->zm1e, sze * si);
+  win_array_add(&wa, window->cellarea, szcS * sd);
+  win_array_add(&wa, window->h1au1, szeS * sd);
+  win_array_add(&wa, window->h2au1, szeS * sd);
+
+  /* Window data and work arrays                                     */
+  win_alloc_vars(window, windat, wincon, win_array_var, &wa);
+
+  return(wa.na);
+}
+
+/* END win_data_arrays()                                             */
+/*-------------------------------------------------------------------*/
+
+
+
 /*-------------------------------------------------------------------*/
 /*-------------------------------------------------------------------*/
 /* Routine to generate auxiliary cell maps in directions that have   */
@@ -138,6 +138,7 @@ void tracer_step_window(master_t *master,
 			win_priv_t *wincon)
 {
 
+  PROF_BEGIN("tracer_step_window", window->wn);
   /*-----------------------------------------------------------------*/
   /* Refill variables required for FFSL                              */
   if (wincon->trasc & FFSL)
@@ -163,6 +164,7 @@ void tracer_step_window(master_t *master,
   /* Refill the master with tracer and density data from the         */
   /* window data structure.  */
   win_data_empty_3d(master, window, windat, TRACERS);
+  PROF_END;
 
 }
 
@@ -187,6 +189,7 @@ void tracer_step(master_t *master,    /* Master data                 */
   /* Solve the tracer equation in each window                        */
   for (nn = 1; nn <= nwindows; nn++) {
     n = wincon[1]->twin[nn];
+    if (!dp_is_local(n)) continue;
 
     /*---------------------------------------------------------------*/
     /* Set the lateral boundary conditions for tracers.              */
@@ -215,6 +218,7 @@ void tracer_step(master_t *master,    /* Master data                 */
   /* and the global array variable sums over windows (as is the case */
   /* with total mass), then the global sum only adds mass from one   */
   /* window. This seems to be an issue with the threading libraries. */
+  dp_exchange(TMASS);
   for (nn = 1; nn <= nwindows; nn++) {
     n = wincon[1]->twin[nn];
     win_data_empty_3d(master, window[n], windat[n], TMASS);
@@ -285,7 +289,10 @@ void tracer_step_3d(geometry_t *window, /* Window geometry           */
   } else if (wincon->trasc == LAGRANGE) {
      advect_diffuse_lag(window, windat, wincon);
   } else {
-    if ((windat->cc2 = advect_diffuse(window, windat, wincon))) return;
+    PROF_BEGIN("advect_diffuse", window->wn);
+    windat->cc2 = advect_diffuse(window, windat, wincon);
+    PROF_END;
+    if (windat->cc2) return;
   }
 
   TIMING_DUMP_WIN(2, "  advect_diffuse", window->wn);
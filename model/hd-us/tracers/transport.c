@@ -116,12 +116,7 @@ void transport_step(master_t *master, geometry_t **window,
 {
   geometry_t *geom = master->geom;
   int nwindows = master->nwindows;
-  geometry_t *tpg;
-  window_t *tpd;
-  win_priv_t *tpc;
-  int nn, n, s, nb;
-  int cc, c;
-  double clock = dp_clock();
+  int nn, n;
 
   if (master->tmode & NONE) return;
 
@@ -151,245 +146,282 @@ void transport_step(master_t *master, geometry_t **window,
   if (master->tmode & SP_DUMP) return;
 
   /*-----------------------------------------------------------------*/
-  /* Solve the tracer equation in each window                        */
-  for (nn = 1; nn <= nwindows; nn++) {
-    n = wincon[1]->twin[nn];
-
-    /*---------------------------------------------------------------*/
-    /* Set pointers                                                  */
-    tpg = window[n];
-    tpd = windat[n];
-    tpc = wincon[n];
-    wincon[n]->togn = master->togn;
-
-    /*---------------------------------------------------------------*/
-    /* Interpolate onto the target grid (master)                     */
-    memcpy(master->eta, tpd->eta, tpg->szcS * sizeof(double));
-    memcpy(master->Kz, tpd->Kz, tpg->sgsiz * sizeof(double));
+  /* Interpolate onto the target grid (master). The window arrays    */
+  /* only map directly onto the master for a single window.          */
+  if (nwindows == 1) {
+    n = wincon[1]->twin[1];
+    memcpy(master->eta, windat[n]->eta, window[n]->szcS * sizeof(double));
+    memcpy(master->Kz, windat[n]->Kz, window[n]->sgsiz * sizeof(double));
     /* Velocities are required for MONOTONIC global fills          */
     if (master->fillf & MONOTONIC || master->smagorinsky > 0.0) {
-      memcpy(master->u1, tpd->u1, tpg->sgsiz * sizeof(double));
+      memcpy(master->u1, windat[n]->u1, window[n]->sgsiz * sizeof(double));
     }
+  }
 
-    /*---------------------------------------------------------------*/
-    /* Fill 3D  velocities into the window data structures.          */
-    win_data_fill_3d(master, window[n], windat[n], master->nwindows);
-
-    /*---------------------------------------------------------------*/
-    /* Calculate a heat and salt flux if required                    */
-    calc_heatf(window[n], windat[n], wincon[n]);
-    calc_saltf(window[n], windat[n], wincon[n]);
-    
-    init_sigma(window[n], windat[n], wincon[n]);
-    trans_data_nan(window[n], windat[n], wincon[n]);
+  /*-----------------------------------------------------------------*/
+  /* Set up the transport step in each window. Invoke distributed    */
+  /* processing step.                                                */
+  dp_transport_step();
 
-    /* Calculate the 3D velocity alert diagnostics                   */
-    if (!(master->alertf & NONE)) {
-      vel2D_lbc(windat[n]->u1, window[n]->nbpte1, window[n]->nbe1,
-		window[n]->bpte1, window[n]->bine1, wincon[n]->slip);
-      alerts_w(window[n], VEL3D);
+  /*-----------------------------------------------------------------*/
+  /* Transfer the alert diagnostics to the master. This is done      */
+  /* non-threaded since the master maxima are accumulated over all   */
+  /* windows.                                                        */
+  if (!(master->alertf & NONE)) {
+    for (nn = 1; nn <= nwindows; nn++) {
+      n = wincon[1]->twin[nn];
+      master_alert_fill(master, window[n], windat[n]);
     }
+  }
+}
 
-    /*---------------------------------------------------------------*/
-    /* Read the boundary velocities from file for global fills if    */
-    /* required.                                                     */
-    if (master->tmode & DO_OBC) {
-      for (nb = 0; nb < window[n]->nobc; nb++)
-	reset_bdry_eta(window[n], windat[n], wincon[n], window[n]->open[nb], windat[n]->eta);
-      windat[n]->nu1 = wincon[n]->w9;
-      /* Transfer any custom data from the master to the slaves      */
-      bdry_transfer_u1(master, window[n], windat[n]);
-      memcpy(windat[n]->nu1, windat[n]->u1, window[n]->sgsiz * sizeof(double));
-      bdry_u1_3d(window[n], windat[n], wincon[n]);
-      memcpy(windat[n]->u1, windat[n]->nu1, window[n]->sgsiz * sizeof(double));
-    }
-    if (master->fillf & SET_BDRY) {
-      windat[n]->nu1 = wincon[n]->w9;
-      /* Transfer any custom data from the master to the slaves      */
-      bdry_transfer_u1(master, window[n], windat[n]);
-      memset(windat[n]->nu1, 0, window[n]->sgsiz * sizeof(double));
-      bdry_u1_3d(window[n], windat[n], wincon[n]);
-      memcpy(windat[n]->u1, windat[n]->nu1, window[n]->sgsiz * sizeof(double));
-    }
-    if (master->fillf & SET_BDRY_ETA) {
-      wincon[n]->neweta = wincon[n]->d4;
-      bdry_transfer_eta(master, window[n], windat[n]);
-      memset(wincon[n]->neweta, 0, window[n]->sgsizS * sizeof(double));
-      bdry_eta(window[n], windat[n], wincon[n]);
-      memcpy(windat[n]->eta, wincon[n]->neweta, window[n]->sgsizS * sizeof(double));
-    }
+/* END transport_step()                                              */
+/*-------------------------------------------------------------------*/
 
-    /*---------------------------------------------------------------*/
-    /* Set the cell centered velocities. Note: tangential velocity   */
-    /* is not read from file and must be computed.                   */
-    if (!(master->tmode & (GLOBAL|SP_SIMPLE)))
-      vel_cen(window[n], windat[n], wincon[n], windat[n]->u1, NULL,
-	      windat[n]->u, windat[n]->v, NULL, NULL, 0);
 
-    /*---------------------------------------------------------------*/
-    /* Set the lateral boundary conditions for tracers.  */
+/*-------------------------------------------------------------------*/
+/* Transport step for a single window. This is invoked via the       */
+/* distributed processing gateway dp_transport_step().               */
+/*-------------------------------------------------------------------*/
+void transport_step_window(master_t *master,   /* Master data        */
+			   geometry_t *window, /* Window geometry    */
+			   window_t *windat,   /* Window data        */
+			   win_priv_t *wincon  /* Window constants   */
+			   )
+{
+  geometry_t *tpg;
+  window_t *tpd;
+  win_priv_t *tpc;
+  int nb;
+  int cc, c;
+  double clock = dp_clock();
+
+  /*-----------------------------------------------------------------*/
+  /* Set pointers                                                    */
+  tpg = window;
+  tpd = windat;
+  tpc = wincon;
+  wincon->togn = master->togn;
+
+  /*-----------------------------------------------------------------*/
+  /* Fill 3D  velocities into the window data structures.            */
+  win_data_fill_3d(master, window, windat, master->nwindows);
+
+  /*-----------------------------------------------------------------*/
+  /* Calculate a heat and salt flux if required                      */
+  calc_heatf(window, windat, wincon);
+  calc_saltf(window, windat, wincon);
+  
+  init_sigma(window, windat, wincon);
+  trans_data_nan(window, windat, wincon);
+
+  /* Calculate the 3D velocity alert diagnostics                     */
+  if (!(master->alertf & NONE)) {
+    vel2D_lbc(windat->u1, window->nbpte1, window->nbe1,
+		window->bpte1, window->bine1, wincon->slip);
+    alerts_w(window, VEL3D);
+  }
+
+  /*-----------------------------------------------------------------*/
+  /* Read the boundary velocities from file for global fills if      */
+  /* required.                                                       */
+  if (master->tmode & DO_OBC) {
+    for (nb = 0; nb < window->nobc; nb++)
+	reset_bdry_eta(window, windat, wincon, window->open[nb], windat->eta);
+    windat->nu1 = wincon->w9;
+    /* Transfer any custom data from the master to the slaves        */
+    bdry_transfer_u1(master, window, windat);
+    memcpy(windat->nu1, windat->u1, window->sgsiz * sizeof(double));
+    bdry_u1_3d(window, windat, wincon);
+    memcpy(windat->u1, windat->nu1, window->sgsiz * sizeof(double));
+  }
+  if (master->fillf & SET_BDRY) {
+    windat->nu1 = wincon->w9;
+    /* Transfer any custom data from the master to the slaves        */
+    bdry_transfer_u1(master, window, windat);
+    memset(windat->nu1, 0, window->sgsiz * sizeof(double));
+    bdry_u1_3d(window, windat, wincon);
+    memcpy(windat->u1, windat->nu1, window->sgsiz * sizeof(double));
+  }
+  if (master->fillf & SET_BDRY_ETA) {
+    wincon->neweta = wincon->d4;
+    bdry_transfer_eta(master, window, windat);
+    memset(wincon->neweta, 0, window->sgsizS * sizeof(double));
+    bdry_eta(window, windat, wincon);
+    memcpy(windat->eta, wincon->neweta, window->sgsizS * sizeof(double));
+  }
+
+  /*-----------------------------------------------------------------*/
+  /* Set the cell centered velocities. Note: tangential velocity     */
+  /* is not read from file and must be computed.                     */
+  if (!(master->tmode & (GLOBAL|SP_SIMPLE)))
+    vel_cen(window, windat, wincon, windat->u1, NULL,
+	      windat->u, windat->v, NULL, NULL, 0);
+
+  /*-----------------------------------------------------------------*/
+  /* Set the lateral boundary conditions for tracers.  */
 #if !GLOB_BC
-    set_lateral_OBC_tr(window[n], windat[n]->ntr, windat[n]->tr_wc);
-    set_lateral_BC_tr(windat[n]->tr_wc, windat[n]->ntr, window[n]->nbpt,
-                      window[n]->bpt, window[n]->bin);
-    set_lateral_BC_vel(windat[n]->u1flux3d, window[n]->nbpt,
-                       window[n]->bpte1, window[n]->bine1);
+  set_lateral_OBC_tr(window, windat->ntr, windat->tr_wc);
+  set_lateral_BC_tr(windat->tr_wc, windat->ntr, window->nbpt,
+                    window->bpt, window->bin);
+  set_lateral_BC_vel(windat->u1flux3d, window->nbpt,
+                     window->bpte1, window->bine1);
 #endif
 
-    /*---------------------------------------------------------------*/
-    /* Set the vertical  mixing coefficients. This  is done  in this */
-    /* window loop so that transferred velocities from other windows */
-    /* can be used in the velocity shear term.                       */
-    if (wincon[n]->do_closure) {
-      density_w(window[n], windat[n], wincon[n]);
-      wincon[n]->calc_closure(window[n], windat[n], wincon[n]);
-      bdry_closure(window[n], windat[n], wincon[n]);
-    }
+  /*-----------------------------------------------------------------*/
+  /* Set the vertical  mixing coefficients. This  is done  in this   */
+  /* window loop so that transferred velocities from other windows   */
+  /* can be used in the velocity shear term.                         */
+  if (wincon->do_closure) {
+    density_w(window, windat, wincon);
+    wincon->calc_closure(window, windat, wincon);
+    bdry_closure(window, windat, wincon);
+  }
 
-    /*---------------------------------------------------------------*/
-    /* Get the surface boundary condition for vertical velocity.     */
-    if(wincon[n]->tgrid & (EXACT|INEXACT)) {
-      tpd->t = master->t;
-      tpd->dt = master->dt;
-      tpd->dtf = master->dtf;
-      tpd->dtb = master->dtb;
-      tpd->dttr = master->dttr;
-      tpd->rampval = master->rampval;
-      tpd->nstep = master->nstep;
-      /*tpd->etarlxtc = master->etarlxtc;*/
-      tpd->df_diagn_set = master->df_diagn_set;
-      if (!(master->tmode & SP_ORIGIN)) {
+  /*-----------------------------------------------------------------*/
+  /* Get the surface boundary condition for vertical velocity.       */
+  if(wincon->tgrid & (EXACT|INEXACT)) {
+    tpd->t = master->t;
+    tpd->dt = master->dt;
+    tpd->dtf = master->dtf;
+    tpd->dtb = master->dtb;
+    tpd->dttr = master->dttr;
+    tpd->rampval = master->rampval;
+    tpd->nstep = master->nstep;
+    /*tpd->etarlxtc = master->etarlxtc;*/
+    tpd->df_diagn_set = master->df_diagn_set;
+    if (!(master->tmode & SP_ORIGIN)) {
 	for (cc = 1; cc <= tpg->b2_t; cc++) {
 	  c = tpg->w2_t[cc];
 	  tpd->detadt[c] = (tpd->eta[c] - tpd->etab[c]) / tpd->dttr;	
 	}
 	vel_w_bounds(tpg, tpd, tpc);
 	memcpy(tpd->etab, tpd->eta, tpg->sgsizS * sizeof(double));
-      }
-    } else {
-      if (!(master->tmode & SP_ORIGIN)) {
-	for (cc = 1; cc <= window[n]->b2_t; cc++) {
-	  c = window[n]->w2_t[cc];
-	  windat[n]->detadt[c] = (windat[n]->eta[c] - windat[n]->etab[c]) / 
-	    windat[n]->dttr;
+    }
+  } else {
+    if (!(master->tmode & SP_ORIGIN)) {
+	for (cc = 1; cc <= window->b2_t; cc++) {
+	  c = window->w2_t[cc];
+	  windat->detadt[c] = (windat->eta[c] - windat->etab[c]) / 
+	    windat->dttr;
 	}
-	vel_w_bounds(window[n], windat[n], wincon[n]);
-	memcpy(windat[n]->etab, windat[n]->eta, 
-	       window[n]->sgsizS * sizeof(double));
-      }
+	vel_w_bounds(window, windat, wincon);
+	memcpy(windat->etab, windat->eta, 
+	       window->sgsizS * sizeof(double));
     }
+  }
 
-    /*---------------------------------------------------------------*/
-    /* When using the flux-form semi-lagrange scheme, the velocities */
-    /* must be set to zero on the first time step of the transport   */
-    /* model run. On the first time step, the transport model uses   */
-    /* the same value for the old elevation (oldeta) and the new     */
-    /* elevation (eta), so in effect the sea surface elevation does  */
-    /* not change on the first time step. The flux divergence        */
-    /* therefore also needs to be zero for the first time step only, */
-    /* which is achieved by setting u1, u2, w and volume fluxes = 0. */
-    if (wincon[n]->compatible & V7367 && (wincon[n]->trasc == FFSL) && (windat[n]->nstep == 0)) {
-      hd_warn("Setting initial velocity and volume fluxes to zero for FFSL advection scheme (t = %f)\n", windat[n]->t / 86400);
-      memset(windat[n]->u1, 0, window[n]->sze * sizeof(double));
-      memset(windat[n]->w, 0, window[n]->szc * sizeof(double));
-      memset(windat[n]->u1vm, 0, window[n]->sze * sizeof(double));
-      memset(windat[n]->u1flux3d, 0, window[n]->sze * sizeof(double));
-    }
+  /*-----------------------------------------------------------------*/
+  /* When using the flux-form semi-lagrange scheme, the velocities   */
+  /* must be set to zero on the first time step of the transport     */
+  /* model run. On the first time step, the transport model uses     */
+  /* the same value for the old elevation (oldeta) and the new       */
+  /* elevation (eta), so in effect the sea surface elevation does    */
+  /* not change on the first time step. The flux divergence          */
+  /* therefore also needs to be zero for the first time step only,   */
+  /* which is achieved by setting u1, u2, w and volume fluxes = 0.   */
+  if (wincon->compatible & V7367 && (wincon->trasc == FFSL) && (windat->nstep == 0)) {
+    hd_warn("Setting initial velocity and volume fluxes to zero for FFSL advection scheme (t = %f)\n", windat->t / 86400);
+    memset(windat->u1, 0, window->sze * sizeof(double));
+    memset(windat->w, 0, window->szc * sizeof(double));
+    memset(windat->u1vm, 0, window->sze * sizeof(double));
+    memset(windat->u1flux3d, 0, window->sze * sizeof(double));
+  }
 
-    /*---------------------------------------------------------------*/
-    /* Evalulate the sources and sinks of water                      */
-    /* If using the flux-form semi-lagrange advection scheme in the  */
-    /* transport model, don't call ss_water. The volume flux due to  */
-    /* the point source should have been stored (as a vertical       */
-    /* velocity) in wmean and transferred above to waterss.          */
-    if (wincon[n]->npss)
-      ss_water(window[n], windat[n], wincon[n]);
+  /*-----------------------------------------------------------------*/
+  /* Evalulate the sources and sinks of water                        */
+  /* If using the flux-form semi-lagrange advection scheme in the    */
+  /* transport model, don't call ss_water. The volume flux due to    */
+  /* the point source should have been stored (as a vertical         */
+  /* velocity) in wmean and transferred above to waterss.            */
+  if (wincon->npss)
+    ss_water(window, windat, wincon);
 
-    /*---------------------------------------------------------------*/
-    /* Get the cfl time-steps if required                            */
-    if (!(wincon[n]->cfl & NONE))
-    calc_cfl(window[n], windat[n], wincon[n]);
+  /*-----------------------------------------------------------------*/
+  /* Get the cfl time-steps if required                              */
+  if (!(wincon->cfl & NONE))
+  calc_cfl(window, windat, wincon);
 
-    /*---------------------------------------------------------------*/
-    /* Get the mean velocity and elevation if required               */
-    calc_means_t(window[n], windat[n], wincon[n]);
+  /*-----------------------------------------------------------------*/
+  /* Get the mean velocity and elevation if required                 */
+  calc_means_t(window, windat, wincon);
 
-    /*---------------------------------------------------------------*/
-    /* Increment the mean counter if required                        */
-    /* Reset occurs @ TS at the end of tracer_step_3d()              */
-    /*reset_means(window[n], windat[n], wincon[n], RESET);*/
-
-    /*-----------------------------------------------------------------*/
-    /* Get the initial total mass of tracer using cells to process and */
-    /* dz corresponding to the previous time-step.                     */
-    calc_volume(window[n], windat[n], wincon[n]);
-
-    /*-----------------------------------------------------------------*/
-    /* Fill options:                                                   */
-    /* keyword = GLOBAL, flag = GLOBAL; non-monotonic global fill      */
-    /* keyword = MONOTONIC, flag = MONOTONIC; monotonic global fill    */
-    /* keyword = OBC_ADJUST, flag |= OBC_ADJUST; adjust OBC fluxes for */
-    /*           global fills.                                         */
-    /* keyword = WEIGHTED, flag = WEIGHTED; monotonic global fill      */
-    /* keyword = DIAGNOSE, flag |= DIAGNOSE; print diagnostics to file */
-    /*           trans.ts                                              */
-    /* keyword = DIAGNOSE_BGC, flag |= DIAGNOSE_BGC; print diagnostics */
-    /*           to file trans.ts                                      */
-    if (!(wincon[n]->fillf & NONE))
-      global_fill(window[n], windat[n], wincon[n], NULL, -1, 0);
+  /*-----------------------------------------------------------------*/
+  /* Increment the mean counter if required                          */
+  /* Reset occurs @ TS at the end of tracer_step_3d()                */
+  /*reset_means(window, windat, wincon, RESET);*/
 
-    /*---------------------------------------------------------------*/
-    /* Set up non semi-lagrange advection schemes                    */
-    if (!(wincon[n]->trasc & LAGRANGE)) {
-      if (wincon[n]->conserve & CONS_MRG)
-	merge_volflux(window[n], windat[n], wincon[n]);
-
-      /* Set the vertical grid spacings at e1 and e2 faces.          */
-      set_dz_at_u1(window[n], windat[n], wincon[n]);
-      set_flux_3d(window[n], windat[n], wincon[n], VEL3D);
-
-      /* Compute eta based on depth averaged velocity divergence.    */
-      /* This corresponds to the end of the time-step.               */     
-      if (wincon[n]->conserve & CONS_ETA) {
-	if (wincon[n]->trasc == FFSL)
-	  check_tracer_eta(window[n], windat[n], wincon[n]);
+  /*-----------------------------------------------------------------*/
+  /* Get the initial total mass of tracer using cells to process and */
+  /* dz corresponding to the previous time-step.                     */
+  calc_volume(window, windat, wincon);
+
+  /*-----------------------------------------------------------------*/
+  /* Fill options:                                                   */
+  /* keyword = GLOBAL, flag = GLOBAL; non-monotonic global fill      */
+  /* keyword = MONOTONIC, flag = MONOTONIC; monotonic global fill    */
+  /* keyword = OBC_ADJUST, flag |= OBC_ADJUST; adjust OBC fluxes for */
+  /*           global fills.                                         */
+  /* keyword = WEIGHTED, flag = WEIGHTED; monotonic global fill      */
+  /* keyword = DIAGNOSE, flag |= DIAGNOSE; print diagnostics to file */
+  /*           trans.ts                                              */
+  /* keyword = DIAGNOSE_BGC, flag |= DIAGNOSE_BGC; print diagnostics */
+  /*           to file trans.ts                                      */
+  if (!(wincon->fillf & NONE))
+    global_fill(window, windat, wincon, NULL, -1, 0);
+
+  /*-----------------------------------------------------------------*/
+  /* Set up non semi-lagrange advection schemes                      */
+  if (!(wincon->trasc & LAGRANGE)) {
+    if (wincon->conserve & CONS_MRG)
+	merge_volflux(window, windat, wincon);
+
+    /* Set the vertical grid spacings at e1 and e2 faces.            */
+    set_dz_at_u1(window, windat, wincon);
+    set_flux_3d(window, windat, wincon, VEL3D);
+
+    /* Compute eta based on depth averaged velocity divergence.      */
+    /* This corresponds to the end of the time-step.               */     
+    if (wincon->conserve & CONS_ETA) {
+	if (wincon->trasc == FFSL)
+	  check_tracer_eta(window, windat, wincon);
 	else
-	  calc_tracer_eta(window[n], windat[n], wincon[n]);
-      }
-      /* Recompute the fluxes and velocity                           */
-      if (wincon[n]->conserve & CONS_SUB)
-	recalc_vel(window[n], windat[n], wincon[n]);
-
-      /* Compute the vertical velocity based on velocity divergence. */
-      /* This makes velocity and elevation dynamically consistent,   */
-      /* hence advection is conservative.                            */  
-      set_dz(window[n], windat[n], wincon[n]);
-      if (wincon[n]->conserve & CONS_W) {
-	if (wincon[n]->trasc == FFSL)
-	  ff_sl_w_update(window[n], windat[n], wincon[n]);
+	  calc_tracer_eta(window, windat, wincon);
+    }
+    /* Recompute the fluxes and velocity                             */
+    if (wincon->conserve & CONS_SUB)
+	recalc_vel(window, windat, wincon);
+
+    /* Compute the vertical velocity based on velocity divergence.   */
+    /* This makes velocity and elevation dynamically consistent,     */
+    /* hence advection is conservative.                            */  
+    set_dz(window, windat, wincon);
+    if (wincon->conserve & CONS_W) {
+	if (wincon->trasc == FFSL)
+	  ff_sl_w_update(window, windat, wincon);
 	else
-	  vel_w_update(window[n], windat[n], wincon[n]);
-      }
-    } else {
-      set_dz_at_u1(window[n], windat[n], wincon[n]);
-      /* Set up the cell centered surface vectors and dz arrays      */
-      set_dz(window[n], windat[n], wincon[n]);
-      /* Compute eta based on depth averaged velocity divergence.    */
-      /* This corresponds to the end of the time-step.               */     
-      if (wincon[n]->conserve & CONS_W) {
-	set_flux_3d(window[n], windat[n], wincon[n], VEL3D);
-	calc_tracer_eta(window[n], windat[n], wincon[n]);
-	vel_w_update(window[n], windat[n], wincon[n]);
-      }
-
-      /* Set the dz arrays for eta at t+1 (nsur_t)                   */
-      reset_dzt(window[n], windat[n], wincon[n]);
-      memcpy(wincon[n]->s1, wincon[n]->s2, window[n]->sgsiz * sizeof(int));
-      wincon[n]->vc = wincon[n]->vc2;
-      wincon[n]->vcs = wincon[n]->vcs2;
-      wincon[n]->vcs1 = wincon[n]->vca2;
-      wincon[n]->vc1 = wincon[n]->vci2;
-      if(wincon[n]->tgrid & (EXACT|INEXACT)) {
+	  vel_w_update(window, windat, wincon);
+    }
+  } else {
+    set_dz_at_u1(window, windat, wincon);
+    /* Set up the cell centered surface vectors and dz arrays        */
+    set_dz(window, windat, wincon);
+    /* Compute eta based on depth averaged velocity divergence.      */
+    /* This corresponds to the end of the time-step.               */     
+    if (wincon->conserve & CONS_W) {
+	set_flux_3d(window, windat, wincon, VEL3D);
+	calc_tracer_eta(window, windat, wincon);
+	vel_w_update(window, windat, wincon);
+    }
+
+    /* Set the dz arrays for eta at t+1 (nsur_t)                     */
+    reset_dzt(window, windat, wincon);
+    memcpy(wincon->s1, wincon->s2, window->sgsiz * sizeof(int));
+    wincon->vc = wincon->vc2;
+    wincon->vcs = wincon->vcs2;
+    wincon->vcs1 = wincon->vca2;
+    wincon->vc1 = wincon->vci2;
+    if(wincon->tgrid & (EXACT|INEXACT)) {
 	set_dz(tpg, tpd, tpc);
 	reset_dzt(tpg, tpd, tpc);
 	memcpy(tpc->s1, tpc->s2, tpg->sgsiz * sizeof(int));
@@ -397,41 +429,39 @@ void transport_step(master_t *master, geometry_t **window,
 	tpc->vcs = tpc->vcs2;
 	tpc->vcs1 = tpc->vca2;
 	tpc->vc1 = tpc->vci2;
-      }
     }
+  }
 
-    /*---------------------------------------------------------------*/
-    /* Get the Smagorinsky mixing if required                        */
-    if (wincon[n]->smagorinsky != 0.0) {
-      memcpy(windat[n]->u1b, windat[n]->u1, window[n]->sgsiz * sizeof(double));
-      wincon[n]->hor_mix->pre(window[n], windat[n], wincon[n]);
-      wincon[n]->hor_mix->setup(window[n], windat[n], wincon[n]);
-    }
+  /*-----------------------------------------------------------------*/
+  /* Get the Smagorinsky mixing if required                          */
+  if (wincon->smagorinsky != 0.0) {
+    memcpy(windat->u1b, windat->u1, window->sgsiz * sizeof(double));
+    wincon->hor_mix->pre(window, windat, wincon);
+    wincon->hor_mix->setup(window, windat, wincon);
+  }
 
-    /*---------------------------------------------------------------*/
-    /* Compute the tangential component of velocity                  */
-    vel_tan_3d(window[n], windat[n], wincon[n]);
+  /*-----------------------------------------------------------------*/
+  /* Compute the tangential component of velocity                    */
+  vel_tan_3d(window, windat, wincon);
 
-    /*---------------------------------------------------------------*/
-    /* Calculate the alert diagnostics if required                   */
-    if (wincon[n]->numbers & SPEED_2D || wincon[n]->means & VEL2D)
-      vint_3d(window[n], windat[n], wincon[n]);
-    if (!(master->alertf & NONE)) {
-      vint_3d(window[n], windat[n], wincon[n]);
-      alerts_w(window[n], VEL3D);
-      wincon[n]->neweta = windat[n]->eta;
-      alerts_w(window[n], VEL2D);
-      alerts_w(window[n], ETA_A);
-      alerts_w(window[n], WVEL);
-      alerts_w(window[n], TRACERS);
-      master_alert_fill(master, window[n], windat[n]);
-    }
-    windat[n]->wclk = (dp_clock() - clock);
-    debug_c(window[n], D_INIT, D_POST);
-  }
+  /*-----------------------------------------------------------------*/
+  /* Calculate the alert diagnostics if required                     */
+  if (wincon->numbers & SPEED_2D || wincon->means & VEL2D)
+    vint_3d(window, windat, wincon);
+  if (!(master->alertf & NONE)) {
+    vint_3d(window, windat, wincon);
+    alerts_w(window, VEL3D);
+    wincon->neweta = windat->eta;
+    alerts_w(window, VEL2D);
+    alerts_w(window, ETA_A);
+    alerts_w(window, WVEL);
+    alerts_w(window, TRACERS);
+  }
+  windat->wclk = (dp_clock() - clock);
+  debug_c(window, D_INIT, D_POST);
 }
 
-/* END transport_step()                                              */
+/* END transport_step_window()                                       */
 /*-------------------------------------------------------------------*/
 
 
@@ -5291,7 +5321,7 @@ double hd_trans_interp(geometry_t *window, GRID_SPECS **gs, double x, double y,
 
     x = (double)window->c2p[kd][window->m2d[co]];
     y = (double)window->c2p[k2][cs];
-    windat->d[k2]->vid = vid;
+    gs[k2]->d->vid = vid;
     v2 = grid_interp_on_point2(gs, kd, k2, x, y);
   } else {
     v2 = grid_interp_on_point(gs[k2], x, y);
@@ -5325,7 +5355,7 @@ double hd_trans_interp(geometry_t *window, GRID_SPECS **gs, double x, double y,
     if (osl & (L_BILIN|L_BAYLIN)) {
       x = (double)window->c2p[kd][window->m2d[co]];
       y = (double)window->c2p[k1][cs];
-      windat->d[k1]->vid = vid;
+      gs[k1]->d->vid = vid;
       v1 = grid_interp_on_point2(gs, kd, k1, x, y);
     } else {
       delaunay* d = gs[k1]->d;
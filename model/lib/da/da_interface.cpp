@@ -54,6 +54,19 @@ void *da_create_object(double da_ls)
 }
 
 
+/** Selects the local analysis
+ * @param daobj da_obj pointer
+ * @param radius radius, in degrees, of observations used to update
+ * each water column. Zero selects the global analysis
+ * @param nthreads number of threads to share the columns between
+ */
+extern "C"
+void da_set_local(void *daobj, double radius, int nthreads)
+{
+  ((da_obj*)daobj)->set_local(radius, nthreads);
+}
+
+
 /** Destructor
  * Deletes memory associated with the da_obj object
  */
@@ -108,6 +121,34 @@ void da_fill_A_col(void *daobj, int col, double *vals)
 }
 
  
+/** Maps A from an anomaly store, in place of da_allocA and filling
+ * @param daobj da_obj pointer
+ * @param fname name of the anomaly store
+ * @param nrows number of states x number of cells
+ * @param key description of the inputs, a store built from other
+ *            inputs is rejected
+ * @return non-zero if the store is missing or does not match
+ */
+extern "C"
+int da_map_A(void *daobj, const char *fname, int nrows, const char *key)
+{
+  return( ((da_obj*)daobj)->mapA(fname, nrows, key) );
+}
+
+
+/** Writes A to an anomaly store for later use with da_map_A
+ * @param daobj da_obj pointer
+ * @param fname name of the anomaly store
+ * @param key description of the inputs, as given to da_map_A
+ * @return non-zero exit status on error
+ */
+extern "C"
+int da_store_A(void *daobj, const char *fname, const char *key)
+{
+  return( ((da_obj*)daobj)->storeA(fname, key) );
+}
+
+
 /** Checks A to make sure there is valid data throughout - useful for
  * debugging
  * @param daobj da_obj pointer
@@ -28,6 +28,7 @@
  */
 #include <list>
 #include <vector>
+#include <algorithm>
 #include <iterator>
 #include <string>
 using namespace std;
@@ -45,16 +46,55 @@ using namespace std;
 #include <gsl/gsl_blas.h>
 #include <gsl/gsl_linalg.h>
 #include <gsl/gsl_math.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "ems.h"
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
 #include "da_utils.hpp"
 #include "da_obj.hpp"
 
+/*
+ * Anomaly store file header. The members follow as contiguous
+ * columns of nrows doubles, i.e. A in column-major order. The key
+ * is a hash of the caller's description of the inputs the store was
+ * built from.
+ */
+#define DA_STORE_MAGIC "daanom2"
+typedef struct {
+  char magic[8];
+  int64_t nrows;
+  int64_t nmem;
+  uint64_t key;
+  char pad[32];
+} da_store_header;
+
+/*
+ * 64 bit FNV-1a hash of the store key
+ */
+static uint64_t da_store_key(const char *key)
+{
+  uint64_t h = 14695981039346656037ULL;
+
+  while (key != NULL && *key) {
+    h ^= (unsigned char)*key++;
+    h *= 1099511628211ULL;
+  }
+  return(h);
+}
+
 /**
  * Constructor
  */
 da_obj::da_obj(double ls)
 {
   f_A    = NULL;
+  f_Amap = NULL;
+  f_Amapsize = 0;
   f_R    = NULL;
   f_HA   = NULL;
   f_K    = NULL;
@@ -70,6 +110,8 @@ da_obj::da_obj(double ls)
   f_full_wo_err = NULL;
   
   f_ls = ls;
+  f_lr = 0.0;
+  f_nthreads = 1;
 }
 
 
@@ -80,7 +122,9 @@ da_obj::~da_obj(void)
 {
   int i;
 
-  if (f_A != NULL)
+  if (f_Amap != NULL)
+    munmap(f_Amap, f_Amapsize);
+  else if (f_A != NULL)
     gsl_matrix_free(f_A);
 
   if (f_R != NULL)
@@ -129,14 +173,16 @@ da_obj::~da_obj(void)
 
 
 /**
- * Allocates the A matrix and sets all values to NaN
+ * Allocates the A matrix and sets all values to NaN. A is held one
+ * member per row of f_A (the transpose of A) so that it has the same
+ * layout as the anomaly store
  * @param nrows number of rows
  * @param ncols number of columns
  * @return 0 on success, 1 failure
  */
 int da_obj::allocA(int nrows, int ncols)
 {
-  f_A = gsl_matrix_alloc((size_t)nrows, (size_t)ncols);
+  f_A = gsl_matrix_alloc((size_t)ncols, (size_t)nrows);
   
   if (f_A == NULL)
     return(1);
@@ -174,7 +220,9 @@ int da_obj::get_state_offset(char *ref_var)
  */
 void da_obj::fillA(int row, int col, double val)
 {
-  gsl_matrix_set(f_A, (size_t)row, (size_t)col, val);
+  if (f_Amap != NULL)
+    quit("DA: A is mapped read only from an anomaly store\n");
+  gsl_matrix_set(f_A, (size_t)col, (size_t)row, val);
 }
 
 /**
@@ -183,8 +231,10 @@ void da_obj::fillA(int row, int col, double val)
 void da_obj::fillA(int col, double *vals)
 {
   size_t r;
-  for (r=0; r<f_A->size1; r++)
-    gsl_matrix_set(f_A, r, (size_t)col, vals[r]);
+  if (f_Amap != NULL)
+    quit("DA: A is mapped read only from an anomaly store\n");
+  for (r=0; r<nrowsA(); r++)
+    gsl_matrix_set(f_A, (size_t)col, r, vals[r]);
 }
 
 /**
@@ -195,9 +245,9 @@ void da_obj::fillA(int col, double *vals)
 int da_obj::checkA(void)
 {
   int r,c;
-  for (r=0; r<f_A->size1; r++) {
-    for (c=0; c<f_A->size2; c++) {
-      double val = gsl_matrix_get(f_A, (size_t)r, (size_t)c);
+  for (c=0; c<nmemA(); c++) {
+    for (r=0; r<nrowsA(); r++) {
+      double val = gsl_matrix_get(f_A, (size_t)c, (size_t)r);
       if (isnan(val) || val == DA_INVALID_VAL)
 	return(0);
     }
@@ -233,7 +283,94 @@ void da_obj::dumpMatrix(const char *fname, const gsl_matrix *M)
  */
 void da_obj::writeA(const char *fname)
 {
-  dumpMatrix(fname, f_A);
+  gsl_matrix *A = gsl_matrix_alloc(nrowsA(), nmemA());
+  gsl_matrix_transpose_memcpy(A, f_A);
+  dumpMatrix(fname, A);
+  gsl_matrix_free(A);
+}
+
+
+/**
+ * Maps A from an anomaly store written by storeA. Nothing is read
+ * here; members are paged in as the analysis touches them, so
+ * ensembles larger than memory can be used.
+ * @param fname name of the anomaly store
+ * @param nrows expected number of rows of A
+ * @param key description of the inputs A is built from
+ * @return 0 on success, 1 if the store is missing or does not match
+ */
+int da_obj::mapA(const char *fname, int nrows, const char *key)
+{
+  da_store_header hdr;
+  struct stat st;
+  void *map;
+  int fd;
+
+  if ((fd = open(fname, O_RDONLY)) < 0)
+    return(1);
+  if (fstat(fd, &st) || read(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+      memcmp(hdr.magic, DA_STORE_MAGIC, sizeof(hdr.magic)) != 0 || hdr.nrows != nrows ||
+      hdr.key != da_store_key(key) || hdr.nmem < 2 || (size_t)st.st_size !=
+      sizeof(hdr) + (size_t)hdr.nrows * hdr.nmem * sizeof(double)) {
+    close(fd);
+    return(1);
+  }
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return(1);
+
+  if (f_Amap != NULL)
+    munmap(f_Amap, f_Amapsize);
+  else if (f_A != NULL)
+    gsl_matrix_free(f_A);
+
+  f_Amap = map;
+  f_Amapsize = st.st_size;
+  f_Aview = gsl_matrix_view_array((double *)((char *)map + sizeof(hdr)),
+				  hdr.nmem, hdr.nrows);
+  f_A = &f_Aview.matrix;
+
+  return(0);
+}
+
+
+/**
+ * Writes A to an anomaly store for later use with mapA. The store is
+ * written to a temporary file and renamed so a concurrent run never
+ * maps a partial store.
+ * @param fname name of the anomaly store
+ * @param key description of the inputs A was built from
+ * @return 0 on success, 1 failure
+ */
+int da_obj::storeA(const char *fname, const char *key)
+{
+  da_store_header hdr;
+  string tmp = string(fname) + ".tmp";
+  size_t c;
+  FILE *F;
+
+  if (f_A == NULL || f_Amap != NULL)
+    return(1);
+
+  memset(&hdr, 0, sizeof(hdr));
+  strcpy(hdr.magic, DA_STORE_MAGIC);
+  hdr.nrows = nrowsA();
+  hdr.nmem  = nmemA();
+  hdr.key   = da_store_key(key);
+
+  if ((F = fopen(tmp.c_str(), "wb")) == NULL)
+    return(1);
+  fwrite(&hdr, sizeof(hdr), 1, F);
+  for (c=0; c<nmemA(); c++)
+    fwrite(gsl_matrix_const_ptr(f_A, c, 0), sizeof(double), nrowsA(), F);
+  if (fclose(F) || rename(tmp.c_str(), fname)) {
+    unlink(tmp.c_str());
+    return(1);
+  }
+
+  return(0);
 }
 
 /**
@@ -297,7 +434,7 @@ void da_obj::constructR(void)
 void da_obj::constructHA_Hwb(void)
 {
   size_t nobs     = f_obs_exec.size();
-  size_t nmembers = f_A->size2;
+  size_t nmembers = nmemA();
   list <da_obs_exec>::iterator obs;
   int r = 0;
 
@@ -331,12 +468,12 @@ void da_obj::constructHA_Hwb(void)
     int row = (*obs).f_gs;
 
     /* Quick check */
-    if (row >= f_A->size1)
+    if (row >= nrowsA())
       quit("Invalid row observation calculation\n");
     
     /* Go ahead and assign */
     {
-      gsl_vector_const_view rowH = gsl_matrix_const_row(f_A, row);
+      gsl_vector_const_view rowH = gsl_matrix_const_column(f_A, row);
       gsl_matrix_set_row(f_HA, r, &rowH.vector);
       gsl_vector_set(f_Hwb, r, gsl_vector_get(f_wb, row));
     }
@@ -525,8 +662,8 @@ void da_obj::constructK(void)
   constructHA_Hwb();
   
   /* Get some sizes */
-  rowsA  = f_A->size1;
-  nmem   = f_A->size2;
+  rowsA  = nrowsA();
+  nmem   = nmemA();
   nobs   = f_HA->size1;
   i_nmem = 1.0 / (nmem-1);
 
@@ -547,7 +684,7 @@ void da_obj::constructK(void)
     quit("Error creating intermediate AHA matrix\n");
 
   /* AHA */
-  ret = gsl_blas_dgemm(CblasNoTrans, CblasTrans, 1.0, f_A, f_HA, 0.0, AHA);
+  ret = gsl_blas_dgemm(CblasTrans, CblasTrans, 1.0, f_A, f_HA, 0.0, AHA);
 
   /* Modify AHA for localisation, if using */
   //  dumpMatrix("aha_before.txt", AHA);
@@ -678,7 +815,7 @@ void da_obj::construct_full_wo_err(void)
  */
 void da_obj::set_wb(int index, double data)
 {
-  size_t len = f_A->size1;
+  size_t len = nrowsA();
   
   /* Only need to allocate once */
   if (f_wb == NULL) {
@@ -699,7 +836,7 @@ void da_obj::set_wb(int index, double data)
  */
 void da_obj::set_xy(int index, double x, double y)
 {
-  size_t len = f_A->size1;
+  size_t len = nrowsA();
   
   /* Only need to allocate once */
   if (f_x == NULL) {
@@ -732,11 +869,17 @@ void da_obj::do_analysis(void)
   list <da_obs_exec>::iterator fin = f_obs_exec.end();
   gsl_vector *wo_minus_Hwb;
 
+  /* Local analysis builds no global K */
+  if (f_lr > 0.0) {
+    do_local_analysis();
+    return;
+  }
+
   /* Need K and the observations vector to proceed */
   constructK();
   constructWo();
 
-  len  = f_A->size1;
+  len  = nrowsA();
   nobs = f_K->size2;
   
   /* Allocate vectors, if needed */
@@ -771,12 +914,248 @@ void da_obj::do_analysis(void)
 }
 
 
+/**
+ * Selects the local analysis. Each block of the state vector is
+ * updated using only the observations within radius of it, so the
+ * cost scales with the local rather than the global number of
+ * observations.
+ * @param radius observation search radius in degrees; 0 reverts to
+ * the global analysis
+ * @param nthreads number of threads to analyse blocks with
+ */
+void da_obj::set_local(double radius, int nthreads)
+{
+  f_lr = radius;
+  f_nthreads = (nthreads > 1) ? nthreads : 1;
+}
+
+
+/**
+ * Groups the rows of the state vector by location. All states and
+ * layers of a water column share the same observations and
+ * localisation factors so they are analysed as one block.
+ */
+void da_obj::constructBlocks(void)
+{
+  map< pair<double,double>, size_t > loc;
+  map< pair<double,double>, size_t >::iterator pos;
+  size_t r, len = nrowsA();
+
+  if (f_x == NULL)
+    quit("Locations have not been set for the local analysis\n");
+
+  f_blocks.clear();
+  for (r=0; r<len; r++) {
+    pair<double,double> xy(gsl_vector_get(f_x, r), gsl_vector_get(f_y, r));
+    if ( (pos = loc.find(xy)) == loc.end() ) {
+      loc[xy] = f_blocks.size();
+      f_blocks.push_back(vector<size_t>(1, r));
+    } else
+      f_blocks[pos->second].push_back(r);
+  }
+}
+
+
+/**
+ * Local analysis for block b of the state vector
+ *
+ *    wa = wb + (1/n-1)*A(lf.HAl)' * z
+ *    z  = ((1/n-1)(HAl)(HAl)' + Rl) \ (wol - Hwbl)
+ *
+ * where l denotes the observations within f_lr of the block and lf
+ * the localisation factor of applyLocalisaton. z is found with a
+ * Cholesky solve, the inverse is never formed. If every observation
+ * is within f_lr this reproduces the global analysis.
+ */
+void da_obj::local_analysis_block(size_t b)
+{
+  vector<size_t> &rows = f_blocks[b];
+  size_t nmem = nmemA();
+  double i_nmem = 1.0 / (nmem-1);
+  double x = gsl_vector_get(f_x, rows[0]);
+  double y = gsl_vector_get(f_y, rows[0]);
+  long bx = (long)floor(x / f_lr);
+  long by = (long)floor(y / f_lr);
+  map< pair<long,long>, vector<size_t> >::const_iterator pos;
+  vector<size_t> near, obs;
+  vector<double> lf;
+  gsl_matrix *HAl, *P;
+  gsl_vector *z, *v;
+  size_t i, j, nl;
+  long di, dj;
+
+  /* Observations in range can only be in the surrounding bins. These
+     are taken in observation order, as in the global analysis */
+  for (di=-1; di<=1; di++)
+    for (dj=-1; dj<=1; dj++)
+      if ( (pos = f_obins.find(make_pair(bx+di, by+dj))) != f_obins.end() )
+	near.insert(near.end(), pos->second.begin(), pos->second.end());
+  sort(near.begin(), near.end());
+
+  /* Find the observations in range */
+  for (i=0; i<near.size(); i++) {
+    double dist;
+    j = near[i];
+    dist = gsl_hypot(x - f_ox[j], y - f_oy[j]);
+    if (dist <= f_lr) {
+      obs.push_back(j);
+      lf.push_back(f_ls ? 1.0 / (1 + 0.5* gsl_pow_2(dist / f_ls)) : 1.0);
+    }
+  }
+
+  /* No observations, no increment */
+  nl = obs.size();
+  if (nl == 0) {
+    for (i=0; i<rows.size(); i++)
+      gsl_vector_set(f_wa, rows[i], gsl_vector_get(f_wb, rows[i]));
+    return;
+  }
+
+  HAl = gsl_matrix_alloc(nl, nmem);
+  P   = gsl_matrix_alloc(nl, nl);
+  z   = gsl_vector_alloc(nl);
+  v   = gsl_vector_alloc(nmem);
+  if (HAl == NULL || P == NULL || z == NULL || v == NULL)
+    quit("Unable to allocate local analysis matrices\n");
+
+  for (j=0; j<nl; j++) {
+    gsl_vector_const_view rowH = gsl_matrix_const_row(f_HA, obs[j]);
+    gsl_matrix_set_row(HAl, j, &rowH.vector);
+    gsl_vector_set(z, j, f_d[obs[j]]);
+  }
+
+  /* P = (1/n-1)(HAl)(HAl)' + Rl */
+  gsl_blas_dsyrk(CblasLower, CblasNoTrans, i_nmem, HAl, 0.0, P);
+  for (j=0; j<nl; j++) {
+    *gsl_matrix_ptr(P, j, j) += f_err[obs[j]];
+    for (i=0; i<j; i++)
+      gsl_matrix_set(P, i, j, gsl_matrix_get(P, j, i));
+  }
+
+  /* z = P \ d */
+  gsl_linalg_cholesky_decomp(P);
+  gsl_linalg_cholesky_svx(P, z);
+
+  /* v = (1/n-1)(lf.HAl)' z */
+  for (j=0; j<nl; j++)
+    *gsl_vector_ptr(z, j) *= lf[j];
+  gsl_blas_dgemv(CblasTrans, i_nmem, HAl, z, 0.0, v);
+
+  /* wa = wb + Av for each row of the block */
+  for (i=0; i<rows.size(); i++) {
+    gsl_vector_const_view rowA = gsl_matrix_const_column(f_A, rows[i]);
+    double inc;
+    gsl_blas_ddot(&rowA.vector, v, &inc);
+    gsl_vector_set(f_wa, rows[i], gsl_vector_get(f_wb, rows[i]) + inc);
+  }
+
+  gsl_matrix_free(HAl);
+  gsl_matrix_free(P);
+  gsl_vector_free(z);
+  gsl_vector_free(v);
+}
+
+
+#ifdef HAVE_PTHREADS
+/*
+ * Shared state for the local analysis threads. Blocks are handed out
+ * in order from a counter so threads stay busy however unevenly the
+ * observations are spread.
+ */
+typedef struct {
+  da_obj *obj;
+  size_t nblocks;
+  size_t next;
+  pthread_mutex_t lock;
+} da_local_work;
+
+static void *local_analysis_thread(void *arg)
+{
+  da_local_work *w = (da_local_work *)arg;
+
+  while (1) {
+    size_t b;
+    pthread_mutex_lock(&w->lock);
+    b = w->next++;
+    pthread_mutex_unlock(&w->lock);
+    if (b >= w->nblocks)
+      break;
+    w->obj->local_analysis_block(b);
+  }
+  return(NULL);
+}
+#endif
+
+
+/**
+ * Calculate the analysis field block by block using only nearby
+ * observations
+ */
+void da_obj::do_local_analysis(void)
+{
+  size_t len = nrowsA();
+  size_t nobs, b, j = 0;
+  list <da_obs_exec>::iterator obs;
+
+  /* Only the diagonal of R is used, so it is not formed here */
+  constructHA_Hwb();
+  constructWo();
+  constructBlocks();
+
+  /* Observation data in array form for the blocks */
+  nobs = f_obs_exec.size();
+  f_d.resize(nobs);
+  f_err.resize(nobs);
+  f_ox.resize(nobs);
+  f_oy.resize(nobs);
+  f_obins.clear();
+  for (obs = f_obs_exec.begin(); obs != f_obs_exec.end(); obs++, j++) {
+    f_d[j]   = (*obs).f_val - gsl_vector_get(f_Hwb, j);
+    f_err[j] = (*obs).f_err;
+    f_ox[j]  = (*obs).f_x;
+    f_oy[j]  = (*obs).f_y;
+    f_obins[make_pair((long)floor(f_ox[j] / f_lr),
+		      (long)floor(f_oy[j] / f_lr))].push_back(j);
+  }
+
+  /* Allocate vectors, if needed */
+  if (f_wa == NULL) {
+    f_wa = gsl_vector_calloc(len);
+    if (f_wa == NULL)
+      quit("Unable to allocate analysis vector\n");
+  }
+
+#ifdef HAVE_PTHREADS
+  if (f_nthreads > 1) {
+    vector<pthread_t> threads(f_nthreads);
+    da_local_work w;
+    int n;
+
+    w.obj = this;
+    w.nblocks = f_blocks.size();
+    w.next = 0;
+    pthread_mutex_init(&w.lock, NULL);
+    for (n=0; n<f_nthreads; n++)
+      if (pthread_create(&threads[n], NULL, local_analysis_thread, &w))
+	quit("Unable to create local analysis thread\n");
+    for (n=0; n<f_nthreads; n++)
+      pthread_join(threads[n], NULL);
+    pthread_mutex_destroy(&w.lock);
+    return;
+  }
+#endif
+
+  for (b=0; b<f_blocks.size(); b++)
+    local_analysis_block(b);
+}
+
+
 /** Copies background into analysis
  *
  */
 void da_obj::copy_wb_wa(void)
 {
-  int len = f_A->size1;
+  int len = nrowsA();
   /* Allocate vectors, if needed */
   if (f_wa == NULL) {
     f_wa = gsl_vector_calloc(len);
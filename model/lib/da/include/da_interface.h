@@ -23,10 +23,13 @@
 void da_warn_on_quit(void);
 void *da_create_object(double da_ls);
 void da_destroy_object(void *obj);
+void da_set_local(void *daobj, double radius, int nthreads);
 int da_allocA(void *daobj, int nrows, int ncols);
 void da_fill_A(void *daobj, int row, int col, double val);
 void da_fill_A_col(void *daobj, int col, double *vals);
 int da_check_A(void *daobj);
+int da_map_A(void *daobj, const char *fname, int nrows, const char *key);
+int da_store_A(void *daobj, const char *fname, const char *key);
 void da_writeA(void *daobj, const char *fname);
 void da_create_maps(void *daobj, double **gx, double **gy, double *gz,
  		                                         int nx, int ny, int nz);
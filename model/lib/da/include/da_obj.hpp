@@ -41,6 +41,8 @@ class da_obj
   void fillA(int col, double *vals);
   int checkA(void);
   void writeA(const char *fname);
+  int mapA(const char *fname, int nrows, const char *key);
+  int storeA(const char *fname, const char *key);
   void dumpMatrix(const char *fname, const gsl_matrix *M);
   void add_obs(da_obs *obs);
 
@@ -100,6 +102,12 @@ class da_obj
   /* Calculate and apply the localisation factor */
   void applyLocalisaton(gsl_matrix *AHA);
 
+  /* Switch to the local analysis */
+  void set_local(double radius, int nthreads);
+
+  /* Local analysis of one block of the state vector */
+  void local_analysis_block(size_t b);
+
   /* For when there are no observations */
   void copy_wb_wa(void);
 
@@ -110,10 +118,49 @@ private:
   double f_ls;
 
   /**
-   * Holds the anomaly field
+   * Radius, in degrees, of observations used in the local
+   * analysis. Zero means the global analysis
+   */
+  double f_lr;
+
+  /**
+   * Number of threads for the local analysis
+   */
+  int f_nthreads;
+
+  /**
+   * Rows of the state vector sharing a location; these are
+   * analysed together in the local analysis
+   */
+  vector< vector<size_t> > f_blocks;
+
+  /**
+   * Innovations (wo - Hwb), error variances and locations of the
+   * observations for the local analysis
+   */
+  vector<double> f_d;
+  vector<double> f_err;
+  vector<double> f_ox;
+  vector<double> f_oy;
+
+  /**
+   * Observations binned on a grid of spacing f_lr, so a block only
+   * searches the bins around it
+   */
+  map< pair<long,long>, vector<size_t> > f_obins;
+
+  /**
+   * Holds the anomaly field, one member per row
    */
   gsl_matrix *f_A;
 
+  /**
+   * Mapping of the anomaly store, if A came from one
+   */
+  void *f_Amap;
+  size_t f_Amapsize;
+  gsl_matrix_view f_Aview;
+
   /**
    * Error covariance matrix
    */
@@ -190,7 +237,15 @@ private:
   /*
    * METHODS
    */
+  inline size_t nrowsA(void) {
+    return(f_A->size2);
+  }
+  inline size_t nmemA(void) {
+    return(f_A->size1);
+  }
   void constructK(void);
+  void constructBlocks(void);
+  void do_local_analysis(void);
   void constructHA_Hwb(void);
   void constructR(void);
   void constructWo(void);
@@ -180,7 +180,7 @@ eprocess_entry eprocesslist[] = {
     {"moldiff", PT_GEN, 0, 0, moldiff_init, NULL, moldiff_destroy, moldiff_precalc, NULL, NULL},
     {"nitrification_denitrification_sed", PT_SED, 0, 0, nitrification_denitrification_sed_init, nitrification_denitrification_sed_postinit, nitrification_denitrification_sed_destroy, nitrification_denitrification_sed_precalc, nitrification_denitrification_sed_calc, nitrification_denitrification_sed_postcalc},
     {"nitrification_denitrification_anammox", PT_GEN, 0, 0, nitrification_denitrification_anammox_init, nitrification_denitrification_anammox_postinit, nitrification_denitrification_anammox_destroy, nitrification_denitrification_anammox_precalc, nitrification_denitrification_anammox_calc, nitrification_denitrification_anammox_postcalc},
-    {"nitrification_wc", PT_WC, 0, 0, nitrification_wc_init, NULL, nitrification_wc_destroy, nitrification_wc_precalc, nitrification_wc_calc, nitrification_wc_postcalc},
+    {"nitrification_wc", PT_WC, 0, 0, nitrification_wc_init, NULL, nitrification_wc_destroy, nitrification_wc_precalc, nitrification_wc_calc, nitrification_wc_postcalc, nitrification_wc_calc_batch},
     {"nodularia_grow_wc", PT_WC, 0, 0, nodularia_grow_wc_init, nodularia_grow_wc_postinit, nodularia_grow_wc_destroy, nodularia_grow_wc_precalc, nodularia_grow_wc_calc, nodularia_grow_wc_postcalc},
     {"nodularia_mortality_wc", PT_WC, 0, 0, nodularia_mortality_wc_init, NULL, nodularia_mortality_wc_destroy, nodularia_mortality_wc_precalc, nodularia_mortality_wc_calc, nodularia_mortality_wc_postcalc},
     {"nodularia_mortality_sed", PT_SED, 0, 0, nodularia_mortality_sed_init, nodularia_mortality_sed_postinit, nodularia_mortality_sed_destroy, nodularia_mortality_sed_precalc, nodularia_mortality_sed_calc, nodularia_mortality_sed_postcalc},
@@ -177,6 +177,53 @@ cell* cell_create(column* col, CELLTYPE ct, int k, int k_wc, int k_sed)
   return c;
 }
 
+/** Updates a cell for a new step after its column has been remapped
+ * to the host model with no change in topology. Cell thicknesses and
+ * porosity are refreshed and the common variables are reset.
+ *
+ * @param c Pointer to cell
+ */
+void cell_update(cell* c)
+{
+  ecology* e = c->e;
+  column* col = c->col;
+  int i;
+
+  for (i = 0; i < c->ncv; ++i)
+    c->cv[i] = NaN;         /* must be initialized by some process */
+
+  if (c->type == CT_WC) {
+    c->dz_wc = col->dz_wc[c->k_wc];
+  } else if (c->type == CT_SED) {
+    c->dz_sed = col->dz_sed[c->k_sed];
+    c->porosity = col->porosity[c->k_sed];
+  } else {                    /* CT_EPI */
+    cell* child;
+
+    c->dz_wc = col->dz_wc[c->k_wc];
+    c->dz_sed = col->dz_sed[c->k_sed];
+    c->porosity = col->porosity[col->topk_sed];
+    if (e->use_multi_sed) {
+      int kk;
+      for (kk = col->topk_sed; kk >= col->botk_sed; --kk) {
+	c->dz_multi_sed[kk] = col->dz_sed[kk];
+	c->porosity_multi_sed[kk] = col->porosity[kk];
+      }
+    }
+
+    child = c->wcchild;
+    child->dz_wc = c->dz_wc;
+    child = c->sedchild;
+    child->dz_sed = c->dz_sed;
+    child->porosity = c->porosity;
+    for (i = 0; i < child->ncv; ++i)
+      child->cv[i] = NaN;   /* must be initialized by some process */
+  }
+
+  c->nsubstep = 0;
+  c->ia = NULL;
+}
+
 /** Writes calculated tracer concentrations back to the host model.
  ** The values of "flux" diagnostic tracers are written back after
  ** being divided by dt to result in average flux value over the time
@@ -677,6 +724,13 @@ static void addstats(int n, double x, double* y, double* y1, int naccpt, int nre
   pthstuff* pth = c->e->pth;
 #endif
 
+  /*
+   * Flux evaluations are the cost weight of the column when the columns
+   * are split between threads for the next step. Each column is stepped
+   * by one thread only, so no lock is needed here.
+   */
+  c->e->colcost[c->col->b] += nfcn;
+
 #if (NCPU > 1)
   pthread_mutex_lock(&pth->stats_lock);
 #endif
@@ -695,6 +749,29 @@ static void addstats(int n, double x, double* y, double* y1, int naccpt, int nre
 #endif
 }
 
+/** Reports a failed integration for a cell to the host model.
+ * @param c Pointer to cell
+ */
+static void cell_calc_failed(cell* c)
+{
+  ecology* e = c->e;
+  int ij[2];
+  int b = c->col->b;
+  char str[MAXSTRLEN];
+
+  ginterface_get_ij(e->model, b, ij);
+  if (c->type == CT_WC) {
+    sprintf(str, "ecology: error: integration failed in water cell, nstep = %d, nsubstep = %d, b = %d, k = %d (i,j) = (%u,%u)\n", e->nstep, c->nsubstep, b, c->k_wc, ij[0],ij[1]);
+    i_set_error(e->model, b, LFATAL, str);
+  } else if (c->type == CT_SED) {
+    sprintf(str, "ecology: error: integration failed in sediment cell, nstep = %d, nsubstep = %d, b = %d, k = %d (i,j) = (%u,%u)\n", e->nstep, c->nsubstep, b, c->k_sed, ij[0],ij[1]);
+    i_set_error(e->model, b, LFATAL, str);
+  } else {
+    sprintf(str, "ecology: error: integration failed in epibenthic cell, nstep = %d, nsubstep = %d, b = %d (i,j) = (%u,%u)\n", e->nstep, c->nsubstep, b, ij[0],ij[1]);
+    i_set_error(e->model, b, LFATAL, str);
+  }
+}
+
 /** Integration loop for a cell.
  * @param c Pointer to cell
  * @return status flag, 0 for fail, 1 for success
@@ -716,22 +793,7 @@ int cell_calc(cell* c)
    */
   if (!e->eint(fluxes, c->nvar, e->t, c->y, e->t + e->dt, e->precision, e->dt, c->h0, NULL, addstats, c)) {
     /* Integration failed */
-    int ij[2];
-    int b = c->col->b;
-    void *hmodel = e->model;
-    char str[MAXSTRLEN];
-    
-    ginterface_get_ij(e->model, b, ij);
-    if (c->type == CT_WC) {
-      sprintf(str, "ecology: error: integration failed in water cell, nstep = %d, nsubstep = %d, b = %d, k = %d (i,j) = (%u,%u)\n", e->nstep, c->nsubstep, b, c->k_wc, ij[0],ij[1]);
-      i_set_error(e->model, b, LFATAL, str);
-    } else if (c->type == CT_SED) {
-      sprintf(str, "ecology: error: integration failed in sediment cell, nstep = %d, nsubstep = %d, b = %d, k = %d (i,j) = (%u,%u)\n", e->nstep, c->nsubstep, b, c->k_sed, ij[0],ij[1]);
-      i_set_error(e->model, b, LFATAL, str);
-    } else {
-      sprintf(str, "ecology: error: integration failed in epibenthic cell, nstep = %d, nsubstep = %d, b = %d (i,j) = (%u,%u)\n", e->nstep, c->nsubstep, b, ij[0],ij[1]);
-      i_set_error(e->model, b, LFATAL, str);
-    }
+    cell_calc_failed(c);
     return(0);
   }
   
@@ -742,6 +804,191 @@ int cell_calc(cell* c)
   return(1);
 }
 
+/*
+ * Batch of cells integrated together by cell_calc_batch()
+ */
+typedef struct {
+  cell** cells;
+  derivfn fluxes;
+  EPROCESSTYPE pt;              /* process type, PT_GEN for epibenthic */
+  double* y;                    /* lane state, contiguous */
+  double* y1;                   /* lane fluxes, contiguous */
+} cellbatch;
+
+/** Gathers a lane of the batch into contiguous storage and points the
+ * cell at it, as the scalar flux calculation does.
+ */
+static void batchgather(cellbatch* cb, int nl, int l, double* t, double* y, double* y1, intargs* ia)
+{
+  cell* c = cb->cells[l];
+  int i;
+
+  for (i = 0; i < c->nvar; ++i) {
+    cb->y[i] = y[i * nl + l];
+    cb->y1[i] = y1[i * nl + l];
+  }
+  ia->t = t[l];
+  ia->y = cb->y;
+  ia->y1 = cb->y1;
+  ia->media = c;
+  c->ia = ia;
+}
+
+/** Flux calculation for a batch of cells. The integrator keeps the
+ * state with the lanes interleaved (y[i * nl + l]). Processes with a
+ * batched flux procedure are called once for all lanes. For the others
+ * each active lane is gathered into contiguous storage, the scalar flux
+ * procedures run until the next batched one, and the fluxes scattered
+ * back. The processes run in the same order as in wcfluxes() and
+ * sedfluxes(). Epibenthic cells also step the processes of their child
+ * cells, and are stepped a lane at a time with epifluxes().
+ */
+static void batchfluxes(int nl, int* active, double* t, double* y, double* y1, void* pp)
+{
+  cellbatch* cb = (cellbatch*) pp;
+  ecology* e = cb->cells[0]->e;
+  int nvar = cb->cells[0]->nvar;
+  intargs ia;
+  int l, i, j, jj;
+
+  if (cb->pt == PT_GEN) {
+    for (l = 0; l < nl; ++l) {
+      cell* c = cb->cells[l];
+
+      if (!active[l])
+	continue;
+      for (i = 0; i < nvar; ++i)
+	cb->y[i] = y[i * nl + l];
+      cb->fluxes(t[l], cb->y, cb->y1, c);
+      for (i = 0; i < nvar; ++i)
+	y1[i * nl + l] = cb->y1[i];
+    }
+    return;
+  }
+
+  for (i = 0; i < nvar; ++i)
+    for (l = 0; l < nl; ++l)
+      if (active[l])
+	y1[i * nl + l] = 0.0;
+
+  for (j = 0; j < e->npr[cb->pt]; j = jj) {
+    eprocess* p = e->processes[cb->pt][j];
+
+    if (p->calc_batch != NULL) {
+      p->calc_batch(p, nl, active, t, cb->cells, y, y1);
+      if (e->check_nans) {
+	for (l = 0; l < nl; ++l) {
+	  if (!active[l])
+	    continue;
+	  batchgather(cb, nl, l, t, y, y1, &ia);
+	  check_nans(p, cb->cells[l]);
+	  cb->cells[l]->ia = NULL;
+	}
+      }
+      jj = j + 1;
+      continue;
+    }
+
+    /* Scalar processes up to the next batched one */
+    for (jj = j + 1; jj < e->npr[cb->pt]; ++jj)
+      if (e->processes[cb->pt][jj]->calc_batch != NULL)
+	break;
+    for (l = 0; l < nl; ++l) {
+      cell* c = cb->cells[l];
+
+      if (!active[l])
+	continue;
+      batchgather(cb, nl, l, t, y, y1, &ia);
+      for (i = j; i < jj; ++i) {
+	p = e->processes[cb->pt][i];
+	if (p->calc != NULL) {
+	  p->calc(p, &ia);
+
+	  if (e->check_nans)
+	    check_nans(p, c);
+	}
+      }
+      c->ia = NULL;
+      for (i = 0; i < nvar; ++i)
+	y1[i * nl + l] = cb->y1[i];
+    }
+  }
+
+  for (l = 0; l < nl; ++l)
+    if (active[l])
+      cb->cells[l]->nsubstep++;
+}
+
+static void batchstats(int l, int n, double x, double* y, double* y1, int naccpt, int nrejct, int nfcn, void* pp)
+{
+  cellbatch* cb = (cellbatch*) pp;
+
+  addstats(n, x, y, y1, naccpt, nrejct, nfcn, cb->cells[l]);
+}
+
+/** Integration loop for a batch of cells of the same type and
+ * dimension, stepped together by dopri5_batch(). Falls back to
+ * cell_calc() for each cell with any other integrator.
+ * @param cells Cells to integrate
+ * @param nc Number of cells
+ * @return status flag, 0 for fail, 1 for success
+ */
+int cell_calc_batch(cell** cells, int nc)
+{
+  ecology* e = cells[0]->e;
+  int nvar = cells[0]->nvar;
+  cellbatch cb;
+  double** y;
+  double** h0;
+  int* status;
+  int ok;
+  int l;
+
+  if (nc == 1 || e->eint != dopri5) {
+    for (l = 0; l < nc; ++l)
+      if (!cell_calc(cells[l]))
+	return(0);
+    return(1);
+  }
+
+  if (cells[0]->type == CT_WC)
+    cb.fluxes = wcfluxes;
+  else if (cells[0]->type == CT_SED)
+    cb.fluxes = sedfluxes;
+  else   /* CT_EPI */
+    cb.fluxes = epifluxes;
+  cb.cells = cells;
+  cb.pt = (cells[0]->type == CT_EPI) ? PT_GEN : celltype2processtype(cells[0]->type);
+  cb.y = malloc(nvar * 2 * sizeof(double));
+  cb.y1 = &cb.y[nvar];
+
+  y = malloc(nc * 2 * sizeof(double*));
+  h0 = &y[nc];
+  status = malloc(nc * sizeof(int));
+  for (l = 0; l < nc; ++l) {
+    assert(cells[l]->type == cells[0]->type && cells[l]->nvar == nvar);
+    y[l] = cells[l]->y;
+    h0[l] = cells[l]->h0;
+  }
+
+  ok = dopri5_batch(batchfluxes, nvar, nc, e->t, y, e->t + e->dt, e->precision, e->dt, h0, batchstats, &cb, status);
+
+  for (l = 0; l < nc; ++l) {
+    if (!status[l]) {
+      cell_calc_failed(cells[l]);
+      break;
+    }
+    if (e->check_negs)
+      check_negs(cells[l],"calc");
+  }
+
+  free(status);
+  free(y);
+  free(cb.y);
+
+  return(ok);
+}
+
 /** Runs postcalc procedures for the cell (those to be performed after the
  * integration loop).
  * @param c Pointer to cell
@@ -35,40 +35,34 @@
 
 
 
-/** Column constructor.
- * @param e Pointer to ecology structure.
- * @param b Column (box) index.
- * @return Pointer to the column structure.
+typedef int (*addcell_fn) (column* col, CELLTYPE ct, int k, int k_wc, int k_sed);
+
+/** Maps the column to the host model storage and finds the non-empty
+ * water and sediment cell range.
+ * @param col Pointer to column
  */
-column* column_create(ecology* e, int b)
+static void column_map(column* col)
 {
-  column* col = malloc(sizeof(column));
+  ecology* e = col->e;
+  int b = col->b;
+  int n_wc, n_sed, up_wc, up_sed;
+  int i, k;
 
   /*
    * k range, empty layers included 
    */
-  int topk_wc = einterface_getwctopk(e->model, b);
-  int botk_wc = einterface_getwcbotk(e->model, b);
-  int topk_sed = einterface_getsedtopk(e->model, b);
-  int botk_sed = einterface_getsedbotk(e->model, b);
-  int n_wc = abs(topk_wc - botk_wc) + 1;
-  int n_sed = abs(topk_sed - botk_sed) + 1;
+  col->ktop_wc = einterface_getwctopk(e->model, b);
+  col->kbot_wc = einterface_getwcbotk(e->model, b);
+  col->ktop_sed = einterface_getsedtopk(e->model, b);
+  col->kbot_sed = einterface_getsedbotk(e->model, b);
+  n_wc = abs(col->ktop_wc - col->kbot_wc) + 1;
+  n_sed = abs(col->ktop_sed - col->kbot_sed) + 1;
 
   /*
    * k direction flags 
    */
-  int up_wc = botk_wc < topk_wc;
-  int up_sed = botk_sed < topk_sed;
-
-  /*
-   * bottom water / top sediment cell indices 
-   */
-  int ii = 0;
-  int i, k, j;
-
-  col->e = e;
-  col->model = e->model;
-  col->b = b;
+  up_wc = col->kbot_wc < col->ktop_wc;
+  up_sed = col->kbot_sed < col->ktop_sed;
 
   col->tr_wc = einterface_getwctracers(e->model, b);
   col->tr_sed = einterface_getsedtracers(e->model, b);
@@ -77,12 +71,6 @@ column* column_create(ecology* e, int b)
   col->dz_sed = einterface_getsedcellthicknesses(e->model, b);
   col->porosity = einterface_getporosity(e->model, b);
 
-  col->ncells = 0;
-  col->n_wc = 0;
-  col->n_sed = 0;
-
-  col->cells = calloc(n_wc + n_sed - 1, sizeof(void*));
-
   /*
    * What is attempted here is to automatically exclude empty water or
    * sediment cells. (By "empty" cells we count those with thickness less
@@ -98,7 +86,7 @@ column* column_create(ecology* e, int b)
   /*
    * find non-empty bottom water cell 
    */
-  for (i = 0, k = botk_wc; i < n_wc; ++i, (up_wc) ? ++k : --k)
+  for (i = 0, k = col->kbot_wc; i < n_wc; ++i, (up_wc) ? ++k : --k)
     if (col->dz_wc[k] >= THICKNESS_WC_MIN) {
       col->botk_wc = k;
       break;
@@ -106,7 +94,7 @@ column* column_create(ecology* e, int b)
   /*
    * find non-empty top water cell 
    */
-  for (i = 0, k = topk_wc; i < n_wc; ++i, (up_wc) ? --k : ++k)
+  for (i = 0, k = col->ktop_wc; i < n_wc; ++i, (up_wc) ? --k : ++k)
     if (col->dz_wc[k] >= THICKNESS_WC_MIN) {
       col->topk_wc = k;
       break;
@@ -114,7 +102,7 @@ column* column_create(ecology* e, int b)
   /*
    * find non-empty bottom sediment cell 
    */
-  for (i = 0, k = botk_sed; i < n_sed; ++i, (up_sed) ? ++k : --k)
+  for (i = 0, k = col->kbot_sed; i < n_sed; ++i, (up_sed) ? ++k : --k)
     if (col->dz_sed[k] >= THICKNESS_SED_MIN) {
       col->botk_sed = k;
       break;
@@ -123,11 +111,43 @@ column* column_create(ecology* e, int b)
   /*
    * find non-empty top sediment cell 
    */
-  for (i = 0, k = topk_sed; i < n_sed; ++i, (up_sed) ? --k : ++k)
+  for (i = 0, k = col->ktop_sed; i < n_sed; ++i, (up_sed) ? --k : ++k)
     if (col->dz_sed[k] >= THICKNESS_SED_MIN) {
       col->topk_sed = k;
       break;
     }
+}
+
+/** Releases the host model storage maps of the column.
+ * @param col Pointer to column
+ */
+static void column_unmap(column* col)
+{
+  if (col->dz_wc != NULL)
+    free(col->dz_wc);
+  if (col->dz_sed != NULL)
+    free(col->dz_sed);
+  if (col->e->ntr > 0) {
+    free(col->tr_wc);
+    free(col->tr_sed);
+  }
+  if (col->e->nepi > 0)
+    free(col->epivar);
+}
+
+/** Goes through the non-empty cells of a mapped column, calling addcell()
+ * for each cell in the order they are stacked in the column.
+ * @param col Pointer to column
+ * @param addcell Function to create or verify the cell
+ * @return Number of cells; -1 if addcell() failed
+ */
+static int column_layout(column* col, addcell_fn addcell)
+{
+  ecology* e = col->e;
+  int up_wc = col->kbot_wc < col->ktop_wc;
+  int up_sed = col->kbot_sed < col->ktop_sed;
+  int ii = 0;
+  int k;
 
   /*
    * create water cells 
@@ -136,13 +156,15 @@ column* column_create(ecology* e, int b)
     if (up_wc) {
       for (k = col->topk_wc; k > col->botk_wc; --k)
 	if (col->dz_wc[k] >= THICKNESS_WC_MIN) {
-	  col->cells[ii] = cell_create(col, CT_WC, ii, k, -1);
+	  if (!addcell(col, CT_WC, ii, k, -1))
+	    return -1;
 	  ++ii;
 	}
     } else {
       for (k = col->topk_wc; k < col->botk_wc; ++k)
 	if (col->dz_wc[k] >= THICKNESS_WC_MIN) {
-	  col->cells[ii] = cell_create(col, CT_WC, ii, k, -1);
+	  if (!addcell(col, CT_WC, ii, k, -1))
+	    return -1;
 	  ++ii;
 	}
     }
@@ -156,7 +178,8 @@ column* column_create(ecology* e, int b)
       e->quitfn("ecology: error: column %d: no non-empty water cells\n", col->b);
     else if (col->topk_sed >= 0) {
       if (e->npr[PT_SED] > 0) {
-	col->cells[ii] = cell_create(col, CT_SED, ii, -1, col->topk_sed);
+	if (!addcell(col, CT_SED, ii, -1, col->topk_sed))
+	  return -1;
 	++ii;
             
 	/* TMP
@@ -173,7 +196,8 @@ column* column_create(ecology* e, int b)
       e->quitfn("ecology: error: column %d: no non-empty sediment cells\n", col->b);
     else if (col->topk_wc >= 0) {
       if (e->npr[PT_WC] > 0) {
-	col->cells[ii] = cell_create(col, CT_WC, ii, col->botk_wc, -1);
+	if (!addcell(col, CT_WC, ii, col->botk_wc, -1))
+	  return -1;
 	++ii;
 	/* TMP
 	 */
@@ -194,17 +218,20 @@ column* column_create(ecology* e, int b)
      * such a structure if there is no need for it. 
      */
     if (e->npr[PT_EPI] > 0) {
-      col->cells[ii] = cell_create(col, CT_EPI, ii, col->botk_wc, col->topk_sed);
+      if (!addcell(col, CT_EPI, ii, col->botk_wc, col->topk_sed))
+	return -1;
       ++ii;
     } else {
       if (e->npr[PT_WC] > 0) {
-	col->cells[ii] = cell_create(col, CT_WC, ii, col->botk_wc, -1);
+	if (!addcell(col, CT_WC, ii, col->botk_wc, -1))
+	  return -1;
 	++ii;
 	emstag(LMETRIC,"eco:column:column_create","Cerated WC dummy cells at: %d",col->b);
     
       }
       if (e->npr[PT_SED] > 0) {
-	col->cells[ii] = cell_create(col, CT_SED, ii, -1, col->topk_sed);
+	if (!addcell(col, CT_SED, ii, -1, col->topk_sed))
+	  return -1;
 	++ii;
 	emstag(LMETRIC,"eco:column:column_create","Cerated SED dummy cells at: %d",col->b);
       }
@@ -218,38 +245,100 @@ column* column_create(ecology* e, int b)
     if (up_sed) {
       for (k = col->topk_sed - 1; k >= col->botk_sed; --k)
 	if (col->dz_sed[k] >= THICKNESS_SED_MIN) {
-	  col->cells[ii] = cell_create(col, CT_SED, ii, -1, k);
+	  if (!addcell(col, CT_SED, ii, -1, k))
+	    return -1;
 	  ++ii;
 	}
     } else {
-      for (k = col->topk_sed + 1; k <= botk_sed; ++k)
+      for (k = col->topk_sed + 1; k <= col->kbot_sed; ++k)
 	if (col->dz_sed[k] >= THICKNESS_SED_MIN) {
-	  col->cells[ii] = cell_create(col, CT_SED, ii, -1, k);
+	  if (!addcell(col, CT_SED, ii, -1, k))
+	    return -1;
 	  ++ii;
 	}
     }
   }
 
-  /* Column based tracers */
-  col->y = d_alloc_2d(col->ncells, e->ntr);
-  col->y_sed0 = d_alloc_1d(e->ntr);
-  col->y_epi  = d_alloc_1d(e->nepi);
-  col->zc = d_alloc_1d(n_wc);
-  col->dz = d_alloc_1d(n_wc);
-  i = 0;
+  return ii;
+}
+
+/** Creates a cell in the column.
+ */
+static int column_addcell(column* col, CELLTYPE ct, int k, int k_wc, int k_sed)
+{
+  col->cells[k] = cell_create(col, ct, k, k_wc, k_sed);
+  return 1;
+}
+
+/** Verifies that an existing cell of the column matches the layout.
+ */
+static int column_checkcell(column* col, CELLTYPE ct, int k, int k_wc, int k_sed)
+{
+  cell* c;
+
+  if (k >= col->ncells)
+    return 0;
+  c = col->cells[k];
+
+  return (c->type == ct && c->k_wc == k_wc && c->k_sed == k_sed);
+}
+
+/** Sets the column based view of the water cell depths and thicknesses.
+ * @param col Pointer to column
+ */
+static void column_setz(column* col)
+{
+  int up_wc = col->kbot_wc < col->ktop_wc;
+  int i = 0, k;
+
   if (up_wc) {
     for (k = col->topk_wc; k >= col->botk_wc; --k) {
-      col->zc[i] = einterface_getcellz(e->model, b, k);
+      col->zc[i] = einterface_getcellz(col->model, col->b, k);
       col->dz[i] = col->dz_wc[k];
       i++;
     }
   } else {
     for (k = col->topk_wc; k <= col->botk_wc; ++k) {
-      col->zc[i] = einterface_getcellz(e->model, b, k);
+      col->zc[i] = einterface_getcellz(col->model, col->b, k);
       col->dz[i] = col->dz_wc[k];
       i++;
     }
   }
+}
+
+/** Column constructor.
+ * @param e Pointer to ecology structure.
+ * @param b Column (box) index.
+ * @return Pointer to the column structure.
+ */
+column* column_create(ecology* e, int b)
+{
+  column* col = malloc(sizeof(column));
+  int n_wc, n_sed;
+  int i, j;
+
+  col->e = e;
+  col->model = e->model;
+  col->b = b;
+
+  column_map(col);
+  n_wc = abs(col->ktop_wc - col->kbot_wc) + 1;
+  n_sed = abs(col->ktop_sed - col->kbot_sed) + 1;
+
+  col->ncells = 0;
+  col->n_wc = 0;
+  col->n_sed = 0;
+
+  col->cells = calloc(n_wc + n_sed - 1, sizeof(void*));
+  column_layout(col, column_addcell);
+
+  /* Column based tracers */
+  col->y = d_alloc_2d(col->ncells, e->ntr);
+  col->y_sed0 = d_alloc_1d(e->ntr);
+  col->y_epi  = d_alloc_1d(e->nepi);
+  col->zc = d_alloc_1d(n_wc);
+  col->dz = d_alloc_1d(n_wc);
+  column_setz(col);
   
   col->ncv = e->cv_column->n;
   col->n_ncv = NULL;
@@ -270,6 +359,68 @@ column* column_create(ecology* e, int b)
   return col;
 }
 
+/** Remaps an existing column to the host model for a new step. The
+ * cells are kept if the column topology (host k range, non-empty
+ * water and sediment cells) is unchanged.
+ * @param col Pointer to column
+ * @return 1 if the column can be reused, 0 if it must be rebuilt
+ */
+int column_update(column* col)
+{
+  int ktop_wc = col->ktop_wc;
+  int kbot_wc = col->kbot_wc;
+  int ktop_sed = col->ktop_sed;
+  int kbot_sed = col->kbot_sed;
+  int topk_wc = col->topk_wc;
+  int botk_wc = col->botk_wc;
+  int topk_sed = col->topk_sed;
+  int botk_sed = col->botk_sed;
+  int i, j, k;
+
+  column_unmap(col);
+  column_map(col);
+
+  if (col->ktop_wc != ktop_wc || col->kbot_wc != kbot_wc ||
+      col->ktop_sed != ktop_sed || col->kbot_sed != kbot_sed ||
+      col->topk_wc != topk_wc || col->botk_wc != botk_wc ||
+      col->topk_sed != topk_sed || col->botk_sed != botk_sed)
+    return 0;
+  if (column_layout(col, column_checkcell) != col->ncells)
+    return 0;
+
+  for (k = 0; k < col->ncells; ++k)
+    cell_update(col->cells[k]);
+  column_setz(col);
+
+  for (i = 0; i < col->ncv; i++)
+    for (j = 0; j < col->n_ncv[i]; ++j)
+      col->cv[i][j] = NaN;  /* must be initialized by some process */
+
+  return 1;
+}
+
+/** Returns the column for a given index from the ecology column pool.
+ * The pooled column is remapped to the host model, and only rebuilt if
+ * its topology has changed since the last step (e.g. wetting or drying,
+ * or a change in the sediment layers).
+ * @param e Pointer to ecology structure.
+ * @param b Column (box) index.
+ * @return Pointer to the column structure.
+ */
+column* column_get(ecology* e, int b)
+{
+  column* col = e->columns[b];
+
+  if (col != NULL && column_update(col))
+    return col;
+
+  column_destroy(col);
+  col = column_create(e, b);
+  e->columns[b] = col;
+
+  return col;
+}
+
 /** Column destructor.
  * @param col Pointer to column
  */
@@ -280,22 +431,10 @@ void column_destroy(column* col)
   if (col == NULL)
     return;
 
-  /*
-   * this includes writing back the new tracer values to the host model 
-   */
   for (i = 0; i < col->ncells; ++i)
     cell_destroy(col->cells[i]);
 
-  if (col->dz_wc != NULL)
-    free(col->dz_wc);
-  if (col->dz_sed != NULL)
-    free(col->dz_sed);
-  if (col->e->ntr > 0) {
-    free(col->tr_wc);
-    free(col->tr_sed);
-  }
-  if (col->e->nepi > 0)
-    free(col->epivar);
+  column_unmap(col);
   free(col->cells);
   if (col->ncv > 0) {
     /* free each pointer first */
@@ -497,6 +636,47 @@ static void column_fill(column* col)
     y_epi[n] = *col->epivar[n];
 }
 
+/** Steps all the cells in a column with the integration of the cells
+ * batched. All cells are filled and precalculated first, runs of
+ * consecutive cells of the same type are then integrated together, and
+ * postcalc and writeback follow for each cell in order. Not used with
+ * processes that pass state down the column from one cell step to the
+ * next (see batch_excluded() in ecology.c).
+ * @param col Pointer to column
+ * @return 0 for fail, 1 for success
+ */
+static int column_step_batch(column* col)
+{
+  int k, kk;
+
+  for (k = 0; k < col->ncells; ++k) {
+    cell* c = col->cells[k];
+    assert(k == c->k);
+
+    cell_fill(c, col);
+    cell_precalc(c);
+  }
+
+  for (k = 0; k < col->ncells; k = kk) {
+    cell* c = col->cells[k];
+
+    for (kk = k + 1; kk < col->ncells; ++kk)
+      if (col->cells[kk]->type != c->type || col->cells[kk]->nvar != c->nvar)
+	break;
+    if (!cell_calc_batch(&col->cells[k], kk - k))
+      return 0;
+  }
+
+  for (k = 0; k < col->ncells; ++k) {
+    cell* c = col->cells[k];
+
+    cell_postcalc(c);
+    cell_writeback(c);
+  }
+
+  return 1;
+}
+
 /** Performs ecology step for a column.
  * @param col Pointer to column
  * @return 0 for fail, 1 for success
@@ -505,37 +685,43 @@ int column_step(column* col)
 {
   int k;
   emslog(LMETRIC,"Starting Column-%d Step at %f \n",col->b,wall_time());
+  col->e->colcost[col->b] = 0.0;
   /*
    * column_step -- just stepping all the cells 
    */
-  for (k = 0; k < col->ncells; ++k) {
-    cell* c = col->cells[k];
-    assert(k == c->k);
-
-    /*
-     * column_prestep processes write directly to the state variable
-     * storage in the host model, while cell processes read/write
-     * from/to the local cell storage cell.y. This is why filling of
-     * cell's tracer values must be done in between those two groups of
-     * processes. The values of diagnostic variables are set to 0. 
-     */
-    cell_fill(c, col);
-
-    /* pre integration stuff */
-    cell_precalc(c); 
-    /* integration */
-    if (!cell_calc(c)) {
-      /* Failed, bail out */
+  if (col->e->batch_calc) {
+    if (!column_step_batch(col))
       return 0;
+  } else {
+    for (k = 0; k < col->ncells; ++k) {
+      cell* c = col->cells[k];
+      assert(k == c->k);
+
+      /*
+       * column_prestep processes write directly to the state variable
+       * storage in the host model, while cell processes read/write
+       * from/to the local cell storage cell.y. This is why filling of
+       * cell's tracer values must be done in between those two groups of
+       * processes. The values of diagnostic variables are set to 0. 
+       */
+      cell_fill(c, col);
+
+      /* pre integration stuff */
+      cell_precalc(c); 
+      /* integration */
+      if (!cell_calc(c)) {
+        /* Failed, bail out */
+        return 0;
+      }
+      cell_postcalc(c); /* post integration stuff */
+      /*
+       * Writes calculated tracer concentrations back to the host
+       * model. The values of "flux" diagnostic tracers are written back
+       * after being divided by dt to result in average flux value over
+       * the time step. 
+       */
+      cell_writeback(c);
     }
-    cell_postcalc(c); /* post integration stuff */
-    /*
-     * Writes calculated tracer concentrations back to the host
-     * model. The values of "flux" diagnostic tracers are written back
-     * after being divided by dt to result in average flux value over
-     * the time step. 
-     */
-    cell_writeback(c);
   }
   /*UR added writeback to capture the postprocessing variables */
   /* now iterate again to write it back again after the entire column has bee calculated */
@@ -351,33 +351,115 @@ static void print_unmapped(ecology* e)
 }
 
 #if (NCPU > 1)
+static void column_step_chunk(ecology* e, int c);
+
+/** Takes the next column chunk for a pool thread. The thread's own queue
+ * is used first; once it is empty, chunks are stolen from the tail of the
+ * other threads' queues.
+ * @param pth Thread pool
+ * @param thread_index Index of the calling thread
+ * @return Chunk index, or -1 if no work is left
+ */
+static int pth_nextchunk(pthstuff* pth, int thread_index)
+{
+    int c = -1;
+    int i;
+
+    for (i = 0; i < NCPU && c < 0; ++i) {
+        pthqueue* q = &pth->queues[(thread_index + i) % NCPU];
+
+        pthread_mutex_lock(&q->lock);
+        if (q->head < q->tail)
+            c = (i == 0) ? q->head++ : --q->tail;
+        pthread_mutex_unlock(&q->lock);
+    }
+
+    return c;
+}
+
+static void* pth_worker(void* p)
+{
+    pthargs* args = (pthargs*) p;
+    ecology* e = args->e;
+    pthstuff* pth = e->pth;
+    int generation = 0;
+    int c;
+
+    for (;;) {
+        pthread_mutex_lock(&pth->pool_lock);
+        while (pth->generation == generation && !pth->quit)
+            pthread_cond_wait(&pth->have_work, &pth->pool_lock);
+        if (pth->quit) {
+            pthread_mutex_unlock(&pth->pool_lock);
+            break;
+        }
+        generation = pth->generation;
+        pthread_mutex_unlock(&pth->pool_lock);
+
+        while ((c = pth_nextchunk(pth, args->thread_index)) >= 0)
+            column_step_chunk(e, c);
+
+        pthread_mutex_lock(&pth->pool_lock);
+        if (--pth->nbusy == 0)
+            pthread_cond_signal(&pth->have_done);
+        pthread_mutex_unlock(&pth->pool_lock);
+    }
+
+    return NULL;
+}
+
 void pth_init(ecology* e)
 {
     pthstuff* pth = malloc(sizeof(pthstuff));
     int i;
 
     e->pth = pth;
-    pthread_attr_init(&pth->thread_attr);
 
     /*
-     * The threads are run as detached threads here. This means that once
-     * started, they are on their own, no formal synchronization (joining)
-     * point is required. As one of the threads terminates, another thread
-     * is started. The advantage of this approach is that only NCPU treads
-     * for running column_step() are required for maximum effectiveness
-     * (speed); above that, the threads number does not matter. An
-     * alternative approach I tried is to run threads as joinable. This
-     * would mean to launch them in pools and waiting for each pool to
-     * terminate. It is a bit more simple from programming point of view at
-     * a minimum level but is not supposed to go for maximum efficiency.
+     * The threads are created once here and kept for the whole run. For
+     * each step, ecology_step() splits the columns into chunks of about
+     * equal cost and hands each thread a contiguous range of chunks; a
+     * thread that runs out of work steals chunks from the others. This
+     * saves creating a thread per column, and the balance follows the
+     * actual integration cost of the columns rather than their number.
      */
-    pthread_attr_setdetachstate(&pth->thread_attr, PTHREAD_CREATE_DETACHED);
     pthread_mutex_init(&pth->stats_lock, NULL);
-    pthread_mutex_init(&pth->avail_lock, NULL);
-    pthread_cond_init(&pth->have_avail, NULL);
-    pth->navail = NCPU;
+    pthread_mutex_init(&pth->pool_lock, NULL);
+    pthread_cond_init(&pth->have_work, NULL);
+    pthread_cond_init(&pth->have_done, NULL);
+    pth->generation = 0;
+    pth->nbusy = 0;
+    pth->quit = 0;
+    for (i = 0; i < NCPU; ++i) {
+        pthread_mutex_init(&pth->queues[i].lock, NULL);
+        pth->queues[i].head = 0;
+        pth->queues[i].tail = 0;
+        pth->args[i].e = e;
+        pth->args[i].thread_index = i;
+    }
     for (i = 0; i < NCPU; ++i)
-        pth->avail[i] = 1;
+        pthread_create(&pth->threads[i], NULL, pth_worker, &pth->args[i]);
+}
+
+static void pth_destroy(ecology* e)
+{
+    pthstuff* pth = e->pth;
+    int i;
+
+    pthread_mutex_lock(&pth->pool_lock);
+    pth->quit = 1;
+    pthread_cond_broadcast(&pth->have_work);
+    pthread_mutex_unlock(&pth->pool_lock);
+    for (i = 0; i < NCPU; ++i) {
+        pthread_join(pth->threads[i], NULL);
+        pthread_mutex_destroy(&pth->queues[i].lock);
+    }
+    pthread_cond_destroy(&pth->have_done);
+    pthread_cond_destroy(&pth->have_work);
+    pthread_mutex_destroy(&pth->pool_lock);
+    pthread_mutex_destroy(&pth->stats_lock);
+    free(pth);
+    e->pth = NULL;
 }
 #endif
 
@@ -422,6 +504,11 @@ ecology* ecology_create()
     e->eint = dopri5;
     e->precision = NaN;
     e->h0 = NULL;
+    e->columns = NULL;
+    e->colcost = NULL;
+    e->chunks = NULL;
+    e->nchunks = 0;
+    e->batch_calc = BATCH_CALC_DEF;
     e->check_nans = CHECK_NANS_DEF;
     e->check_negs = CHECK_NEGS_DEF;
     e->verify_diagn = VERIFY_DIAGN_EXTERN_DEF;
@@ -661,6 +748,40 @@ void *ecology_pre_build(char *eco_vars, char *eco_defs, FILE *fp)
  * @param prmfname Parameter file name
  * @return struct ecology
  */
+/*
+ * Processes that carry state between the cells of a column through the
+ * column variables, and rely on each cell being precalculated, integrated
+ * and postcalculated before the next cell starts. E.g. gas_exchange_wc
+ * flags the first qualifying layer in precalc, applies the air-sea flux
+ * in calc to that layer only, and marks it done in postcalc.
+ */
+static char* colseq_processes[] = {
+  "gas_exchange_wc",
+  "dimethyl_sulfide_wc",
+  "chlorophyll_normalized_wc",
+  "light_spectral_wc",
+  "light_spectral_uq_epi",
+  NULL
+};
+
+/** Returns 1 if a process is present that cannot be used with batched
+ * integration, which precalculates all cells of a column before
+ * integrating any of them.
+ * @param e Pointer to ecology
+ */
+static int batch_excluded(ecology* e)
+{
+  int type, i;
+
+  for (type = PT_WC; type <= PT_EPI; ++type)
+    for (i = 0; colseq_processes[i] != NULL; ++i)
+      if (process_present(e, type, colseq_processes[i])) {
+	emstag(LWARN,"ecology:ecology.c:ecology_build","batch_integration not supported with process \"%s\" : ignored\n", colseq_processes[i]);
+	return 1;
+      }
+  return 0;
+}
+
 ecology* ecology_build(void* model, char* prmfname)
 {
     ecology* e = ecology_create();
@@ -946,6 +1067,18 @@ ecology* ecology_build(void* model, char* prmfname)
     emstag(LDEBUG, "ecology:ecology.c:ecology_build"," integration precision = %.3g\n", e->precision);
 
     e->h0 = malloc(e->max_ncolumns * (e->nwclayers + e->nsedlayers) * sizeof(double));
+    e->columns = calloc(e->max_ncolumns, sizeof(column*));
+    e->colcost = calloc(e->max_ncolumns, sizeof(double));
+    e->chunks = malloc((e->max_ncolumns + 1) * sizeof(int));
+    /*
+     * batched integration is only available for dopri5
+     */
+    prm_readint(prmfile, "batch_integration", &e->batch_calc);
+    if (e->eint != dopri5)
+        e->batch_calc = 0;
+    if (e->batch_calc && batch_excluded(e))
+        e->batch_calc = 0;
+    emstag(LINFO, "ecology:ecology.c:ecology_build"," batch_integration = %s\n", (e->batch_calc) ? "true" : "false");
     prm_readint(prmfile, "check_nans", &e->check_nans);
     emstag(LINFO, "ecology:ecology.c:ecology_build"," check_nans = %s\n", (e->check_nans) ? "true" : "false");
     prm_readint(prmfile, "check_negs", &e->check_negs);
@@ -1070,43 +1203,91 @@ void ecology_destroy(ecology* e)
     }
 #if (NCPU > 1)
     if (e->multithreaded)
-        free(e->pth);
+        pth_destroy(e);
 #endif
     if (e->h0 != NULL)
       free(e->h0);
+    if (e->columns != NULL) {
+      for (i = 0; i < e->max_ncolumns; ++i)
+        column_destroy(e->columns[i]);
+      free(e->columns);
+    }
+    if (e->colcost != NULL)
+      free(e->colcost);
+    if (e->chunks != NULL)
+      free(e->chunks);
     free(e);
     emstag(LINFO,"eco:ecology:ecology_destroy"," destroyed\n");
 }
 
-#if (NCPU > 1)
-static void pth_finish(pthstuff* pth)
+#if (NCPU > 1) || defined(HAVE_OMP)
+/** Splits the columns into contiguous chunks of about equal cost for the
+ * threaded step. The cost of a column is the number of flux evaluations
+ * it took in the previous step.
+ * @param e Pointer to ecology
+ * @param nthreads Number of threads the chunks are shared between
+ */
+static void ecology_build_chunks(ecology* e, int nthreads)
 {
-    pthread_mutex_lock(&pth->avail_lock);
-    while (pth->navail != NCPU)
-        pthread_cond_wait(&pth->have_avail, &pth->avail_lock);
-    pthread_mutex_unlock(&pth->avail_lock);
+    double total = 0.0;
+    double target, cost;
+    int i, n;
+
+    for (i = 0; i < e->ncolumns; ++i)
+        total += e->colcost[i] + 1.0;
+    target = total / (nthreads * CHUNKS_PER_THREAD);
+
+    n = 0;
+    e->chunks[0] = 0;
+    cost = 0.0;
+    for (i = 0; i < e->ncolumns - 1; ++i) {
+        cost += e->colcost[i] + 1.0;
+        if (cost >= target) {
+            e->chunks[++n] = i + 1;
+            cost = 0.0;
+        }
+    }
+    e->chunks[++n] = e->ncolumns;
+    e->nchunks = n;
 }
+#endif
 
-static void pth_free(pthstuff* pth, int thread_index)
+#if (NCPU > 1)
+static void column_step_chunk(ecology* e, int c)
 {
-    pthread_mutex_lock(&pth->avail_lock);
-    pth->navail++;
-    pth->avail[thread_index] = 1;
-    pthread_cond_signal(&pth->have_avail);
-    pthread_mutex_unlock(&pth->avail_lock);
+    int i;
+
+    for (i = e->chunks[c]; i < e->chunks[c + 1]; ++i) {
+        column* col;
+
+        if (einterface_isboundarycolumn(e->model, i))
+            continue;
+        col = column_get(e, i);
+        column_step(col);
+    }
 }
 
-static void* column_step_pth(void* p)
+/** Runs a step on the thread pool and waits for it to finish.
+ * @param e Pointer to ecology
+ */
+static void pth_step(ecology* e)
 {
-    pthargs* args = (pthargs*) p;
-    column* col = column_create(args->e, args->column_index);
-
-    column_step(col);
-    column_destroy(col);
+    pthstuff* pth = e->pth;
+    int i;
 
-    pth_free(args->e->pth, args->thread_index);
+    ecology_build_chunks(e, NCPU);
+    for (i = 0; i < NCPU; ++i) {
+        pth->queues[i].head = i * e->nchunks / NCPU;
+        pth->queues[i].tail = (i + 1) * e->nchunks / NCPU;
+    }
 
-    return NULL;
+    pthread_mutex_lock(&pth->pool_lock);
+    pth->nbusy = NCPU;
+    pth->generation++;
+    pthread_cond_broadcast(&pth->have_work);
+    while (pth->nbusy > 0)
+        pthread_cond_wait(&pth->have_done, &pth->pool_lock);
+    pthread_mutex_unlock(&pth->pool_lock);
 }
 #endif
 
@@ -1123,14 +1304,12 @@ static void* column_step_pth(void* p)
     if (einterface_isboundarycolumn(e->model, i))
         continue;
     /*
-     * We create columns at each ecology step rather than once because
-     * this results in dynamic mapping, taking account of cell wetting or
-     * drying, and because this is not too expensive compared with
-     * integration.
+     * Columns are kept in a pool between ecology steps. They are
+     * remapped each step, and only rebuilt if cell wetting or drying
+     * has changed the column topology.
      */
-    col = column_create(e, i);
+    col = column_get(e, i);
     column_step(col);
-    column_destroy(col);
     }
 
  }
@@ -1148,10 +1327,10 @@ int eco_get_nstep(ecology *e)
  */
 void ecology_step(ecology* e, double dt)
 {
-#if (NCPU > 1)
-    pthstuff* pth = e->pth;
+    int i;
+#if (NCPU == 1) && defined(HAVE_OMP)
+    int c;
 #endif
-    int i,j;
 
     /*
      * Now that we are using vca2, we cannot precompute the number or
@@ -1180,10 +1359,18 @@ void ecology_step(ecology* e, double dt)
     
 #if (NCPU == 1)
 #ifdef HAVE_OMP
+    /*
+     * Columns are handed out in chunks of about equal integration cost
+     * rather than equal number.
+     */
+    ecology_build_chunks(e, e->omp_num_threads);
     omp_set_nested(1);
-#pragma omp parallel for private(i) num_threads(e->omp_num_threads),schedule(dynamic,1000)
-#endif
+#pragma omp parallel for private(i) num_threads(e->omp_num_threads),schedule(dynamic,1)
+    for (c = 0; c < e->nchunks; ++c)
+    for (i = e->chunks[c]; i < e->chunks[c + 1]; ++i) {
+#else
     for (i = 0; i < e->ncolumns; ++i) {
+#endif
       column* col;
       /* 
        * Unlike sediments, we're not actually keying of this flag just yet
@@ -1203,48 +1390,18 @@ void ecology_step(ecology* e, double dt)
       }
 
       /*
-       * We create columns at each ecology step rather than once because
-       * this results in dynamic mapping, taking account of cell wetting or
-       * drying, and because this is not too expensive compared with
-       * the integration.
+       * Columns are kept in a pool between ecology steps. They are
+       * remapped each step, and only rebuilt if cell wetting or drying
+       * has changed the column topology.
        */
-      col = column_create(e, i);
+      col = column_get(e, i);
       if (!column_step(col))
 	einterface_log_error(e, e->model, col->b);
-      
-      column_destroy(col);
     }
 
 #else
     if (e->multithreaded) {
-        for (i = 0; i < e->ncolumns; ++i) {
-            pthargs* args;
-            int j;
-
-            if (einterface_isboundarycolumn(e->model, i))
-                continue;
-
-            pthread_mutex_lock(&pth->avail_lock);
-            if (pth->navail == 0)
-                pthread_cond_wait(&pth->have_avail, &pth->avail_lock);
-            pth->navail--;
-
-            for (j = 0; j < NCPU; ++j)
-                if (pth->avail[j] == 1)
-                    break;
-
-            assert(j < NCPU);
-            pth->avail[j] = 0;
-            pthread_mutex_unlock(&pth->avail_lock);
-
-            args = &pth->args[j];
-            args->e = e;
-            args->thread_index = j;
-            args->column_index = i;
-            pthread_create(&pth->threads[j], &pth->thread_attr, column_step_pth, args);
-        }
-
-        pth_finish(pth);
+        pth_step(e);
     } else {
         for (i = 0; i < e->ncolumns; ++i) {
             column* col;
@@ -1252,14 +1409,12 @@ void ecology_step(ecology* e, double dt)
             if (einterface_isboundarycolumn(e->model, i))
                 continue;
     /*
-         * We create columns at each ecology step rather than once because
-         * this results in dynamic mapping, taking account of cell wetting or
-         * drying, and because this is not too expensive compared with
-         * the integration.
+         * Columns are kept in a pool between ecology steps. They are
+         * remapped each step, and only rebuilt if cell wetting or drying
+         * has changed the column topology.
          */
-            col = column_create(e, i);
+            col = column_get(e, i);
             column_step(col);
-            column_destroy(col);
         }
     }
 #endif
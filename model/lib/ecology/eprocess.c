@@ -139,6 +139,7 @@ eprocess* eprocess_create(ecology* e, EPROCESSTYPE type, char* entry)
             p->precalc = pe->precalc;
             p->calc = pe->calc;
             p->postcalc = pe->postcalc;
+            p->calc_batch = pe->calc_batch;
             break;
         }
     }
@@ -91,6 +91,12 @@ struct cell {
  */
 cell* cell_create(column* col, CELLTYPE ct, int k, int k_wc, int k_sed);
 
+/** Updates a cell for a new step after its column has been remapped
+ * to the host model with no change in topology.
+ * @param c Pointer to cell
+ */
+void cell_update(cell* c);
+
 /** Cell destructor.
  * @param c Pointer to cell
  */
@@ -108,6 +114,13 @@ void cell_precalc(cell* c);
  */
 int cell_calc(cell* c);
 
+/** Integration loop for a batch of cells of the same type and dimension.
+ * @param cells Cells to integrate
+ * @param nc Number of cells
+ * @return 0 for fail, 1 for success
+ */
+int cell_calc_batch(cell** cells, int nc);
+
 /** Runs postcalc procedures for the cell (those to be performed after the
  * integration loop).
  * @param c Pointer to cell
@@ -27,6 +27,16 @@ struct column {
     void* model;                /* host model */
 
     int b;                      /* column index */
+    /*
+     * k range in the host model, empty layers included 
+     */
+    int ktop_wc;
+    int kbot_wc;
+    int ktop_sed;
+    int kbot_sed;
+    /*
+     * k range of non-empty cells 
+     */
     int topk_wc;
     int botk_wc;
     int topk_sed;
@@ -81,6 +91,20 @@ struct intargs {
  */
 column* column_create(ecology* e, int i);
 
+/** Remaps an existing column to the host model for a new step.
+ * @param col Pointer to column
+ * @return 1 if the column can be reused, 0 if it must be rebuilt
+ */
+int column_update(column* col);
+
+/** Returns the column for a given index from the ecology column pool,
+ * creating or rebuilding it if required.
+ * @param e Pointer to ecology structure.
+ * @param b Column (box) index.
+ * @return Pointer to the column structure.
+ */
+column* column_get(ecology* e, int b);
+
 /** Column destructor.
  * @param col Pointer to column
  */
@@ -47,6 +47,7 @@
 #define MANDATORY_WATER_DEF 0
 #define MANDATORY_SEDIMENT_DEF 1
 #define CHECK_NANS_DEF 0
+#define BATCH_CALC_DEF 0
 #define CHECK_NEGS_DEF 0
 #define VERIFY_DIAGN_EXTERN_DEF 0
 #define VERIFY_DIAGN_INTERN_DEF 1
@@ -57,6 +58,7 @@
 #ifdef HAVE_OMP
 #define OMP_NUM_THREADS_DEF 1
 #endif
+#define CHUNKS_PER_THREAD 8
 
 #define ISDEBUG() (is_log_enabled(LDEBUG))
 
@@ -75,45 +77,62 @@ typedef struct {
 #if (NCPU > 1)
 typedef struct {
     ecology* e;
-    int column_index;
     int thread_index;
 } pthargs;
 
+/*
+ * Queue of column chunks handed to a pool thread for a step. The owner
+ * takes chunks from the head; idle threads steal from the tail.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    int head;                   /* next chunk to run */
+    int tail;                   /* one past the last chunk */
+} pthqueue;
+
 typedef struct {
-    /*
-     * Posix thread initialisation structure used to create a thread.
-     */
-    pthread_attr_t thread_attr;
     /*
      * Posix mutex used to lock ecostats.
      */
     pthread_mutex_t stats_lock;
     /*
-     * Posix mutex used to lock thread counter.
+     * Posix mutex used to lock the pool state below.
      */
-    pthread_mutex_t avail_lock;
+    pthread_mutex_t pool_lock;
     /*
-     * Posix condition used to suspend thread requests if navail = 0. Also
-     * used at waiting for all threads to finish at the end of
-     * ecology_step().
+     * Posix condition used to wake the threads when a step is posted or
+     * the pool is shut down.
      */
-    pthread_cond_t have_avail;
+    pthread_cond_t have_work;
     /*
-     * Number of available threads; 0 <= navail <= NCPU
+     * Posix condition used to wake ecology_step() when the last thread
+     * has finished the step.
      */
-    int navail;
+    pthread_cond_t have_done;
     /*
-     * Status of columns: not 0 - available, 0 - not available.
+     * Step counter; incremented to post a new step to the threads.
      */
-    int avail[NCPU];
+    int generation;
     /*
-     * Threads to run column_step().
+     * Number of threads still working on the current step
+     */
+    int nbusy;
+    /*
+     * Flag: set to shut the threads down
+     */
+    int quit;
+    /*
+     * Persistent threads to run column_step().
      */
     pthread_t threads[NCPU];
     /*
-     * Information for launching a particular thread
+     * Information for a particular thread
      */
     pthargs args[NCPU];
+    /*
+     * Chunk queue of each thread
+     */
+    pthqueue queues[NCPU];
 } pthstuff;
 #endif
 
@@ -240,7 +259,16 @@ struct ecology {
     integrator eint;
     double precision;
     double* h0;                 /* initial step size */
-
+    column** columns;           /* column pool [0..max_ncolumns-1]; kept
+                                 * between steps */
+    double* colcost;            /* flux evaluations per column in the
+                                 * last step [0..max_ncolumns-1] */
+    int* chunks;                /* column chunk boundaries for the
+                                 * threaded step [0..nchunks] */
+    int nchunks;
+
+    int batch_calc;             /* flag: integrate runs of cells of the
+                                 * same type in a column together */
     int check_nans;             /* flag */
     int check_negs;             /* flag */
     int verify_diagn;           /* flag */
@@ -61,6 +61,13 @@ extern char* eprocess_type_tags[];
 typedef void (*eprocess_initfn) (eprocess* p);
 typedef void (*eprocess_calcfn) (eprocess* p, void* pp);
 
+/* Optional flux procedure for a batch of nl cells of the same type,
+ * integrated together (see cell_calc_batch()). The tracer state and fluxes
+ * are interleaved by lane, y[i * nl + l], and only lanes with active[l]
+ * set may be written. Must give the same fluxes as calc for each lane.
+ */
+typedef void (*eprocess_batchfn) (eprocess* p, int nl, int* active, double* t, cell** cells, double* y, double* y1);
+
 struct eprocess {
     ecology* ecology;
     EPROCESSTYPE type;
@@ -75,6 +82,7 @@ struct eprocess {
     eprocess_calcfn precalc;
     eprocess_calcfn calc;
     eprocess_calcfn postcalc;
+    eprocess_batchfn calc_batch;
 
     void* workspace;
 };
@@ -92,6 +100,7 @@ typedef struct {
     eprocess_calcfn precalc;
     eprocess_calcfn calc;
     eprocess_calcfn postcalc;
+    eprocess_batchfn calc_batch; /* optional, NULL if not given */
 } eprocess_entry;
 
 /* Global process list -- see "allprocesses.c".
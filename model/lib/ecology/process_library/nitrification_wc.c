@@ -141,3 +141,39 @@ void nitrification_wc_calc(eprocess* p, void* pp)
 void nitrification_wc_postcalc(eprocess* p, void* pp)
 {
 }
+
+/*
+ * Batched form of nitrification_wc_calc(); y and y1 are interleaved by
+ * lane (see eprocess_batchfn).
+ */
+void nitrification_wc_calc_batch(eprocess* p, int nl, int* active, double* t, cell** cells, double* y, double* y1)
+{
+  workspace* ws = p->workspace;
+  double* NH4 = &y[ws->NH4_i * nl];
+  double* Oxygen = &y[ws->Oxygen_i * nl];
+  double* dNH4 = &y1[ws->NH4_i * nl];
+  double* dNO3 = &y1[ws->NO3_i * nl];
+  double* dOxygen = &y1[ws->Oxygen_i * nl];
+  double* dNH4_pr = (ws->NH4_pr_i > -1) ? &y1[ws->NH4_pr_i * nl] : NULL;
+  double* dOxy_pr = (ws->Oxy_pr_i > -1) ? &y1[ws->Oxy_pr_i * nl] : NULL;
+  int l;
+
+  for (l = 0; l < nl; ++l) {
+    double Oxy, Nitrification;
+
+    if (!active[l])
+      continue;
+
+    Oxy = e_max(Oxygen[l]);
+    Nitrification = cells[l]->cv[ws->r_nit_wc_i] * NH4[l] * Oxy / (ws->KO_Nit + Oxy);
+
+    dNH4[l] -= Nitrification;
+    dNO3[l] += Nitrification;
+    dOxygen[l] -= Nitrification * 48.0/14.01 ;
+
+    if (dNH4_pr != NULL)
+      dNH4_pr[l] -= Nitrification * SEC_PER_DAY;
+    if (dOxy_pr != NULL)
+      dOxy_pr[l] -= Nitrification * 48.0/14.01 * SEC_PER_DAY;
+  }
+}
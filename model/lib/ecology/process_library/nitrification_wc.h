@@ -24,6 +24,7 @@ void nitrification_wc_destroy(eprocess* p);
 void nitrification_wc_precalc(eprocess* p, void* pp);
 void nitrification_wc_calc(eprocess* p, void* pp);
 void nitrification_wc_postcalc(eprocess* p, void* pp);
+void nitrification_wc_calc_batch(eprocess* p, int nl, int* active, double* t, cell** cells, double* y, double* y1);
 
 #define _NITRIFICATION_WC_H
 #endif
@@ -0,0 +1,140 @@
+/*
+ * Test of the local analysis of the DA library (da_obj.cpp)
+ *
+ * Sets up a small state of NX x NY water columns of NZ layers with a
+ * random anomaly field and background, and observations at random
+ * rows. The analysis is done globally (DA_LS localisation), then
+ * locally with a radius covering every observation, which should give
+ * the same answer to rounding. The local analysis with a smaller
+ * radius is then done on one thread and on NTHREADS, which should be
+ * identical.
+ *
+ * Usage: local
+ * Exits with a non-zero status if any test fails.
+ */
+
+#include <list>
+#include <vector>
+#include <string>
+using namespace std;
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <gsl/gsl_matrix.h>
+#include "ems.h"
+#include "da_utils.hpp"
+#include "da_obj.hpp"
+
+#define NX 8
+#define NY 6
+#define NZ 3
+#define NROWS (NX * NY * NZ)
+#define NMEM 20
+#define NOBS 30
+#define DX 0.1                  /* Column spacing, degrees */
+#define LS 0.3                  /* DA_LS */
+#define TOL 1e-9
+
+/* The observations, handed out on each read                         */
+static list<da_obs_exec> obs_all;
+
+/*
+ * Observations held in memory. No data members are added to da_obs,
+ * which da_obj deletes through a base pointer.
+ */
+class test_obs : public da_obs
+{
+public:
+  virtual list<da_obs_exec> & read_obs(double t, da_maps *maps) {
+    f_obs_list = obs_all;
+    return(f_obs_list);
+  }
+};
+
+static double urand(void)
+{
+  return(rand() / (double)RAND_MAX - 0.5);
+}
+
+/* Builds the DA object with the local analysis radius and threads   */
+static da_obj *build(double radius, int nthreads)
+{
+  da_obj *obj = new da_obj(LS);
+  int r, m;
+
+  obj->allocA(NROWS, NMEM);
+  srand(1);
+  for (r = 0; r < NROWS; r++) {
+    int c = r % (NX * NY);
+    obj->set_wb(r, 20.0 + urand());
+    obj->set_xy(r, 150.0 + DX * (c % NX), -20.0 + DX * (c / NX));
+    for (m = 0; m < NMEM; m++)
+      obj->fillA(r, m, urand());
+  }
+  obj->add_obs(new test_obs());
+  obj->read_all_obs(0.0);
+  obj->set_local(radius, nthreads);
+  return(obj);
+}
+
+/* Largest difference of the analyses                                */
+static double compare(da_obj *a, da_obj *b)
+{
+  double dmax = 0.0;
+  int r;
+
+  for (r = 0; r < NROWS; r++) {
+    double d = fabs(a->get_wa(r) - b->get_wa(r));
+    if (d > dmax) dmax = d;
+  }
+  return(dmax);
+}
+
+int main(int argc, char *argv[])
+{
+  da_obj *glob, *all, *loc1, *locn;
+  double d;
+  int n, err = 0;
+
+  /* Observations at random rows, at the location of the row         */
+  srand(2);
+  for (n = 0; n < NOBS; n++) {
+    da_obs_exec o;
+    int c;
+    o.f_gs = rand() % NROWS;
+    c = o.f_gs % (NX * NY);
+    o.f_x = 150.0 + DX * (c % NX);
+    o.f_y = -20.0 + DX * (c / NX);
+    o.f_val = 20.0 + urand();
+    o.f_err = 0.01;
+    obs_all.push_back(o);
+  }
+
+  /* 1 : a radius covering every observation gives the global answer */
+  glob = build(0.0, 1);
+  all = build(10.0 * DX * (NX + NY), 1);
+  glob->do_analysis();
+  all->do_analysis();
+  d = compare(glob, all);
+  printf("test 1 : local (all observations) against global : "
+	 "max difference %8.2e : %s\n", d, (d <= TOL) ? "PASS" : "FAIL");
+  err |= (d > TOL);
+
+  /* 2 : the local analysis is the same on 1 and 4 threads           */
+  loc1 = build(2.0 * DX, 1);
+  locn = build(2.0 * DX, 4);
+  loc1->do_analysis();
+  locn->do_analysis();
+  d = compare(loc1, locn);
+  printf("test 2 : local on 4 threads against 1 : "
+	 "max difference %8.2e : %s\n", d, (d == 0.0) ? "PASS" : "FAIL");
+  err |= (d != 0.0);
+
+  delete(glob);
+  delete(all);
+  delete(loc1);
+  delete(locn);
+  return(err ? 1 : 0);
+}
+
+// EOF
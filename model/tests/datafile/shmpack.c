@@ -0,0 +1,176 @@
+/*
+ * Test of the shared memory memory packets (shmpack) in datafile.c
+ *
+ * test 1 : a writer and two slow readers. Each reader checks that
+ *          every value of the record it holds is the record time, also
+ *          after a pause, so a slot overwritten while held is caught.
+ * test 2 : one more reader than the segment supports is rejected.
+ * test 3 : a reader stops with an error when the writer restarts.
+ *
+ * Usage: shmpack
+ * Exits with a non-zero status if any test fails.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "ems.h"
+
+/* Located in datafile.c */
+extern int shmpack_read_file(char *mpname, datafile_t *df);
+extern void shmpack_wait(datafile_t *df);
+extern void shmpack_release(df_mempack_t *mp);
+
+#define NAME "test_shmpack.shm"
+#define NP 10
+#define NZ 4
+#define NREC 40
+#define NREADER 8               /* SHMPACK_NREADER in datafile.c */
+
+/*
+ * Publishes records first..last, pausing hold seconds after the first
+ * so that the readers attach, then running faster than the readers.
+ */
+static void writer(int first, int last, int hold)
+{
+  df_mempack_t mp;
+  int n = 2 * NP + NZ, k, i;
+
+  memset(&mp, 0, sizeof(df_mempack_t));
+  mp.npoints = NP;
+  mp.nz = NZ;
+  mp.n2d = 1;
+  mp.n3d = 1;
+  mp.dt = 1.0;
+  strcpy(mp.tunits, "seconds since 2000-01-01 00:00:00 +00");
+  strcpy(mp.xyzunits, "m m m");
+  strcpy(mp.vars, "eta temp");
+  strcpy(mp.units, "m degC");
+  mp.xyz = d_alloc_1d(n);
+  mp.v2d = d_alloc_1d(NP);
+  mp.v3d = d_alloc_1d(NP * NZ);
+
+  for (k = first; k <= last; k++) {
+    for (i = 0; i < n; i++) mp.xyz[i] = k;
+    for (i = 0; i < NP; i++) mp.v2d[i] = k;
+    for (i = 0; i < NP * NZ; i++) mp.v3d[i] = k;
+    mp.time = k;
+    shmpack_write(&mp, NAME);
+    if (k == first && hold) sleep(hold);
+    usleep(500);
+  }
+  shmpack_close(&mp);
+  exit(0);
+}
+
+/* Returns the number of values of the held record that are wrong */
+static int check(df_mempack_t *mp)
+{
+  int n = 2 * NP + NZ, i, nerr = 0;
+
+  for (i = 0; i < n; i++) nerr += (mp->xyz[i] != mp->time);
+  for (i = 0; i < NP; i++) nerr += (mp->v2d[i] != mp->time);
+  for (i = 0; i < NP * NZ; i++) nerr += (mp->v3d[i] != mp->time);
+  return(nerr);
+}
+
+/* Reads records until the last, checking each one held */
+static void reader(int last)
+{
+  datafile_t df;
+  df_mempack_t *mp;
+  int nerr = 0;
+
+  memset(&df, 0, sizeof(datafile_t));
+  mp = (df_mempack_t *)calloc(1, sizeof(df_mempack_t));
+  strcpy(mp->id, NAME);
+  df.private_data = mp;
+  df.type = DFT_SHMPACK;
+
+  shmpack_read_file(NAME, &df);
+  while (mp->time < last) {
+    shmpack_wait(&df);
+    shmpack_read_file(NAME, &df);
+    nerr += check(mp);
+    usleep(2000);
+    nerr += check(mp);
+  }
+  shmpack_release(mp);
+  shmpack_close(mp);
+  exit(nerr ? 1 : 0);
+}
+
+/* Starts a process running f(a, b, c) */
+static pid_t start(void (*f)(int, int, int), int a, int b, int c)
+{
+  pid_t pid = fork();
+  if (pid == 0) f(a, b, c);
+  return(pid);
+}
+
+static void reader3(int last, int b, int c)
+{
+  reader(last);
+}
+
+/* Waits for n processes, returning the number that failed */
+static int nfailed(pid_t *pid, int n)
+{
+  int i, status, nf = 0;
+
+  for (i = 0; i < n; i++) {
+    waitpid(pid[i], &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) nf++;
+  }
+  return(nf);
+}
+
+int main(int argc, char *argv[])
+{
+  pid_t w, r[NREADER + 1];
+  int i, nf, err = 0;
+
+  /* 1 : two slow readers never see a record overwritten           */
+  shm_unlink("/" NAME);
+  w = start(writer, 1, NREC, 1);
+  for (i = 0; i < 2; i++)
+    r[i] = start(reader3, NREC, 0, 0);
+  nf = nfailed(r, 2) + nfailed(&w, 1);
+  printf("test 1 : two readers : %s\n", nf ? "FAIL" : "PASS");
+  fflush(stdout);
+  err |= nf;
+
+  /* 2 : a reader beyond NREADER is rejected                       */
+  shm_unlink("/" NAME);
+  w = start(writer, 1, NREC, 2);
+  for (i = 0; i <= NREADER; i++)
+    r[i] = start(reader3, NREC, 0, 0);
+  nf = nfailed(r, NREADER + 1);
+  nfailed(&w, 1);
+  printf("test 2 : %d readers, %d rejected : %s\n", NREADER + 1, nf,
+	 (nf == 1) ? "PASS" : "FAIL");
+  fflush(stdout);
+  err |= (nf != 1);
+
+  /* 3 : a reader stops when the writer restarts                   */
+  shm_unlink("/" NAME);
+  w = start(writer, 1, 3, 0);
+  r[0] = start(reader3, NREC, 0, 0);
+  nfailed(&w, 1);
+  sleep(2);
+  w = start(writer, 1, 3, 0);
+  nfailed(&w, 1);
+  nf = nfailed(r, 1);
+  printf("test 3 : writer restart detected : %s\n", nf ? "PASS" : "FAIL");
+  fflush(stdout);
+  err |= (nf != 1);
+
+  shm_unlink("/" NAME);
+  return(err ? 1 : 0);
+}
+
+// EOF
@@ -0,0 +1,178 @@
+/*
+ * Test of the cached unstructured interpolation weights in dfeval.c
+ *
+ * Writes a small UGRID file with a 2D and a 3D variable on a jittered
+ * set of nodes, then evaluates both at points between the nodes,
+ * between the records and between the layers. Each variable is
+ * evaluated with the cached weights (the default for the linear and
+ * natural neighbour rules) and, from a second copy of the file with
+ * the weights freed after the first evaluation, by rebuilding the
+ * Grid Spec interpolators. The bottom layer of the 3D variable has no
+ * data and one layer is partly missing.
+ *
+ * Usage: usweights
+ * Exits with a non-zero status if any rule differs by more than TOL.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "ems.h"
+
+#define NAME "test_usweights.nc"
+#define NX 12
+#define NN (NX * NX)
+#define NZ 4
+#define NREC 3
+#define NPT 200
+#define TOL 1e-10
+
+static char *rules[] = {"linear", "nn_sibson", "nn_non_sibson",
+			"nna_sibson", "nna_non_sibson"};
+#define NRULES (int)(sizeof(rules) / sizeof(char *))
+
+static double zgrid[NZ] = {-30.0, -20.0, -10.0, -2.0};
+
+/* Writes the UGRID file                                             */
+static void write_file(void)
+{
+  int fid, dt, dn, dk, vt, vx, vy, vz, ve, vs, dims[3];
+  double x[NN], y[NN], eta[NN], temp[NZ * NN], t;
+  size_t start[3], count[3];
+  int i, k, r;
+
+  for (i = 0; i < NN; i++) {
+    x[i] = (i % NX) + 0.3 * rand() / (double)RAND_MAX;
+    y[i] = (i / NX) + 0.3 * rand() / (double)RAND_MAX;
+  }
+
+  nc_create(NAME, NC_CLOBBER, &fid);
+  nc_def_dim(fid, "time", NC_UNLIMITED, &dt);
+  nc_def_dim(fid, "k", NZ, &dk);
+  nc_def_dim(fid, "node", NN, &dn);
+  nc_def_var(fid, "time", NC_DOUBLE, 1, &dt, &vt);
+  nc_put_att_text(fid, vt, "units", 36,
+		  "days since 2000-01-01 00:00:00 +00");
+  nc_def_var(fid, "x", NC_DOUBLE, 1, &dn, &vx);
+  nc_put_att_text(fid, vx, "coordinate_type", 1, "X");
+  nc_put_att_text(fid, vx, "units", 5, "metre");
+  nc_def_var(fid, "y", NC_DOUBLE, 1, &dn, &vy);
+  nc_put_att_text(fid, vy, "coordinate_type", 1, "Y");
+  nc_put_att_text(fid, vy, "units", 5, "metre");
+  nc_def_var(fid, "z", NC_DOUBLE, 1, &dk, &vz);
+  nc_put_att_text(fid, vz, "coordinate_type", 1, "Z");
+  nc_put_att_text(fid, vz, "units", 5, "metre");
+  dims[0] = dt;
+  dims[1] = dn;
+  nc_def_var(fid, "eta", NC_DOUBLE, 2, dims, &ve);
+  nc_put_att_text(fid, ve, "coordinates", 10, "time, x, y");
+  dims[1] = dk;
+  dims[2] = dn;
+  nc_def_var(fid, "temp", NC_DOUBLE, 3, dims, &vs);
+  nc_put_att_text(fid, vs, "coordinates", 13, "time, z, x, y");
+  nc_put_att_text(fid, NC_GLOBAL, "Conventions", 9, "UGRID-1.0");
+  nc_enddef(fid);
+
+  nc_put_var_double(fid, vx, x);
+  nc_put_var_double(fid, vy, y);
+  nc_put_var_double(fid, vz, zgrid);
+  for (r = 0; r < NREC; r++) {
+    t = r;
+    start[0] = r;
+    count[0] = 1;
+    nc_put_var1_double(fid, vt, start, &t);
+    for (i = 0; i < NN; i++) {
+      eta[i] = sin(x[i] + r) * cos(y[i]) + 0.1 * rand() / (double)RAND_MAX;
+      for (k = 0; k < NZ; k++) {
+	if (k == 0 || (k == 2 && (i % 7) == 0))
+	  temp[k * NN + i] = NaN;
+	else
+	  temp[k * NN + i] = 20.0 + k + cos(x[i] * y[i] + r) +
+	    0.1 * rand() / (double)RAND_MAX;
+      }
+    }
+    start[1] = start[2] = 0;
+    count[1] = NN;
+    nc_put_vara_double(fid, ve, start, count, eta);
+    count[1] = NZ;
+    count[2] = NN;
+    nc_put_vara_double(fid, vs, start, count, temp);
+  }
+  nc_close(fid);
+}
+
+/* Differences of two evaluations, NaN in both counting as equal     */
+static double diff(double a, double b)
+{
+  if (isnan(a) && isnan(b))
+    return(0.0);
+  if (isnan(a) || isnan(b))
+    return(HUGE);
+  return(fabs(a - b));
+}
+
+/*
+ * Evaluates variable var of a copy of the file with rule, with the
+ * cached weights (rebuild = 0) or rebuilding the interpolators.
+ */
+static void evaluate(char *rule, char *var, int rebuild, double *val)
+{
+  timeseries_t ts;
+  df_variable_t *v;
+  int id, n;
+
+  memset(&ts, 0, sizeof(timeseries_t));
+  ts_read(NAME, &ts);
+  strcpy(ts.df->i_rule, rule);
+  id = ts_get_index(&ts, var);
+  v = df_get_variable(ts.df, id);
+
+  /* The interpolators are built on the first evaluation, after      */
+  /* which freeing the weights leaves the rebuild path.              */
+  if (rebuild) {
+    if (strcmp(var, "eta") == 0)
+      ts_eval_xy(&ts, id, 0.0, NX / 2.0, NX / 2.0);
+    else
+      ts_eval_xyz(&ts, id, 0.0, NX / 2.0, NX / 2.0, -5.0);
+    df_free_us_weights(v);
+  }
+
+  srand(2);
+  for (n = 0; n < NPT; n++) {
+    double t = (NREC - 1) * rand() / (double)RAND_MAX;
+    double x = 1.0 + (NX - 3) * rand() / (double)RAND_MAX;
+    double y = 1.0 + (NX - 3) * rand() / (double)RAND_MAX;
+    double z = -35.0 + 35.0 * rand() / (double)RAND_MAX;
+    if (strcmp(var, "eta") == 0)
+      val[n] = ts_eval_xy(&ts, id, t, x, y);
+    else
+      val[n] = ts_eval_xyz(&ts, id, t, x, y, z);
+  }
+  ts_free(&ts);
+}
+
+int main(int argc, char *argv[])
+{
+  double cached[NPT], rebuilt[NPT];
+  char *vars[] = {"eta", "temp"};
+  int i, j, n, err = 0;
+
+  write_file();
+  for (j = 0; j < 2; j++) {
+    for (i = 0; i < NRULES; i++) {
+      double dmax = 0.0;
+      evaluate(rules[i], vars[j], 0, cached);
+      evaluate(rules[i], vars[j], 1, rebuilt);
+      for (n = 0; n < NPT; n++)
+	dmax = max(dmax, diff(cached[n], rebuilt[n]));
+      printf("%-4s %-14s : max difference %8.2e : %s\n", vars[j], rules[i],
+	     dmax, (dmax <= TOL) ? "PASS" : "FAIL");
+      err |= (dmax > TOL);
+    }
+  }
+  unlink(NAME);
+  return(err ? 1 : 0);
+}
+
+// EOF